@@ -0,0 +1,315 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Scripted restic stand-in for benchmarks.
+   Built as "restic.exe" into a private directory that the benchmark host puts
+   first on PATH. Serves a deterministic synthetic repository: one backup path
+   (C:\bench\data) with FAKE_RESTIC_SNAPSHOTS snapshots, each a tree of
+   FAKE_RESTIC_DEPTH levels with FAKE_RESTIC_FANOUT subdirectories and
+   FAKE_RESTIC_FILES files per directory. Files change every 4 snapshots so
+   version listings have more than one entry.
+
+   Supported: snapshots [--json], ls --json <id>, find --json --path <p> <file>,
+   dump <id> <path>, restore, rewrite (no-ops). FAKE_RESTIC_LATENCY_MS adds a
+   fixed startup delay to model restic loading the repository index. */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L  /* nanosleep */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <time.h>
+#endif
+
+#define BACKUP_PATH_JSON  "C:\\\\bench\\\\data"
+#define BACKUP_PREFIX     "/C/bench/data"
+
+static int g_Snapshots = 20;
+static int g_Depth = 6;
+static int g_Fanout = 3;
+static int g_Files = 10;
+
+static int EnvInt(const char* name, int def) {
+    const char* v = getenv(name);
+    if (!v || !*v) return def;
+    return atoi(v);
+}
+
+static void SleepMs(int ms) {
+    if (ms <= 0) return;
+#ifdef _WIN32
+    Sleep((DWORD)ms);
+#else
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/* Days since 1970-01-01 -> civil date (Howard Hinnant's algorithm) */
+static void CivilFromDays(long z, int* y, int* m, int* d) {
+    long era, yoe, doy, mp;
+    z += 719468;
+    era = (z >= 0 ? z : z - 146096) / 146097;
+    yoe = z - era * 146097;
+    *y = (int)(yoe - yoe / 1460 + yoe / 36524 - yoe / 146096) / 365;
+    doy = yoe - (365 * (long)*y + *y / 4 - *y / 100);
+    mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = (int)(*y + era * 400 + (*m <= 2));
+}
+
+/* 2025-01-01 is day 20089 since the epoch */
+#define BASE_DAY 20089L
+
+static void FormatTime(long day, int hour, char* out, size_t maxLen) {
+    int y, m, d;
+    CivilFromDays(day, &y, &m, &d);
+    snprintf(out, maxLen, "%04d-%02d-%02dT%02d:00:00.000000000Z", y, m, d, hour);
+}
+
+/* Deterministic 64-char hex snapshot ID */
+static void SnapshotId(int idx, char* out) {
+    unsigned int h = 2166136261u;
+    int i;
+    for (i = 0; i < 8; i++) {
+        h ^= (unsigned int)(idx + i * 31);
+        h *= 16777619u;
+        snprintf(out + i * 8, 9, "%08x", h);
+    }
+    out[64] = '\0';
+}
+
+static int FindSnapshot(const char* prefix) {
+    char id[65];
+    int i;
+    size_t len = strlen(prefix);
+    for (i = 0; i < g_Snapshots; i++) {
+        SnapshotId(i, id);
+        if (len > 0 && strncmp(id, prefix, len) == 0) return i;
+    }
+    return -1;
+}
+
+/* File contents change every 4 snapshots */
+static int FileVersion(int snapIdx) { return snapIdx / 4; }
+
+static long long FileSize(int fileIdx, int version) {
+    return 1000 + (long long)((fileIdx * 37 + version * 13) % 5000);
+}
+
+static void CmdSnapshots(int json) {
+    int i;
+    char id[65], t[64];
+
+    if (!json) {
+        printf("ID        Time                 Host   Paths\n");
+        for (i = 0; i < g_Snapshots; i++) {
+            SnapshotId(i, id);
+            FormatTime(BASE_DAY + i, 10, t, sizeof(t));
+            printf("%.8s  %.19s  bench  C:\\bench\\data\n", id, t);
+        }
+        return;
+    }
+
+    printf("[");
+    for (i = 0; i < g_Snapshots; i++) {
+        SnapshotId(i, id);
+        FormatTime(BASE_DAY + i, 10, t, sizeof(t));
+        printf("%s{\"time\":\"%s\",\"tree\":\"%s\",\"paths\":[\"%s\"],"
+               "\"hostname\":\"bench\",\"username\":\"bench\",\"id\":\"%s\",\"short_id\":\"%.8s\"}",
+               i ? "," : "", t, id, BACKUP_PATH_JSON, id, id);
+    }
+    printf("]\n");
+}
+
+static void PrintDirNode(const char* path, const char* name, const char* mtime) {
+    printf("{\"name\":\"%s\",\"type\":\"dir\",\"path\":\"%s\",\"uid\":0,\"gid\":0,"
+           "\"mode\":2147484141,\"permissions\":\"drwxr-xr-x\",\"mtime\":\"%s\","
+           "\"atime\":\"%s\",\"ctime\":\"%s\",\"struct_type\":\"node\"}\n",
+           name, path, mtime, mtime, mtime);
+}
+
+static void ListTree(const char* dirPath, int level, int version) {
+    char child[1024], mtime[64];
+    int k;
+
+    FormatTime(BASE_DAY + version * 4, 8, mtime, sizeof(mtime));
+
+    for (k = 0; k < g_Files; k++) {
+        snprintf(child, sizeof(child), "%s/file%d.txt", dirPath, k);
+        printf("{\"name\":\"file%d.txt\",\"type\":\"file\",\"path\":\"%s\",\"uid\":0,\"gid\":0,"
+               "\"size\":%lld,\"mode\":420,\"permissions\":\"-rw-r--r--\",\"mtime\":\"%s\","
+               "\"atime\":\"%s\",\"ctime\":\"%s\",\"struct_type\":\"node\"}\n",
+               k, child, FileSize(k, version), mtime, mtime, mtime);
+    }
+
+    if (level >= g_Depth) return;
+
+    for (k = 0; k < g_Fanout; k++) {
+        char name[32];
+        snprintf(name, sizeof(name), "dir%d", k);
+        snprintf(child, sizeof(child), "%s/%s", dirPath, name);
+        PrintDirNode(child, name, mtime);
+        ListTree(child, level + 1, version);
+    }
+}
+
+static int CmdLs(const char* snapPrefix) {
+    char id[65], t[64];
+    int idx = FindSnapshot(snapPrefix);
+    if (idx < 0) {
+        fprintf(stderr, "Fatal: no matching ID found for prefix \"%s\"\n", snapPrefix);
+        return 1;
+    }
+
+    SnapshotId(idx, id);
+    FormatTime(BASE_DAY + idx, 10, t, sizeof(t));
+    printf("{\"time\":\"%s\",\"tree\":\"%s\",\"paths\":[\"%s\"],\"hostname\":\"bench\","
+           "\"id\":\"%s\",\"short_id\":\"%.8s\",\"struct_type\":\"snapshot\"}\n",
+           t, id, BACKUP_PATH_JSON, id, id);
+
+    PrintDirNode("/C", "C", t);
+    PrintDirNode("/C/bench", "bench", t);
+    PrintDirNode(BACKUP_PREFIX, "data", t);
+    ListTree(BACKUP_PREFIX, 1, FileVersion(idx));
+    return 0;
+}
+
+/* Validate "/C/bench/data/dir0/dir2/file3.txt" against the synthetic layout.
+   Returns the file index or -1 if the path does not exist. */
+static int ParseFilePath(const char* path) {
+    const char* p;
+    int level = 1, k;
+
+    if (strncmp(path, BACKUP_PREFIX "/", strlen(BACKUP_PREFIX) + 1) != 0) return -1;
+    p = path + strlen(BACKUP_PREFIX) + 1;
+
+    while (strncmp(p, "dir", 3) == 0) {
+        k = atoi(p + 3);
+        if (k < 0 || k >= g_Fanout || level >= g_Depth) return -1;
+        p = strchr(p, '/');
+        if (!p) return -1;
+        p++;
+        level++;
+    }
+
+    if (sscanf(p, "file%d.txt", &k) != 1 || k < 0 || k >= g_Files) return -1;
+    return k;
+}
+
+static int CmdFind(const char* filePath) {
+    char id[65], mtime[64];
+    int i, fileIdx = ParseFilePath(filePath), first = 1;
+
+    printf("[");
+    if (fileIdx >= 0) {
+        for (i = g_Snapshots - 1; i >= 0; i--) {
+            int version = FileVersion(i);
+            SnapshotId(i, id);
+            FormatTime(BASE_DAY + version * 4, 8, mtime, sizeof(mtime));
+            printf("%s{\"matches\":[{\"path\":\"%s\",\"permissions\":\"-rw-r--r--\","
+                   "\"type\":\"file\",\"mode\":420,\"mtime\":\"%s\",\"atime\":\"%s\","
+                   "\"ctime\":\"%s\",\"uid\":0,\"gid\":0,\"size\":%lld}],"
+                   "\"hits\":1,\"snapshot\":\"%s\"}",
+                   first ? "" : ",", filePath, mtime, mtime, mtime,
+                   FileSize(fileIdx, version), id);
+            first = 0;
+        }
+    }
+    printf("]\n");
+    return 0;
+}
+
+static int CmdDump(const char* snapPrefix, const char* filePath) {
+    char block[4096];
+    long long size, written = 0;
+    int idx = FindSnapshot(snapPrefix);
+    int fileIdx = ParseFilePath(filePath);
+    size_t i;
+
+    if (idx < 0 || fileIdx < 0) {
+        fprintf(stderr, "Fatal: cannot dump file: path not found\n");
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(block); i++)
+        block[i] = (char)('a' + (i + (size_t)fileIdx) % 26);
+
+    size = FileSize(fileIdx, FileVersion(idx));
+    while (written < size) {
+        size_t chunk = (size - written) < (long long)sizeof(block)
+                     ? (size_t)(size - written) : sizeof(block);
+        fwrite(block, 1, chunk, stdout);
+        written += (long long)chunk;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int i = 1;
+    const char* cmd;
+    static char outBuf[1 << 16];
+
+#ifdef _WIN32
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+
+    g_Snapshots = EnvInt("FAKE_RESTIC_SNAPSHOTS", g_Snapshots);
+    g_Depth = EnvInt("FAKE_RESTIC_DEPTH", g_Depth);
+    g_Fanout = EnvInt("FAKE_RESTIC_FANOUT", g_Fanout);
+    g_Files = EnvInt("FAKE_RESTIC_FILES", g_Files);
+    SleepMs(EnvInt("FAKE_RESTIC_LATENCY_MS", 0));
+
+    /* Skip global options: -r <repo> */
+    while (i < argc && argv[i][0] == '-') {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) i++;
+        i++;
+    }
+    if (i >= argc) {
+        fprintf(stderr, "usage: restic -r <repo> <command> ...\n");
+        return 1;
+    }
+    cmd = argv[i++];
+
+    if (strcmp(cmd, "version") == 0) {
+        printf("restic 0.17.3 (fake) compiled for benchmarks\n");
+        return 0;
+    }
+    if (strcmp(cmd, "snapshots") == 0) {
+        CmdSnapshots(i < argc && strcmp(argv[i], "--json") == 0);
+        return 0;
+    }
+    if (strcmp(cmd, "ls") == 0) {
+        if (i < argc && strcmp(argv[i], "--json") == 0) i++;
+        return (i < argc) ? CmdLs(argv[i]) : 1;
+    }
+    if (strcmp(cmd, "find") == 0) {
+        /* find --json --path <path> <file> */
+        while (i < argc && argv[i][0] == '-') {
+            if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) i++;
+            i++;
+        }
+        return (i < argc) ? CmdFind(argv[i]) : 1;
+    }
+    if (strcmp(cmd, "dump") == 0) {
+        return (i + 1 < argc) ? CmdDump(argv[i], argv[i + 1]) : 1;
+    }
+    if (strcmp(cmd, "restore") == 0 || strcmp(cmd, "rewrite") == 0) {
+        return 0;
+    }
+
+    fprintf(stderr, "Fatal: unknown command \"%s\"\n", cmd);
+    return 1;
+}
@@ -0,0 +1,622 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Microbenchmarks for the snapshot ingest pipeline.
+   Measures each stage a cold snapshot visit goes through, in isolation:
+     parse   ParseLsOutputAll over synthetic `restic ls --json` NDJSON
+     group   BulkCacheSubdirectories minus the time spent inside LsCache_Store
+     store   LsCache_Store insert throughput while filling a DB to N rows
+     lookup  LsCache_Lookup read throughput against the N-row DB
+     lookup_index
+             the same reads served from the snapshot's mapped index file
+   at each requested size (default 1k, 100k and 10M rows). Reports entries/s
+   and bytes allocated per stage as JSON.
+
+   Allocation accounting: cJSON allocations are counted through
+   cJSON_InitHooks; SQLite via sqlite3_status64 high-water marks; plugin
+   arrays (ResticLsEntry, DirEntry) are added from their known sizes. The
+   stages allocate nothing through mem_budget.h (the plugin charges the
+   ingest to MEM_PARSE around them), so its counters are not reported.
+
+   parse/group hold every ResticLsEntry in memory (~600 bytes each), so they
+   run on at most --max-parse-entries rows (default 1M); store/lookup always
+   use the full size.
+
+   With --baseline, each stage is checked against a baseline file
+   (bench/ingest_baseline.json) recorded with the same sizes: its time and
+   cJSON allocations must stay within the tolerance.
+   Any regression makes the exit code 1. --write-baseline records the current
+   results as a new baseline.
+
+   --repeat N runs every size N times and reports the median time per stage.
+
+   Usage: ingest_bench [--sizes 1000,100000,10000000]
+                       [--max-parse-entries N] [--lookups N] [--repeat N]
+                       [--out file]
+                       [--baseline FILE] [--write-baseline FILE] [--tolerance PCT] */
+
+#include "wfx_interface.h"
+#include "json_parse.h"
+#include "ls_cache.h"
+#include "perf_stats.h"
+#include "cJSON.h"
+#include "sqlite3.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef RESTIC_WFX_VERSION
+#define RESTIC_WFX_VERSION "dev"
+#endif
+
+/* The plugin core expects the DLL module handle; NULL resolves to this exe */
+HMODULE g_hModule = NULL;
+
+#define BENCH_REPO_NAME   "restic-wfx-ingest-bench"
+#define BENCH_SHORT_ID    "1a2b3c4d"
+#define FILES_PER_DIR     100
+#define DIRS_PER_GROUP    100
+#define MAX_SIZES         8
+
+/* Baseline defaults; a baseline file may set its own */
+#define DEFAULT_TOLERANCE_PCT    25.0
+#define DEFAULT_LATENCY_SLACK_MS 2.0
+
+/* --- Counting allocator for cJSON --- */
+
+static LONGLONG g_CjsonBytes = 0;
+static LONGLONG g_CjsonAllocs = 0;
+
+static void* CountingMalloc(size_t size) {
+    g_CjsonBytes += (LONGLONG)size;
+    g_CjsonAllocs++;
+    return malloc(size);
+}
+
+static void CountingFree(void* p) {
+    free(p);
+}
+
+/* --- Timing --- */
+
+static LONGLONG Now(void) {
+    LARGE_INTEGER c;
+    QueryPerformanceCounter(&c);
+    return c.QuadPart;
+}
+
+static double Rate(LONGLONG count, LONGLONG micros) {
+    if (micros <= 0) micros = 1;
+    return (double)count * 1000000.0 / (double)micros;
+}
+
+/* SQLite memory high-water since the last reset; resets it again. */
+static LONGLONG SqliteHighwater(void) {
+    sqlite3_int64 cur = 0, hi = 0;
+    sqlite3_status64(SQLITE_STATUS_MEMORY_USED, &cur, &hi, 1);
+    return (LONGLONG)hi;
+}
+
+/* --- Synthetic data --- */
+
+/* Build `restic ls --json` output with approximately `entries` rows:
+   /bench/gG/dD/fileF.txt, FILES_PER_DIR files per directory and
+   DIRS_PER_GROUP directories per group. Caller frees. */
+static char* BuildNdjson(int entries, size_t* outLen) {
+    size_t cap = (size_t)entries * 200 + 512;
+    char* buf = (char*)malloc(cap);
+    size_t len = 0;
+    int emitted = 0, d = 0;
+
+    if (!buf) return NULL;
+
+    len += snprintf(buf + len, cap - len,
+        "{\"time\":\"2025-01-01T10:00:00Z\",\"tree\":\"00\",\"paths\":[\"/bench\"],"
+        "\"hostname\":\"bench\",\"id\":\"" BENCH_SHORT_ID "\",\"short_id\":\""
+        BENCH_SHORT_ID "\",\"struct_type\":\"snapshot\"}\n");
+
+    while (emitted < entries) {
+        int f;
+        if (d % DIRS_PER_GROUP == 0) {
+            len += snprintf(buf + len, cap - len,
+                "{\"name\":\"g%d\",\"type\":\"dir\",\"path\":\"/bench/g%d\","
+                "\"mtime\":\"2025-01-01T09:00:00Z\",\"struct_type\":\"node\"}\n",
+                d / DIRS_PER_GROUP, d / DIRS_PER_GROUP);
+            emitted++;
+        }
+        len += snprintf(buf + len, cap - len,
+            "{\"name\":\"d%d\",\"type\":\"dir\",\"path\":\"/bench/g%d/d%d\","
+            "\"mtime\":\"2025-01-01T09:00:00Z\",\"struct_type\":\"node\"}\n",
+            d, d / DIRS_PER_GROUP, d);
+        emitted++;
+        for (f = 0; f < FILES_PER_DIR && emitted < entries; f++) {
+            len += snprintf(buf + len, cap - len,
+                "{\"name\":\"file%d.txt\",\"type\":\"file\",\"path\":\"/bench/g%d/d%d/file%d.txt\","
+                "\"size\":%d,\"mtime\":\"2025-01-01T09:%02d:00Z\",\"struct_type\":\"node\"}\n",
+                f, d / DIRS_PER_GROUP, d, f, 1000 + f * 37, f % 60);
+            emitted++;
+        }
+        d++;
+    }
+
+    *outLen = len;
+    return buf;
+}
+
+static void FillDirEntries(DirEntry* entries, int count) {
+    int i;
+    memset(entries, 0, sizeof(DirEntry) * count);
+    for (i = 0; i < count; i++) {
+        snprintf(entries[i].name, MAX_PATH, "file%d.txt", i);
+        entries[i].fileSizeLow = 1000 + i * 37;
+        entries[i].lastWriteTime.dwLowDateTime = 0xD53E8000u + i;
+        entries[i].lastWriteTime.dwHighDateTime = 0x01DB5C3Bu;
+    }
+}
+
+/* --- Stages --- */
+
+static cJSON* StageJson(const char* name, LONGLONG entries, LONGLONG micros,
+                        LONGLONG bytesAllocated) {
+    cJSON* o = cJSON_CreateObject();
+    cJSON_AddStringToObject(o, "stage", name);
+    cJSON_AddNumberToObject(o, "entries", (double)entries);
+    cJSON_AddNumberToObject(o, "ms", (double)micros / 1000.0);
+    cJSON_AddNumberToObject(o, "entries_per_sec", Rate(entries, micros));
+    cJSON_AddNumberToObject(o, "bytes_allocated", (double)bytesAllocated);
+    return o;
+}
+
+/* parse + group on an in-memory listing of `entries` rows */
+static void BenchParseAndGroup(int entries, cJSON* stages) {
+    size_t ndLen = 0;
+    char* ndjson = BuildNdjson(entries, &ndLen);
+    ResticLsEntry* all = NULL;
+    DirEntry* direct = NULL;
+    int count, directCount = 0;
+    LONGLONG t0, micros;
+    PerfStats before, after;
+
+    if (!ndjson) return;
+
+    /* parse */
+    g_CjsonBytes = 0;
+    g_CjsonAllocs = 0;
+    t0 = Now();
+    count = ParseLsOutputAll(ndjson, &all);
+    micros = PerfStats_MicrosSince(t0);
+    free(ndjson);
+    if (count <= 0) { free(all); return; }
+    {
+        cJSON* s = StageJson("parse", count, micros,
+                             g_CjsonBytes + (LONGLONG)count * sizeof(ResticLsEntry));
+        cJSON_AddNumberToObject(s, "input_bytes", (double)ndLen);
+        cJSON_AddNumberToObject(s, "cjson_allocations", (double)g_CjsonAllocs);
+        cJSON_AddItemToArray(stages, s);
+    }
+
+    /* group: BulkCacheSubdirectories into a fresh DB, store time subtracted */
+    LsCache_DeleteRepo(BENCH_REPO_NAME);
+    SqliteHighwater();
+    PerfStats_Get(&before);
+    t0 = Now();
+    BulkCacheSubdirectories(BENCH_REPO_NAME, BENCH_SHORT_ID, "/bench",
+                            all, count, &direct, &directCount);
+    micros = PerfStats_MicrosSince(t0);
+    PerfStats_Get(&after);
+    {
+        /* Per-group DirEntry arrays plus the parent index (path strings excluded) */
+        LONGLONG storeMicros = after.storeMicros - before.storeMicros;
+        cJSON* s = StageJson("group", count, micros - storeMicros,
+                             (LONGLONG)count * (sizeof(DirEntry) + sizeof(char*)));
+        cJSON_AddNumberToObject(s, "including_store_ms", (double)micros / 1000.0);
+        cJSON_AddNumberToObject(s, "sqlite_highwater_bytes", (double)SqliteHighwater());
+        cJSON_AddItemToArray(stages, s);
+    }
+
+    free(direct);
+    free(all);
+    LsCache_DeleteRepo(BENCH_REPO_NAME);
+}
+
+/* Random directory reads; deterministic LCG so every run reads the same
+   directories. Returns the stage object added to stages. */
+static cJSON* BenchLookups(int dirs, int lookups, const char* stage, cJSON* stages) {
+    unsigned int seed = 12345u;
+    LONGLONG t0, micros, looked = 0, allocated = 0;
+    char path[MAX_PATH];
+    cJSON* s;
+    int i, d;
+
+    t0 = Now();
+    for (i = 0; i < lookups; i++) {
+        int count = 0;
+        DirEntry* e;
+        seed = seed * 1103515245u + 12345u;
+        d = (int)((seed >> 8) % (unsigned int)dirs);
+        snprintf(path, MAX_PATH, "/bench/g%d/d%d", d / DIRS_PER_GROUP, d);
+        e = LsCache_Lookup(BENCH_REPO_NAME, BENCH_SHORT_ID, path, &count);
+        looked += count;
+        allocated += (LONGLONG)count * sizeof(DirEntry);
+        free(e);
+    }
+    micros = PerfStats_MicrosSince(t0);
+
+    s = StageJson(stage, looked, micros, allocated);
+    cJSON_AddNumberToObject(s, "lookups", lookups);
+    cJSON_AddNumberToObject(s, "lookups_per_sec", Rate(lookups, micros));
+    cJSON_AddNumberToObject(s, "sqlite_highwater_bytes", (double)SqliteHighwater());
+    cJSON_AddItemToArray(stages, s);
+    return s;
+}
+
+/* store: fill a fresh DB to `rows` rows; lookup: random directory reads,
+   from SQLite and then from the index file written for the snapshot */
+static void BenchStoreAndLookup(int rows, int lookups, cJSON* stages) {
+    DirEntry* batch = (DirEntry*)malloc(sizeof(DirEntry) * FILES_PER_DIR);
+    int dirs = (rows + FILES_PER_DIR - 1) / FILES_PER_DIR;
+    int d;
+    LONGLONG t0, micros;
+    char path[MAX_PATH];
+
+    if (!batch) return;
+    FillDirEntries(batch, FILES_PER_DIR);
+
+    LsCache_DeleteRepo(BENCH_REPO_NAME);
+    SqliteHighwater();
+    t0 = Now();
+    for (d = 0; d < dirs; d++) {
+        int n = (d == dirs - 1) ? rows - d * FILES_PER_DIR : FILES_PER_DIR;
+        snprintf(path, MAX_PATH, "/bench/g%d/d%d", d / DIRS_PER_GROUP, d);
+        LsCache_Store(BENCH_REPO_NAME, BENCH_SHORT_ID, path, batch, n);
+    }
+    micros = PerfStats_MicrosSince(t0);
+    {
+        cJSON* s = StageJson("store", rows, micros, SqliteHighwater());
+        cJSON_AddNumberToObject(s, "transactions", dirs);
+        cJSON_AddItemToArray(stages, s);
+    }
+
+    /* lookup: from SQLite */
+    BenchLookups(dirs, lookups, "lookup", stages);
+
+    /* lookup_index: the same reads from the snapshot's mapped index file */
+    LsCache_SetIndexFiles(TRUE);
+    t0 = Now();
+    LsCache_MarkSnapshotLoaded(BENCH_REPO_NAME, BENCH_SHORT_ID);
+    micros = PerfStats_MicrosSince(t0);
+    {
+        cJSON* s = BenchLookups(dirs, lookups, "lookup_index", stages);
+        /* Marking also rolls up the directory sizes before writing the file */
+        cJSON_AddNumberToObject(s, "mark_loaded_ms", (double)micros / 1000.0);
+    }
+    LsCache_SetIndexFiles(FALSE);
+
+    free(batch);
+    LsCache_DeleteRepo(BENCH_REPO_NAME);
+}
+
+static int CompareDoubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Replace each stage's time with the median over its repeats. repeats holds
+   one stage array per extra repeat, in the same stage order. */
+static void TakeMedianTimes(cJSON* stages, cJSON* repeats) {
+    int count = cJSON_GetArraySize(repeats) + 1;
+    double* ms = (double*)malloc(sizeof(double) * count);
+    cJSON* stage;
+    int index = 0;
+
+    if (!ms) return;
+    cJSON_ArrayForEach(stage, stages) {
+        cJSON* rep;
+        double median, entries;
+        int n = 0;
+
+        ms[n++] = cJSON_GetNumberValue(cJSON_GetObjectItem(stage, "ms"));
+        cJSON_ArrayForEach(rep, repeats) {
+            cJSON* other = cJSON_GetArrayItem(rep, index);
+            if (other) ms[n++] = cJSON_GetNumberValue(cJSON_GetObjectItem(other, "ms"));
+        }
+        qsort(ms, n, sizeof(double), CompareDoubles);
+        median = ms[n / 2];
+        entries = cJSON_GetNumberValue(cJSON_GetObjectItem(stage, "entries"));
+        cJSON_SetNumberValue(cJSON_GetObjectItem(stage, "ms"), median);
+        cJSON_SetNumberValue(cJSON_GetObjectItem(stage, "entries_per_sec"),
+                             Rate((LONGLONG)entries, (LONGLONG)(median * 1000.0)));
+        index++;
+    }
+    free(ms);
+}
+
+/* --- Baseline --- */
+
+static cJSON* LoadJsonFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    cJSON* json = NULL;
+    char* text;
+    long size;
+
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text) {
+        size_t got = fread(text, 1, (size_t)size, f);
+        text[got] = '\0';
+        json = cJSON_Parse(text);
+        free(text);
+    }
+    fclose(f);
+    return json;
+}
+
+static cJSON* FindStage(cJSON* root, double rows, const char* stage) {
+    cJSON* run;
+    cJSON_ArrayForEach(run, cJSON_GetObjectItem(root, "sizes")) {
+        cJSON* s;
+        if (cJSON_GetNumberValue(cJSON_GetObjectItem(run, "rows")) != rows) continue;
+        cJSON_ArrayForEach(s, cJSON_GetObjectItem(run, "stages")) {
+            cJSON* n = cJSON_GetObjectItem(s, "stage");
+            if (cJSON_IsString(n) && strcmp(n->valuestring, stage) == 0) return s;
+        }
+    }
+    return NULL;
+}
+
+/* Check one metric of a stage if the baseline has it; returns 1 if it
+   regressed. The limit is the baseline plus tolerancePct percent plus slack. */
+static int CheckMetric(cJSON* base, cJSON* actual, const char* metric, int rows,
+                       double tolerancePct, double slack, int* checked) {
+    cJSON* b = cJSON_GetObjectItem(base, metric);
+    cJSON* a = cJSON_GetObjectItem(actual, metric);
+    const char* stage = cJSON_GetObjectItem(base, "stage")->valuestring;
+    double limit;
+
+    if (!cJSON_IsNumber(b)) return 0;
+    (*checked)++;
+    if (!cJSON_IsNumber(a)) {
+        fprintf(stderr, "REGRESSION %d/%s %s: no longer reported\n", rows, stage, metric);
+        return 1;
+    }
+    limit = b->valuedouble * (1.0 + tolerancePct / 100.0) + slack;
+    if (a->valuedouble > limit) {
+        fprintf(stderr, "REGRESSION %d/%s %s: baseline %.2f, now %.2f (limit %.2f)\n",
+                rows, stage, metric, b->valuedouble, a->valuedouble, limit);
+        return 1;
+    }
+    if (a->valuedouble < b->valuedouble)
+        fprintf(stderr, "improved   %d/%s %s: baseline %.2f, now %.2f\n",
+                rows, stage, metric, b->valuedouble, a->valuedouble);
+    return 0;
+}
+
+/* Compare results against a baseline recorded with the same fixture. ms is
+   checked within the tolerance plus the latency slack, cjson_allocations
+   within the tolerance. Returns the number of regressions, or -1 if the
+   baseline can't be used. */
+static int CompareBaseline(cJSON* results, const char* baselineFile, double tolerancePct) {
+    cJSON* baseline = LoadJsonFile(baselineFile);
+    cJSON* run;
+    double slackMs = DEFAULT_LATENCY_SLACK_MS;
+    int regressions = 0, checked = 0;
+
+    if (!baseline) {
+        fprintf(stderr, "cannot read baseline %s\n", baselineFile);
+        return -1;
+    }
+    if (!cJSON_Compare(cJSON_GetObjectItem(baseline, "fixture"),
+                       cJSON_GetObjectItem(results, "fixture"), 1)) {
+        fprintf(stderr, "baseline %s was recorded with a different fixture\n", baselineFile);
+        cJSON_Delete(baseline);
+        return -1;
+    }
+    if (tolerancePct < 0 && cJSON_IsNumber(cJSON_GetObjectItem(baseline, "tolerance_pct")))
+        tolerancePct = cJSON_GetObjectItem(baseline, "tolerance_pct")->valuedouble;
+    if (tolerancePct < 0) tolerancePct = DEFAULT_TOLERANCE_PCT;
+    if (cJSON_IsNumber(cJSON_GetObjectItem(baseline, "latency_slack_ms")))
+        slackMs = cJSON_GetObjectItem(baseline, "latency_slack_ms")->valuedouble;
+
+    cJSON_ArrayForEach(run, cJSON_GetObjectItem(baseline, "sizes")) {
+        int rows = (int)cJSON_GetNumberValue(cJSON_GetObjectItem(run, "rows"));
+        cJSON* base;
+        cJSON_ArrayForEach(base, cJSON_GetObjectItem(run, "stages")) {
+            cJSON* name = cJSON_GetObjectItem(base, "stage");
+            cJSON* actual;
+
+            if (!cJSON_IsString(name)) continue;
+            actual = FindStage(results, rows, name->valuestring);
+            if (!actual) {
+                fprintf(stderr, "REGRESSION %d/%s: stage no longer runs\n",
+                        rows, name->valuestring);
+                regressions++;
+                continue;
+            }
+            regressions += CheckMetric(base, actual, "ms", rows, tolerancePct, slackMs,
+                                       &checked);
+            regressions += CheckMetric(base, actual, "cjson_allocations", rows, tolerancePct, 0,
+                                       &checked);
+        }
+    }
+
+    fprintf(stderr, "baseline %s: %d metrics checked, %d regressions (tolerance %.0f%%)\n",
+            baselineFile, checked, regressions, tolerancePct);
+    cJSON_Delete(baseline);
+    return regressions;
+}
+
+/* Write the gated metrics of the current run as a baseline file */
+static BOOL WriteBaseline(cJSON* results, const char* path, double tolerancePct) {
+    static const char* gated[] = { "ms", "cjson_allocations" };
+    cJSON* baseline = cJSON_CreateObject();
+    cJSON* sizes;
+    cJSON* run;
+    char* text;
+    FILE* f;
+    int k;
+
+    cJSON_AddStringToObject(baseline, "benchmark", "ingest");
+    cJSON_AddItemToObject(baseline, "fixture",
+                          cJSON_Duplicate(cJSON_GetObjectItem(results, "fixture"), 1));
+    cJSON_AddNumberToObject(baseline, "tolerance_pct",
+                            tolerancePct >= 0 ? tolerancePct : DEFAULT_TOLERANCE_PCT);
+    cJSON_AddNumberToObject(baseline, "latency_slack_ms", DEFAULT_LATENCY_SLACK_MS);
+    sizes = cJSON_AddArrayToObject(baseline, "sizes");
+
+    cJSON_ArrayForEach(run, cJSON_GetObjectItem(results, "sizes")) {
+        cJSON* outRun = cJSON_CreateObject();
+        cJSON* stages;
+        cJSON* stage;
+        cJSON_AddNumberToObject(outRun, "rows",
+                                cJSON_GetNumberValue(cJSON_GetObjectItem(run, "rows")));
+        stages = cJSON_AddArrayToObject(outRun, "stages");
+        cJSON_ArrayForEach(stage, cJSON_GetObjectItem(run, "stages")) {
+            cJSON* out = cJSON_CreateObject();
+            cJSON_AddStringToObject(out, "stage",
+                                    cJSON_GetObjectItem(stage, "stage")->valuestring);
+            for (k = 0; k < (int)(sizeof(gated) / sizeof(gated[0])); k++) {
+                cJSON* v = cJSON_GetObjectItem(stage, gated[k]);
+                if (cJSON_IsNumber(v)) cJSON_AddNumberToObject(out, gated[k], v->valuedouble);
+            }
+            cJSON_AddItemToArray(stages, out);
+        }
+        cJSON_AddItemToArray(sizes, outRun);
+    }
+
+    text = cJSON_Print(baseline);
+    f = fopen(path, "w");
+    if (f) {
+        fputs(text, f);
+        fputc('\n', f);
+        fclose(f);
+    }
+    cJSON_free(text);
+    cJSON_Delete(baseline);
+    return f != NULL;
+}
+
+static int ParseSizes(const char* list, int* sizes) {
+    int n = 0;
+    const char* p = list;
+    while (*p && n < MAX_SIZES) {
+        int v = atoi(p);
+        if (v > 0) sizes[n++] = v;
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return n;
+}
+
+int main(int argc, char** argv) {
+    int sizes[MAX_SIZES] = { 1000, 100000, 10000000 };
+    int sizeCount = 3;
+    int maxParse = 1000000;
+    int lookups = 2000;
+    int repeat = 1;
+    const char* outFile = NULL;
+    const char* baselineFile = NULL;
+    const char* writeBaselineFile = NULL;
+    double tolerancePct = -1.0;
+    int exitCode = 0;
+    cJSON_Hooks hooks;
+    cJSON* root;
+    cJSON* fixture;
+    cJSON* runs;
+    char* text;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--sizes") == 0 && v) { sizeCount = ParseSizes(v, sizes); i++; }
+        else if (strcmp(a, "--max-parse-entries") == 0 && v) { maxParse = atoi(v); i++; }
+        else if (strcmp(a, "--lookups") == 0 && v) { lookups = atoi(v); i++; }
+        else if (strcmp(a, "--repeat") == 0 && v) { repeat = atoi(v); i++; }
+        else if (strcmp(a, "--out") == 0 && v) { outFile = v; i++; }
+        else if (strcmp(a, "--baseline") == 0 && v) { baselineFile = v; i++; }
+        else if (strcmp(a, "--write-baseline") == 0 && v) { writeBaselineFile = v; i++; }
+        else if (strcmp(a, "--tolerance") == 0 && v) { tolerancePct = atof(v); i++; }
+        else {
+            fprintf(stderr, "unknown argument: %s\n", a);
+            return 2;
+        }
+    }
+    if (lookups < 1) lookups = 1;
+    if (repeat < 1) repeat = 1;
+
+    hooks.malloc_fn = CountingMalloc;
+    hooks.free_fn = CountingFree;
+    cJSON_InitHooks(&hooks);
+    LsCache_Init();
+
+    root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "benchmark", "ingest");
+    cJSON_AddStringToObject(root, "plugin_version", RESTIC_WFX_VERSION);
+    cJSON_AddNumberToObject(root, "files_per_dir", FILES_PER_DIR);
+
+    fixture = cJSON_AddObjectToObject(root, "fixture");
+    cJSON_AddItemToObject(fixture, "sizes", cJSON_CreateIntArray(sizes, sizeCount));
+    cJSON_AddNumberToObject(fixture, "max_parse_entries", maxParse);
+    cJSON_AddNumberToObject(fixture, "lookups", lookups);
+    cJSON_AddNumberToObject(root, "repeat", repeat);
+
+    runs = cJSON_AddArrayToObject(root, "sizes");
+
+    for (i = 0; i < sizeCount; i++) {
+        cJSON* run = cJSON_CreateObject();
+        cJSON* stages;
+        cJSON* extra = cJSON_CreateArray();
+        int r;
+        cJSON_AddNumberToObject(run, "rows", sizes[i]);
+        stages = cJSON_AddArrayToObject(run, "stages");
+
+        for (r = 0; r < repeat; r++) {
+            cJSON* target = stages;
+            if (r > 0) {
+                target = cJSON_CreateArray();
+                cJSON_AddItemToArray(extra, target);
+            }
+            fprintf(stderr, "ingest_bench: %d rows\n", sizes[i]);
+            if (sizes[i] <= maxParse)
+                BenchParseAndGroup(sizes[i], target);
+            BenchStoreAndLookup(sizes[i], lookups, target);
+        }
+        TakeMedianTimes(stages, extra);
+        cJSON_Delete(extra);
+        cJSON_AddItemToArray(runs, run);
+    }
+
+    text = cJSON_Print(root);
+    if (outFile) {
+        FILE* f = fopen(outFile, "w");
+        if (f) {
+            fputs(text, f);
+            fputc('\n', f);
+            fclose(f);
+        } else {
+            fprintf(stderr, "cannot write %s\n", outFile);
+        }
+    } else {
+        printf("%s\n", text);
+    }
+
+    cJSON_free(text);
+
+    if (writeBaselineFile && !WriteBaseline(root, writeBaselineFile, tolerancePct)) {
+        fprintf(stderr, "cannot write %s\n", writeBaselineFile);
+        exitCode = 1;
+    }
+    if (baselineFile && CompareBaseline(root, baselineFile, tolerancePct) != 0)
+        exitCode = 1;
+
+    cJSON_Delete(root);
+    LsCache_Shutdown();
+    return exitCode;
+}
@@ -0,0 +1,654 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* End-to-end navigation benchmark.
+   Links the plugin core directly and replays a scripted Total Commander
+   session through FsFindFirst/FsGetFile/FsContentGetValue against the fake
+   restic (bench/fake_restic.c), once with cold caches and once warm.
+   Reports p50/p99 latency, restic spawns, bytes parsed and SQLite statements
+   per step plus peak RSS, as JSON so results can be compared between builds.
+
+   With --baseline, the results are also checked against a baseline file
+   (bench/baseline.json): restic spawns must not exceed the baseline, and p50
+   latency and tracked allocations must stay within the tolerance. Any
+   regression makes the exit code 1. --write-baseline records the current
+   results as a new baseline.
+
+   Usage: nav_bench [--iterations N] [--out results.json] [--trace trace.json]
+                    [--baseline FILE] [--write-baseline FILE] [--tolerance PCT]
+                    [--fake-restic-dir DIR] [--snapshots N] [--depth N]
+                    [--fanout N] [--files N] [--latency-ms N] */
+
+#include "wfx_interface.h"
+#include "repo_config.h"
+#include "ls_cache.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "mem_budget.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <psapi.h>
+
+/* The plugin core expects the DLL module handle; NULL resolves to this exe */
+HMODULE g_hModule = NULL;
+
+#ifndef RESTIC_WFX_VERSION
+#define RESTIC_WFX_VERSION "dev"
+#endif
+
+#define BENCH_REPO_NAME   "restic-wfx-bench"
+#define BENCH_PATH_NAME   "C__bench_data"
+#define MAX_STEPS         16
+
+/* Baseline defaults; a baseline file may set its own */
+#define DEFAULT_TOLERANCE_PCT    25.0
+#define DEFAULT_LATENCY_SLACK_MS 2.0
+
+typedef enum { STEP_LIST, STEP_GET, STEP_CONTENT } StepKind;
+
+typedef struct {
+    const char* name;
+    StepKind kind;
+    char path[MAX_PATH];
+} BenchStep;
+
+typedef struct {
+    double* samplesMs;      /* one per iteration */
+    PerfStats totals;       /* summed counter deltas over all iterations */
+    LONG64 trackedAllocs;   /* summed mem_budget allocation deltas */
+} StepResult;
+
+static BenchStep g_Steps[MAX_STEPS];
+static int g_StepCount = 0;
+static char g_LocalTemp[MAX_PATH];
+
+/* --- Host callbacks (stand-ins for Total Commander) --- */
+
+static int __stdcall BenchProgress(int PluginNr, char* SourceName,
+                                   char* TargetName, int PercentDone) {
+    return 0;
+}
+
+static void __stdcall BenchLog(int PluginNr, int MsgType, char* LogString) {
+    if (MsgType == MSGTYPE_IMPORTANTERROR)
+        fprintf(stderr, "plugin: %s\n", LogString);
+}
+
+static BOOL __stdcall BenchRequest(int PluginNr, int RequestType,
+                                   char* CustomTitle, char* CustomText,
+                                   char* ReturnedText, int maxlen) {
+    if (RequestType == RT_MsgOK || RequestType == RT_MsgYesNo) {
+        fprintf(stderr, "plugin: %s: %s\n", CustomTitle ? CustomTitle : "",
+                CustomText ? CustomText : "");
+        return TRUE;
+    }
+    return FALSE;  /* never answer prompts: the bench repo has its password set */
+}
+
+/* --- Session setup --- */
+
+static double NowMs(void) {
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+
+/* Replace the INI-loaded repositories with the single fake benchmark repo */
+static void ConfigureBenchRepo(void) {
+    RepoConfig* repo;
+
+    memset(&g_RepoStore.repos, 0, sizeof(g_RepoStore.repos));
+    g_RepoStore.count = 1;
+    repo = &g_RepoStore.repos[0];
+    strncpy(repo->name, BENCH_REPO_NAME, MAX_REPO_NAME - 1);
+    strncpy(repo->path, "bench:fake", MAX_REPO_PATH - 1);
+    strncpy(repo->password, "bench", MAX_REPO_PASS - 1);
+    repo->configured = TRUE;
+    repo->hasPassword = TRUE;
+}
+
+/* Bring the plugin to a known state. Cold also drops the persistent cache. */
+static void ResetPlugin(BOOL cold) {
+    if (cold) LsCache_DeleteRepo(BENCH_REPO_NAME);
+    FsDisconnect("\\");
+    FsInit(1, BenchProgress, BenchLog, BenchRequest);
+    ConfigureBenchRepo();
+    if (cold) LsCache_DeleteRepo(BENCH_REPO_NAME);
+}
+
+static void AddStep(const char* name, StepKind kind, const char* path) {
+    BenchStep* s;
+    if (g_StepCount >= MAX_STEPS) return;
+    s = &g_Steps[g_StepCount++];
+    s->name = name;
+    s->kind = kind;
+    strncpy(s->path, path, MAX_PATH - 1);
+    s->path[MAX_PATH - 1] = '\0';
+}
+
+/* Resolve the newest snapshot's display name by listing the backup path once. */
+static BOOL BuildSession(void) {
+    char path[MAX_PATH];
+    char snapDir[MAX_PATH];
+    char snapName[MAX_PATH] = {0};
+    DirEntry* entries;
+    int count = 0, i, level;
+
+    snprintf(path, MAX_PATH, "\\%s\\%s", BENCH_REPO_NAME, BENCH_PATH_NAME);
+    entries = GetEntriesForPath(path, &count);
+    for (i = 0; i < count; i++) {
+        if (entries[i].name[0] != '[') {
+            strncpy(snapName, entries[i].name, MAX_PATH - 1);
+            break;
+        }
+    }
+    free(entries);
+    if (!snapName[0]) return FALSE;
+
+    g_StepCount = 0;
+    snprintf(path, MAX_PATH, "\\%s", BENCH_REPO_NAME);
+    AddStep("open_repo", STEP_LIST, path);
+    snprintf(path, MAX_PATH, "\\%s\\%s", BENCH_REPO_NAME, BENCH_PATH_NAME);
+    AddStep("open_path", STEP_LIST, path);
+    snprintf(snapDir, MAX_PATH, "\\%s\\%s\\%s", BENCH_REPO_NAME, BENCH_PATH_NAME, snapName);
+    AddStep("open_snapshot", STEP_LIST, snapDir);
+
+    /* Descend 5 levels: dir0\dir1\dir2\... */
+    {
+        static const char* names[] = { "descend_1", "descend_2", "descend_3",
+                                       "descend_4", "descend_5" };
+        strncpy(path, snapDir, MAX_PATH - 1);
+        for (level = 0; level < 5; level++) {
+            size_t len = strlen(path);
+            snprintf(path + len, MAX_PATH - len, "\\dir%d", level % 3);
+            AddStep(names[level], STEP_LIST, path);
+        }
+    }
+
+    snprintf(path, MAX_PATH, "\\%s\\%s\\[All Files]", BENCH_REPO_NAME, BENCH_PATH_NAME);
+    AddStep("open_all_files", STEP_LIST, path);
+    snprintf(path, MAX_PATH, "\\%s\\%s\\[All Files]\\file0 [show all versions].txt",
+             BENCH_REPO_NAME, BENCH_PATH_NAME);
+    AddStep("list_versions", STEP_LIST, path);
+    snprintf(path, MAX_PATH, "%s\\dir0\\file1.txt", snapDir);
+    AddStep("get_file", STEP_GET, path);
+    AddStep("content_value", STEP_CONTENT, snapDir);
+    return TRUE;
+}
+
+static void RunStep(const BenchStep* step) {
+    switch (step->kind) {
+        case STEP_LIST: {
+            WIN32_FIND_DATAA fd;
+            HANDLE h = FsFindFirst((char*)step->path, &fd);
+            if (h != INVALID_HANDLE_VALUE) {
+                while (FsFindNext(h, &fd)) { }
+                FsFindClose(h);
+            }
+            break;
+        }
+        case STEP_GET: {
+            RemoteInfoStruct ri;
+            memset(&ri, 0, sizeof(ri));
+            FsGetFile((char*)step->path, g_LocalTemp, FS_COPYFLAGS_OVERWRITE, &ri);
+            DeleteFileA(g_LocalTemp);
+            break;
+        }
+        case STEP_CONTENT: {
+            char value[256];
+            FsContentGetValue((char*)step->path, 0, 0, value, sizeof(value), 0);
+            break;
+        }
+    }
+}
+
+/* Run the full session `iterations` times and collect per-step samples. */
+static void RunMode(BOOL cold, int iterations, StepResult* results) {
+    int it, s;
+
+    if (!cold) {
+        /* Warm-up pass: populate every cache layer, untimed */
+        ResetPlugin(TRUE);
+        for (s = 0; s < g_StepCount; s++) RunStep(&g_Steps[s]);
+    }
+
+    for (it = 0; it < iterations; it++) {
+        if (cold) ResetPlugin(TRUE);
+
+        for (s = 0; s < g_StepCount; s++) {
+            PerfStats before, after;
+            MemStats memBefore, memAfter;
+            double t0, t1;
+
+            PerfStats_Get(&before);
+            Mem_GetStats(&memBefore);
+            t0 = NowMs();
+            RunStep(&g_Steps[s]);
+            t1 = NowMs();
+            Mem_GetStats(&memAfter);
+            PerfStats_Get(&after);
+
+            results[s].samplesMs[it] = t1 - t0;
+            results[s].totals.resticSpawns += after.resticSpawns - before.resticSpawns;
+            results[s].totals.pipeBytes += after.pipeBytes - before.pipeBytes;
+            results[s].totals.parsedBytes += after.parsedBytes - before.parsedBytes;
+            results[s].totals.sqliteStatements += after.sqliteStatements - before.sqliteStatements;
+            results[s].totals.storeMicros += after.storeMicros - before.storeMicros;
+            results[s].trackedAllocs += memAfter.allocations - memBefore.allocations;
+        }
+    }
+}
+
+static int CompareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+/* Nearest-rank percentile over a sorted sample array */
+static double Percentile(const double* sorted, int n, int pct) {
+    int rank;
+    if (n <= 0) return 0.0;
+    rank = (pct * n + 99) / 100;
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static cJSON* ModeToJson(StepResult* results, int iterations) {
+    cJSON* mode = cJSON_CreateObject();
+    cJSON* steps = cJSON_AddArrayToObject(mode, "steps");
+    double totalP50 = 0.0;
+    int s;
+
+    for (s = 0; s < g_StepCount; s++) {
+        cJSON* step = cJSON_CreateObject();
+        double p50, p99;
+
+        qsort(results[s].samplesMs, iterations, sizeof(double), CompareDouble);
+        p50 = Percentile(results[s].samplesMs, iterations, 50);
+        p99 = Percentile(results[s].samplesMs, iterations, 99);
+        totalP50 += p50;
+
+        cJSON_AddStringToObject(step, "name", g_Steps[s].name);
+        cJSON_AddStringToObject(step, "path", g_Steps[s].path);
+        cJSON_AddNumberToObject(step, "p50_ms", p50);
+        cJSON_AddNumberToObject(step, "p99_ms", p99);
+        cJSON_AddNumberToObject(step, "restic_spawns",
+                                (double)results[s].totals.resticSpawns / iterations);
+        cJSON_AddNumberToObject(step, "pipe_bytes",
+                                (double)results[s].totals.pipeBytes / iterations);
+        cJSON_AddNumberToObject(step, "parsed_bytes",
+                                (double)results[s].totals.parsedBytes / iterations);
+        cJSON_AddNumberToObject(step, "sqlite_statements",
+                                (double)results[s].totals.sqliteStatements / iterations);
+        cJSON_AddNumberToObject(step, "sqlite_store_ms",
+                                (double)results[s].totals.storeMicros / 1000.0 / iterations);
+        cJSON_AddNumberToObject(step, "tracked_allocs",
+                                (double)results[s].trackedAllocs / iterations);
+        cJSON_AddItemToArray(steps, step);
+    }
+
+    cJSON_AddNumberToObject(mode, "session_p50_ms", totalP50);
+    return mode;
+}
+
+static StepResult* AllocResults(int iterations) {
+    StepResult* results = (StepResult*)calloc(g_StepCount, sizeof(StepResult));
+    int s;
+    if (!results) return NULL;
+    for (s = 0; s < g_StepCount; s++) {
+        results[s].samplesMs = (double*)calloc(iterations, sizeof(double));
+        if (!results[s].samplesMs) return NULL;
+    }
+    return results;
+}
+
+static void FreeResults(StepResult* results) {
+    int s;
+    if (!results) return;
+    for (s = 0; s < g_StepCount; s++) free(results[s].samplesMs);
+    free(results);
+}
+
+/* --- Baseline gate --- */
+
+static cJSON* LoadJsonFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    cJSON* json = NULL;
+    char* text;
+    long size;
+
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    text = (size >= 0) ? (char*)malloc((size_t)size + 1) : NULL;
+    if (text) {
+        size_t got = fread(text, 1, (size_t)size, f);
+        text[got] = '\0';
+        json = cJSON_Parse(text);
+        free(text);
+    }
+    fclose(f);
+    return json;
+}
+
+static cJSON* FindStep(cJSON* root, const char* mode, const char* name) {
+    cJSON* steps = cJSON_GetObjectItem(
+        cJSON_GetObjectItem(cJSON_GetObjectItem(root, "modes"), mode), "steps");
+    cJSON* step;
+    cJSON_ArrayForEach(step, steps) {
+        cJSON* n = cJSON_GetObjectItem(step, "name");
+        if (cJSON_IsString(n) && strcmp(n->valuestring, name) == 0) return step;
+    }
+    return NULL;
+}
+
+/* Check one metric; returns 1 if it regressed. maxAllowed is computed by the
+   caller from the baseline value. */
+static int CheckMetric(const char* mode, const char* step, const char* metric,
+                       double baseline, double actual, double maxAllowed) {
+    if (actual > maxAllowed) {
+        fprintf(stderr, "REGRESSION %s/%s %s: baseline %.2f, now %.2f (limit %.2f)\n",
+                mode, step, metric, baseline, actual, maxAllowed);
+        return 1;
+    }
+    if (actual < baseline)
+        fprintf(stderr, "improved   %s/%s %s: baseline %.2f, now %.2f\n",
+                mode, step, metric, baseline, actual);
+    return 0;
+}
+
+/* Compare results against a baseline. Only metrics present in the baseline
+   are checked: restic_spawns exactly (the session is deterministic), p50_ms
+   and tracked_allocs within the tolerance. Returns the number of
+   regressions, or -1 if the baseline can't be used. */
+static int CompareBaseline(cJSON* results, const char* baselineFile, double tolerancePct) {
+    cJSON* baseline = LoadJsonFile(baselineFile);
+    cJSON* mode;
+    double slackMs = DEFAULT_LATENCY_SLACK_MS;
+    int regressions = 0, checked = 0;
+
+    if (!baseline) {
+        fprintf(stderr, "cannot read baseline %s\n", baselineFile);
+        return -1;
+    }
+    if (!cJSON_Compare(cJSON_GetObjectItem(baseline, "fixture"),
+                       cJSON_GetObjectItem(results, "fixture"), 1)) {
+        fprintf(stderr, "baseline %s was recorded with a different fixture\n", baselineFile);
+        cJSON_Delete(baseline);
+        return -1;
+    }
+    if (tolerancePct < 0 && cJSON_IsNumber(cJSON_GetObjectItem(baseline, "tolerance_pct")))
+        tolerancePct = cJSON_GetObjectItem(baseline, "tolerance_pct")->valuedouble;
+    if (tolerancePct < 0) tolerancePct = DEFAULT_TOLERANCE_PCT;
+    if (cJSON_IsNumber(cJSON_GetObjectItem(baseline, "latency_slack_ms")))
+        slackMs = cJSON_GetObjectItem(baseline, "latency_slack_ms")->valuedouble;
+
+    cJSON_ArrayForEach(mode, cJSON_GetObjectItem(baseline, "modes")) {
+        cJSON* base;
+        cJSON_ArrayForEach(base, cJSON_GetObjectItem(mode, "steps")) {
+            cJSON* name = cJSON_GetObjectItem(base, "name");
+            cJSON* actual;
+            cJSON* b;
+
+            if (!cJSON_IsString(name)) continue;
+            actual = FindStep(results, mode->string, name->valuestring);
+            if (!actual) {
+                fprintf(stderr, "REGRESSION %s/%s: step no longer runs\n",
+                        mode->string, name->valuestring);
+                regressions++;
+                continue;
+            }
+
+            b = cJSON_GetObjectItem(base, "restic_spawns");
+            if (cJSON_IsNumber(b)) {
+                regressions += CheckMetric(mode->string, name->valuestring, "restic_spawns",
+                    b->valuedouble, cJSON_GetObjectItem(actual, "restic_spawns")->valuedouble,
+                    b->valuedouble);
+                checked++;
+            }
+            b = cJSON_GetObjectItem(base, "p50_ms");
+            if (cJSON_IsNumber(b)) {
+                regressions += CheckMetric(mode->string, name->valuestring, "p50_ms",
+                    b->valuedouble, cJSON_GetObjectItem(actual, "p50_ms")->valuedouble,
+                    b->valuedouble * (1.0 + tolerancePct / 100.0) + slackMs);
+                checked++;
+            }
+            b = cJSON_GetObjectItem(base, "tracked_allocs");
+            if (cJSON_IsNumber(b)) {
+                regressions += CheckMetric(mode->string, name->valuestring, "tracked_allocs",
+                    b->valuedouble, cJSON_GetObjectItem(actual, "tracked_allocs")->valuedouble,
+                    b->valuedouble * (1.0 + tolerancePct / 100.0));
+                checked++;
+            }
+        }
+    }
+
+    fprintf(stderr, "baseline %s: %d metrics checked, %d regressions (tolerance %.0f%%)\n",
+            baselineFile, checked, regressions, tolerancePct);
+    cJSON_Delete(baseline);
+    return regressions;
+}
+
+/* Write the gated metrics of the current run as a baseline file */
+static BOOL WriteBaseline(cJSON* results, const char* path, double tolerancePct) {
+    static const char* gated[] = { "restic_spawns", "p50_ms", "tracked_allocs" };
+    cJSON* baseline = cJSON_CreateObject();
+    cJSON* modes;
+    cJSON* mode;
+    char* text;
+    FILE* f;
+    int k;
+
+    cJSON_AddStringToObject(baseline, "benchmark", "navigation");
+    cJSON_AddItemToObject(baseline, "fixture",
+                          cJSON_Duplicate(cJSON_GetObjectItem(results, "fixture"), 1));
+    cJSON_AddNumberToObject(baseline, "tolerance_pct",
+                            tolerancePct >= 0 ? tolerancePct : DEFAULT_TOLERANCE_PCT);
+    cJSON_AddNumberToObject(baseline, "latency_slack_ms", DEFAULT_LATENCY_SLACK_MS);
+    modes = cJSON_AddObjectToObject(baseline, "modes");
+
+    cJSON_ArrayForEach(mode, cJSON_GetObjectItem(results, "modes")) {
+        cJSON* steps = cJSON_AddArrayToObject(cJSON_AddObjectToObject(modes, mode->string),
+                                              "steps");
+        cJSON* step;
+        cJSON_ArrayForEach(step, cJSON_GetObjectItem(mode, "steps")) {
+            cJSON* out = cJSON_CreateObject();
+            cJSON_AddStringToObject(out, "name",
+                                    cJSON_GetObjectItem(step, "name")->valuestring);
+            for (k = 0; k < 3; k++) {
+                /* Microsecond precision keeps the checked-in file readable */
+                double v = cJSON_GetObjectItem(step, gated[k])->valuedouble;
+                cJSON_AddNumberToObject(out, gated[k],
+                                        (double)(LONGLONG)(v * 1000.0 + 0.5) / 1000.0);
+            }
+            cJSON_AddItemToArray(steps, out);
+        }
+    }
+
+    text = cJSON_Print(baseline);
+    f = fopen(path, "w");
+    if (f) {
+        fputs(text, f);
+        fputc('\n', f);
+        fclose(f);
+    }
+    cJSON_free(text);
+    cJSON_Delete(baseline);
+    return f != NULL;
+}
+
+/* Put the fake restic first on PATH so CreateProcess("restic ...") finds it */
+static BOOL UseFakeRestic(const char* fakeDir) {
+    char exe[MAX_PATH];
+    char* oldPath;
+    char* newPath;
+    DWORD len;
+
+    snprintf(exe, MAX_PATH, "%s\\restic.exe", fakeDir);
+    if (GetFileAttributesA(exe) == INVALID_FILE_ATTRIBUTES) {
+        fprintf(stderr, "fake restic not found: %s\n", exe);
+        return FALSE;
+    }
+
+    len = GetEnvironmentVariableA("PATH", NULL, 0);
+    oldPath = (char*)malloc(len + 1);
+    newPath = (char*)malloc(len + strlen(fakeDir) + 2);
+    if (!oldPath || !newPath) { free(oldPath); free(newPath); return FALSE; }
+    oldPath[0] = '\0';
+    GetEnvironmentVariableA("PATH", oldPath, len + 1);
+    sprintf(newPath, "%s;%s", fakeDir, oldPath);
+    SetEnvironmentVariableA("PATH", newPath);
+    free(oldPath);
+    free(newPath);
+    return TRUE;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 10;
+    const char* outFile = NULL;
+    const char* traceFile = NULL;
+    const char* baselineFile = NULL;
+    const char* writeBaselineFile = NULL;
+    double tolerancePct = -1.0;
+    int exitCode = 0;
+    char fakeDir[MAX_PATH] = {0};
+    StepResult* coldResults;
+    StepResult* warmResults;
+    cJSON* root;
+    cJSON* fixture;
+    cJSON* modes;
+    char* text;
+    int i;
+    PROCESS_MEMORY_COUNTERS pmc;
+
+    for (i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--iterations") == 0 && v) { iterations = atoi(v); i++; }
+        else if (strcmp(a, "--out") == 0 && v) { outFile = v; i++; }
+        else if (strcmp(a, "--trace") == 0 && v) { traceFile = v; i++; }
+        else if (strcmp(a, "--baseline") == 0 && v) { baselineFile = v; i++; }
+        else if (strcmp(a, "--write-baseline") == 0 && v) { writeBaselineFile = v; i++; }
+        else if (strcmp(a, "--tolerance") == 0 && v) { tolerancePct = atof(v); i++; }
+        else if (strcmp(a, "--fake-restic-dir") == 0 && v) {
+            strncpy(fakeDir, v, MAX_PATH - 1); i++;
+        }
+        else if (strcmp(a, "--snapshots") == 0 && v) { SetEnvironmentVariableA("FAKE_RESTIC_SNAPSHOTS", v); i++; }
+        else if (strcmp(a, "--depth") == 0 && v) { SetEnvironmentVariableA("FAKE_RESTIC_DEPTH", v); i++; }
+        else if (strcmp(a, "--fanout") == 0 && v) { SetEnvironmentVariableA("FAKE_RESTIC_FANOUT", v); i++; }
+        else if (strcmp(a, "--files") == 0 && v) { SetEnvironmentVariableA("FAKE_RESTIC_FILES", v); i++; }
+        else if (strcmp(a, "--latency-ms") == 0 && v) { SetEnvironmentVariableA("FAKE_RESTIC_LATENCY_MS", v); i++; }
+        else {
+            fprintf(stderr, "unknown argument: %s\n", a);
+            return 2;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    /* Default fake restic location: <exe dir>\fake */
+    if (!fakeDir[0]) {
+        char* slash;
+        GetModuleFileNameA(NULL, fakeDir, MAX_PATH);
+        slash = strrchr(fakeDir, '\\');
+        if (slash) *slash = '\0';
+        strncat(fakeDir, "\\fake", MAX_PATH - strlen(fakeDir) - 1);
+    }
+    if (!UseFakeRestic(fakeDir)) return 1;
+
+    GetTempPathA(MAX_PATH, g_LocalTemp);
+    strncat(g_LocalTemp, "restic_wfx_bench.tmp", MAX_PATH - strlen(g_LocalTemp) - 1);
+
+    if (traceFile && !Trace_Start(traceFile)) {
+        fprintf(stderr, "cannot write %s\n", traceFile);
+        return 1;
+    }
+
+    FsInit(1, BenchProgress, BenchLog, BenchRequest);
+    ConfigureBenchRepo();
+    if (!BuildSession()) {
+        fprintf(stderr, "could not list snapshots from the fake restic\n");
+        return 1;
+    }
+
+    coldResults = AllocResults(iterations);
+    warmResults = AllocResults(iterations);
+    if (!coldResults || !warmResults) return 1;
+
+    PerfStats_Reset();
+    RunMode(TRUE, iterations, coldResults);
+    RunMode(FALSE, iterations, warmResults);
+
+    root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "benchmark", "navigation");
+    cJSON_AddStringToObject(root, "plugin_version", RESTIC_WFX_VERSION);
+    cJSON_AddNumberToObject(root, "iterations", iterations);
+
+    fixture = cJSON_AddObjectToObject(root, "fixture");
+    {
+        static const char* vars[] = { "FAKE_RESTIC_SNAPSHOTS", "FAKE_RESTIC_DEPTH",
+                                      "FAKE_RESTIC_FANOUT", "FAKE_RESTIC_FILES",
+                                      "FAKE_RESTIC_LATENCY_MS" };
+        static const char* keys[] = { "snapshots", "depth", "fanout", "files", "latency_ms" };
+        int k;
+        for (k = 0; k < 5; k++) {
+            char val[32] = {0};
+            if (GetEnvironmentVariableA(vars[k], val, sizeof(val)) > 0)
+                cJSON_AddNumberToObject(fixture, keys[k], atoi(val));
+            else
+                cJSON_AddStringToObject(fixture, keys[k], "default");
+        }
+    }
+
+    modes = cJSON_AddObjectToObject(root, "modes");
+    cJSON_AddItemToObject(modes, "cold", ModeToJson(coldResults, iterations));
+    cJSON_AddItemToObject(modes, "warm", ModeToJson(warmResults, iterations));
+
+    memset(&pmc, 0, sizeof(pmc));
+    pmc.cb = sizeof(pmc);
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        cJSON_AddNumberToObject(root, "peak_rss_bytes", (double)pmc.PeakWorkingSetSize);
+
+    text = cJSON_Print(root);
+    if (outFile) {
+        FILE* f = fopen(outFile, "w");
+        if (f) {
+            fputs(text, f);
+            fputc('\n', f);
+            fclose(f);
+        } else {
+            fprintf(stderr, "cannot write %s\n", outFile);
+        }
+    } else {
+        printf("%s\n", text);
+    }
+
+    cJSON_free(text);
+
+    if (writeBaselineFile && !WriteBaseline(root, writeBaselineFile, tolerancePct)) {
+        fprintf(stderr, "cannot write %s\n", writeBaselineFile);
+        exitCode = 1;
+    }
+    if (baselineFile) {
+        int regressions = CompareBaseline(root, baselineFile, tolerancePct);
+        if (regressions != 0) exitCode = 1;
+    }
+
+    cJSON_Delete(root);
+    FreeResults(coldResults);
+    FreeResults(warmResults);
+
+    /* Leave no benchmark state behind in the user's cache directory */
+    LsCache_DeleteRepo(BENCH_REPO_NAME);
+    FsDisconnect("\\");
+    Trace_Stop();
+    return exitCode;
+}
@@ -0,0 +1,193 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "cache_service.h"
+#include "trace.h"
+#include <sddl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* How long to wait for a pipe instance while the service is busy with
+   other windows before listing locally */
+#define CACHE_CONNECT_TIMEOUT_MS 2000
+
+static BOOL g_Enabled = FALSE;
+
+void CacheService_InitFromConfig(const char* configFilePath) {
+    g_Enabled = GetPrivateProfileIntA("Service", "Enabled", 0, configFilePath) == 1;
+}
+
+void CacheService_Disable(void) {
+    g_Enabled = FALSE;
+}
+
+BOOL CacheService_IsEnabled(void) {
+    return g_Enabled;
+}
+
+/* String SID ("S-1-5-21-...") of the user a process runs as */
+static BOOL ProcessUserSid(HANDLE process, char* outSid, int maxLen) {
+    HANDLE token;
+    DWORD_PTR info[64];         /* TOKEN_USER and the SID it points to */
+    DWORD size;
+    char* sid = NULL;
+    BOOL ok;
+
+    if (!OpenProcessToken(process, TOKEN_QUERY, &token)) return FALSE;
+    ok = GetTokenInformation(token, TokenUser, info, sizeof(info), &size) &&
+         ConvertSidToStringSidA(((TOKEN_USER*)info)->User.Sid, &sid);
+    CloseHandle(token);
+    if (!ok) return FALSE;
+
+    ok = (int)strlen(sid) < maxLen;
+    if (ok) strcpy(outSid, sid);
+    LocalFree(sid);
+    return ok;
+}
+
+BOOL CacheService_UserSid(char* outSid, int maxLen) {
+    return ProcessUserSid(GetCurrentProcess(), outSid, maxLen);
+}
+
+BOOL CacheService_PipeName(char* outName, int maxLen) {
+    char sid[CACHE_SERVICE_SID_MAX];
+
+    if (!CacheService_UserSid(sid, sizeof(sid))) return FALSE;
+    snprintf(outName, maxLen, "\\\\.\\pipe\\restic-wfx-cache-%s", sid);
+    return TRUE;
+}
+
+BOOL CacheService_ReadAll(HANDLE pipe, void* buf, DWORD size) {
+    BYTE* p = (BYTE*)buf;
+    DWORD got;
+
+    while (size > 0) {
+        if (!ReadFile(pipe, p, size, &got, NULL) || got == 0) return FALSE;
+        p += got;
+        size -= got;
+    }
+    return TRUE;
+}
+
+BOOL CacheService_WriteAll(HANDLE pipe, const void* buf, DWORD size) {
+    const BYTE* p = (const BYTE*)buf;
+    DWORD written;
+
+    while (size > 0) {
+        if (!WriteFile(pipe, p, size, &written, NULL) || written == 0) return FALSE;
+        p += written;
+        size -= written;
+    }
+    return TRUE;
+}
+
+/* TRUE if the process serving a pipe runs as the given user, so that a
+   pipe another account created under our name is never trusted */
+static BOOL ServerRunsAs(HANDLE pipe, const char* userSid) {
+    char serverSid[CACHE_SERVICE_SID_MAX];
+    ULONG pid;
+    HANDLE process;
+    BOOL ok;
+
+    if (!GetNamedPipeServerProcessId(pipe, &pid)) return FALSE;
+    process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+    if (!process) return FALSE;
+    ok = ProcessUserSid(process, serverSid, sizeof(serverSid)) &&
+         strcmp(serverSid, userSid) == 0;
+    CloseHandle(process);
+    return ok;
+}
+
+/* Connect to the service, waiting a little while all its pipe instances
+   are taken. Returns INVALID_HANDLE_VALUE if it is not running or is not
+   ours. The server may only identify us, not act as us. */
+static HANDLE Connect(void) {
+    char name[MAX_PATH];
+    char sid[CACHE_SERVICE_SID_MAX];
+    HANDLE pipe = INVALID_HANDLE_VALUE;
+    int attempt;
+
+    if (!CacheService_UserSid(sid, sizeof(sid)) || !CacheService_PipeName(name, MAX_PATH))
+        return INVALID_HANDLE_VALUE;
+    for (attempt = 0; attempt < 2; attempt++) {
+        pipe = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING,
+                           SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION, NULL);
+        if (pipe != INVALID_HANDLE_VALUE || GetLastError() != ERROR_PIPE_BUSY) break;
+        if (!WaitNamedPipeA(name, CACHE_CONNECT_TIMEOUT_MS)) break;
+    }
+    if (pipe != INVALID_HANDLE_VALUE && !ServerRunsAs(pipe, sid)) {
+        CloseHandle(pipe);
+        pipe = INVALID_HANDLE_VALUE;
+    }
+    return pipe;
+}
+
+/* Send a request and read the reply header. Returns the connected pipe
+   (the records follow), or INVALID_HANDLE_VALUE. */
+static HANDLE Call(DWORD op, const char* path, CacheReplyHeader* reply) {
+    CacheRequest req;
+    HANDLE pipe = Connect();
+
+    if (pipe == INVALID_HANDLE_VALUE) return pipe;
+
+    memset(&req, 0, sizeof(req));
+    req.version = CACHE_SERVICE_VERSION;
+    req.op = op;
+    strncpy(req.path, path, MAX_PATH - 1);
+
+    if (!CacheService_WriteAll(pipe, &req, sizeof(req)) ||
+        !CacheService_ReadAll(pipe, reply, sizeof(CacheReplyHeader)) ||
+        reply->version != CACHE_SERVICE_VERSION) {
+        CloseHandle(pipe);
+        return INVALID_HANDLE_VALUE;
+    }
+    return pipe;
+}
+
+BOOL CacheService_List(const char* path, DirEntry** outEntries, int* outCount) {
+    CacheReplyHeader reply;
+    DirEntry* entries = NULL;
+    HANDLE pipe;
+    BOOL ok;
+    TraceSpan span;
+
+    *outEntries = NULL;
+    *outCount = 0;
+    if (!g_Enabled) return FALSE;
+
+    Trace_Begin(&span);
+    pipe = Call(CACHE_OP_LIST, path, &reply);
+    ok = pipe != INVALID_HANDLE_VALUE && reply.status == CACHE_REPLY_OK &&
+         reply.count <= CACHE_REPLY_MAX_ENTRIES;
+    if (ok && reply.count > 0) {
+        entries = (DirEntry*)malloc(sizeof(DirEntry) * reply.count);
+        ok = entries != NULL &&
+             CacheService_ReadAll(pipe, entries, (DWORD)(sizeof(DirEntry) * reply.count));
+    }
+    if (pipe != INVALID_HANDLE_VALUE) CloseHandle(pipe);
+
+    Trace_ArgStr(&span, "path", path);
+    Trace_ArgInt(&span, "served", ok);
+    Trace_End(&span, "service.list");
+
+    if (!ok) {
+        free(entries);
+        return FALSE;
+    }
+    *outEntries = entries;
+    *outCount = (int)reply.count;
+    return TRUE;
+}
+
+void CacheService_Forget(const char* repoName) {
+    CacheReplyHeader reply;
+    HANDLE pipe;
+
+    if (!g_Enabled) return;
+    pipe = Call(CACHE_OP_FORGET, repoName, &reply);
+    if (pipe != INVALID_HANDLE_VALUE) CloseHandle(pipe);
+}
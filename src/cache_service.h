@@ -0,0 +1,82 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef CACHE_SERVICE_H
+#define CACHE_SERVICE_H
+
+#include "wfx_interface.h"
+
+/* Optional shared cache service ([Service] Enabled=1).
+   restic-wfx-cached hosts the plugin core in a process of its own and
+   answers directory listings over a named pipe of the user, so every
+   Total Commander window shares one warm memory cache and one set of
+   restic processes: listings run one at a time, and one of a repository
+   whose listing is running waits for it. The plugin asks it first for
+   folders below a repository and lists locally whenever it is not
+   running, is busy with another repository for a while, or cannot answer
+   (anything that would ask the user, such as a password or a search).
+
+   The pipe is named after the user's SID and only admits that SID; the
+   plugin also checks that the process serving it runs as the user. */
+
+#define CACHE_SERVICE_VERSION 1
+
+#define CACHE_OP_LIST   1       /* path: plugin path; reply: DirEntry records */
+#define CACHE_OP_FORGET 2       /* path: repo name; reply: no records */
+
+#define CACHE_REPLY_OK    0
+#define CACHE_REPLY_LOCAL 1     /* the plugin has to list this itself */
+
+/* Room for a string SID ("S-1-5-21-" and up to 15 sub-authorities) */
+#define CACHE_SERVICE_SID_MAX 192
+
+/* Upper bound on the records of a reply a client accepts */
+#define CACHE_REPLY_MAX_ENTRIES 1000000
+
+typedef struct {
+    DWORD version;              /* CACHE_SERVICE_VERSION */
+    DWORD op;                   /* CACHE_OP_* */
+    char path[MAX_PATH];        /* ANSI, as Total Commander passes it */
+} CacheRequest;
+
+/* Followed by count DirEntry records */
+typedef struct {
+    DWORD version;
+    DWORD status;               /* CACHE_REPLY_* */
+    DWORD count;
+} CacheReplyHeader;
+
+/* Use the service if [Service] Enabled=1 is set in the given INI file. */
+void CacheService_InitFromConfig(const char* configFilePath);
+
+/* Stop asking the service; the service itself calls this, as it shares
+   the plugin's INI file. */
+void CacheService_Disable(void);
+
+BOOL CacheService_IsEnabled(void);
+
+/* String SID of the current user. FALSE if the token cannot be read. */
+BOOL CacheService_UserSid(char* outSid, int maxLen);
+
+/* Name of the current user's service pipe, derived from the user's SID.
+   FALSE if the SID cannot be read. */
+BOOL CacheService_PipeName(char* outName, int maxLen);
+
+/* Read or write exactly size bytes of a pipe. */
+BOOL CacheService_ReadAll(HANDLE pipe, void* buf, DWORD size);
+BOOL CacheService_WriteAll(HANDLE pipe, const void* buf, DWORD size);
+
+/* Have the service list a plugin path. Returns TRUE with *outEntries set
+   (caller frees, NULL for an empty folder), or FALSE if the plugin has to
+   list it itself: no service of this user is running, it failed, or it
+   answered CACHE_REPLY_LOCAL. */
+BOOL CacheService_List(const char* path, DirEntry** outEntries, int* outCount);
+
+/* Tell the service to drop what it holds in memory about a repository
+   (its snapshots changed). Does nothing if no service is running. */
+void CacheService_Forget(const char* repoName);
+
+#endif /* CACHE_SERVICE_H */
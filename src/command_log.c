@@ -0,0 +1,267 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "command_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <shlobj.h>
+
+/* Callers append formatted lines to g_Pending under g_Lock. A writer thread,
+   started on demand, moves them to the file every LOG_FLUSH_MS (sooner when
+   the buffer is half full) and exits after LOG_IDLE_EXIT_MS without work,
+   so no thread outlives a quiet plugin. The writer holds a reference to
+   the module it runs in and drops it as it exits (FreeLibraryAndExitThread),
+   so the DLL is not unloaded under it when Total Commander frees the
+   plugin without FsDisconnect; CommandLog_Shutdown stops and joins it
+   sooner. g_FileLock serialises file appends and rotation; lock order is
+   g_FileLock, then g_Lock. */
+
+#define LOG_BUF_SIZE       65536
+#define LOG_LINE_MAX       3072
+#define LOG_FLUSH_MS       500
+#define LOG_IDLE_EXIT_MS   5000
+#define LOG_MAX_SIZE       (1024 * 1024)
+#define LOG_GENERATIONS    3
+
+static volatile LONG g_InitState = 0;  /* 0 = not started, 1 = in progress, 2 = ready */
+static CRITICAL_SECTION g_Lock;        /* g_Pending, g_PendingLen, the writer state */
+static CRITICAL_SECTION g_FileLock;    /* the log file and g_WriteBuf */
+static HANDLE g_WakeEvent = NULL;
+static char g_LogFilePath[MAX_PATH] = {0};
+
+static char g_Pending[LOG_BUF_SIZE];
+static int g_PendingLen = 0;
+static BOOL g_WriterRunning = FALSE;
+static BOOL g_StopWriter = FALSE;
+static HANDLE g_WriterThread = NULL;   /* last writer started, until joined */
+static char g_WriteBuf[LOG_BUF_SIZE];
+
+/* Build log file path: %APPDATA%\GHISLER\plugins\wfx\restic_wfx\restic_commands.log */
+static void BuildLogPath(void) {
+    char appData[MAX_PATH];
+    char dir[MAX_PATH];
+
+    if (FAILED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appData))) {
+        g_LogFilePath[0] = '\0';
+        return;
+    }
+
+    /* Create intermediate directories */
+    snprintf(dir, MAX_PATH, "%s\\GHISLER", appData);
+    CreateDirectoryA(dir, NULL);
+    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins", appData);
+    CreateDirectoryA(dir, NULL);
+    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins\\wfx", appData);
+    CreateDirectoryA(dir, NULL);
+    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins\\wfx\\restic_wfx", appData);
+    CreateDirectoryA(dir, NULL);
+
+    snprintf(g_LogFilePath, MAX_PATH,
+             "%s\\GHISLER\\plugins\\wfx\\restic_wfx\\restic_commands.log", appData);
+}
+
+static void EnsureInit(void) {
+    if (g_InitState == 2) return;
+
+    if (InterlockedCompareExchange(&g_InitState, 1, 0) == 0) {
+        InitializeCriticalSection(&g_Lock);
+        InitializeCriticalSection(&g_FileLock);
+        g_WakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+        BuildLogPath();
+        InterlockedExchange(&g_InitState, 2);
+    } else {
+        while (g_InitState != 2) Sleep(0);
+    }
+}
+
+/* restic_commands.log -> .1 -> .2 -> .3 (oldest dropped) */
+static void RotateLogs(void) {
+    char from[MAX_PATH], to[MAX_PATH];
+    int i;
+
+    for (i = LOG_GENERATIONS - 1; i >= 1; i--) {
+        snprintf(from, MAX_PATH, "%s.%d", g_LogFilePath, i);
+        snprintf(to, MAX_PATH, "%s.%d", g_LogFilePath, i + 1);
+        MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING);
+    }
+    snprintf(to, MAX_PATH, "%s.1", g_LogFilePath);
+    MoveFileExA(g_LogFilePath, to, MOVEFILE_REPLACE_EXISTING);
+}
+
+/* Append to the log file, rotating first if it would exceed LOG_MAX_SIZE.
+   Caller holds g_FileLock. */
+static void AppendToFile(const char* data, int len) {
+    HANDLE hFile;
+    LARGE_INTEGER size, zero;
+    DWORD written;
+
+    hFile = CreateFileA(g_LogFilePath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                        OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return;
+
+    if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0 &&
+        size.QuadPart + len > LOG_MAX_SIZE) {
+        CloseHandle(hFile);
+        RotateLogs();
+        hFile = CreateFileA(g_LogFilePath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE) return;
+    }
+
+    zero.QuadPart = 0;
+    SetFilePointerEx(hFile, zero, NULL, FILE_END);
+    WriteFile(hFile, data, (DWORD)len, &written, NULL);
+    CloseHandle(hFile);
+}
+
+/* Move all pending lines to the file. With tryOnly, gives up instead of
+   waiting if another thread holds a lock (safe from DllMain). */
+static void DrainPending(BOOL tryOnly) {
+    int len;
+
+    if (tryOnly) {
+        if (!TryEnterCriticalSection(&g_FileLock)) return;
+        if (!TryEnterCriticalSection(&g_Lock)) {
+            LeaveCriticalSection(&g_FileLock);
+            return;
+        }
+    } else {
+        EnterCriticalSection(&g_FileLock);
+        EnterCriticalSection(&g_Lock);
+    }
+
+    len = g_PendingLen;
+    memcpy(g_WriteBuf, g_Pending, len);
+    g_PendingLen = 0;
+    LeaveCriticalSection(&g_Lock);
+
+    if (len > 0) AppendToFile(g_WriteBuf, len);
+    LeaveCriticalSection(&g_FileLock);
+}
+
+/* param is the module reference taken for the thread by StartWriter */
+static DWORD WINAPI WriterThreadProc(LPVOID param) {
+    ULONGLONG idleSince = GetTickCount64();
+    BOOL done = FALSE;
+
+    while (!done) {
+        WaitForSingleObject(g_WakeEvent, LOG_FLUSH_MS);
+
+        EnterCriticalSection(&g_Lock);
+        if (g_StopWriter ||
+            (g_PendingLen == 0 && GetTickCount64() - idleSince >= LOG_IDLE_EXIT_MS)) {
+            g_WriterRunning = FALSE;
+            done = TRUE;
+        }
+        if (done || g_PendingLen == 0) {
+            LeaveCriticalSection(&g_Lock);
+            continue;
+        }
+        LeaveCriticalSection(&g_Lock);
+
+        DrainPending(FALSE);
+        idleSince = GetTickCount64();
+    }
+
+    /* Nothing of this module runs after the reference is dropped */
+    FreeLibraryAndExitThread((HMODULE)param, 0);
+    return 0;
+}
+
+/* Start a writer thread holding its own reference to this module. Returns
+   NULL if it could not be started. Caller holds g_Lock. */
+static HANDLE StartWriter(void) {
+    HMODULE self = NULL;
+    HANDLE hThread;
+
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                            (LPCSTR)(void*)WriterThreadProc, &self))
+        return NULL;
+    hThread = CreateThread(NULL, 0, WriterThreadProc, self, 0, NULL);
+    if (!hThread) FreeLibrary(self);
+    return hThread;
+}
+
+void CommandLog_Write(const char* cmdLine, LONGLONG durationMs,
+                      DWORD exitCode, LONGLONG bytes) {
+    char line[LOG_LINE_MAX];
+    SYSTEMTIME st;
+    int len;
+    BOOL wake, haveWriter;
+
+    EnsureInit();
+    if (g_LogFilePath[0] == '\0') return;
+
+    GetLocalTime(&st);
+    len = snprintf(line, sizeof(line),
+                   "[%04d-%02d-%02d %02d:%02d:%02d] %7lld ms  exit %-3ld %12lld bytes  %s\n",
+                   st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond,
+                   (long long)durationMs, (long)(LONG)exitCode, (long long)bytes, cmdLine);
+    if (len < 0) return;
+    if (len >= (int)sizeof(line)) {
+        len = (int)sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+
+    EnterCriticalSection(&g_Lock);
+    if (g_PendingLen + len > LOG_BUF_SIZE) {
+        /* Writer is behind: write out on this thread rather than drop lines */
+        LeaveCriticalSection(&g_Lock);
+        DrainPending(FALSE);
+        EnterCriticalSection(&g_Lock);
+    }
+    if (g_PendingLen + len <= LOG_BUF_SIZE) {
+        memcpy(g_Pending + g_PendingLen, line, len);
+        g_PendingLen += len;
+    }
+    if (!g_WriterRunning && !g_StopWriter) {
+        /* A writer that went idle has already left the lock and is only
+           returning; reap it before starting the next */
+        if (g_WriterThread) {
+            WaitForSingleObject(g_WriterThread, INFINITE);
+            CloseHandle(g_WriterThread);
+        }
+        g_WriterThread = StartWriter();
+        if (g_WriterThread) g_WriterRunning = TRUE;
+    }
+    haveWriter = g_WriterRunning;
+    wake = g_PendingLen > LOG_BUF_SIZE / 2;
+    LeaveCriticalSection(&g_Lock);
+
+    if (!haveWriter)
+        DrainPending(FALSE);
+    else if (wake)
+        SetEvent(g_WakeEvent);
+}
+
+void CommandLog_Flush(void) {
+    if (g_InitState != 2) return;
+    DrainPending(TRUE);
+}
+
+void CommandLog_Shutdown(void) {
+    HANDLE hThread;
+
+    if (g_InitState != 2) return;
+
+    EnterCriticalSection(&g_Lock);
+    g_StopWriter = TRUE;
+    hThread = g_WriterThread;
+    g_WriterThread = NULL;
+    LeaveCriticalSection(&g_Lock);
+
+    if (hThread) {
+        SetEvent(g_WakeEvent);
+        WaitForSingleObject(hThread, INFINITE);
+        CloseHandle(hThread);
+    }
+    DrainPending(FALSE);
+
+    /* Lines of a later session start a new writer */
+    EnterCriticalSection(&g_Lock);
+    g_StopWriter = FALSE;
+    LeaveCriticalSection(&g_Lock);
+}
@@ -0,0 +1,31 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef COMMAND_LOG_H
+#define COMMAND_LOG_H
+
+#include <windows.h>
+
+/* restic_commands.log: one line per finished restic run with its duration,
+   exit code and bytes transferred. Lines are buffered in memory and appended
+   by a background thread, so callers never wait for the disk. The log is
+   rotated to restic_commands.log.1 .. .3 when it exceeds 1 MB. */
+
+/* Queue one finished command. exitCode is (DWORD)-1 if restic did not run
+   or was cancelled. */
+void CommandLog_Write(const char* cmdLine, LONGLONG durationMs,
+                      DWORD exitCode, LONGLONG bytes);
+
+/* Write out all queued lines on the calling thread, unless another thread
+   holds the log (safe from DllMain). */
+void CommandLog_Flush(void);
+
+/* Stop and join the writer thread, then write out all queued lines. Call
+   where the loader lock is not held (FsDisconnect); a later
+   CommandLog_Write starts a new writer. */
+void CommandLog_Shutdown(void);
+
+#endif /* COMMAND_LOG_H */
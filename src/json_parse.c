@@ -6,6 +6,8 @@
 
 #include "json_parse.h"
 #include "cJSON.h"
+#include "perf_stats.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -86,10 +88,13 @@ int ParseSnapshots(const char* json, ResticSnapshot** outSnapshots) {
     cJSON* item = NULL;
     int count, i;
     ResticSnapshot* snapshots = NULL;
+    TraceSpan span;
 
     if (!json || !outSnapshots) return -1;
     *outSnapshots = NULL;
 
+    Trace_Begin(&span);
+    PerfStats_AddParsedBytes((LONGLONG)strlen(json));
     root = cJSON_Parse(json);
     if (!root || !cJSON_IsArray(root)) {
         cJSON_Delete(root);
@@ -146,6 +151,8 @@ int ParseSnapshots(const char* json, ResticSnapshot** outSnapshots) {
     }
 
     *outSnapshots = snapshots;
+    Trace_ArgInt(&span, "snapshots", count);
+    Trace_End(&span, "parse.snapshots");
     return count;
 }
 
@@ -175,10 +182,13 @@ int ParseFindOutput(const char* json, ResticFindEntry** outEntries) {
     int count = 0, capacity = 0;
     cJSON* root = NULL;
     cJSON* snapItem = NULL;
+    TraceSpan span;
 
     if (!json || !outEntries) return -1;
     *outEntries = NULL;
 
+    Trace_Begin(&span);
+    PerfStats_AddParsedBytes((LONGLONG)strlen(json));
     root = cJSON_Parse(json);
     if (!root || !cJSON_IsArray(root)) {
         cJSON_Delete(root);
@@ -231,6 +241,8 @@ int ParseFindOutput(const char* json, ResticFindEntry** outEntries) {
 
     cJSON_Delete(root);
     *outEntries = entries;
+    Trace_ArgInt(&span, "entries", count);
+    Trace_End(&span, "parse.find");
     return count;
 }
 
@@ -239,9 +251,11 @@ int ParseLsOutputAll(const char* ndjson, ResticLsEntry** outEntries) {
     int count = 0, capacity = 0;
     const char* lineStart;
     const char* lineEnd;
+    TraceSpan span;
 
     if (!ndjson || !outEntries) return -1;
     *outEntries = NULL;
+    Trace_Begin(&span);
 
     lineStart = ndjson;
     while (*lineStart) {
@@ -319,7 +333,11 @@ int ParseLsOutputAll(const char* ndjson, ResticLsEntry** outEntries) {
         lineStart = lineEnd + (*lineEnd ? 1 : 0);
     }
 
+    PerfStats_AddParsedBytes((LONGLONG)(lineStart - ndjson));
     *outEntries = entries;
+    Trace_ArgInt(&span, "entries", count);
+    Trace_ArgInt(&span, "bytes", (LONGLONG)(lineStart - ndjson));
+    Trace_End(&span, "parse.ls");
     return count;
 }
 
@@ -329,9 +347,11 @@ int ParseLsOutput(const char* ndjson, const char* parentPath, ResticLsEntry** ou
     const char* lineStart;
     const char* lineEnd;
     int parentLen;
+    TraceSpan span;
 
     if (!ndjson || !outEntries) return -1;
     *outEntries = NULL;
+    Trace_Begin(&span);
 
     parentLen = parentPath ? (int)strlen(parentPath) : 0;
     /* Remove trailing slash from parentPath if present */
@@ -415,6 +435,9 @@ int ParseLsOutput(const char* ndjson, const char* parentPath, ResticLsEntry** ou
         lineStart = lineEnd + (*lineEnd ? 1 : 0);
     }
 
+    PerfStats_AddParsedBytes((LONGLONG)(lineStart - ndjson));
     *outEntries = entries;
+    Trace_ArgInt(&span, "entries", count);
+    Trace_End(&span, "parse.ls_filtered");
     return count;
 }
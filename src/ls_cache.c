@@ -6,6 +6,10 @@
 
 #include "ls_cache.h"
 #include "json_parse.h"  /* For AnsiToUtf8, Utf8ToAnsi */
+#include "perf_stats.h"
+#include "mem_budget.h"
+#include "path_filter.h"
+#include "snap_index.h"
 #include "sqlite3.h"
 #include <string.h>
 #include <stdlib.h>
@@ -13,11 +17,15 @@
 #include <shlobj.h>
 #include <shlwapi.h>
 
-/* Maximum number of simultaneously open repo databases */
-#define MAX_DBS 16
+/* Maximum number of simultaneously open repo databases. Each thread gets
+   its own connection to a repo's database (a connection and its prepared
+   statements are not shared between threads), so a background copy never
+   waits for the browsing thread's statements or the other way round. */
+#define MAX_DBS 32
 
 typedef struct {
     char repoName[64];
+    DWORD threadId;             /* the only thread using this connection */
     sqlite3* db;
     /* Prepared statements */
     sqlite3_stmt* stmtLookupSentinel;
@@ -26,13 +34,47 @@ typedef struct {
     sqlite3_stmt* stmtInsertEntry;
     sqlite3_stmt* stmtCheckLoaded;
     sqlite3_stmt* stmtMarkLoaded;
+    sqlite3_stmt* stmtInsertStats;
+    sqlite3_stmt* stmtLookupStats;
 } DbConn;
 
-static DbConn g_Dbs[MAX_DBS];
+static DbConn* g_Dbs[MAX_DBS];
 static int g_DbCount = 0;
+static SRWLOCK g_DbLock = SRWLOCK_INIT;     /* guards g_Dbs, not the connections */
 static BOOL g_Initialized = FALSE;
 static char g_CacheDir[MAX_PATH] = {0};
 
+/* Mapped per-snapshot index files ([Cache] IndexFiles=1). Each mapping takes
+   address space for the whole file, so only a few stay open. A slot with a
+   NULL index remembers that the snapshot has no (valid) index file. */
+#define MAX_OPEN_INDEXES 8
+
+typedef struct {
+    char repoName[64];
+    char shortId[65];
+    SnapIndex* index;
+    volatile LONG64 lastUsed;
+} OpenIndex;
+
+static BOOL g_IndexFiles = FALSE;
+static OpenIndex g_Indexes[MAX_OPEN_INDEXES];
+static volatile LONG64 g_IndexClock = 0;
+static SRWLOCK g_IndexLock = SRWLOCK_INIT;  /* shared to read a mapping, exclusive to (un)map */
+
+/* Path filters of loaded snapshots, read from path_filters on first use.
+   The bits are Mem_Alloc'd and given back by LsCache_ReleaseFilters. */
+typedef struct {
+    char repoName[64];
+    char shortId[65];
+    BYTE* bits;
+    DWORD byteCount;
+} LoadedFilter;
+
+static LoadedFilter* g_Filters = NULL;
+static int g_FilterCount = 0;
+static int g_FilterCapacity = 0;
+static SRWLOCK g_FilterLock = SRWLOCK_INIT;     /* guards g_Filters */
+
 /* Build the cache directory path: %APPDATA%\GHISLER\plugins\wfx\restic_wfx\cache\ */
 static BOOL EnsureCacheDir(void) {
     char appData[MAX_PATH];
@@ -64,6 +106,141 @@ static void GetDbPath(const char* repoName, char* outPath, int maxLen) {
     snprintf(outPath, maxLen, "%s\\%s.db", g_CacheDir, repoName);
 }
 
+/* Directory of a repo's index files: cache\<repo>.index\<shortId>.idx */
+static void GetIndexDir(const char* repoName, char* outPath, int maxLen) {
+    snprintf(outPath, maxLen, "%s\\%s.index", g_CacheDir, repoName);
+}
+
+static void GetIndexPath(const char* repoName, const char* shortId, char* outPath, int maxLen) {
+    snprintf(outPath, maxLen, "%s\\%s.index\\%s.idx", g_CacheDir, repoName, shortId);
+}
+
+/* Unmap the indexes of one snapshot, or of the whole repo (shortId NULL).
+   A mapped file cannot be replaced or deleted, so this precedes both. */
+static void CloseIndexes(const char* repoName, const char* shortId) {
+    int i;
+
+    AcquireSRWLockExclusive(&g_IndexLock);
+    for (i = 0; i < MAX_OPEN_INDEXES; i++) {
+        OpenIndex* slot = &g_Indexes[i];
+        if (slot->repoName[0] == '\0' || strcmp(slot->repoName, repoName) != 0) continue;
+        if (shortId && strcmp(slot->shortId, shortId) != 0) continue;
+        SnapIndex_Close(slot->index);
+        memset(slot, 0, sizeof(OpenIndex));
+    }
+    ReleaseSRWLockExclusive(&g_IndexLock);
+}
+
+/* DropFilters with g_FilterLock held */
+static LONG64 RemoveFilters(const char* repoName, const char* shortId) {
+    LONG64 freed = 0;
+    int i = 0;
+
+    while (i < g_FilterCount) {
+        LoadedFilter* f = &g_Filters[i];
+        if ((repoName && strcmp(f->repoName, repoName) != 0) ||
+            (shortId && strcmp(f->shortId, shortId) != 0)) {
+            i++;
+            continue;
+        }
+        freed += f->byteCount;
+        Mem_Free(f->bits);
+        g_Filters[i] = g_Filters[--g_FilterCount];
+    }
+    return freed;
+}
+
+/* Free the loaded path filters of one snapshot, or of the whole repo
+   (shortId NULL), or of every repo (repoName NULL). Returns bytes freed. */
+static LONG64 DropFilters(const char* repoName, const char* shortId) {
+    LONG64 freed;
+
+    AcquireSRWLockExclusive(&g_FilterLock);
+    freed = RemoveFilters(repoName, shortId);
+    ReleaseSRWLockExclusive(&g_FilterLock);
+    return freed;
+}
+
+/* Slot of a snapshot's mapped index, or NULL if it is not open. Called
+   with g_IndexLock held (shared is enough). */
+static OpenIndex* FindOpenIndex(const char* repoName, const char* shortId) {
+    int i;
+
+    for (i = 0; i < MAX_OPEN_INDEXES; i++) {
+        OpenIndex* s = &g_Indexes[i];
+        if (s->repoName[0] != '\0' && strcmp(s->repoName, repoName) == 0 &&
+            strcmp(s->shortId, shortId) == 0) {
+            InterlockedExchange64(&s->lastUsed, InterlockedIncrement64(&g_IndexClock));
+            return s;
+        }
+    }
+    return NULL;
+}
+
+/* Mapped index of a snapshot, or NULL if it has none. Opens the file on
+   first use, replacing the least recently used slot. Called with
+   g_IndexLock held exclusively. */
+static SnapIndex* GetSnapIndex(const char* repoName, const char* shortId) {
+    OpenIndex* slot = FindOpenIndex(repoName, shortId);
+    char idxPath[MAX_PATH];
+    int i;
+
+    if (slot) return slot->index;
+    for (i = 0; i < MAX_OPEN_INDEXES; i++) {
+        OpenIndex* s = &g_Indexes[i];
+        if (!slot || s->lastUsed < slot->lastUsed) slot = s;
+    }
+
+    if (!EnsureCacheDir()) return NULL;
+
+    SnapIndex_Close(slot->index);
+    memset(slot, 0, sizeof(OpenIndex));
+    strncpy(slot->repoName, repoName, sizeof(slot->repoName) - 1);
+    strncpy(slot->shortId, shortId, sizeof(slot->shortId) - 1);
+    GetIndexPath(repoName, shortId, idxPath, MAX_PATH);
+    slot->index = SnapIndex_Open(idxPath);
+    slot->lastUsed = InterlockedIncrement64(&g_IndexClock);
+    return slot->index;
+}
+
+/* Delete a repo's index files except those of validShortIds[0..validCount-1]
+   (validCount 0 deletes all of them, and the directory) */
+static void DeleteIndexFiles(const char* repoName, const char** validShortIds, int validCount) {
+    char dir[MAX_PATH];
+    char filePath[MAX_PATH];
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind;
+    int i;
+
+    if (!EnsureCacheDir()) return;
+    if (validCount == 0) CloseIndexes(repoName, NULL);
+    GetIndexDir(repoName, dir, MAX_PATH);
+    snprintf(filePath, MAX_PATH, "%s\\*.idx", dir);
+
+    hFind = FindFirstFileA(filePath, &fd);
+    if (hFind == INVALID_HANDLE_VALUE) return;
+    do {
+        char shortId[65];
+        char* dot;
+        BOOL keep = FALSE;
+
+        strncpy(shortId, fd.cFileName, sizeof(shortId) - 1);
+        shortId[sizeof(shortId) - 1] = '\0';
+        dot = strrchr(shortId, '.');
+        if (dot) *dot = '\0';
+        for (i = 0; i < validCount && !keep; i++)
+            keep = (strcmp(validShortIds[i], shortId) == 0);
+        if (keep) continue;
+
+        CloseIndexes(repoName, shortId);
+        snprintf(filePath, MAX_PATH, "%s\\%s", dir, fd.cFileName);
+        DeleteFileA(filePath);
+    } while (FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+
+    if (validCount == 0) RemoveDirectoryA(dir);
+}
+
 /* Finalize all prepared statements for a connection */
 static void FinalizeStatements(DbConn* conn) {
     if (conn->stmtLookupSentinel) { sqlite3_finalize(conn->stmtLookupSentinel); conn->stmtLookupSentinel = NULL; }
@@ -72,6 +249,15 @@ static void FinalizeStatements(DbConn* conn) {
     if (conn->stmtInsertEntry)    { sqlite3_finalize(conn->stmtInsertEntry);    conn->stmtInsertEntry = NULL; }
     if (conn->stmtCheckLoaded)    { sqlite3_finalize(conn->stmtCheckLoaded);    conn->stmtCheckLoaded = NULL; }
     if (conn->stmtMarkLoaded)     { sqlite3_finalize(conn->stmtMarkLoaded);     conn->stmtMarkLoaded = NULL; }
+    if (conn->stmtInsertStats)    { sqlite3_finalize(conn->stmtInsertStats);    conn->stmtInsertStats = NULL; }
+    if (conn->stmtLookupStats)    { sqlite3_finalize(conn->stmtLookupStats);    conn->stmtLookupStats = NULL; }
+}
+
+/* sqlite3_trace_v2 callback: counts statements for the performance counters */
+static int CountStatementCallback(unsigned type, void* ctx, void* p, void* x) {
+    (void)ctx; (void)p; (void)x;
+    if (type == SQLITE_TRACE_STMT) PerfStats_AddStatement();
+    return 0;
 }
 
 /* Create schema tables if they don't exist */
@@ -100,6 +286,46 @@ static BOOL CreateSchema(sqlite3* db) {
         "CREATE TABLE IF NOT EXISTS snapshot_loaded ("
         "  short_id TEXT PRIMARY KEY,"
         "  loaded_at INTEGER NOT NULL"
+        ");"
+        "CREATE TABLE IF NOT EXISTS snapshot_stats ("
+        "  short_id TEXT PRIMARY KEY,"
+        "  restic_ms INTEGER NOT NULL,"
+        "  first_byte_ms INTEGER NOT NULL,"
+        "  output_bytes INTEGER NOT NULL,"
+        "  entry_count INTEGER NOT NULL,"
+        "  dir_count INTEGER NOT NULL,"
+        "  parse_ms INTEGER NOT NULL,"
+        "  sqlite_ms INTEGER NOT NULL,"
+        "  recorded_at INTEGER NOT NULL"
+        ");"
+        /* Largest files of a snapshot in index order, no sort of its rows.
+           Kept up by every insert, so [Largest files] never builds it on
+           the UI thread; a cache from before it gets it once when opened */
+        "CREATE INDEX IF NOT EXISTS idx_dir_entries_size "
+        "  ON dir_entries(short_id, size_high, size_low) WHERE is_dir = 0;"
+        /* Recursive size of every directory of a loaded snapshot */
+        "CREATE TABLE IF NOT EXISTS dir_sizes ("
+        "  short_id TEXT NOT NULL,"
+        "  path TEXT NOT NULL,"
+        "  total_size INTEGER NOT NULL,"
+        "  file_count INTEGER NOT NULL,"
+        "  PRIMARY KEY (short_id, path)"
+        ");"
+        /* Bloom filter over the cached_dirs paths of a loaded snapshot */
+        "CREATE TABLE IF NOT EXISTS path_filters ("
+        "  short_id TEXT PRIMARY KEY,"
+        "  bits BLOB NOT NULL"
+        ");"
+        /* Snapshot being ingested, by which process (and thread) of which
+           machine; started is the process creation time, so a reused pid
+           is told apart */
+        "CREATE TABLE IF NOT EXISTS ingest_leases ("
+        "  short_id TEXT PRIMARY KEY,"
+        "  host TEXT NOT NULL,"
+        "  pid INTEGER NOT NULL,"
+        "  started INTEGER NOT NULL,"
+        "  thread INTEGER NOT NULL,"
+        "  taken_at INTEGER NOT NULL"
         ");";
 
     char* errMsg = NULL;
@@ -110,7 +336,7 @@ static BOOL CreateSchema(sqlite3* db) {
     }
 
     /* Set schema version */
-    sqlite3_exec(db, "PRAGMA user_version=1;", NULL, NULL, NULL);
+    sqlite3_exec(db, "PRAGMA user_version=5;", NULL, NULL, NULL);
     return TRUE;
 }
 
@@ -152,85 +378,191 @@ static BOOL PrepareStatements(DbConn* conn) {
         -1, &conn->stmtMarkLoaded, NULL);
     if (rc != SQLITE_OK) return FALSE;
 
+    rc = sqlite3_prepare_v2(conn->db,
+        "INSERT OR REPLACE INTO snapshot_stats "
+        "(short_id, restic_ms, first_byte_ms, output_bytes, entry_count, dir_count, "
+        " parse_ms, sqlite_ms, recorded_at) "
+        "VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9)",
+        -1, &conn->stmtInsertStats, NULL);
+    if (rc != SQLITE_OK) return FALSE;
+
+    rc = sqlite3_prepare_v2(conn->db,
+        "SELECT restic_ms, first_byte_ms, output_bytes, entry_count, dir_count, "
+        "parse_ms, sqlite_ms, recorded_at FROM snapshot_stats WHERE short_id=?1",
+        -1, &conn->stmtLookupStats, NULL);
+    if (rc != SQLITE_OK) return FALSE;
+
     return TRUE;
 }
 
-/* Open (or reuse) a database connection for the given repo.
-   Returns NULL on failure. */
-static DbConn* GetConnection(const char* repoName) {
-    int i;
-    char dbPath[MAX_PATH];
-    int rc;
+/* Finalize the statements of a connection, close it and free it */
+static void CloseConnection(DbConn* conn) {
+    FinalizeStatements(conn);
+    if (conn->db) sqlite3_close(conn->db);
+    free(conn);
+}
 
-    /* Check for existing connection */
-    for (i = 0; i < g_DbCount; i++) {
-        if (strcmp(g_Dbs[i].repoName, repoName) == 0)
-            return &g_Dbs[i];
+/* Close the connections of threads that have exited, to make room in a
+   full table. Called with g_DbLock held exclusively. */
+static void PruneConnections(void) {
+    int i = 0;
+
+    while (i < g_DbCount) {
+        HANDLE thread = OpenThread(SYNCHRONIZE, FALSE, g_Dbs[i]->threadId);
+        BOOL exited = !thread || WaitForSingleObject(thread, 0) == WAIT_OBJECT_0;
+
+        if (thread) CloseHandle(thread);
+        if (exited) {
+            CloseConnection(g_Dbs[i]);
+            g_Dbs[i] = g_Dbs[--g_DbCount];
+        } else {
+            i++;
+        }
     }
+}
+
+/* Open a connection to a repo's database. Returns NULL on failure. */
+static DbConn* OpenConnection(const char* repoName) {
+    char dbPath[MAX_PATH];
+    DbConn* conn;
+    int rc;
 
     /* Ensure cache directory exists */
     if (!EnsureCacheDir()) return NULL;
 
-    /* No room for more connections */
-    if (g_DbCount >= MAX_DBS) return NULL;
-
+    conn = (DbConn*)calloc(1, sizeof(DbConn));
+    if (!conn) return NULL;
+    strncpy(conn->repoName, repoName, sizeof(conn->repoName) - 1);
+    conn->threadId = GetCurrentThreadId();
     GetDbPath(repoName, dbPath, MAX_PATH);
 
-    /* Open database */
-    {
-        DbConn* conn = &g_Dbs[g_DbCount];
-        memset(conn, 0, sizeof(DbConn));
-        strncpy(conn->repoName, repoName, sizeof(conn->repoName) - 1);
+    rc = sqlite3_open(dbPath, &conn->db);
+    if (rc != SQLITE_OK) {
+        /* Try to delete corrupt DB and retry once */
+        if (conn->db) sqlite3_close(conn->db);
+        conn->db = NULL;
+        DeleteFileA(dbPath);
 
         rc = sqlite3_open(dbPath, &conn->db);
         if (rc != SQLITE_OK) {
-            /* Try to delete corrupt DB and retry once */
-            if (conn->db) sqlite3_close(conn->db);
-            conn->db = NULL;
-            DeleteFileA(dbPath);
-
-            rc = sqlite3_open(dbPath, &conn->db);
-            if (rc != SQLITE_OK) {
-                if (conn->db) sqlite3_close(conn->db);
-                conn->db = NULL;
-                return NULL;
-            }
+            CloseConnection(conn);
+            return NULL;
         }
+    }
 
-        if (!CreateSchema(conn->db)) {
-            /* Schema creation failed — possibly corrupt; delete and retry */
-            sqlite3_close(conn->db);
-            conn->db = NULL;
-            DeleteFileA(dbPath);
-
-            rc = sqlite3_open(dbPath, &conn->db);
-            if (rc != SQLITE_OK || !CreateSchema(conn->db)) {
-                if (conn->db) sqlite3_close(conn->db);
-                conn->db = NULL;
-                return NULL;
-            }
-        }
+    if (!CreateSchema(conn->db)) {
+        /* Schema creation failed — possibly corrupt; delete and retry */
+        sqlite3_close(conn->db);
+        conn->db = NULL;
+        DeleteFileA(dbPath);
 
-        if (!PrepareStatements(conn)) {
-            FinalizeStatements(conn);
-            sqlite3_close(conn->db);
-            conn->db = NULL;
+        rc = sqlite3_open(dbPath, &conn->db);
+        if (rc != SQLITE_OK || !CreateSchema(conn->db)) {
+            CloseConnection(conn);
             return NULL;
         }
+    }
+
+    if (!PrepareStatements(conn)) {
+        CloseConnection(conn);
+        return NULL;
+    }
+
+    sqlite3_trace_v2(conn->db, SQLITE_TRACE_STMT, CountStatementCallback, NULL);
+    return conn;
+}
+
+/* The calling thread's connection to a repo's database, opened on first
+   use. Returns NULL on failure. */
+static DbConn* GetConnection(const char* repoName) {
+    DWORD self = GetCurrentThreadId();
+    DbConn* conn = NULL;
+    int i;
 
-        g_DbCount++;
-        return conn;
+    /* Check for existing connection */
+    AcquireSRWLockShared(&g_DbLock);
+    for (i = 0; i < g_DbCount && !conn; i++) {
+        if (g_Dbs[i]->threadId == self && strcmp(g_Dbs[i]->repoName, repoName) == 0)
+            conn = g_Dbs[i];
     }
+    ReleaseSRWLockShared(&g_DbLock);
+    if (conn) return conn;
+
+    /* Opened without the lock; only this thread looks for it */
+    conn = OpenConnection(repoName);
+    if (!conn) return NULL;
+
+    AcquireSRWLockExclusive(&g_DbLock);
+    if (g_DbCount >= MAX_DBS) PruneConnections();
+    if (g_DbCount < MAX_DBS) {
+        g_Dbs[g_DbCount++] = conn;
+    } else {
+        /* No room for more connections */
+        CloseConnection(conn);
+        conn = NULL;
+    }
+    ReleaseSRWLockExclusive(&g_DbLock);
+    return conn;
 }
 
 /* --- Public API --- */
 
 void LsCache_Init(void) {
     g_Initialized = TRUE;
-    g_DbCount = 0;
     g_CacheDir[0] = '\0';
 }
 
+void LsCache_SetIndexFiles(BOOL enable) {
+    g_IndexFiles = enable;
+}
+
+/* Serve a lookup from the snapshot's mapped index file. The names are the
+   only data converted; everything else is read straight from the view. */
+static DirEntry* LookupSnapIndex(const char* repoName, const char* shortId,
+                                 const char* path, int* outCount) {
+    OpenIndex* slot;
+    SnapIndex* index;
+    const SnapIndexEntry* records = NULL;
+    DirEntry* entries = NULL;
+    BOOL exclusive = FALSE;
+    int count = 0;
+    int i;
+
+    /* Readers share an open mapping; opening one (or replacing the least
+       recently used) needs the lock to itself */
+    AcquireSRWLockShared(&g_IndexLock);
+    slot = FindOpenIndex(repoName, shortId);
+    if (slot) {
+        index = slot->index;
+    } else {
+        ReleaseSRWLockShared(&g_IndexLock);
+        AcquireSRWLockExclusive(&g_IndexLock);
+        exclusive = TRUE;
+        index = GetSnapIndex(repoName, shortId);
+    }
+
+    if (index) records = SnapIndex_FindDir(index, path, &count);
+
+    /* Same "cached empty" convention as the SQLite path */
+    if (records) entries = (DirEntry*)malloc(count > 0 ? sizeof(DirEntry) * count : 1);
+
+    for (i = 0; entries && i < count; i++) {
+        const SnapIndexEntry* r = &records[i];
+        DirEntry* e = &entries[i];
+        Utf8ToAnsi(SnapIndex_Name(index, r), e->name, MAX_PATH);
+        e->isDirectory = r->isDirectory ? TRUE : FALSE;
+        e->fileSizeLow = r->sizeLow;
+        e->fileSizeHigh = r->sizeHigh;
+        e->lastWriteTime.dwLowDateTime = r->mtimeLow;
+        e->lastWriteTime.dwHighDateTime = r->mtimeHigh;
+    }
+    if (exclusive) ReleaseSRWLockExclusive(&g_IndexLock);
+    else ReleaseSRWLockShared(&g_IndexLock);
+
+    if (entries) *outCount = count;
+    return entries;
+}
+
 DirEntry* LsCache_Lookup(const char* repoName, const char* shortId,
                           const char* path, int* outCount) {
     DbConn* conn;
@@ -241,6 +573,11 @@ DirEntry* LsCache_Lookup(const char* repoName, const char* shortId,
     *outCount = 0;
     if (!g_Initialized) return NULL;
 
+    if (g_IndexFiles) {
+        entries = LookupSnapIndex(repoName, shortId, path, outCount);
+        if (entries) return entries;
+    }
+
     conn = GetConnection(repoName);
     if (!conn) return NULL;
 
@@ -309,12 +646,15 @@ void LsCache_Store(const char* repoName, const char* shortId,
     DbConn* conn;
     int i;
     char* errMsg = NULL;
+    LARGE_INTEGER start;
 
     if (!g_Initialized) return;
 
     conn = GetConnection(repoName);
     if (!conn) return;
 
+    QueryPerformanceCounter(&start);
+
     /* Begin transaction */
     if (sqlite3_exec(conn->db, "BEGIN", NULL, NULL, &errMsg) != SQLITE_OK) {
         sqlite3_free(errMsg);
@@ -356,15 +696,49 @@ void LsCache_Store(const char* repoName, const char* shortId,
 
     /* Commit */
     sqlite3_exec(conn->db, "COMMIT", NULL, NULL, NULL);
+    PerfStats_AddStoreMicros(PerfStats_MicrosSince(start.QuadPart));
+}
+
+/* Delete the rows of one table whose short_id is not in ids. Returns the
+   number of rows deleted, or -1 if the statement failed (for example if a
+   lazily created table does not exist yet). */
+static int DeleteForgotten(DbConn* conn, const char* table, const char** ids, int n) {
+    sqlite3_stmt* stmt = NULL;
+    char* sql;
+    int sqlLen, offset, i;
+    int deleted = -1;
+
+    /* DELETE FROM <table> WHERE short_id NOT IN (?1, ?2, ...): base SQL
+       plus up to 7 characters per parameter */
+    sqlLen = 96 + (int)strlen(table) + n * 8;
+    sql = (char*)malloc(sqlLen);
+    if (!sql) return -1;
+
+    offset = snprintf(sql, sqlLen, "DELETE FROM %s WHERE short_id NOT IN (", table);
+    for (i = 0; i < n; i++)
+        offset += snprintf(sql + offset, sqlLen - offset, i > 0 ? ",?%d" : "?%d", i + 1);
+    snprintf(sql + offset, sqlLen - offset, ")");
+
+    if (sqlite3_prepare_v2(conn->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
+        for (i = 0; i < n; i++)
+            sqlite3_bind_text(stmt, i + 1, ids[i], -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_DONE)
+            deleted = sqlite3_changes(conn->db);
+        sqlite3_finalize(stmt);
+    }
+    free(sql);
+    return deleted;
 }
 
 int LsCache_Purge(const char* repoName, const char** validShortIds, int validCount) {
+    /* Tables whose deleted rows are counted in the result */
+    static const char* counted[] = {
+        "dir_entries", "cached_dirs", "snapshot_loaded",
+        "dir_sizes", "path_filters", "snapshot_stats"
+    };
     DbConn* conn;
     int totalDeleted = 0;
-    char* sql = NULL;
-    int sqlLen, offset, i;
-    char* errMsg = NULL;
-    sqlite3_stmt* stmt = NULL;
+    int i, n;
 
     if (!g_Initialized) return -1;
     if (validCount <= 0) return 0;
@@ -372,84 +746,484 @@ int LsCache_Purge(const char* repoName, const char** validShortIds, int validCou
     conn = GetConnection(repoName);
     if (!conn) return -1;
 
-    /* Build parameterized query: DELETE FROM ... WHERE short_id NOT IN (?1, ?2, ...) */
-    /* Estimate buffer: base SQL (~80) + 4 chars per param */
-    sqlLen = 128 + validCount * 4;
-    sql = (char*)malloc(sqlLen);
-    if (!sql) return -1;
+    for (i = 0; i < (int)(sizeof(counted) / sizeof(counted[0])); i++) {
+        n = DeleteForgotten(conn, counted[i], validShortIds, validCount);
+        if (n > 0) totalDeleted += n;
+    }
+
+    /* Stale names in search_names are harmless: they no longer match any
+       dir_entries row */
+    DeleteForgotten(conn, "search_indexed", validShortIds, validCount);
 
-    offset = snprintf(sql, sqlLen, "DELETE FROM dir_entries WHERE short_id NOT IN (");
-    for (i = 0; i < validCount; i++) {
-        if (i > 0) offset += snprintf(sql + offset, sqlLen - offset, ",");
-        offset += snprintf(sql + offset, sqlLen - offset, "?%d", i + 1);
+    /* If a folded snapshot is gone, files last seen in it must fall back to
+       older snapshots, so rebuild everything */
+    if (DeleteForgotten(conn, "last_seen_folded", validShortIds, validCount) > 0) {
+        sqlite3_exec(conn->db, "DELETE FROM file_last_seen; DELETE FROM last_seen_folded;",
+                     NULL, NULL, NULL);
     }
-    snprintf(sql + offset, sqlLen - offset, ")");
 
-    /* Execute for dir_entries */
-    if (sqlite3_prepare_v2(conn->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        for (i = 0; i < validCount; i++) {
-            sqlite3_bind_text(stmt, i + 1, validShortIds[i], -1, SQLITE_STATIC);
+    /* Index files of forgotten snapshots */
+    DeleteIndexFiles(repoName, validShortIds, validCount);
+
+    return totalDeleted;
+}
+
+BOOL LsCache_IsSnapshotLoaded(const char* repoName, const char* shortId) {
+    DbConn* conn;
+    int rc;
+
+    if (!g_Initialized) return FALSE;
+
+    conn = GetConnection(repoName);
+    if (!conn) return FALSE;
+
+    sqlite3_reset(conn->stmtCheckLoaded);
+    sqlite3_bind_text(conn->stmtCheckLoaded, 1, shortId, -1, SQLITE_STATIC);
+
+    rc = sqlite3_step(conn->stmtCheckLoaded);
+    return (rc == SQLITE_ROW);
+}
+
+/* A lease of another machine (a cache on a shared profile) cannot be
+   checked for a live holder; it is given up after this long */
+#define LEASE_TIMEOUT_SECONDS 1800
+
+/* This process as ingest_leases records it */
+typedef struct {
+    char host[MAX_COMPUTERNAME_LENGTH + 1];
+    DWORD pid;
+    LONG64 started;
+} LeaseOwner;
+
+static LONG64 FileTimeToInt64(const FILETIME* ft) {
+    return ((LONG64)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+static void GetLeaseOwner(LeaseOwner* owner) {
+    FILETIME created, exited, kernel, user;
+    DWORD size = sizeof(owner->host);
+
+    memset(owner, 0, sizeof(LeaseOwner));
+    if (!GetComputerNameA(owner->host, &size)) owner->host[0] = '\0';
+    owner->pid = GetCurrentProcessId();
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+        owner->started = FileTimeToInt64(&created);
+}
+
+/* TRUE if the process of a lease taken on this machine has ended, or its
+   pid now belongs to a process started later. A process of another user
+   that cannot be opened counts as running. */
+static BOOL IsLeaseHolderGone(DWORD pid, LONG64 started) {
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid);
+    FILETIME created, exited, kernel, user;
+    BOOL gone;
+
+    if (!process) return GetLastError() == ERROR_INVALID_PARAMETER;
+    gone = WaitForSingleObject(process, 0) == WAIT_OBJECT_0 ||
+           (GetProcessTimes(process, &created, &exited, &kernel, &user) &&
+            FileTimeToInt64(&created) != started);
+    CloseHandle(process);
+    return gone;
+}
+
+int LsCache_AcquireIngestLease(const char* repoName, const char* shortId) {
+    DbConn* conn;
+    sqlite3_stmt* stmt = NULL;
+    LeaseOwner me;
+    BOOL held = FALSE, ok;
+
+    if (!g_Initialized) return -1;
+
+    conn = GetConnection(repoName);
+    if (!conn) return -1;
+    GetLeaseOwner(&me);
+
+    /* Another process writing the database for longer than busy_timeout
+       is most likely ingesting: try again later */
+    if (sqlite3_exec(conn->db, "BEGIN IMMEDIATE", NULL, NULL, NULL) != SQLITE_OK)
+        return sqlite3_errcode(conn->db) == SQLITE_BUSY ? 0 : -1;
+
+    ok = sqlite3_prepare_v2(conn->db,
+            "SELECT host, pid, started, thread, strftime('%s','now') - taken_at "
+            "FROM ingest_leases WHERE short_id = ?1", -1, &stmt, NULL) == SQLITE_OK;
+    if (ok) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* host = (const char*)sqlite3_column_text(stmt, 0);
+            DWORD pid = (DWORD)sqlite3_column_int64(stmt, 1);
+            LONG64 started = sqlite3_column_int64(stmt, 2);
+            DWORD thread = (DWORD)sqlite3_column_int64(stmt, 3);
+
+            if (!host || strcmp(host, me.host) != 0) {
+                held = sqlite3_column_int64(stmt, 4) < LEASE_TIMEOUT_SECONDS;
+            } else if (pid == me.pid && started == me.started) {
+                /* Another thread of this process; one left by this thread
+                   is taken over */
+                held = thread != GetCurrentThreadId();
+            } else {
+                held = !IsLeaseHolderGone(pid, started);
+            }
         }
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            totalDeleted = sqlite3_changes(conn->db);
+        sqlite3_finalize(stmt);
+        stmt = NULL;
+    }
+
+    if (ok && !held) {
+        ok = sqlite3_prepare_v2(conn->db,
+                "INSERT OR REPLACE INTO ingest_leases "
+                "(short_id, host, pid, started, thread, taken_at) "
+                "VALUES (?1, ?2, ?3, ?4, ?5, strftime('%s','now'))", -1, &stmt, NULL) == SQLITE_OK;
+        if (ok) {
+            sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+            sqlite3_bind_text(stmt, 2, me.host, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 3, me.pid);
+            sqlite3_bind_int64(stmt, 4, me.started);
+            sqlite3_bind_int64(stmt, 5, GetCurrentThreadId());
+            ok = sqlite3_step(stmt) == SQLITE_DONE;
+            sqlite3_finalize(stmt);
         }
+    }
+
+    if (!ok || sqlite3_exec(conn->db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK) {
+        sqlite3_exec(conn->db, "ROLLBACK", NULL, NULL, NULL);
+        return -1;
+    }
+    return held ? 0 : 1;
+}
+
+void LsCache_ReleaseIngestLease(const char* repoName, const char* shortId) {
+    DbConn* conn;
+    sqlite3_stmt* stmt = NULL;
+    LeaseOwner me;
+
+    if (!g_Initialized) return;
+
+    conn = GetConnection(repoName);
+    if (!conn) return;
+    GetLeaseOwner(&me);
+
+    if (sqlite3_prepare_v2(conn->db,
+            "DELETE FROM ingest_leases WHERE short_id = ?1 AND host = ?2 "
+            "AND pid = ?3 AND started = ?4 AND thread = ?5", -1, &stmt, NULL) != SQLITE_OK)
+        return;
+    sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, me.host, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 3, me.pid);
+    sqlite3_bind_int64(stmt, 4, me.started);
+    sqlite3_bind_int64(stmt, 5, GetCurrentThreadId());
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+}
+
+/* Compute the recursive size of every directory of a loaded snapshot into
+   dir_sizes: one GROUP BY over the snapshot's files gives the direct sizes,
+   which a recursive CTE then adds to every ancestor ("/C/x/sub" -> "/C/x"
+   -> "/C" -> "/"). Directories without files below them get no row. */
+static BOOL RollupDirSizes(DbConn* conn, const char* shortId) {
+    sqlite3_stmt* stmt = NULL;
+    BOOL ok = FALSE;
+
+    sqlite3_exec(conn->db, "BEGIN", NULL, NULL, NULL);
+
+    if (sqlite3_prepare_v2(conn->db, "DELETE FROM dir_sizes WHERE short_id = ?1",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        ok = (sqlite3_step(stmt) == SQLITE_DONE);
+        sqlite3_finalize(stmt);
+    }
+
+    /* rtrim(path, <path without '/'>) cuts the last component, leaving
+       the parent with a trailing '/' */
+    if (ok && sqlite3_prepare_v2(conn->db,
+            "WITH RECURSIVE direct(path, bytes, files) AS ("
+            "  SELECT path, SUM(size_high * 4294967296 + size_low), COUNT(*) "
+            "  FROM dir_entries WHERE short_id = ?1 AND is_dir = 0 GROUP BY path"
+            "), up(path, bytes, files) AS ("
+            "  SELECT path, bytes, files FROM direct"
+            "  UNION ALL"
+            "  SELECT CASE WHEN length(rtrim(path, replace(path, '/', ''))) <= 1 THEN '/'"
+            "         ELSE substr(path, 1, length(rtrim(path, replace(path, '/', ''))) - 1) END,"
+            "         bytes, files"
+            "  FROM up WHERE path <> '/'"
+            ") "
+            "INSERT INTO dir_sizes (short_id, path, total_size, file_count) "
+            "SELECT ?1, path, SUM(bytes), SUM(files) FROM up GROUP BY path",
+            -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        ok = (sqlite3_step(stmt) == SQLITE_DONE);
         sqlite3_finalize(stmt);
+    } else {
+        ok = FALSE;
     }
 
-    /* Same for cached_dirs */
-    offset = snprintf(sql, sqlLen, "DELETE FROM cached_dirs WHERE short_id NOT IN (");
-    for (i = 0; i < validCount; i++) {
-        if (i > 0) offset += snprintf(sql + offset, sqlLen - offset, ",");
-        offset += snprintf(sql + offset, sqlLen - offset, "?%d", i + 1);
+    sqlite3_exec(conn->db, ok ? "COMMIT" : "ROLLBACK", NULL, NULL, NULL);
+    return ok;
+}
+
+/* Roll up a snapshot loaded before dir_sizes existed (or after a rewrite
+   cleared it). Returns FALSE if the snapshot is not fully loaded. */
+static BOOL EnsureDirSizes(DbConn* conn, const char* shortId) {
+    sqlite3_stmt* stmt = NULL;
+    BOOL present = FALSE;
+
+    sqlite3_reset(conn->stmtCheckLoaded);
+    sqlite3_bind_text(conn->stmtCheckLoaded, 1, shortId, -1, SQLITE_STATIC);
+    if (sqlite3_step(conn->stmtCheckLoaded) != SQLITE_ROW) return FALSE;
+    sqlite3_reset(conn->stmtCheckLoaded);
+
+    if (sqlite3_prepare_v2(conn->db, "SELECT 1 FROM dir_sizes WHERE short_id = ?1 LIMIT 1",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        present = (sqlite3_step(stmt) == SQLITE_ROW);
+        sqlite3_finalize(stmt);
     }
-    snprintf(sql + offset, sqlLen - offset, ")");
+    return present || RollupDirSizes(conn, shortId);
+}
 
-    if (sqlite3_prepare_v2(conn->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        for (i = 0; i < validCount; i++) {
-            sqlite3_bind_text(stmt, i + 1, validShortIds[i], -1, SQLITE_STATIC);
+/* Build the path filter of a loaded snapshot from its cached_dirs rows,
+   which are exactly the paths LsCache_Lookup can hit */
+static BOOL BuildPathFilter(DbConn* conn, const char* shortId) {
+    sqlite3_stmt* stmt = NULL;
+    BYTE* bits = NULL;
+    DWORD byteCount = 0;
+    BOOL ok = FALSE;
+
+    if (sqlite3_prepare_v2(conn->db, "SELECT COUNT(*) FROM cached_dirs WHERE short_id = ?1",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            byteCount = PathFilter_Size((DWORD)sqlite3_column_int64(stmt, 0));
+            bits = (BYTE*)calloc(byteCount, 1);
+            ok = (bits != NULL);
         }
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            totalDeleted += sqlite3_changes(conn->db);
+        sqlite3_finalize(stmt);
+    }
+
+    if (ok && sqlite3_prepare_v2(conn->db, "SELECT path FROM cached_dirs WHERE short_id = ?1",
+                                 -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* path = (const char*)sqlite3_column_text(stmt, 0);
+            if (path) PathFilter_Add(bits, byteCount, path);
         }
         sqlite3_finalize(stmt);
+    } else {
+        ok = FALSE;
     }
 
-    /* Same for snapshot_loaded */
-    offset = snprintf(sql, sqlLen, "DELETE FROM snapshot_loaded WHERE short_id NOT IN (");
-    for (i = 0; i < validCount; i++) {
-        if (i > 0) offset += snprintf(sql + offset, sqlLen - offset, ",");
-        offset += snprintf(sql + offset, sqlLen - offset, "?%d", i + 1);
+    if (ok && sqlite3_prepare_v2(conn->db,
+            "INSERT OR REPLACE INTO path_filters (short_id, bits) VALUES (?1, ?2)",
+            -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+        sqlite3_bind_blob(stmt, 2, bits, (int)byteCount, SQLITE_STATIC);
+        ok = (sqlite3_step(stmt) == SQLITE_DONE);
+        sqlite3_finalize(stmt);
+    } else {
+        ok = FALSE;
     }
-    snprintf(sql + offset, sqlLen - offset, ")");
 
-    if (sqlite3_prepare_v2(conn->db, sql, -1, &stmt, NULL) == SQLITE_OK) {
-        for (i = 0; i < validCount; i++) {
-            sqlite3_bind_text(stmt, i + 1, validShortIds[i], -1, SQLITE_STATIC);
+    free(bits);
+    return ok;
+}
+
+/* Keep a snapshot's path filter bits (Mem_Alloc'd) in g_Filters, unless
+   another thread loaded them meanwhile or the table cannot grow */
+static void KeepPathFilter(const char* repoName, const char* shortId, BYTE* bits, DWORD bytes) {
+    LoadedFilter* f;
+    int i;
+
+    AcquireSRWLockExclusive(&g_FilterLock);
+    for (i = 0; i < g_FilterCount && bits; i++) {
+        if (strcmp(g_Filters[i].shortId, shortId) == 0 &&
+            strcmp(g_Filters[i].repoName, repoName) == 0) {
+            Mem_Free(bits);
+            bits = NULL;
         }
-        if (sqlite3_step(stmt) == SQLITE_DONE) {
-            totalDeleted += sqlite3_changes(conn->db);
+    }
+    if (bits && g_FilterCount == g_FilterCapacity) {
+        int newCap = g_FilterCapacity ? g_FilterCapacity * 2 : 32;
+        LoadedFilter* grown = (LoadedFilter*)realloc(g_Filters, sizeof(LoadedFilter) * newCap);
+        if (grown) {
+            g_Filters = grown;
+            g_FilterCapacity = newCap;
         }
-        sqlite3_finalize(stmt);
     }
+    if (bits && g_FilterCount < g_FilterCapacity) {
+        f = &g_Filters[g_FilterCount++];
+        memset(f, 0, sizeof(LoadedFilter));
+        strncpy(f->repoName, repoName, sizeof(f->repoName) - 1);
+        strncpy(f->shortId, shortId, sizeof(f->shortId) - 1);
+        f->bits = bits;
+        f->byteCount = bytes;
+    } else {
+        Mem_Free(bits);
+    }
+    ReleaseSRWLockExclusive(&g_FilterLock);
+}
 
-    free(sql);
-    return totalDeleted;
+/* Read a snapshot's stored path filter into g_Filters. *outStored tells
+   whether a row exists; FALSE is returned without one or when the memory
+   budget refuses the bits. */
+static BOOL ReadPathFilter(DbConn* conn, const char* shortId, BOOL* outStored) {
+    sqlite3_stmt* stmt = NULL;
+    BOOL read = FALSE;
+
+    *outStored = FALSE;
+    if (sqlite3_prepare_v2(conn->db, "SELECT bits FROM path_filters WHERE short_id = ?1",
+                           -1, &stmt, NULL) != SQLITE_OK)
+        return FALSE;
+    sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const void* blob = sqlite3_column_blob(stmt, 0);
+        int bytes = sqlite3_column_bytes(stmt, 0);
+        /* Allocated before taking g_FilterLock, as Mem_Alloc may reclaim */
+        BYTE* bits = (blob && bytes > 0) ? (BYTE*)Mem_Alloc(MEM_PATH_FILTER, bytes) : NULL;
+
+        *outStored = TRUE;
+        if (bits) {
+            memcpy(bits, blob, bytes);
+            KeepPathFilter(conn->repoName, shortId, bits, (DWORD)bytes);
+            read = TRUE;
+        }
+    }
+    sqlite3_finalize(stmt);
+    return read;
 }
 
-BOOL LsCache_IsSnapshotLoaded(const char* repoName, const char* shortId) {
+/* Load the path filter of a snapshot; snapshots loaded before path filters
+   existed get theirs built on first use. FALSE if the snapshot is not
+   fully loaded. */
+static BOOL LoadPathFilter(DbConn* conn, const char* shortId) {
+    BOOL stored, loaded;
+
+    if (ReadPathFilter(conn, shortId, &stored)) return TRUE;
+    if (stored) return FALSE;
+
+    sqlite3_reset(conn->stmtCheckLoaded);
+    sqlite3_bind_text(conn->stmtCheckLoaded, 1, shortId, -1, SQLITE_STATIC);
+    loaded = (sqlite3_step(conn->stmtCheckLoaded) == SQLITE_ROW);
+    sqlite3_reset(conn->stmtCheckLoaded);
+
+    if (!loaded || !BuildPathFilter(conn, shortId)) return FALSE;
+    return ReadPathFilter(conn, shortId, &stored);
+}
+
+/* Test a path against a snapshot's loaded filter: 1 absent, 0 may exist,
+   -1 if the filter is not loaded */
+static int TestPathFilter(const char* repoName, const char* shortId, const char* path) {
+    int result = -1;
+    int i;
+
+    AcquireSRWLockShared(&g_FilterLock);
+    for (i = 0; i < g_FilterCount && result < 0; i++) {
+        const LoadedFilter* f = &g_Filters[i];
+        if (strcmp(f->shortId, shortId) == 0 && strcmp(f->repoName, repoName) == 0)
+            result = !PathFilter_MayContain(f->bits, f->byteCount, path);
+    }
+    ReleaseSRWLockShared(&g_FilterLock);
+    return result;
+}
+
+BOOL LsCache_IsPathAbsent(const char* repoName, const char* shortId, const char* path) {
     DbConn* conn;
-    int rc;
+    int absent;
 
     if (!g_Initialized) return FALSE;
 
-    conn = GetConnection(repoName);
-    if (!conn) return FALSE;
+    absent = TestPathFilter(repoName, shortId, path);
+    if (absent < 0) {
+        conn = GetConnection(repoName);
+        if (!conn || !LoadPathFilter(conn, shortId)) return FALSE;
+        /* The budget reclaimer may already have dropped it again */
+        absent = TestPathFilter(repoName, shortId, path);
+    }
+    return absent > 0;
+}
 
-    sqlite3_reset(conn->stmtCheckLoaded);
-    sqlite3_bind_text(conn->stmtCheckLoaded, 1, shortId, -1, SQLITE_STATIC);
+LONG64 LsCache_ReleaseFilters(void) {
+    LONG64 freed;
+
+    /* Called by the budget reclaimer, which must not wait for a lock that
+       the allocating thread may hold */
+    if (!TryAcquireSRWLockExclusive(&g_FilterLock)) return 0;
+    freed = RemoveFilters(NULL, NULL);
+    free(g_Filters);
+    g_Filters = NULL;
+    g_FilterCount = 0;
+    g_FilterCapacity = 0;
+    ReleaseSRWLockExclusive(&g_FilterLock);
+    return freed;
+}
 
-    rc = sqlite3_step(conn->stmtCheckLoaded);
-    return (rc == SQLITE_ROW);
+/* Write the index file of a loaded snapshot by merging its directories
+   (cached_dirs, which includes empty ones) with its entries, both streamed
+   in primary key order. Entries of a directory without a sentinel are
+   skipped, as LsCache_Lookup would not serve them either. */
+static BOOL WriteSnapIndex(DbConn* conn, const char* shortId) {
+    char dir[MAX_PATH];
+    char idxPath[MAX_PATH];
+    sqlite3_stmt* dirStmt = NULL;
+    sqlite3_stmt* entryStmt = NULL;
+    SnapIndexWriter* w = NULL;
+    int rcDir, rcEntry;
+    BOOL ok;
+
+    GetIndexDir(conn->repoName, dir, MAX_PATH);
+    CreateDirectoryA(dir, NULL);
+    GetIndexPath(conn->repoName, shortId, idxPath, MAX_PATH);
+
+    /* The old mapping would keep the file from being replaced */
+    CloseIndexes(conn->repoName, shortId);
+
+    ok = sqlite3_prepare_v2(conn->db,
+            "SELECT path FROM cached_dirs WHERE short_id = ?1 ORDER BY path",
+            -1, &dirStmt, NULL) == SQLITE_OK &&
+         sqlite3_prepare_v2(conn->db,
+            "SELECT path, name, is_dir, size_low, size_high, mtime_low, mtime_high "
+            "FROM dir_entries WHERE short_id = ?1 ORDER BY path, name",
+            -1, &entryStmt, NULL) == SQLITE_OK;
+    if (ok) {
+        w = SnapIndex_Create(idxPath);
+        ok = (w != NULL);
+    }
+
+    if (ok) {
+        sqlite3_bind_text(dirStmt, 1, shortId, -1, SQLITE_STATIC);
+        sqlite3_bind_text(entryStmt, 1, shortId, -1, SQLITE_STATIC);
+        rcDir = sqlite3_step(dirStmt);
+        rcEntry = sqlite3_step(entryStmt);
+
+        while (ok && rcDir == SQLITE_ROW) {
+            const char* dirPath = (const char*)sqlite3_column_text(dirStmt, 0);
+            ok = dirPath && SnapIndex_AddDir(w, dirPath);
+
+            while (ok && rcEntry == SQLITE_ROW) {
+                const char* entryPath = (const char*)sqlite3_column_text(entryStmt, 0);
+                const char* name = (const char*)sqlite3_column_text(entryStmt, 1);
+                int cmp = strcmp(entryPath ? entryPath : "", dirPath);
+
+                if (cmp > 0) break;
+                if (cmp == 0) {
+                    FILETIME mtime;
+                    mtime.dwLowDateTime = (DWORD)sqlite3_column_int64(entryStmt, 5);
+                    mtime.dwHighDateTime = (DWORD)sqlite3_column_int64(entryStmt, 6);
+                    ok = SnapIndex_AddEntry(w, name ? name : "",
+                                            sqlite3_column_int(entryStmt, 2),
+                                            (DWORD)sqlite3_column_int64(entryStmt, 3),
+                                            (DWORD)sqlite3_column_int64(entryStmt, 4),
+                                            mtime);
+                }
+                rcEntry = sqlite3_step(entryStmt);
+            }
+            rcDir = sqlite3_step(dirStmt);
+        }
+        ok = ok && rcDir == SQLITE_DONE;
+    }
+
+    sqlite3_finalize(dirStmt);
+    sqlite3_finalize(entryStmt);
+    return SnapIndex_Finish(w, ok);
 }
 
 void LsCache_MarkSnapshotLoaded(const char* repoName, const char* shortId) {
@@ -464,6 +1238,639 @@ void LsCache_MarkSnapshotLoaded(const char* repoName, const char* shortId) {
     sqlite3_bind_text(conn->stmtMarkLoaded, 1, shortId, -1, SQLITE_STATIC);
     sqlite3_bind_int64(conn->stmtMarkLoaded, 2, (sqlite3_int64)GetTickCount64());
     sqlite3_step(conn->stmtMarkLoaded);
+
+    /* The listing is complete now, so the directory sizes are final, and
+       so is the set of directories its path filter covers */
+    RollupDirSizes(conn, shortId);
+    DropFilters(repoName, shortId);
+    BuildPathFilter(conn, shortId);
+
+    /* ...and can be frozen into the snapshot's index file */
+    if (g_IndexFiles) WriteSnapIndex(conn, shortId);
+}
+
+void LsCache_StoreSnapshotStats(const char* repoName, const char* shortId,
+                                const SnapshotStats* stats) {
+    DbConn* conn;
+    sqlite3_stmt* s;
+
+    if (!g_Initialized) return;
+
+    conn = GetConnection(repoName);
+    if (!conn) return;
+
+    s = conn->stmtInsertStats;
+    sqlite3_reset(s);
+    sqlite3_bind_text(s, 1, shortId, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(s, 2, stats->resticMs);
+    sqlite3_bind_int64(s, 3, stats->firstByteMs);
+    sqlite3_bind_int64(s, 4, stats->outputBytes);
+    sqlite3_bind_int64(s, 5, stats->entryCount);
+    sqlite3_bind_int64(s, 6, stats->dirCount);
+    sqlite3_bind_int64(s, 7, stats->parseMs);
+    sqlite3_bind_int64(s, 8, stats->sqliteMs);
+    sqlite3_bind_int64(s, 9, stats->recordedAt);
+    sqlite3_step(s);
+}
+
+BOOL LsCache_GetSnapshotStats(const char* repoName, const char* shortId,
+                              SnapshotStats* out) {
+    DbConn* conn;
+    sqlite3_stmt* s;
+
+    if (!g_Initialized) return FALSE;
+
+    conn = GetConnection(repoName);
+    if (!conn) return FALSE;
+
+    s = conn->stmtLookupStats;
+    sqlite3_reset(s);
+    sqlite3_bind_text(s, 1, shortId, -1, SQLITE_STATIC);
+    if (sqlite3_step(s) != SQLITE_ROW) return FALSE;
+
+    out->resticMs    = sqlite3_column_int64(s, 0);
+    out->firstByteMs = sqlite3_column_int64(s, 1);
+    out->outputBytes = sqlite3_column_int64(s, 2);
+    out->entryCount  = sqlite3_column_int64(s, 3);
+    out->dirCount    = sqlite3_column_int64(s, 4);
+    out->parseMs     = sqlite3_column_int64(s, 5);
+    out->sqliteMs    = sqlite3_column_int64(s, 6);
+    out->recordedAt  = sqlite3_column_int64(s, 7);
+    sqlite3_reset(s);
+    return TRUE;
+}
+
+/* --- Name search --- */
+
+/* Build the name index on first use and catch up with snapshots loaded
+   since. search_names holds each distinct file name once; search_fts is a
+   trigram index over it, so LIKE '%abc%' patterns are answered without
+   scanning dir_entries. search_indexed remembers which snapshot loads have
+   been indexed (a reloaded snapshot has a new loaded_at and is re-indexed).
+   Returns FALSE if the index is unavailable; callers then scan by name. */
+static BOOL EnsureSearchIndex(DbConn* conn) {
+    static const char* schema =
+        "CREATE TABLE IF NOT EXISTS search_names ("
+        "  id INTEGER PRIMARY KEY,"
+        "  name TEXT NOT NULL UNIQUE"
+        ");"
+        "CREATE VIRTUAL TABLE IF NOT EXISTS search_fts USING fts5("
+        "  name, content='search_names', content_rowid='id', tokenize='trigram'"
+        ");"
+        "CREATE TABLE IF NOT EXISTS search_indexed ("
+        "  short_id TEXT PRIMARY KEY,"
+        "  loaded_at INTEGER NOT NULL"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_dir_entries_name ON dir_entries(name);";
+    static const char* pendingWhere =
+        "FROM snapshot_loaded l LEFT JOIN search_indexed s USING (short_id) "
+        "WHERE s.short_id IS NULL OR s.loaded_at <> l.loaded_at";
+    sqlite3_stmt* stmt = NULL;
+    sqlite3_int64 maxId = 0;
+    BOOL pending = FALSE;
+    BOOL ok;
+    char sql[512];
+
+    if (sqlite3_exec(conn->db, schema, NULL, NULL, NULL) != SQLITE_OK) return FALSE;
+
+    snprintf(sql, sizeof(sql), "SELECT 1 %s LIMIT 1", pendingWhere);
+    if (sqlite3_prepare_v2(conn->db, sql, -1, &stmt, NULL) != SQLITE_OK) return FALSE;
+    pending = (sqlite3_step(stmt) == SQLITE_ROW);
+    sqlite3_finalize(stmt);
+    if (!pending) return TRUE;
+
+    sqlite3_exec(conn->db, "BEGIN", NULL, NULL, NULL);
+
+    if (sqlite3_prepare_v2(conn->db, "SELECT IFNULL(MAX(id), 0) FROM search_names",
+                           -1, &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) maxId = sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+
+    /* New names only: search_names is append-only, so ids above maxId are
+       exactly the rows the FTS index has not seen */
+    snprintf(sql, sizeof(sql),
+             "INSERT OR IGNORE INTO search_names(name) "
+             "SELECT DISTINCT name FROM dir_entries WHERE short_id IN (SELECT l.short_id %s)",
+             pendingWhere);
+    ok = (sqlite3_exec(conn->db, sql, NULL, NULL, NULL) == SQLITE_OK);
+
+    if (ok && sqlite3_prepare_v2(conn->db,
+            "INSERT INTO search_fts(rowid, name) SELECT id, name FROM search_names WHERE id > ?1",
+            -1, &stmt, NULL) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, maxId);
+        ok = (sqlite3_step(stmt) == SQLITE_DONE);
+        sqlite3_finalize(stmt);
+    } else {
+        ok = FALSE;
+    }
+
+    if (ok) {
+        snprintf(sql, sizeof(sql),
+                 "INSERT OR REPLACE INTO search_indexed(short_id, loaded_at) "
+                 "SELECT l.short_id, l.loaded_at %s", pendingWhere);
+        ok = (sqlite3_exec(conn->db, sql, NULL, NULL, NULL) == SQLITE_OK);
+    }
+
+    sqlite3_exec(conn->db, ok ? "COMMIT" : "ROLLBACK", NULL, NULL, NULL);
+    return ok;
+}
+
+LsSearchHit* LsCache_Search(const char* repoName, const char* pathPrefix,
+                            const char* likePattern, LsNameFilter filter,
+                            void* userData, int maxHits, int* outCount) {
+    DbConn* conn;
+    sqlite3_stmt* nameStmt = NULL;
+    sqlite3_stmt* hitStmt = NULL;
+    LsSearchHit* hits = NULL;
+    int count = 0, capacity = 0;
+    BOOL indexed;
+    int rc;
+
+    *outCount = 0;
+    if (!g_Initialized || maxHits <= 0) return NULL;
+
+    conn = GetConnection(repoName);
+    if (!conn) return NULL;
+
+    indexed = EnsureSearchIndex(conn);
+
+    /* Candidate names: trigram index when available, else the distinct
+       names of all loaded snapshots */
+    if (indexed && likePattern && likePattern[0]) {
+        rc = sqlite3_prepare_v2(conn->db, "SELECT name FROM search_fts WHERE name LIKE ?1",
+                                -1, &nameStmt, NULL);
+        if (rc == SQLITE_OK) sqlite3_bind_text(nameStmt, 1, likePattern, -1, SQLITE_STATIC);
+    } else if (indexed) {
+        rc = sqlite3_prepare_v2(conn->db, "SELECT name FROM search_names", -1, &nameStmt, NULL);
+    } else {
+        rc = sqlite3_prepare_v2(conn->db,
+                "SELECT DISTINCT name FROM dir_entries WHERE short_id IN "
+                "(SELECT short_id FROM snapshot_loaded)", -1, &nameStmt, NULL);
+    }
+    if (rc != SQLITE_OK) return NULL;
+
+    /* Every row for a name under the prefix, in snapshots that are loaded
+       (partially cached snapshots would give incomplete answers) */
+    rc = sqlite3_prepare_v2(conn->db,
+            "SELECT short_id, path, is_dir, size_low, size_high, mtime_low, mtime_high "
+            "FROM dir_entries WHERE name = ?1 "
+            "AND (path = ?2 OR substr(path, 1, length(?2) + 1) = ?2 || '/' OR ?2 = '') "
+            "AND short_id IN (SELECT short_id FROM snapshot_loaded)",
+            -1, &hitStmt, NULL);
+    if (rc != SQLITE_OK) {
+        sqlite3_finalize(nameStmt);
+        return NULL;
+    }
+
+    while (count < maxHits && sqlite3_step(nameStmt) == SQLITE_ROW) {
+        const char* name = (const char*)sqlite3_column_text(nameStmt, 0);
+        if (!name || (filter && !filter(name, userData))) continue;
+
+        sqlite3_reset(hitStmt);
+        sqlite3_bind_text(hitStmt, 1, name, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(hitStmt, 2, pathPrefix ? pathPrefix : "", -1, SQLITE_STATIC);
+
+        while (count < maxHits && sqlite3_step(hitStmt) == SQLITE_ROW) {
+            LsSearchHit* h;
+            const char* shortId = (const char*)sqlite3_column_text(hitStmt, 0);
+            const char* path = (const char*)sqlite3_column_text(hitStmt, 1);
+
+            if (count >= capacity) {
+                int newCap = capacity ? capacity * 2 : 64;
+                LsSearchHit* grown;
+                if (newCap > maxHits) newCap = maxHits;
+                grown = (LsSearchHit*)realloc(hits, sizeof(LsSearchHit) * newCap);
+                if (!grown) break;
+                hits = grown;
+                capacity = newCap;
+            }
+
+            h = &hits[count++];
+            memset(h, 0, sizeof(*h));
+            strncpy(h->shortId, shortId ? shortId : "", sizeof(h->shortId) - 1);
+            strncpy(h->path, path ? path : "", sizeof(h->path) - 1);
+            Utf8ToAnsi(name, h->entry.name, MAX_PATH);
+            h->entry.isDirectory = sqlite3_column_int(hitStmt, 2);
+            h->entry.fileSizeLow = (DWORD)sqlite3_column_int64(hitStmt, 3);
+            h->entry.fileSizeHigh = (DWORD)sqlite3_column_int64(hitStmt, 4);
+            h->entry.lastWriteTime.dwLowDateTime = (DWORD)sqlite3_column_int64(hitStmt, 5);
+            h->entry.lastWriteTime.dwHighDateTime = (DWORD)sqlite3_column_int64(hitStmt, 6);
+        }
+    }
+
+    sqlite3_finalize(hitStmt);
+    sqlite3_finalize(nameStmt);
+
+    *outCount = count;
+    return hits;
+}
+
+/* --- Snapshot diff --- */
+
+/* Read the current row of a diff listing statement into a DirEntry */
+static void ReadDiffRow(sqlite3_stmt* stmt, LsDiffKind kind, LsDiffEntry* out) {
+    const char* path = (const char*)sqlite3_column_text(stmt, 0);
+    const char* name = (const char*)sqlite3_column_text(stmt, 1);
+
+    memset(out, 0, sizeof(*out));
+    out->kind = kind;
+    strncpy(out->path, path ? path : "", sizeof(out->path) - 1);
+    Utf8ToAnsi(name ? name : "", out->entry.name, MAX_PATH);
+    out->entry.isDirectory = FALSE;
+    out->entry.fileSizeLow = (DWORD)sqlite3_column_int64(stmt, 2);
+    out->entry.fileSizeHigh = (DWORD)sqlite3_column_int64(stmt, 3);
+    out->entry.lastWriteTime.dwLowDateTime = (DWORD)sqlite3_column_int64(stmt, 4);
+    out->entry.lastWriteTime.dwHighDateTime = (DWORD)sqlite3_column_int64(stmt, 5);
+}
+
+LsDiffEntry* LsCache_Diff(const char* repoName, const char* oldShortId,
+                          const char* newShortId, const char* pathPrefix,
+                          int maxEntries, int* outCount) {
+    /* Both sides come out of the (short_id, path, name) primary key in
+       order, so the join is a single pass without sorting */
+    static const char* sql =
+        "SELECT path, name, size_low, size_high, mtime_low, mtime_high "
+        "FROM dir_entries WHERE short_id = ?1 AND is_dir = 0 "
+        "AND (?2 = '' OR path = ?2 OR substr(path, 1, length(?2) + 1) = ?2 || '/') "
+        "ORDER BY path, name";
+    DbConn* conn;
+    sqlite3_stmt* oldStmt = NULL;
+    sqlite3_stmt* newStmt = NULL;
+    LsDiffEntry* diffs = NULL;
+    int count = 0, capacity = 0;
+    int rcOld, rcNew;
+    const char* prefix = pathPrefix ? pathPrefix : "";
+
+    *outCount = 0;
+    if (!g_Initialized || maxEntries <= 0) return NULL;
+
+    conn = GetConnection(repoName);
+    if (!conn) return NULL;
+
+    if (sqlite3_prepare_v2(conn->db, sql, -1, &oldStmt, NULL) != SQLITE_OK) return NULL;
+    if (sqlite3_prepare_v2(conn->db, sql, -1, &newStmt, NULL) != SQLITE_OK) {
+        sqlite3_finalize(oldStmt);
+        return NULL;
+    }
+    sqlite3_bind_text(oldStmt, 1, oldShortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(oldStmt, 2, prefix, -1, SQLITE_STATIC);
+    sqlite3_bind_text(newStmt, 1, newShortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(newStmt, 2, prefix, -1, SQLITE_STATIC);
+
+    /* One transaction, so both cursors see the same state */
+    sqlite3_exec(conn->db, "BEGIN", NULL, NULL, NULL);
+    rcOld = sqlite3_step(oldStmt);
+    rcNew = sqlite3_step(newStmt);
+
+    while ((rcOld == SQLITE_ROW || rcNew == SQLITE_ROW) && count < maxEntries) {
+        sqlite3_stmt* from = NULL;
+        LsDiffKind kind = LS_DIFF_ADDED;
+        int cmp;
+
+        if (rcOld != SQLITE_ROW) {
+            cmp = 1;
+        } else if (rcNew != SQLITE_ROW) {
+            cmp = -1;
+        } else {
+            cmp = strcmp((const char*)sqlite3_column_text(oldStmt, 0),
+                         (const char*)sqlite3_column_text(newStmt, 0));
+            if (cmp == 0)
+                cmp = strcmp((const char*)sqlite3_column_text(oldStmt, 1),
+                             (const char*)sqlite3_column_text(newStmt, 1));
+        }
+
+        if (cmp < 0) {
+            from = oldStmt;
+            kind = LS_DIFF_REMOVED;
+        } else if (cmp > 0) {
+            from = newStmt;
+            kind = LS_DIFF_ADDED;
+        } else {
+            int col;
+            for (col = 2; col <= 5; col++) {
+                if (sqlite3_column_int64(oldStmt, col) != sqlite3_column_int64(newStmt, col)) {
+                    from = newStmt;
+                    kind = LS_DIFF_MODIFIED;
+                    break;
+                }
+            }
+        }
+
+        if (from) {
+            if (count >= capacity) {
+                int newCap = capacity ? capacity * 2 : 64;
+                LsDiffEntry* grown;
+                if (newCap > maxEntries) newCap = maxEntries;
+                grown = (LsDiffEntry*)realloc(diffs, sizeof(LsDiffEntry) * newCap);
+                if (!grown) break;
+                diffs = grown;
+                capacity = newCap;
+            }
+            ReadDiffRow(from, kind, &diffs[count++]);
+        }
+
+        if (cmp <= 0) rcOld = sqlite3_step(oldStmt);
+        if (cmp >= 0) rcNew = sqlite3_step(newStmt);
+    }
+
+    sqlite3_finalize(oldStmt);
+    sqlite3_finalize(newStmt);
+    sqlite3_exec(conn->db, "COMMIT", NULL, NULL, NULL);
+
+    *outCount = count;
+    return diffs;
+}
+
+/* --- Deleted files --- */
+
+/* file_last_seen holds, per backup path series, every file of the folded
+   snapshots with the newest snapshot that contained it (an upsert that
+   keeps the later snapshot, i.e. a union over the series). Files whose
+   last snapshot is not the newest one of the series are the deleted ones.
+   last_seen_folded records which snapshot loads have been folded in, so
+   each newly ingested snapshot is added once. */
+static BOOL EnsureLastSeenIndex(DbConn* conn) {
+    static const char* schema =
+        "CREATE TABLE IF NOT EXISTS file_last_seen ("
+        "  series TEXT NOT NULL,"
+        "  path TEXT NOT NULL,"
+        "  name TEXT NOT NULL,"
+        "  short_id TEXT NOT NULL,"
+        "  snap_time INTEGER NOT NULL,"
+        "  size_low INTEGER NOT NULL,"
+        "  size_high INTEGER NOT NULL,"
+        "  mtime_low INTEGER NOT NULL,"
+        "  mtime_high INTEGER NOT NULL,"
+        "  PRIMARY KEY (series, path, name)"
+        ");"
+        "CREATE INDEX IF NOT EXISTS idx_file_last_seen_snap ON file_last_seen(series, short_id);"
+        "CREATE TABLE IF NOT EXISTS last_seen_folded ("
+        "  series TEXT NOT NULL,"
+        "  short_id TEXT NOT NULL,"
+        "  loaded_at INTEGER NOT NULL,"
+        "  PRIMARY KEY (series, short_id)"
+        ");";
+    return sqlite3_exec(conn->db, schema, NULL, NULL, NULL) == SQLITE_OK;
+}
+
+/* Fold the loaded snapshots of a series that are not folded in yet */
+static BOOL FoldLastSeen(DbConn* conn, const char* series, const char* prefix,
+                         const char** shortIds, const LONGLONG* snapTimes, int snapCount) {
+    sqlite3_stmt* pending = NULL;
+    sqlite3_stmt* fold = NULL;
+    sqlite3_stmt* mark = NULL;
+    BOOL ok = TRUE;
+    BOOL inTransaction = FALSE;
+    int i;
+
+    if (sqlite3_prepare_v2(conn->db,
+            "SELECT l.loaded_at FROM snapshot_loaded l "
+            "LEFT JOIN last_seen_folded f ON f.series = ?1 AND f.short_id = l.short_id "
+            "WHERE l.short_id = ?2 AND (f.short_id IS NULL OR f.loaded_at <> l.loaded_at)",
+            -1, &pending, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn->db,
+            "INSERT INTO file_last_seen (series, path, name, short_id, snap_time,"
+            "  size_low, size_high, mtime_low, mtime_high) "
+            "SELECT ?1, path, name, short_id, ?3, size_low, size_high, mtime_low, mtime_high "
+            "FROM dir_entries WHERE short_id = ?2 AND is_dir = 0 "
+            "AND (?4 = '' OR path = ?4 OR substr(path, 1, length(?4) + 1) = ?4 || '/') "
+            "ON CONFLICT (series, path, name) DO UPDATE SET "
+            "  short_id = excluded.short_id, snap_time = excluded.snap_time,"
+            "  size_low = excluded.size_low, size_high = excluded.size_high,"
+            "  mtime_low = excluded.mtime_low, mtime_high = excluded.mtime_high "
+            "WHERE excluded.snap_time >= file_last_seen.snap_time",
+            -1, &fold, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(conn->db,
+            "INSERT OR REPLACE INTO last_seen_folded (series, short_id, loaded_at) "
+            "VALUES (?1, ?2, ?3)",
+            -1, &mark, NULL) != SQLITE_OK) {
+        sqlite3_finalize(pending);
+        sqlite3_finalize(fold);
+        sqlite3_finalize(mark);
+        return FALSE;
+    }
+
+    for (i = 0; i < snapCount && ok; i++) {
+        sqlite3_int64 loadedAt;
+
+        sqlite3_reset(pending);
+        sqlite3_bind_text(pending, 1, series, -1, SQLITE_STATIC);
+        sqlite3_bind_text(pending, 2, shortIds[i], -1, SQLITE_STATIC);
+        if (sqlite3_step(pending) != SQLITE_ROW) continue;
+        loadedAt = sqlite3_column_int64(pending, 0);
+        sqlite3_reset(pending);
+
+        if (!inTransaction) {
+            sqlite3_exec(conn->db, "BEGIN", NULL, NULL, NULL);
+            inTransaction = TRUE;
+        }
+
+        sqlite3_reset(fold);
+        sqlite3_bind_text(fold, 1, series, -1, SQLITE_STATIC);
+        sqlite3_bind_text(fold, 2, shortIds[i], -1, SQLITE_STATIC);
+        sqlite3_bind_int64(fold, 3, snapTimes[i]);
+        sqlite3_bind_text(fold, 4, prefix, -1, SQLITE_STATIC);
+        ok = (sqlite3_step(fold) == SQLITE_DONE);
+
+        if (ok) {
+            sqlite3_reset(mark);
+            sqlite3_bind_text(mark, 1, series, -1, SQLITE_STATIC);
+            sqlite3_bind_text(mark, 2, shortIds[i], -1, SQLITE_STATIC);
+            sqlite3_bind_int64(mark, 3, loadedAt);
+            ok = (sqlite3_step(mark) == SQLITE_DONE);
+        }
+    }
+
+    if (inTransaction)
+        sqlite3_exec(conn->db, ok ? "COMMIT" : "ROLLBACK", NULL, NULL, NULL);
+
+    sqlite3_finalize(pending);
+    sqlite3_finalize(fold);
+    sqlite3_finalize(mark);
+    return ok;
+}
+
+LsSearchHit* LsCache_DeletedFiles(const char* repoName, const char* series,
+                                  const char* pathPrefix, const char** shortIds,
+                                  const LONGLONG* snapTimes, int snapCount,
+                                  int maxHits, int* outCount) {
+    DbConn* conn;
+    sqlite3_stmt* stmt = NULL;
+    LsSearchHit* hits = NULL;
+    int count = 0, capacity = 0;
+    const char* prefix = pathPrefix ? pathPrefix : "";
+    const char* newest;
+
+    *outCount = 0;
+    if (!g_Initialized || snapCount <= 0 || maxHits <= 0) return NULL;
+
+    conn = GetConnection(repoName);
+    if (!conn) return NULL;
+
+    newest = shortIds[snapCount - 1];
+    if (!LsCache_IsSnapshotLoaded(repoName, newest)) return NULL;
+
+    if (!EnsureLastSeenIndex(conn) ||
+        !FoldLastSeen(conn, series, prefix, shortIds, snapTimes, snapCount))
+        return NULL;
+
+    if (sqlite3_prepare_v2(conn->db,
+            "SELECT short_id, path, name, size_low, size_high, mtime_low, mtime_high "
+            "FROM file_last_seen WHERE series = ?1 AND short_id <> ?2",
+            -1, &stmt, NULL) != SQLITE_OK)
+        return NULL;
+    sqlite3_bind_text(stmt, 1, series, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, newest, -1, SQLITE_STATIC);
+
+    while (count < maxHits && sqlite3_step(stmt) == SQLITE_ROW) {
+        LsSearchHit* h;
+        const char* shortId = (const char*)sqlite3_column_text(stmt, 0);
+        const char* path = (const char*)sqlite3_column_text(stmt, 1);
+        const char* name = (const char*)sqlite3_column_text(stmt, 2);
+
+        if (count >= capacity) {
+            int newCap = capacity ? capacity * 2 : 64;
+            LsSearchHit* grown;
+            if (newCap > maxHits) newCap = maxHits;
+            grown = (LsSearchHit*)realloc(hits, sizeof(LsSearchHit) * newCap);
+            if (!grown) break;
+            hits = grown;
+            capacity = newCap;
+        }
+
+        h = &hits[count++];
+        memset(h, 0, sizeof(*h));
+        strncpy(h->shortId, shortId ? shortId : "", sizeof(h->shortId) - 1);
+        strncpy(h->path, path ? path : "", sizeof(h->path) - 1);
+        Utf8ToAnsi(name ? name : "", h->entry.name, MAX_PATH);
+        h->entry.fileSizeLow = (DWORD)sqlite3_column_int64(stmt, 3);
+        h->entry.fileSizeHigh = (DWORD)sqlite3_column_int64(stmt, 4);
+        h->entry.lastWriteTime.dwLowDateTime = (DWORD)sqlite3_column_int64(stmt, 5);
+        h->entry.lastWriteTime.dwHighDateTime = (DWORD)sqlite3_column_int64(stmt, 6);
+    }
+    sqlite3_finalize(stmt);
+
+    *outCount = count;
+    return hits;
+}
+
+/* --- Size reports --- */
+
+LsSearchHit* LsCache_LargestFiles(const char* repoName, const char* shortId,
+                                  const char* pathPrefix, int maxHits, int* outCount) {
+    DbConn* conn;
+    sqlite3_stmt* stmt = NULL;
+    LsSearchHit* hits;
+    int count = 0;
+    const char* prefix = pathPrefix ? pathPrefix : "";
+
+    *outCount = 0;
+    if (!g_Initialized || maxHits <= 0) return NULL;
+
+    conn = GetConnection(repoName);
+    if (!conn) return NULL;
+
+    /* Walks idx_dir_entries_size backwards and stops after maxHits files
+       below the prefix, so the cost does not depend on the snapshot size */
+    if (sqlite3_prepare_v2(conn->db,
+            "SELECT path, name, size_low, size_high, mtime_low, mtime_high "
+            "FROM dir_entries INDEXED BY idx_dir_entries_size "
+            "WHERE short_id = ?1 AND is_dir = 0 "
+            "AND (?2 = '' OR path = ?2 OR substr(path, 1, length(?2) + 1) = ?2 || '/') "
+            "ORDER BY size_high DESC, size_low DESC LIMIT ?3",
+            -1, &stmt, NULL) != SQLITE_OK)
+        return NULL;
+    sqlite3_bind_text(stmt, 1, shortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, prefix, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 3, maxHits);
+
+    hits = (LsSearchHit*)calloc(maxHits, sizeof(LsSearchHit));
+    if (!hits) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    while (count < maxHits && sqlite3_step(stmt) == SQLITE_ROW) {
+        LsSearchHit* h = &hits[count++];
+        const char* path = (const char*)sqlite3_column_text(stmt, 0);
+        const char* name = (const char*)sqlite3_column_text(stmt, 1);
+
+        strncpy(h->shortId, shortId, sizeof(h->shortId) - 1);
+        strncpy(h->path, path ? path : "", sizeof(h->path) - 1);
+        Utf8ToAnsi(name ? name : "", h->entry.name, MAX_PATH);
+        h->entry.fileSizeLow = (DWORD)sqlite3_column_int64(stmt, 2);
+        h->entry.fileSizeHigh = (DWORD)sqlite3_column_int64(stmt, 3);
+        h->entry.lastWriteTime.dwLowDateTime = (DWORD)sqlite3_column_int64(stmt, 4);
+        h->entry.lastWriteTime.dwHighDateTime = (DWORD)sqlite3_column_int64(stmt, 5);
+    }
+    sqlite3_finalize(stmt);
+
+    if (count == 0) {
+        free(hits);
+        return NULL;
+    }
+    *outCount = count;
+    return hits;
+}
+
+LsDirGrowth* LsCache_DirGrowth(const char* repoName, const char* oldShortId,
+                               const char* newShortId, const char* pathPrefix,
+                               int maxDirs, int* outCount) {
+    DbConn* conn;
+    sqlite3_stmt* stmt = NULL;
+    LsDirGrowth* dirs;
+    int count = 0;
+    const char* prefix = pathPrefix ? pathPrefix : "";
+
+    *outCount = 0;
+    if (!g_Initialized || maxDirs <= 0) return NULL;
+
+    conn = GetConnection(repoName);
+    if (!conn) return NULL;
+
+    if (!EnsureDirSizes(conn, oldShortId) || !EnsureDirSizes(conn, newShortId))
+        return NULL;
+
+    /* One primary-key probe into the old rollup per directory of the new
+       one; a directory missing from the old snapshot grew by all of it */
+    if (sqlite3_prepare_v2(conn->db,
+            "SELECT n.path, n.total_size, n.total_size - IFNULL(o.total_size, 0) AS growth,"
+            "  n.file_count - IFNULL(o.file_count, 0) "
+            "FROM dir_sizes n LEFT JOIN dir_sizes o ON o.short_id = ?1 AND o.path = n.path "
+            "WHERE n.short_id = ?2 "
+            "AND (?3 = '' OR n.path = ?3 OR substr(n.path, 1, length(?3) + 1) = ?3 || '/') "
+            "AND growth > 0 ORDER BY growth DESC LIMIT ?4",
+            -1, &stmt, NULL) != SQLITE_OK)
+        return NULL;
+    sqlite3_bind_text(stmt, 1, oldShortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 2, newShortId, -1, SQLITE_STATIC);
+    sqlite3_bind_text(stmt, 3, prefix, -1, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 4, maxDirs);
+
+    dirs = (LsDirGrowth*)calloc(maxDirs, sizeof(LsDirGrowth));
+    if (!dirs) {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+
+    while (count < maxDirs && sqlite3_step(stmt) == SQLITE_ROW) {
+        LsDirGrowth* d = &dirs[count++];
+        const char* path = (const char*)sqlite3_column_text(stmt, 0);
+
+        strncpy(d->path, path ? path : "", sizeof(d->path) - 1);
+        d->totalSize = sqlite3_column_int64(stmt, 1);
+        d->growth = sqlite3_column_int64(stmt, 2);
+        d->fileCountDelta = sqlite3_column_int64(stmt, 3);
+    }
+    sqlite3_finalize(stmt);
+
+    if (count == 0) {
+        free(dirs);
+        return NULL;
+    }
+    *outCount = count;
+    return dirs;
 }
 
 void LsCache_InvalidateFile(const char* repoName, const char* filePath) {
@@ -505,8 +1912,20 @@ void LsCache_InvalidateFile(const char* repoName, const char* filePath) {
         sqlite3_finalize(stmt);
     }
 
-    /* Also clear snapshot_loaded since directory structure changed */
-    sqlite3_exec(conn->db, "DELETE FROM snapshot_loaded", NULL, NULL, NULL);
+    /* Also clear snapshot_loaded since directory structure changed; the
+       directory sizes and path filters are rebuilt when a snapshot is
+       reloaded */
+    sqlite3_exec(conn->db,
+                 "DELETE FROM snapshot_loaded; DELETE FROM dir_sizes; DELETE FROM path_filters;",
+                 NULL, NULL, NULL);
+    DropFilters(repoName, NULL);
+
+    /* Index files hold the old listings of every snapshot */
+    DeleteIndexFiles(repoName, NULL, 0);
+
+    /* The removed file may still be recorded as last seen; rebuild on next use */
+    sqlite3_exec(conn->db, "DELETE FROM file_last_seen; DELETE FROM last_seen_folded;",
+                 NULL, NULL, NULL);
 }
 
 void LsCache_DeleteRepo(const char* repoName) {
@@ -515,19 +1934,20 @@ void LsCache_DeleteRepo(const char* repoName) {
 
     if (!g_Initialized) return;
 
-    /* Close connection if open */
-    for (i = 0; i < g_DbCount; i++) {
-        if (strcmp(g_Dbs[i].repoName, repoName) == 0) {
-            FinalizeStatements(&g_Dbs[i]);
-            sqlite3_close(g_Dbs[i].db);
-            /* Shift remaining connections down */
-            g_DbCount--;
-            if (i < g_DbCount) {
-                g_Dbs[i] = g_Dbs[g_DbCount];
-            }
-            break;
+    DropFilters(repoName, NULL);
+
+    /* Close the connections of every thread */
+    AcquireSRWLockExclusive(&g_DbLock);
+    i = 0;
+    while (i < g_DbCount) {
+        if (strcmp(g_Dbs[i]->repoName, repoName) == 0) {
+            CloseConnection(g_Dbs[i]);
+            g_Dbs[i] = g_Dbs[--g_DbCount];
+        } else {
+            i++;
         }
     }
+    ReleaseSRWLockExclusive(&g_DbLock);
 
     /* Delete the DB file */
     if (EnsureCacheDir()) {
@@ -538,19 +1958,46 @@ void LsCache_DeleteRepo(const char* repoName) {
         DeleteFileA(dbPath);
         snprintf(dbPath, MAX_PATH, "%s\\%s.db-shm", g_CacheDir, repoName);
         DeleteFileA(dbPath);
+        DeleteIndexFiles(repoName, NULL, 0);
     }
 }
 
+void LsCache_ReleaseThread(void) {
+    DWORD self = GetCurrentThreadId();
+    int i = 0;
+
+    AcquireSRWLockExclusive(&g_DbLock);
+    while (i < g_DbCount) {
+        if (g_Dbs[i]->threadId == self) {
+            CloseConnection(g_Dbs[i]);
+            g_Dbs[i] = g_Dbs[--g_DbCount];
+        } else {
+            i++;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_DbLock);
+}
+
 void LsCache_Shutdown(void) {
     int i;
 
-    for (i = 0; i < g_DbCount; i++) {
-        FinalizeStatements(&g_Dbs[i]);
-        if (g_Dbs[i].db) {
-            sqlite3_close(g_Dbs[i].db);
-            g_Dbs[i].db = NULL;
-        }
+    DropFilters(NULL, NULL);
+    AcquireSRWLockExclusive(&g_FilterLock);
+    free(g_Filters);
+    g_Filters = NULL;
+    g_FilterCapacity = 0;
+    ReleaseSRWLockExclusive(&g_FilterLock);
+
+    AcquireSRWLockExclusive(&g_IndexLock);
+    for (i = 0; i < MAX_OPEN_INDEXES; i++) {
+        SnapIndex_Close(g_Indexes[i].index);
+        memset(&g_Indexes[i], 0, sizeof(OpenIndex));
     }
+    ReleaseSRWLockExclusive(&g_IndexLock);
+
+    AcquireSRWLockExclusive(&g_DbLock);
+    for (i = 0; i < g_DbCount; i++) CloseConnection(g_Dbs[i]);
     g_DbCount = 0;
+    ReleaseSRWLockExclusive(&g_DbLock);
     g_Initialized = FALSE;
 }
@@ -12,6 +12,10 @@
 /* Initialize the persistent directory listing cache subsystem. */
 void LsCache_Init(void);
 
+/* Write a memory-mapped index file for every snapshot marked loaded, and
+   serve lookups of those snapshots from it ([Cache] IndexFiles=1). */
+void LsCache_SetIndexFiles(BOOL enable);
+
 /* Look up a cached directory listing.
    Returns a malloc'd DirEntry array (caller must free), or NULL on miss.
    Sets *outCount to the number of entries. */
@@ -28,7 +32,8 @@ void LsCache_Store(const char* repoName, const char* shortId,
    Returns the number of rows deleted, or -1 on error. */
 int LsCache_Purge(const char* repoName, const char** validShortIds, int validCount);
 
-/* Delete the entire database for a repository. */
+/* Delete the entire database for a repository. No other thread may be
+   using the repository's cache meanwhile. */
 void LsCache_DeleteRepo(const char* repoName);
 
 /* Invalidate cached entries for a specific file path across all snapshots.
@@ -38,9 +43,140 @@ void LsCache_InvalidateFile(const char* repoName, const char* filePath);
 /* Check if a snapshot has been fully loaded (bulk-cached). */
 BOOL LsCache_IsSnapshotLoaded(const char* repoName, const char* shortId);
 
-/* Mark a snapshot as fully loaded after bulk caching. */
+/* Take the lease on ingesting a snapshot, shared through the repo's
+   database by every TC instance (and thread) using it, so a snapshot is
+   listed once. Returns 1 when taken (ingest, then release it), 0 while
+   another live process or thread holds it (wait, then check whether the
+   snapshot got loaded or try again), -1 if the lease table cannot be used.
+   A lease whose process has ended is taken over; one of another machine
+   after half an hour. */
+int LsCache_AcquireIngestLease(const char* repoName, const char* shortId);
+
+/* Give back a lease taken by this thread with LsCache_AcquireIngestLease. */
+void LsCache_ReleaseIngestLease(const char* repoName, const char* shortId);
+
+/* TRUE if a fully loaded snapshot certainly has no cached directory at
+   path (UTF-8), decided by its Bloom filter without a query. FALSE means
+   "may exist": look it up as usual. The filter is built when the snapshot
+   is marked loaded and kept in memory after first use. */
+BOOL LsCache_IsPathAbsent(const char* repoName, const char* shortId, const char* path);
+
+/* Free the in-memory path filters (reloaded on demand).
+   Returns the number of bytes released. */
+LONG64 LsCache_ReleaseFilters(void);
+
+/* Mark a snapshot as fully loaded after bulk caching. Also rolls up the
+   recursive size of each of its directories for LsCache_DirGrowth, builds
+   its path filter, and writes the snapshot's index file when index files
+   are enabled. */
 void LsCache_MarkSnapshotLoaded(const char* repoName, const char* shortId);
 
+/* Cost of one bulk ingest of a snapshot ("restic ls" + parse + SQLite). */
+typedef struct {
+    LONGLONG resticMs;      /* restic ls wall time */
+    LONGLONG firstByteMs;   /* time to first byte of restic output (-1 if none) */
+    LONGLONG outputBytes;   /* size of the restic ls output */
+    LONGLONG entryCount;    /* all entries in the snapshot */
+    LONGLONG dirCount;      /* directories among them */
+    LONGLONG parseMs;       /* JSON parsing */
+    LONGLONG sqliteMs;      /* grouping + storing all directories */
+    LONGLONG recordedAt;    /* Unix time of the ingest */
+} SnapshotStats;
+
+/* Record the ingest statistics of a snapshot (replaces earlier ones).
+   Kept when the snapshot_loaded flag is cleared, so the last known
+   cost of a snapshot remains available as an estimate. */
+void LsCache_StoreSnapshotStats(const char* repoName, const char* shortId,
+                                const SnapshotStats* stats);
+
+/* Look up the ingest statistics of a snapshot. Returns FALSE if none. */
+BOOL LsCache_GetSnapshotStats(const char* repoName, const char* shortId,
+                              SnapshotStats* out);
+
+/* One cached file found by LsCache_Search, LsCache_DeletedFiles or
+   LsCache_LargestFiles. */
+typedef struct {
+    char shortId[16];
+    char path[MAX_PATH];    /* UTF-8 restic path of the parent directory */
+    DirEntry entry;         /* name converted to ANSI */
+} LsSearchHit;
+
+/* Exact test of a UTF-8 file name; return TRUE to keep it. */
+typedef BOOL (*LsNameFilter)(const char* nameUtf8, void* userData);
+
+/* Search the names of all fully loaded snapshots of a repository.
+   pathPrefix (UTF-8 restic path, "" for everything) limits hits to that
+   directory and below. likePattern, if not empty, is an SQL LIKE pattern
+   that narrows candidates through a trigram index built lazily on first
+   use; filter then decides on each distinct name. Returns a malloc'd array
+   of at most maxHits hits (caller must free), or NULL if none. */
+LsSearchHit* LsCache_Search(const char* repoName, const char* pathPrefix,
+                            const char* likePattern, LsNameFilter filter,
+                            void* userData, int maxHits, int* outCount);
+
+/* Files of a backup path series that are missing from its newest snapshot.
+   shortIds/snapTimes list the series' snapshots oldest first (times as
+   FILETIME ticks); the last one must be fully loaded. series identifies
+   the backup path, pathPrefix is its UTF-8 restic path ("" for everything).
+   Loaded snapshots are folded into a persistent "last seen" table once per
+   ingest, so repeated calls only add newly loaded snapshots. Each hit's
+   shortId is the last snapshot that contained the file. Returns a malloc'd
+   array of at most maxHits hits (caller must free), or NULL if none. */
+LsSearchHit* LsCache_DeletedFiles(const char* repoName, const char* series,
+                                  const char* pathPrefix, const char** shortIds,
+                                  const LONGLONG* snapTimes, int snapCount,
+                                  int maxHits, int* outCount);
+
+/* One file that differs between two snapshots. */
+typedef enum {
+    LS_DIFF_ADDED,
+    LS_DIFF_REMOVED,
+    LS_DIFF_MODIFIED    /* size or mtime changed */
+} LsDiffKind;
+
+typedef struct {
+    LsDiffKind kind;
+    char path[MAX_PATH];    /* UTF-8 restic path of the parent directory */
+    DirEntry entry;         /* new version (old one for LS_DIFF_REMOVED), name in ANSI */
+} LsDiffEntry;
+
+/* Compare the cached files of two fully loaded snapshots below pathPrefix
+   (UTF-8 restic path, "" for everything) by a merge-join of their listings.
+   Directories are not reported. Returns a malloc'd array of at most
+   maxEntries differences ordered by path and name (caller must free), or
+   NULL if there are none. */
+LsDiffEntry* LsCache_Diff(const char* repoName, const char* oldShortId,
+                          const char* newShortId, const char* pathPrefix,
+                          int maxEntries, int* outCount);
+
+/* The maxHits largest files of a fully loaded snapshot below pathPrefix
+   (UTF-8 restic path, "" for everything), largest first, read from a size
+   index. Returns a malloc'd array (caller must free), or NULL if none. */
+LsSearchHit* LsCache_LargestFiles(const char* repoName, const char* shortId,
+                                  const char* pathPrefix, int maxHits, int* outCount);
+
+/* One directory whose recursive size grew between two snapshots. */
+typedef struct {
+    char path[MAX_PATH];        /* UTF-8 restic path of the directory */
+    LONGLONG totalSize;         /* recursive size in the new snapshot */
+    LONGLONG growth;            /* bytes added since the old snapshot */
+    LONGLONG fileCountDelta;    /* files added (negative if fewer) */
+} LsDirGrowth;
+
+/* The maxDirs directories below pathPrefix whose recursive size grew most
+   from oldShortId to newShortId (both fully loaded), largest growth first.
+   Answered from the per-directory size rollups computed when a snapshot is
+   marked loaded. Returns a malloc'd array (caller must free), or NULL if
+   nothing grew. */
+LsDirGrowth* LsCache_DirGrowth(const char* repoName, const char* oldShortId,
+                               const char* newShortId, const char* pathPrefix,
+                               int maxDirs, int* outCount);
+
+/* Close the calling thread's DB connections, when it is about to end.
+   Each thread reads and writes through connections of its own; those of
+   threads that ended without this call are closed when the table fills. */
+void LsCache_ReleaseThread(void);
+
 /* Shut down the persistent cache: close all open DB connections. */
 void LsCache_Shutdown(void);
 
@@ -0,0 +1,164 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "mem_budget.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MB (1024LL * 1024LL)
+
+/* 32-bit Total Commander has 2-4 GB of address space for everything */
+#define DEFAULT_BUDGET ((sizeof(void*) == 4) ? 256 * MB : 1024 * MB)
+
+/* Prepended to every Mem_Alloc block; a union keeps the payload aligned */
+typedef union {
+    struct {
+        size_t size;
+        int sub;
+    } h;
+    double align[2];
+} MemHeader;
+
+static volatile LONG64 g_Current[MEM_SUBSYSTEM_COUNT];
+static volatile LONG64 g_Peak[MEM_SUBSYSTEM_COUNT];
+static volatile LONG64 g_Total = 0;
+static volatile LONG64 g_TotalPeak = 0;
+static volatile LONG64 g_Allocations = 0;
+static LONG64 g_Budget = DEFAULT_BUDGET;
+static volatile LONG g_Reclaims = 0;
+static volatile LONG g_Refusals = 0;
+static volatile LONG g_InReclaim = 0;
+static MemReclaimFunc g_Reclaimer = NULL;
+
+static const char* g_SubsystemNames[MEM_SUBSYSTEM_COUNT] = {
+    "Snapshot list cache", "Listing cache", "restic output", "ls parse", "[All Files] merge",
+    "Path filters", "Native index", "Native trees", "Native file data",
+    "Trace buffers"
+};
+
+static void UpdatePeak(volatile LONG64* peak, LONG64 value) {
+    LONG64 old = *peak;
+    while (value > old) {
+        LONG64 seen = InterlockedCompareExchange64(peak, value, old);
+        if (seen == old) break;
+        old = seen;
+    }
+}
+
+/* Add bytes to the totals, reclaiming cache memory if the budget is hit.
+   The reclaimer is not re-entered: a request made while it runs is only
+   checked against the budget. */
+static BOOL Reserve(MemSubsystem sub, LONG64 bytes) {
+    LONG64 total = InterlockedExchangeAdd64(&g_Total, bytes) + bytes;
+
+    if (total > g_Budget) {
+        if (g_Reclaimer && InterlockedCompareExchange(&g_InReclaim, 1, 0) == 0) {
+            InterlockedIncrement(&g_Reclaims);
+            g_Reclaimer(total - g_Budget);
+            InterlockedExchange(&g_InReclaim, 0);
+            total = InterlockedCompareExchange64(&g_Total, 0, 0);
+        }
+        if (total > g_Budget) {
+            InterlockedExchangeAdd64(&g_Total, -bytes);
+            InterlockedIncrement(&g_Refusals);
+            return FALSE;
+        }
+    }
+
+    UpdatePeak(&g_Peak[sub], InterlockedExchangeAdd64(&g_Current[sub], bytes) + bytes);
+    UpdatePeak(&g_TotalPeak, total);
+    InterlockedIncrement64(&g_Allocations);
+    return TRUE;
+}
+
+static void Release(MemSubsystem sub, LONG64 bytes) {
+    InterlockedExchangeAdd64(&g_Current[sub], -bytes);
+    InterlockedExchangeAdd64(&g_Total, -bytes);
+}
+
+void Mem_InitFromConfig(const char* configFilePath) {
+    int budgetMb = (int)GetPrivateProfileIntA("Memory", "BudgetMB", 0, configFilePath);
+    if (budgetMb > 0) g_Budget = (LONG64)budgetMb * MB;
+}
+
+void Mem_SetReclaimer(MemReclaimFunc reclaimer) {
+    g_Reclaimer = reclaimer;
+}
+
+void* Mem_Alloc(MemSubsystem sub, size_t size) {
+    MemHeader* block;
+
+    if (sub >= MEM_SUBSYSTEM_COUNT) return NULL;
+    if (!Reserve(sub, (LONG64)size)) return NULL;
+
+    block = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (!block) {
+        Release(sub, (LONG64)size);
+        return NULL;
+    }
+    block->h.size = size;
+    block->h.sub = sub;
+    return block + 1;
+}
+
+void Mem_Free(void* ptr) {
+    MemHeader* block;
+    if (!ptr) return;
+    block = (MemHeader*)ptr - 1;
+    Release((MemSubsystem)block->h.sub, (LONG64)block->h.size);
+    free(block);
+}
+
+BOOL Mem_Charge(MemSubsystem sub, size_t bytes) {
+    if (sub >= MEM_SUBSYSTEM_COUNT) return FALSE;
+    return Reserve(sub, (LONG64)bytes);
+}
+
+void Mem_Uncharge(MemSubsystem sub, size_t bytes) {
+    if (sub >= MEM_SUBSYSTEM_COUNT) return;
+    Release(sub, (LONG64)bytes);
+}
+
+void Mem_GetStats(MemStats* out) {
+    int i;
+    for (i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        out->current[i] = g_Current[i];
+        out->peak[i] = g_Peak[i];
+    }
+    out->total = g_Total;
+    out->totalPeak = g_TotalPeak;
+    out->allocations = g_Allocations;
+    out->budget = g_Budget;
+    out->reclaims = g_Reclaims;
+    out->refusals = g_Refusals;
+}
+
+int Mem_Format(char* buf, int bufSize) {
+    MemStats s;
+    int len, i, n;
+
+    if (bufSize <= 0) return 0;
+    Mem_GetStats(&s);
+
+    len = snprintf(buf, bufSize,
+                   "Memory (all repositories)\r\n"
+                   "  Budget: %lld KB, in use %lld KB, peak %lld KB\r\n"
+                   "  Cache evictions for budget: %ld, refused requests: %ld\r\n"
+                   "  %-20s %12s %12s\r\n",
+                   (long long)(s.budget / 1024), (long long)(s.total / 1024),
+                   (long long)(s.totalPeak / 1024), (long)s.reclaims, (long)s.refusals,
+                   "subsystem", "current KB", "peak KB");
+    if (len < 0 || len >= bufSize) return (len < 0) ? 0 : bufSize - 1;
+
+    for (i = 0; i < MEM_SUBSYSTEM_COUNT; i++) {
+        n = snprintf(buf + len, bufSize - len, "  %-20s %12lld %12lld\r\n",
+                     g_SubsystemNames[i], (long long)(s.current[i] / 1024),
+                     (long long)(s.peak[i] / 1024));
+        if (n < 0 || n >= bufSize - len) return bufSize - 1;
+        len += n;
+    }
+    return len;
+}
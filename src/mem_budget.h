@@ -0,0 +1,78 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef MEM_BUDGET_H
+#define MEM_BUDGET_H
+
+#include <windows.h>
+
+/* Memory accounting per subsystem and a global budget for the plugin.
+
+   Long-lived cache memory is allocated through Mem_Alloc/Mem_Free, which
+   record the size in a small header. Transient buffers that are handed to
+   callers as plain malloc memory are accounted with Mem_Charge/Mem_Uncharge
+   by the code that owns them for the duration of an operation.
+
+   When an allocation or charge would exceed the budget, the registered
+   reclaimer is asked to free cache memory first (on the calling thread).
+   If that is not enough, the request is refused: Mem_Alloc returns NULL and
+   Mem_Charge returns FALSE, and the caller skips caching or aborts the
+   operation instead of exhausting the address space.
+
+   The budget defaults to 256 MB in 32-bit builds and 1024 MB in 64-bit
+   builds, and can be set with [Memory] BudgetMB=<n> in restic_wfx.ini. */
+
+typedef enum {
+    MEM_SNAPSHOT_CACHE,   /* g_SnapCache */
+    MEM_LISTING_CACHE,    /* g_LsCache */
+    MEM_RESTIC_OUTPUT,    /* restic stdout buffers while reading and parsing */
+    MEM_PARSE,            /* parsed restic ls entries during snapshot ingest */
+    MEM_MERGE,            /* [All Files] merged listings being built */
+    MEM_PATH_FILTER,      /* per-snapshot path filters loaded by ls_cache */
+    MEM_NATIVE_INDEX,     /* blob tables of repositories read by native_repo */
+    MEM_NATIVE_TREES,     /* decoded tree blobs cached by native_repo */
+    MEM_NATIVE_DATA,      /* file content blobs decoded ahead of writing */
+    MEM_TRACE,            /* per-thread event rings of trace.c */
+    MEM_SUBSYSTEM_COUNT
+} MemSubsystem;
+
+typedef struct {
+    LONG64 current[MEM_SUBSYSTEM_COUNT];
+    LONG64 peak[MEM_SUBSYSTEM_COUNT];
+    LONG64 total;
+    LONG64 totalPeak;
+    LONG64 budget;
+    LONG64 allocations;   /* successful Mem_Alloc and Mem_Charge calls */
+    LONG reclaims;        /* times the reclaimer was invoked */
+    LONG refusals;        /* requests refused after reclaiming */
+} MemStats;
+
+/* Frees cache memory; needBytes is how much must be released to fit the
+   pending request. Returns the number of bytes actually released. */
+typedef LONG64 (*MemReclaimFunc)(LONG64 needBytes);
+
+/* Read [Memory] BudgetMB from the INI file (keeps the default if absent). */
+void Mem_InitFromConfig(const char* configFilePath);
+
+/* Register the cache reclaimer (one per process; NULL to remove). */
+void Mem_SetReclaimer(MemReclaimFunc reclaimer);
+
+/* Tracked allocation. Returns NULL if out of memory or over budget. */
+void* Mem_Alloc(MemSubsystem sub, size_t size);
+void Mem_Free(void* ptr);
+
+/* Account memory allocated elsewhere. Returns FALSE (and accounts nothing)
+   if the bytes don't fit the budget even after reclaiming. */
+BOOL Mem_Charge(MemSubsystem sub, size_t bytes);
+void Mem_Uncharge(MemSubsystem sub, size_t bytes);
+
+/* Snapshot of the counters. */
+void Mem_GetStats(MemStats* out);
+
+/* Render the counters as a text report (\r\n line ends). Returns the length. */
+int Mem_Format(char* buf, int bufSize);
+
+#endif /* MEM_BUDGET_H */
@@ -0,0 +1,202 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "metrics.h"
+#include "repo_config.h"  /* For MAX_REPOS, MAX_REPO_PATH */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Fixed registry, one slot per repository path. Slots are claimed with a
+   compare-exchange and never released, so lookups need no lock and a
+   RepoMetrics pointer stays valid for the life of the process. */
+
+#define SLOT_FREE     0
+#define SLOT_CLAIMED  1
+#define SLOT_READY    2
+
+typedef struct {
+    volatile LONG state;
+    char repoPath[MAX_REPO_PATH];
+    RepoMetrics m;
+} MetricsSlot;
+
+static MetricsSlot g_Slots[MAX_REPOS];
+
+static const char* g_CommandNames[RC_COUNT] = {
+    "snapshots", "ls", "find", "dump", "restore", "rewrite", "other"
+};
+
+/* Find the slot for repoPath, creating it if needed. NULL if the table is full. */
+static RepoMetrics* GetSlot(const char* repoPath, BOOL create) {
+    int i;
+
+    if (!repoPath) return NULL;
+
+    for (i = 0; i < MAX_REPOS; i++) {
+        if (g_Slots[i].state == SLOT_READY && strcmp(g_Slots[i].repoPath, repoPath) == 0)
+            return &g_Slots[i].m;
+    }
+    if (!create) return NULL;
+
+    for (i = 0; i < MAX_REPOS; i++) {
+        if (InterlockedCompareExchange(&g_Slots[i].state, SLOT_CLAIMED, SLOT_FREE) == SLOT_FREE) {
+            strncpy(g_Slots[i].repoPath, repoPath, MAX_REPO_PATH - 1);
+            g_Slots[i].repoPath[MAX_REPO_PATH - 1] = '\0';
+            InterlockedExchange(&g_Slots[i].state, SLOT_READY);
+            return &g_Slots[i].m;
+        }
+    }
+    return NULL;
+}
+
+static void HistogramAdd(MetricHistogram* h, LONGLONG value) {
+    int bucket = 0;
+    if (value < 0) value = 0;
+    while (bucket < METRIC_HIST_BUCKETS - 1 && value >= (1LL << bucket)) bucket++;
+    InterlockedIncrement64(&h->count);
+    InterlockedExchangeAdd64(&h->sum, value);
+    InterlockedIncrement64(&h->buckets[bucket]);
+}
+
+void Metrics_Add(const char* repoPath, MetricCounter counter, LONGLONG delta) {
+    RepoMetrics* m = GetSlot(repoPath, TRUE);
+    if (m && counter < MC_COUNT)
+        InterlockedExchangeAdd64(&m->counters[counter], delta);
+}
+
+void Metrics_RecordRestic(const char* repoPath, ResticCommand cmd,
+                          LONGLONG durationMs, LONGLONG bytes) {
+    RepoMetrics* m = GetSlot(repoPath, TRUE);
+    if (!m || cmd >= RC_COUNT) return;
+    InterlockedIncrement64(&m->spawns[cmd]);
+    InterlockedExchangeAdd64(&m->counters[MC_PIPE_BYTES], bytes);
+    HistogramAdd(&m->resticMs[cmd], durationMs);
+}
+
+void Metrics_RecordIngest(const char* repoPath, LONGLONG rows, LONGLONG micros) {
+    RepoMetrics* m = GetSlot(repoPath, TRUE);
+    if (!m) return;
+    if (micros <= 0) micros = 1;
+    InterlockedExchangeAdd64(&m->counters[MC_INGEST_ROWS], rows);
+    HistogramAdd(&m->ingestRowsPerSec, rows * 1000000 / micros);
+}
+
+ResticCommand Metrics_CommandFromArgs(const char* args) {
+    int i;
+    size_t len;
+
+    if (!args) return RC_OTHER;
+    while (*args == ' ') args++;
+    len = strcspn(args, " ");
+    for (i = 0; i < RC_OTHER; i++) {
+        if (strlen(g_CommandNames[i]) == len && strncmp(args, g_CommandNames[i], len) == 0)
+            return (ResticCommand)i;
+    }
+    return RC_OTHER;
+}
+
+BOOL Metrics_Get(const char* repoPath, RepoMetrics* out) {
+    RepoMetrics* m = GetSlot(repoPath, FALSE);
+    if (!m) {
+        memset(out, 0, sizeof(RepoMetrics));
+        return FALSE;
+    }
+    /* Field-by-field snapshot; individual values may be a few updates apart */
+    memcpy(out, m, sizeof(RepoMetrics));
+    return TRUE;
+}
+
+LONGLONG Metrics_Percentile(const MetricHistogram* h, int pct) {
+    LONGLONG target, seen = 0;
+    int i;
+
+    if (h->count == 0) return 0;
+    target = (h->count * pct + 99) / 100;
+    if (target < 1) target = 1;
+    for (i = 0; i < METRIC_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= target) return (i == 0) ? 0 : (1LL << i) - 1;
+    }
+    return (1LL << (METRIC_HIST_BUCKETS - 1));
+}
+
+int Metrics_HitRate(const RepoMetrics* m, MetricCounter hit, MetricCounter miss) {
+    LONGLONG total = m->counters[hit] + m->counters[miss];
+    if (total <= 0) return -1;
+    return (int)(m->counters[hit] * 100 / total);
+}
+
+/* Append printf-style text to buf, tracking the running length */
+static void Append(char* buf, int bufSize, int* len, const char* fmt, ...) {
+    va_list ap;
+    int n;
+    if (*len >= bufSize - 1) return;
+    va_start(ap, fmt);
+    n = vsnprintf(buf + *len, bufSize - *len, fmt, ap);
+    va_end(ap);
+    if (n > 0) *len += (n < bufSize - *len) ? n : bufSize - *len - 1;
+}
+
+static void AppendHitLine(char* buf, int bufSize, int* len, const RepoMetrics* m,
+                          const char* label, MetricCounter hit, MetricCounter miss) {
+    int rate = Metrics_HitRate(m, hit, miss);
+    Append(buf, bufSize, len, "  %-20s hits %-8lld misses %-8lld", label,
+           (long long)m->counters[hit], (long long)m->counters[miss]);
+    if (rate >= 0) Append(buf, bufSize, len, "(%d%%)\r\n", rate);
+    else Append(buf, bufSize, len, "(-)\r\n");
+}
+
+int Metrics_Format(const char* repoName, const char* repoPath, char* buf, int bufSize) {
+    RepoMetrics m;
+    int len = 0;
+    int i;
+
+    if (bufSize <= 0) return 0;
+    buf[0] = '\0';
+    Metrics_Get(repoPath, &m);
+
+    Append(buf, bufSize, &len, "Statistics for repository \"%s\"\r\n", repoName);
+    Append(buf, bufSize, &len, "Path: %s\r\n", repoPath);
+    Append(buf, bufSize, &len, "Counted since Total Commander loaded the plugin.\r\n\r\n");
+
+    Append(buf, bufSize, &len, "Cache\r\n");
+    AppendHitLine(buf, bufSize, &len, &m, "In-memory listings", MC_MEM_HIT, MC_MEM_MISS);
+    AppendHitLine(buf, bufSize, &len, &m, "SQLite listings", MC_SQLITE_HIT, MC_SQLITE_MISS);
+    AppendHitLine(buf, bufSize, &len, &m, "Path filter skips", MC_FILTER_SKIP, MC_FILTER_PASS);
+    AppendHitLine(buf, bufSize, &len, &m, "Native listings", MC_NATIVE_HIT, MC_NATIVE_MISS);
+    AppendHitLine(buf, bufSize, &len, &m, "Snapshot list", MC_SNAPLIST_HIT, MC_SNAPLIST_MISS);
+
+    Append(buf, bufSize, &len, "\r\nrestic calls\r\n");
+    Append(buf, bufSize, &len, "  %-10s %8s %10s %10s %10s\r\n",
+           "command", "count", "mean ms", "p50 ms", "p99 ms");
+    for (i = 0; i < RC_COUNT; i++) {
+        const MetricHistogram* h = &m.resticMs[i];
+        if (m.spawns[i] == 0) continue;
+        Append(buf, bufSize, &len, "  %-10s %8lld %10lld %10lld %10lld\r\n",
+               g_CommandNames[i], (long long)m.spawns[i],
+               (long long)(h->count ? h->sum / h->count : 0),
+               (long long)Metrics_Percentile(h, 50),
+               (long long)Metrics_Percentile(h, 99));
+    }
+    Append(buf, bufSize, &len, "  (percentiles are histogram bucket upper bounds)\r\n");
+    Append(buf, bufSize, &len, "  Bytes read from restic: %lld\r\n",
+           (long long)m.counters[MC_PIPE_BYTES]);
+
+    Append(buf, bufSize, &len, "\r\nSnapshot ingest\r\n");
+    Append(buf, bufSize, &len, "  Snapshots ingested:  %lld\r\n",
+           (long long)m.ingestRowsPerSec.count);
+    Append(buf, bufSize, &len, "  Rows stored:         %lld\r\n",
+           (long long)m.counters[MC_INGEST_ROWS]);
+    if (m.ingestRowsPerSec.count > 0) {
+        Append(buf, bufSize, &len, "  Rows/s mean:         %lld\r\n",
+               (long long)(m.ingestRowsPerSec.sum / m.ingestRowsPerSec.count));
+        Append(buf, bufSize, &len, "  Rows/s p50:          %lld\r\n",
+               (long long)Metrics_Percentile(&m.ingestRowsPerSec, 50));
+    }
+
+    return len;
+}
@@ -0,0 +1,87 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <windows.h>
+
+/* Per-repository counters and histograms for the cache layers and restic
+   calls. Keyed by restic repository path (repo->path), which both the
+   navigation layer and the process layer have at hand. Shown in the extra
+   content columns and in the virtual [Statistics].txt file. */
+
+typedef enum {
+    MC_MEM_HIT,          /* directory listing served from g_LsCache */
+    MC_MEM_MISS,
+    MC_SQLITE_HIT,       /* directory listing served from the SQLite cache */
+    MC_SQLITE_MISS,
+    MC_FILTER_SKIP,      /* listing ruled out by a snapshot's path filter */
+    MC_FILTER_PASS,
+    MC_NATIVE_HIT,       /* directory listing read from a local repository in-process */
+    MC_NATIVE_MISS,      /* ... or handed to restic because that failed */
+    MC_SNAPLIST_HIT,     /* snapshot list served from g_SnapCache */
+    MC_SNAPLIST_MISS,
+    MC_PIPE_BYTES,       /* bytes read from restic stdout */
+    MC_INGEST_ROWS,      /* rows bulk-cached into SQLite */
+    MC_COUNT
+} MetricCounter;
+
+typedef enum {
+    RC_SNAPSHOTS,
+    RC_LS,
+    RC_FIND,
+    RC_DUMP,
+    RC_RESTORE,
+    RC_REWRITE,
+    RC_OTHER,
+    RC_COUNT
+} ResticCommand;
+
+/* Bucket i counts values in [2^(i-1), 2^i); bucket 0 counts zero.
+   The last bucket is open-ended. */
+#define METRIC_HIST_BUCKETS 24
+
+typedef struct {
+    LONG64 count;
+    LONG64 sum;
+    LONG64 buckets[METRIC_HIST_BUCKETS];
+} MetricHistogram;
+
+typedef struct {
+    LONG64 counters[MC_COUNT];
+    LONG64 spawns[RC_COUNT];
+    MetricHistogram resticMs[RC_COUNT];     /* restic wall time per command */
+    MetricHistogram ingestRowsPerSec;       /* one sample per ingested snapshot */
+} RepoMetrics;
+
+/* Add delta to a counter for the given repository. */
+void Metrics_Add(const char* repoPath, MetricCounter counter, LONGLONG delta);
+
+/* Record one finished restic process: command type, wall time, stdout bytes. */
+void Metrics_RecordRestic(const char* repoPath, ResticCommand cmd,
+                          LONGLONG durationMs, LONGLONG bytes);
+
+/* Record one snapshot ingest (rows stored and time taken). */
+void Metrics_RecordIngest(const char* repoPath, LONGLONG rows, LONGLONG micros);
+
+/* Classify a restic argument string ("ls --json ...") by its first word. */
+ResticCommand Metrics_CommandFromArgs(const char* args);
+
+/* Copy the metrics of a repository. Returns FALSE if nothing was recorded yet. */
+BOOL Metrics_Get(const char* repoPath, RepoMetrics* out);
+
+/* Approximate percentile (0-100) of a histogram: upper bound of the bucket. */
+LONGLONG Metrics_Percentile(const MetricHistogram* h, int pct);
+
+/* Hit rate in percent for a hit/miss counter pair, or -1 if no lookups. */
+int Metrics_HitRate(const RepoMetrics* m, MetricCounter hit, MetricCounter miss);
+
+/* Render the [Statistics] report for a repository into buf.
+   Returns the number of characters written (excluding the terminator). */
+int Metrics_Format(const char* repoName, const char* repoPath, char* buf, int bufSize);
+
+#endif /* METRICS_H */
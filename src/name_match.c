@@ -0,0 +1,299 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "name_match.h"
+#include <stdio.h>
+#include <string.h>
+
+#define REGEX_PREFIX     "re:"
+#define REGEX_PREFIX_LEN 3
+
+/* Shortest literal worth a trigram lookup */
+#define MIN_LIKE_LITERAL 3
+
+static unsigned char FoldCase(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c - 'A' + 'a') : c;
+}
+
+static unsigned int FoldChar(unsigned int c) {
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/* Decode the UTF-8 character at s into *cp and return its length; a byte
+   that does not start a valid sequence counts as one character. */
+static int NextChar(const char* s, unsigned int* cp) {
+    const unsigned char* p = (const unsigned char*)s;
+    int len, i;
+
+    if (p[0] < 0x80) len = 1;
+    else if ((p[0] & 0xE0) == 0xC0) len = 2;
+    else if ((p[0] & 0xF0) == 0xE0) len = 3;
+    else if ((p[0] & 0xF8) == 0xF0) len = 4;
+    else len = 1;
+
+    *cp = (len == 1) ? p[0] : p[0] & (0x7F >> len);
+    for (i = 1; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            *cp = p[0];
+            return 1;
+        }
+        *cp = (*cp << 6) | (p[i] & 0x3F);
+    }
+    return len;
+}
+
+/* --- Wildcards --- */
+
+/* Iterative '*' / '?' matcher: on mismatch, retry from the last '*' with one
+   more character consumed. '?' and the retries step over whole UTF-8
+   characters; literals compare bytewise. */
+static BOOL WildcardMatch(const char* pat, const char* s) {
+    const char* starPat = NULL;
+    const char* starS = NULL;
+    unsigned int c;
+
+    while (*s) {
+        if (*pat == '*') {
+            starPat = ++pat;
+            starS = s;
+        } else if (*pat == '?') {
+            pat++;
+            s += NextChar(s, &c);
+        } else if (*pat && FoldCase(*pat) == FoldCase(*s)) {
+            pat++;
+            s++;
+        } else if (starPat) {
+            pat = starPat;
+            starS += NextChar(starS, &c);
+            s = starS;
+        } else {
+            return FALSE;
+        }
+    }
+    while (*pat == '*') pat++;
+    return *pat == '\0';
+}
+
+/* --- Regular expressions --- */
+
+/* End of the atom starting at re ('.', a class, an escape or a literal
+   character) */
+static const char* AtomEnd(const char* re) {
+    unsigned int c;
+
+    if (*re == '\\') return re[1] ? re + 1 + NextChar(re + 1, &c) : re + 1;
+    if (*re == '[') {
+        const char* p = re + 1;
+        if (*p == '^') p++;
+        if (*p == ']') p++;              /* leading ']' is a literal */
+        while (*p && *p != ']') {
+            if (*p == '\\' && p[1]) p++;
+            p++;
+        }
+        return *p ? p + 1 : p;
+    }
+    return re + NextChar(re, &c);
+}
+
+/* Does character c match the escape whose letter starts at e? */
+static BOOL MatchEscape(const char* e, unsigned int c) {
+    unsigned int letter;
+
+    NextChar(e, &letter);
+    switch (letter) {
+        case 'd': return c >= '0' && c <= '9';
+        case 'w': return (c >= '0' && c <= '9') || (FoldChar(c) >= 'a' && FoldChar(c) <= 'z') ||
+                         c == '_' || c >= 0x80;
+        case 's': return c == ' ' || c == '\t';
+        default:  return FoldChar(letter) == FoldChar(c);
+    }
+}
+
+/* Does the character at s match the atom at re? Returns its length in
+   bytes, 0 if it does not match (or s is at the end). */
+static int MatchAtom(const char* re, const char* s) {
+    unsigned int c, lit;
+    int len;
+
+    if (!*s) return 0;
+    len = NextChar(s, &c);
+    if (*re == '.') return len;
+    if (*re == '\\') return MatchEscape(re + 1, c) ? len : 0;
+    if (*re == '[') {
+        const char* p = re + 1;
+        BOOL negate = FALSE, found = FALSE;
+        if (*p == '^') {
+            negate = TRUE;
+            p++;
+        }
+        do {
+            unsigned int lo, hi;
+            if (*p == '\\' && p[1]) {
+                if (MatchEscape(p + 1, c)) found = TRUE;
+                p += 1 + NextChar(p + 1, &lo);
+                continue;
+            }
+            p += NextChar(p, &lo);
+            lo = FoldChar(lo);
+            hi = lo;
+            if (p[0] == '-' && p[1] && p[1] != ']') {
+                p += 1 + NextChar(p + 1, &hi);
+                hi = FoldChar(hi);
+            }
+            if (FoldChar(c) >= lo && FoldChar(c) <= hi) found = TRUE;
+        } while (*p && *p != ']');
+        return found != negate ? len : 0;
+    }
+    NextChar(re, &lit);
+    return FoldChar(lit) == FoldChar(c) ? len : 0;
+}
+
+static BOOL MatchHere(const char* re, const char* s);
+
+/* Greedy repetition of the atom at re (at least min times), then the rest */
+static BOOL MatchRepeat(const char* re, const char* rest, const char* s, int min) {
+    int len = MatchAtom(re, s);
+
+    if (len && MatchRepeat(re, rest, s + len, min > 0 ? min - 1 : 0)) return TRUE;
+    return min == 0 && MatchHere(rest, s);
+}
+
+static BOOL MatchHere(const char* re, const char* s) {
+    const char* end;
+    int len;
+
+    if (*re == '\0') return TRUE;
+    if (re[0] == '$' && re[1] == '\0') return *s == '\0';
+
+    end = AtomEnd(re);
+    if (*end == '*') return MatchRepeat(re, end + 1, s, 0);
+    if (*end == '+') return MatchRepeat(re, end + 1, s, 1);
+    len = MatchAtom(re, s);
+    if (*end == '?') {
+        if (len && MatchHere(end + 1, s + len)) return TRUE;
+        return MatchHere(end + 1, s);
+    }
+    return len && MatchHere(end, s + len);
+}
+
+static BOOL RegexMatch(const char* re, const char* s) {
+    unsigned int c;
+
+    if (*re == '^') return MatchHere(re + 1, s);
+    for (;;) {
+        if (MatchHere(re, s)) return TRUE;
+        if (!*s) return FALSE;
+        s += NextChar(s, &c);
+    }
+}
+
+/* Longest run of literal characters every match must contain */
+static void RegexLongestLiteral(const char* re, char* out, int outSize) {
+    char run[NAME_MATCH_MAX];
+    int runLen = 0, bestLen = 0;
+    const char* p = re;
+
+    out[0] = '\0';
+    if (*p == '^') p++;
+    while (*p) {
+        const char* end = AtomEnd(p);
+        const char* lit = NULL;
+
+        if (*p == '\\' && p[1] && !strchr("dws", p[1])) lit = p + 1;
+        else if (!strchr(".[\\$", *p)) lit = p;
+
+        /* An optional atom breaks the run; '+' keeps it (one copy is certain) */
+        if (lit && *end != '*' && *end != '?') {
+            int litLen = (int)(end - lit);
+            if (runLen + litLen < (int)sizeof(run)) {
+                memcpy(run + runLen, lit, litLen);
+                runLen += litLen;
+            }
+            if (*end == '+') {
+                run[runLen] = '\0';
+                if (runLen > bestLen) {
+                    bestLen = runLen;
+                    snprintf(out, outSize, "%s", run);
+                }
+                runLen = 0;
+            }
+        } else {
+            run[runLen] = '\0';
+            if (runLen > bestLen) {
+                bestLen = runLen;
+                snprintf(out, outSize, "%s", run);
+            }
+            runLen = 0;
+        }
+        p = end;
+        if (*p == '*' || *p == '+' || *p == '?') p++;
+    }
+    run[runLen] = '\0';
+    if (runLen > bestLen) snprintf(out, outSize, "%s", run);
+}
+
+/* --- Public API --- */
+
+BOOL NameMatch_Init(NameMatch* m, const char* queryUtf8) {
+    memset(m, 0, sizeof(*m));
+    if (!queryUtf8 || !queryUtf8[0]) return FALSE;
+
+    if (strncmp(queryUtf8, REGEX_PREFIX, REGEX_PREFIX_LEN) == 0) {
+        const char* re = queryUtf8 + REGEX_PREFIX_LEN;
+        const char* p;
+        if (!re[0]) return FALSE;
+        /* Reject an unterminated class or a dangling quantifier */
+        for (p = re; *p; p = AtomEnd(p)) {
+            if (*p == '[' && AtomEnd(p)[-1] != ']') return FALSE;
+            if (*p == '*' || *p == '+' || *p == '?') {
+                if (p == re || (p == re + 1 && *re == '^')) return FALSE;
+                continue;
+            }
+        }
+        m->isRegex = TRUE;
+        snprintf(m->pattern, sizeof(m->pattern), "%s", re);
+        return TRUE;
+    }
+
+    if (strpbrk(queryUtf8, "*?"))
+        snprintf(m->pattern, sizeof(m->pattern), "%s", queryUtf8);
+    else
+        snprintf(m->pattern, sizeof(m->pattern), "*%s*", queryUtf8);
+    return TRUE;
+}
+
+void NameMatch_LikePattern(const NameMatch* m, char* out, int outSize) {
+    const char* src;
+    char literal[NAME_MATCH_MAX];
+    int len = 0;
+
+    out[0] = '\0';
+    if (m->isRegex) {
+        RegexLongestLiteral(m->pattern, literal, sizeof(literal));
+        if ((int)strlen(literal) < MIN_LIKE_LITERAL) return;
+        if (outSize < 3) return;
+        out[len++] = '%';
+        src = literal;
+    } else {
+        src = m->pattern;
+    }
+
+    /* '*' -> '%', '?' -> '_'; literal '%' and '_' become '_' (any one
+       character), which keeps the pattern a superset without ESCAPE */
+    for (; *src && len < outSize - 2; src++) {
+        if (*src == '*') out[len++] = '%';
+        else if (*src == '?' || *src == '%' || *src == '_') out[len++] = '_';
+        else out[len++] = *src;
+    }
+    if (m->isRegex) out[len++] = '%';
+    out[len] = '\0';
+}
+
+BOOL NameMatch_Test(const char* nameUtf8, void* userData) {
+    const NameMatch* m = (const NameMatch*)userData;
+    return m->isRegex ? RegexMatch(m->pattern, nameUtf8)
+                      : WildcardMatch(m->pattern, nameUtf8);
+}
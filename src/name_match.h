@@ -0,0 +1,44 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NAME_MATCH_H
+#define NAME_MATCH_H
+
+#include <windows.h>
+
+/* File name matching for [Search] queries. All matching is on UTF-8 names
+   and ignores ASCII case, like Windows file names.
+
+   Query forms:
+     report          names containing "report"
+     *.pdf, IMG_????.jpg
+                     wildcards (* any run, ? one character) over the whole name
+     re:^IMG_\d+\.jpe?g$
+                     regular expression, matched anywhere in the name unless
+                     anchored. Supports . [] [^] * + ? ^ $ and the escapes
+                     \d \w \s (and \ before any other character for a literal);
+                     no groups or alternation. */
+
+#define NAME_MATCH_MAX 512
+
+typedef struct {
+    BOOL isRegex;
+    char pattern[NAME_MATCH_MAX];   /* wildcard (substrings wrapped in *) or regex */
+} NameMatch;
+
+/* Parse a UTF-8 query. Returns FALSE for an empty or malformed query. */
+BOOL NameMatch_Init(NameMatch* m, const char* queryUtf8);
+
+/* SQL LIKE pattern that every matching name also matches (a superset, used
+   to narrow candidates through the trigram index). Writes "" if no useful
+   pattern exists (e.g. regexes without a literal of 3+ characters). */
+void NameMatch_LikePattern(const NameMatch* m, char* out, int outSize);
+
+/* Exact test of a UTF-8 name. userData is a NameMatch*, so this can be
+   passed directly as an LsNameFilter. */
+BOOL NameMatch_Test(const char* nameUtf8, void* userData);
+
+#endif /* NAME_MATCH_H */
@@ -0,0 +1,513 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "native_format.h"
+#include "zstd.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Refuse key files that would make scrypt allocate more than this */
+#define MAX_SCRYPT_BYTES (1024LL * 1024 * 1024)
+
+/* Decompressed repository files larger than this are not metadata restic
+   would write */
+#define MAX_META_FILE (512 * 1024 * 1024)
+
+/* --- IDs and paths --- */
+
+static int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+BOOL NativeFormat_ParseId(const char* hex, BYTE id[32]) {
+    int i;
+    if (!hex) return FALSE;
+    for (i = 0; i < 32; i++) {
+        int hi = HexValue(hex[2 * i]);
+        int lo = (hi >= 0) ? HexValue(hex[2 * i + 1]) : -1;
+        if (lo < 0) return FALSE;
+        id[i] = (BYTE)((hi << 4) | lo);
+    }
+    return hex[64] == '\0';
+}
+
+void NativeFormat_FormatId(const BYTE id[32], char out[65]) {
+    static const char digits[] = "0123456789abcdef";
+    int i;
+    for (i = 0; i < 32; i++) {
+        out[2 * i] = digits[id[i] >> 4];
+        out[2 * i + 1] = digits[id[i] & 15];
+    }
+    out[64] = '\0';
+}
+
+int NativeFormat_CompareIds(const void* a, const void* b) {
+    return memcmp(a, b, sizeof(NativeId));
+}
+
+void NativeFormat_FilePath(char* out, int maxLen, const char* root, const char* dir,
+                           const BYTE* id) {
+    char hex[65];
+
+    if (!id) {
+        snprintf(out, maxLen, "%s" NATIVE_IO_SEP "%s", root, dir);
+        return;
+    }
+    NativeFormat_FormatId(id, hex);
+    if (strcmp(dir, "data") == 0)
+        snprintf(out, maxLen, "%s" NATIVE_IO_SEP "data" NATIVE_IO_SEP "%.2s" NATIVE_IO_SEP "%s",
+                 root, hex, hex);
+    else
+        snprintf(out, maxLen, "%s" NATIVE_IO_SEP "%s" NATIVE_IO_SEP "%s", root, dir, hex);
+}
+
+typedef struct {
+    NativeId* ids;
+    int count;
+    int capacity;
+} IdList;
+
+static BOOL AddListedId(void* ctx, const char* name) {
+    IdList* list = (IdList*)ctx;
+    BYTE id[32];
+
+    if (!NativeFormat_ParseId(name, id)) return TRUE;
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        NativeId* grown = (NativeId*)realloc(list->ids, sizeof(NativeId) * capacity);
+        if (!grown) return FALSE;
+        list->ids = grown;
+        list->capacity = capacity;
+    }
+    memcpy(list->ids[list->count++], id, 32);
+    return TRUE;
+}
+
+NativeId* NativeFormat_ListIds(const char* root, const char* dir, int* outCount) {
+    char path[MAX_PATH];
+    IdList list;
+
+    *outCount = -1;
+    memset(&list, 0, sizeof(list));
+    NativeFormat_FilePath(path, MAX_PATH, root, dir, NULL);
+    if (!NativeIo_ListDir(path, AddListedId, &list)) {
+        free(list.ids);
+        return NULL;
+    }
+    if (list.count > 1) qsort(list.ids, list.count, sizeof(NativeId), NativeFormat_CompareIds);
+    *outCount = list.count;
+    return list.ids;
+}
+
+/* --- Decryption and decompression --- */
+
+/* Decompress one zstd frame. expected is the plaintext length if known (the
+   index records it for blobs), else 0 to take it from the frame header or
+   stream into a growing buffer. Returns a malloc'd buffer, NULL on error. */
+static BYTE* Decompress(const BYTE* src, size_t srcLen, size_t expected, size_t* outLen) {
+    unsigned long long frameSize = ZSTD_getFrameContentSize(src, srcLen);
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    BYTE* buffer = NULL;
+    size_t ret = 1;
+    BOOL ok = TRUE;
+
+    *outLen = 0;
+    if (frameSize == ZSTD_CONTENTSIZE_ERROR) return NULL;
+    if (expected == 0 && frameSize != ZSTD_CONTENTSIZE_UNKNOWN) {
+        if (frameSize > MAX_META_FILE) return NULL;
+        expected = (size_t)frameSize;
+    }
+
+    if (expected > 0 || frameSize == 0) {
+        buffer = (BYTE*)malloc(expected ? expected : 1);
+        if (!buffer) return NULL;
+        ret = ZSTD_decompress(buffer, expected, src, srcLen);
+        if (ZSTD_isError(ret) || ret != expected) {
+            free(buffer);
+            return NULL;
+        }
+        *outLen = expected;
+        return buffer;
+    }
+
+    /* No size in the frame header */
+    stream = ZSTD_createDStream();
+    if (!stream) return NULL;
+    in.src = src;
+    in.size = srcLen;
+    in.pos = 0;
+    out.dst = NULL;
+    out.size = 0;
+    out.pos = 0;
+    while (ok && ret != 0) {
+        if (out.pos == out.size) {
+            size_t size = out.size ? out.size * 2 : srcLen * 4 + 4096;
+            BYTE* grown = (size <= MAX_META_FILE) ? (BYTE*)realloc(buffer, size) : NULL;
+            ok = grown != NULL;
+            if (!ok) break;
+            buffer = grown;
+            out.dst = buffer;
+            out.size = size;
+        }
+        ret = ZSTD_decompressStream(stream, &out, &in);
+        ok = !ZSTD_isError(ret) && (ret == 0 || in.pos < in.size || out.pos == out.size);
+    }
+    ZSTD_freeDStream(stream);
+
+    if (!ok) {
+        free(buffer);
+        return NULL;
+    }
+    *outLen = out.pos;
+    return buffer;
+}
+
+cJSON* NativeFormat_DecodeJson(const CryptoKey* key, int version, const BYTE* raw,
+                               size_t rawLen) {
+    char* plain;
+    size_t plainLen;
+    cJSON* json = NULL;
+
+    if (rawLen <= CRYPTO_OVERHEAD) return NULL;
+    plainLen = rawLen - CRYPTO_OVERHEAD;
+    plain = (char*)malloc(plainLen + 1);
+    if (plain && Crypto_Open(key, raw, rawLen, (BYTE*)plain)) {
+        plain[plainLen] = '\0';
+        if (plain[0] == '{' || plain[0] == '[') {
+            json = cJSON_ParseWithLength(plain, plainLen);
+        } else if (version >= 2 && plainLen > 1 && plain[0] == 2) {
+            size_t textLen;
+            char* text = (char*)Decompress((const BYTE*)plain + 1, plainLen - 1, 0, &textLen);
+            if (text) json = cJSON_ParseWithLength(text, textLen);
+            free(text);
+        }
+    }
+    if (plain) SecureZeroMemory(plain, plainLen);
+    free(plain);
+    return json;
+}
+
+/* --- Keys --- */
+
+static BOOL DecodeField(const cJSON* obj, const char* name, BYTE* out, int expected) {
+    const cJSON* item = cJSON_GetObjectItemCaseSensitive(obj, name);
+    BYTE buf[64];
+    int len;
+
+    if (!cJSON_IsString(item) || !item->valuestring) return FALSE;
+    len = Crypto_Base64Decode(item->valuestring, buf, sizeof(buf));
+    if (len != expected) return FALSE;
+    memcpy(out, buf, expected);
+    SecureZeroMemory(buf, sizeof(buf));
+    return TRUE;
+}
+
+BOOL NativeFormat_OpenKeyFile(const BYTE* raw, size_t rawLen, const char* passwordUtf8,
+                              CryptoKey* outKey) {
+    cJSON* keyJson;
+    cJSON* master = NULL;
+    BYTE salt[64];
+    BYTE* data = NULL;
+    char* plain = NULL;
+    BYTE derived[64];
+    CryptoKey userKey;
+    double n = 0, r = 0, p = 0;
+    int saltLen = -1, dataLen = -1;
+    BOOL ok;
+
+    /* Key files are plain JSON */
+    keyJson = cJSON_ParseWithLength((const char*)raw, rawLen);
+    ok = keyJson != NULL;
+    if (ok) {
+        const cJSON* kdf = cJSON_GetObjectItemCaseSensitive(keyJson, "kdf");
+        const cJSON* saltItem = cJSON_GetObjectItemCaseSensitive(keyJson, "salt");
+        const cJSON* dataItem = cJSON_GetObjectItemCaseSensitive(keyJson, "data");
+
+        n = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(keyJson, "N"));
+        r = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(keyJson, "r"));
+        p = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(keyJson, "p"));
+        ok = cJSON_IsString(kdf) && strcmp(kdf->valuestring, "scrypt") == 0 &&
+             cJSON_IsString(saltItem) && cJSON_IsString(dataItem) &&
+             n >= 2 && r >= 1 && p >= 1 && 128.0 * n * r <= (double)MAX_SCRYPT_BYTES &&
+             128.0 * r * p <= (double)MAX_SCRYPT_BYTES;
+        if (ok) {
+            size_t dataSize = strlen(dataItem->valuestring);
+            saltLen = Crypto_Base64Decode(saltItem->valuestring, salt, sizeof(salt));
+            data = (BYTE*)malloc(dataSize);
+            if (data) dataLen = Crypto_Base64Decode(dataItem->valuestring, data, (int)dataSize);
+            ok = saltLen > 0 && dataLen > CRYPTO_OVERHEAD;
+        }
+    }
+
+    ok = ok && Crypto_Scrypt((const BYTE*)passwordUtf8, strlen(passwordUtf8), salt, saltLen,
+                             (DWORD)n, (DWORD)r, (DWORD)p, derived, sizeof(derived));
+    if (ok) {
+        Crypto_KeyFromBytes(derived, &userKey);
+        plain = (char*)malloc(dataLen - CRYPTO_OVERHEAD + 1);
+        ok = plain && Crypto_Open(&userKey, data, dataLen, (BYTE*)plain);
+    }
+    if (ok) {
+        plain[dataLen - CRYPTO_OVERHEAD] = '\0';
+        master = cJSON_Parse(plain);
+        ok = master &&
+             DecodeField(cJSON_GetObjectItemCaseSensitive(master, "mac"), "k", outKey->macK, 16) &&
+             DecodeField(cJSON_GetObjectItemCaseSensitive(master, "mac"), "r", outKey->macR, 16) &&
+             DecodeField(master, "encrypt", outKey->encrypt, 32);
+    }
+
+    /* The master key JSON holds the keys in base64: wipe its strings */
+    if (master) {
+        cJSON* mac = cJSON_GetObjectItemCaseSensitive(master, "mac");
+        cJSON* item;
+        cJSON_ArrayForEach(item, mac) {
+            if (cJSON_IsString(item)) SecureZeroMemory(item->valuestring, strlen(item->valuestring));
+        }
+        item = cJSON_GetObjectItemCaseSensitive(master, "encrypt");
+        if (cJSON_IsString(item)) SecureZeroMemory(item->valuestring, strlen(item->valuestring));
+        cJSON_Delete(master);
+    }
+    if (plain) {
+        SecureZeroMemory(plain, dataLen - CRYPTO_OVERHEAD);
+        free(plain);
+    }
+    SecureZeroMemory(derived, sizeof(derived));
+    SecureZeroMemory(&userKey, sizeof(userKey));
+    free(data);
+    cJSON_Delete(keyJson);
+    if (!ok) SecureZeroMemory(outKey, sizeof(*outKey));
+    return ok;
+}
+
+/* --- Index --- */
+
+BOOL NativeFormat_ParseIndex(const cJSON* index, NativePackFunc addPack,
+                             NativeBlobFunc addBlob, void* ctx) {
+    const cJSON* packs;
+    const cJSON* pack;
+    BOOL ok = TRUE;
+
+    packs = cJSON_IsArray(index) ? index : cJSON_GetObjectItemCaseSensitive(index, "packs");
+    if (!cJSON_IsArray(packs)) return FALSE;
+
+    cJSON_ArrayForEach(pack, packs) {
+        const cJSON* blobs = cJSON_GetObjectItemCaseSensitive(pack, "blobs");
+        const cJSON* item;
+        BYTE packId[32];
+        DWORD packIndex;
+
+        ok = NativeFormat_ParseId(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(pack, "id")),
+                                  packId) &&
+             cJSON_IsArray(blobs) && addPack(ctx, packId, &packIndex);
+        if (!ok) break;
+
+        cJSON_ArrayForEach(item, blobs) {
+            const char* type = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "type"));
+            double offset = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(item, "offset"));
+            double length = cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(item, "length"));
+            const cJSON* raw = cJSON_GetObjectItemCaseSensitive(item, "uncompressed_length");
+            NativeBlob blob;
+
+            memset(&blob, 0, sizeof(blob));
+            ok = NativeFormat_ParseId(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "id")),
+                                      blob.id) &&
+                 type && offset >= 0 && offset < 4294967296.0 &&
+                 length >= CRYPTO_OVERHEAD && length < 4294967296.0;
+            if (!ok) break;
+
+            blob.pack = packIndex;
+            blob.offset = (DWORD)offset;
+            blob.length = (DWORD)length;
+            if (cJSON_IsNumber(raw) && raw->valuedouble > 0 && raw->valuedouble < 4294967296.0)
+                blob.rawLength = (DWORD)raw->valuedouble;
+            if (strcmp(type, "tree") == 0) blob.type = NATIVE_BLOB_TREE;
+            else if (strcmp(type, "data") == 0) blob.type = NATIVE_BLOB_DATA;
+            else continue;
+
+            ok = addBlob(ctx, &blob);
+            if (!ok) break;
+        }
+        if (!ok) break;
+    }
+    return ok;
+}
+
+/* --- Blobs --- */
+
+NativeFile* NativeFormat_OpenPack(const char* root, const BYTE packId[32]) {
+    char path[MAX_PATH];
+
+    NativeFormat_FilePath(path, MAX_PATH, root, "data", packId);
+    return NativeIo_Open(path, FALSE);
+}
+
+size_t NativeFormat_BlobPlainLength(const NativeBlob* blob) {
+    if (blob->rawLength > 0) return blob->rawLength;
+    return blob->length > CRYPTO_OVERHEAD ? blob->length - CRYPTO_OVERHEAD : 0;
+}
+
+BYTE* NativeFormat_ReadBlob(NativeFile* pack, const CryptoKey* key, const NativeBlob* blob,
+                            size_t* outLen) {
+    BYTE* raw;
+    BYTE* plain = NULL;
+    BYTE hash[32];
+    size_t plainLen = 0;
+    BOOL ok;
+
+    *outLen = 0;
+    raw = (BYTE*)malloc(blob->length);
+    ok = raw && NativeIo_ReadAt(pack, blob->offset, raw, blob->length);
+
+    if (ok) {
+        plainLen = blob->length - CRYPTO_OVERHEAD;
+        plain = (BYTE*)malloc(plainLen ? plainLen : 1);
+        ok = plain && Crypto_Open(key, raw, blob->length, plain);
+    }
+    free(raw);
+
+    /* Compressed blobs are a bare zstd frame */
+    if (ok && blob->rawLength > 0) {
+        size_t rawLen;
+        BYTE* unpacked = Decompress(plain, plainLen, blob->rawLength, &rawLen);
+        free(plain);
+        plain = unpacked;
+        plainLen = rawLen;
+        ok = plain != NULL;
+    }
+
+    if (ok) {
+        Crypto_Sha256(plain, plainLen, hash);
+        ok = memcmp(hash, blob->id, 32) == 0;
+    }
+    if (!ok) {
+        free(plain);
+        return NULL;
+    }
+    *outLen = plainLen;
+    return plain;
+}
+
+/* --- Trees --- */
+
+static BYTE NodeType(const char* type) {
+    if (!type) return NATIVE_NODE_OTHER;
+    if (strcmp(type, "file") == 0) return NATIVE_NODE_FILE;
+    if (strcmp(type, "dir") == 0) return NATIVE_NODE_DIR;
+    if (strcmp(type, "symlink") == 0) return NATIVE_NODE_SYMLINK;
+    return NATIVE_NODE_OTHER;
+}
+
+NativeTree* NativeFormat_ParseTree(const char* text, size_t len, const BYTE id[32],
+                                   size_t prefix, NativeAllocFunc alloc,
+                                   NativeFreeFunc release, size_t* outBytes) {
+    cJSON* root = cJSON_ParseWithLength(text, len);
+    const cJSON* nodes = cJSON_GetObjectItemCaseSensitive(root, "nodes");
+    const cJSON* item;
+    BYTE* block = NULL;
+    NativeTree* tree = NULL;
+    size_t stringBytes = 0, contentCount = 0, bytes;
+    int count = 0;
+    BOOL ok = cJSON_IsObject(root) && (nodes == NULL || cJSON_IsArray(nodes));
+
+    *outBytes = 0;
+    if (!ok) nodes = NULL;
+    cJSON_ArrayForEach(item, nodes) {
+        const char* name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "name"));
+        const char* mtime = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "mtime"));
+        const cJSON* content = cJSON_GetObjectItemCaseSensitive(item, "content");
+        if (!name) {
+            ok = FALSE;
+            break;
+        }
+        stringBytes += strlen(name) + 1 + (mtime ? strlen(mtime) : 0) + 1;
+        if (cJSON_IsArray(content)) contentCount += cJSON_GetArraySize(content);
+        count++;
+    }
+
+    bytes = prefix + sizeof(NativeTree) + sizeof(NativeNode) * count +
+            sizeof(NativeId) * contentCount + stringBytes;
+    if (ok) block = (BYTE*)alloc(bytes);
+    if (block) {
+        NativeNode* node;
+        NativeId* contentIds;
+        char* strings;
+
+        tree = (NativeTree*)(block + prefix);
+        node = (NativeNode*)(tree + 1);
+        contentIds = (NativeId*)(node + count);
+        strings = (char*)(contentIds + contentCount);
+
+        memcpy(tree->id, id, 32);
+        tree->count = count;
+        tree->nodes = node;
+        cJSON_ArrayForEach(item, nodes) {
+            const char* name = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "name"));
+            const char* mtime = cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "mtime"));
+            const cJSON* content = cJSON_GetObjectItemCaseSensitive(item, "content");
+            const cJSON* size = cJSON_GetObjectItemCaseSensitive(item, "size");
+            const cJSON* blobId;
+            size_t n;
+
+            memset(node, 0, sizeof(*node));
+            node->type = NodeType(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "type")));
+            if (cJSON_IsNumber(size) && size->valuedouble > 0)
+                node->size = (ULONGLONG)size->valuedouble;
+            node->hasSubtree = NativeFormat_ParseId(
+                cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(item, "subtree")), node->subtree);
+
+            node->content = (const BYTE(*)[32])contentIds;
+            if (!cJSON_IsArray(content)) content = NULL;
+            cJSON_ArrayForEach(blobId, content) {
+                if (!NativeFormat_ParseId(cJSON_GetStringValue(blobId), *contentIds)) {
+                    ok = FALSE;
+                    break;
+                }
+                contentIds++;
+                node->contentCount++;
+            }
+
+            n = strlen(name) + 1;
+            memcpy(strings, name, n);
+            node->name = strings;
+            strings += n;
+            n = mtime ? strlen(mtime) + 1 : 1;
+            memcpy(strings, mtime ? mtime : "", n);
+            node->mtime = strings;
+            strings += n;
+            node++;
+        }
+        if (!ok) {
+            release(block);
+            tree = NULL;
+        }
+    }
+
+    cJSON_Delete(root);
+    if (tree) *outBytes = bytes;
+    return tree;
+}
+
+const NativeNode* NativeFormat_FindNode(const NativeTree* tree, const char* name,
+                                        size_t nameLen) {
+    int lo = 0, hi = tree->count - 1;
+
+    /* restic keeps the nodes of a tree sorted by name (bytewise) */
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const char* candidate = tree->nodes[mid].name;
+        int cmp = strncmp(candidate, name, nameLen);
+        if (cmp == 0 && candidate[nameLen] != '\0') cmp = 1;
+        if (cmp == 0) return &tree->nodes[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
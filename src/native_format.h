@@ -0,0 +1,132 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NATIVE_FORMAT_H
+#define NATIVE_FORMAT_H
+
+#include "native_port.h"
+#include "native_io.h"
+#include "restic_crypto.h"
+#include "cJSON.h"
+
+/* The file formats of a restic repository, decoded one file or blob at a
+   time: key files, the encrypted JSON files (config, snapshots, index),
+   blobs in pack files and tree blobs. native_repo.c builds the shared,
+   cached and threaded reader on top of these; they keep no state, read
+   files through native_io.h and build on any platform. */
+
+typedef BYTE NativeId[32];
+
+#define NATIVE_BLOB_DATA 0
+#define NATIVE_BLOB_TREE 1
+
+/* One blob of the repository index */
+typedef struct {
+    BYTE id[32];            /* SHA-256 of the plaintext */
+    DWORD pack;             /* number of the containing pack, given by the index reader */
+    DWORD offset;           /* byte offset in the pack file */
+    DWORD length;           /* stored length (IV + ciphertext + MAC) */
+    DWORD rawLength;        /* plaintext length if compressed, else 0 */
+    BYTE type;              /* NATIVE_BLOB_DATA or NATIVE_BLOB_TREE */
+} NativeBlob;
+
+#define NATIVE_NODE_FILE 0
+#define NATIVE_NODE_DIR 1
+#define NATIVE_NODE_SYMLINK 2
+#define NATIVE_NODE_OTHER 3
+
+/* One node of a decoded tree blob; the pointers point into the tree */
+typedef struct {
+    const char* name;               /* UTF-8 */
+    const char* mtime;              /* ISO 8601 as restic stored it, or "" */
+    ULONGLONG size;
+    BYTE type;                      /* NATIVE_NODE_* */
+    BOOL hasSubtree;
+    BYTE subtree[32];               /* tree ID of a directory */
+    DWORD contentCount;
+    const BYTE (*content)[32];      /* data blob IDs of a file, in order */
+} NativeNode;
+
+typedef struct {
+    BYTE id[32];
+    int count;
+    NativeNode* nodes;              /* sorted by name, as restic stores them */
+} NativeTree;
+
+/* Parse a 64-digit hex ID. Returns FALSE if hex is not exactly that. */
+BOOL NativeFormat_ParseId(const char* hex, BYTE id[32]);
+
+/* Lower-case hex of an ID */
+void NativeFormat_FormatId(const BYTE id[32], char out[65]);
+
+/* memcmp of two NativeIds, for qsort and bsearch */
+int NativeFormat_CompareIds(const void* a, const void* b);
+
+/* Path of a repository file: root\dir\<id> (data\<id[0]>\<id> for packs),
+   or root\dir if id is NULL (the config file). */
+void NativeFormat_FilePath(char* out, int maxLen, const char* root, const char* dir,
+                           const BYTE* id);
+
+/* IDs of the files in a repository directory (keys, snapshots, index),
+   sorted. Names that are not 64 hex digits (temp files) are skipped.
+   Returns a malloc'd array (NULL if empty), or *outCount = -1 on failure. */
+NativeId* NativeFormat_ListIds(const char* root, const char* dir, int* outCount);
+
+/* Decrypt the master key of a key file (plain JSON, scrypt parameters and
+   the sealed master key) with a UTF-8 password. Returns FALSE if the file
+   is not a key file, its scrypt parameters are too expensive, or the
+   password does not open it. */
+BOOL NativeFormat_OpenKeyFile(const BYTE* raw, size_t rawLen, const char* passwordUtf8,
+                              CryptoKey* outKey);
+
+/* Decrypt a repository file (config, snapshots/, index/) and parse its
+   JSON. Repository v2 stores these either as plain JSON or as 0x02
+   followed by a zstd frame. Returns NULL if it does not decrypt or parse. */
+cJSON* NativeFormat_DecodeJson(const CryptoKey* key, int version, const BYTE* raw,
+                               size_t rawLen);
+
+/* Callbacks of NativeFormat_ParseIndex: addPack numbers a pack for the
+   blobs that follow it, addBlob takes one tree or data blob. Return FALSE
+   to stop. */
+typedef BOOL (*NativePackFunc)(void* ctx, const BYTE packId[32], DWORD* outPack);
+typedef BOOL (*NativeBlobFunc)(void* ctx, const NativeBlob* blob);
+
+/* Walk a decoded index file: {"packs": [{"id", "blobs": [...]}]}, or the
+   bare pack array of the legacy format. Returns FALSE if it is malformed
+   or a callback stopped. */
+BOOL NativeFormat_ParseIndex(const cJSON* index, NativePackFunc addPack,
+                             NativeBlobFunc addBlob, void* ctx);
+
+/* Open a pack file for reading blobs at their index offsets. */
+NativeFile* NativeFormat_OpenPack(const char* root, const BYTE packId[32]);
+
+/* Plaintext length of a blob as the index records it */
+size_t NativeFormat_BlobPlainLength(const NativeBlob* blob);
+
+/* Read the stored form of a blob from an open pack file and decrypt and
+   decompress it, checking it against its ID. Only reads the key, so it
+   can run on several threads at once. Returns a malloc'd buffer, NULL on
+   error. */
+BYTE* NativeFormat_ReadBlob(NativeFile* pack, const CryptoKey* key, const NativeBlob* blob,
+                            size_t* outLen);
+
+typedef void* (*NativeAllocFunc)(size_t bytes);
+typedef void (*NativeFreeFunc)(void* block);
+
+/* Decode a tree blob ({"nodes": [...]}) into one block from alloc: prefix
+   bytes for the caller, the tree, its nodes, the content IDs of the files,
+   then the strings. Returns the tree inside the block (at prefix) with
+   *outBytes set to the block size, or NULL if it is malformed (the block
+   is then given to release) or alloc fails. The caller frees the block. */
+NativeTree* NativeFormat_ParseTree(const char* text, size_t len, const BYTE id[32],
+                                   size_t prefix, NativeAllocFunc alloc,
+                                   NativeFreeFunc release, size_t* outBytes);
+
+/* Node of a tree by name (nameLen bytes of name), by binary search. */
+const NativeNode* NativeFormat_FindNode(const NativeTree* tree, const char* name,
+                                        size_t nameLen);
+
+#endif /* NATIVE_FORMAT_H */
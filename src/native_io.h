@@ -0,0 +1,42 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NATIVE_IO_H
+#define NATIVE_IO_H
+
+#include "native_port.h"
+
+/* Reading the files of a local repository: native_io_win32.c on Windows,
+   native_io_posix.c elsewhere. Paths are passed through as they are
+   (ANSI on Windows, as the plugin's repository paths are). */
+
+#ifdef _WIN32
+#define NATIVE_IO_SEP "\\"
+#else
+#define NATIVE_IO_SEP "/"
+#endif
+
+typedef struct NativeFile NativeFile;
+
+/* Open a file for reading; sequential hints a front-to-back read, else
+   blobs are read at random offsets. Returns NULL if it cannot be opened. */
+NativeFile* NativeIo_Open(const char* path, BOOL sequential);
+
+void NativeIo_Close(NativeFile* file);
+
+BOOL NativeIo_Size(NativeFile* file, ULONGLONG* outSize);
+
+/* Read exactly len bytes at offset. FALSE on an error or a short read. */
+BOOL NativeIo_ReadAt(NativeFile* file, ULONGLONG offset, void* buf, DWORD len);
+
+/* Called with the name of every regular file of a directory; return FALSE
+   to stop. */
+typedef BOOL (*NativeIoDirFunc)(void* ctx, const char* name);
+
+/* List a directory. Returns FALSE if it cannot be read or fn stopped. */
+BOOL NativeIo_ListDir(const char* dir, NativeIoDirFunc fn, void* ctx);
+
+#endif /* NATIVE_IO_H */
@@ -0,0 +1,79 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "native_io.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct NativeFile {
+    int fd;
+};
+
+NativeFile* NativeIo_Open(const char* path, BOOL sequential) {
+    NativeFile* file;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+    file = (NativeFile*)malloc(sizeof(NativeFile));
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    posix_fadvise(fd, 0, 0, sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+    file->fd = fd;
+    return file;
+}
+
+void NativeIo_Close(NativeFile* file) {
+    if (!file) return;
+    close(file->fd);
+    free(file);
+}
+
+BOOL NativeIo_Size(NativeFile* file, ULONGLONG* outSize) {
+    struct stat st;
+
+    if (fstat(file->fd, &st) != 0 || st.st_size < 0) return FALSE;
+    *outSize = (ULONGLONG)st.st_size;
+    return TRUE;
+}
+
+BOOL NativeIo_ReadAt(NativeFile* file, ULONGLONG offset, void* buf, DWORD len) {
+    BYTE* p = (BYTE*)buf;
+
+    while (len > 0) {
+        ssize_t got = pread(file->fd, p, len, (off_t)offset);
+        if (got <= 0) return FALSE;
+        p += got;
+        offset += (ULONGLONG)got;
+        len -= (DWORD)got;
+    }
+    return TRUE;
+}
+
+BOOL NativeIo_ListDir(const char* dir, NativeIoDirFunc fn, void* ctx) {
+    DIR* d = opendir(dir);
+    struct dirent* entry;
+    BOOL ok = TRUE;
+
+    if (!d) return FALSE;
+    while (ok && (entry = readdir(d)) != NULL) {
+        char path[MAX_PATH];
+        struct stat st;
+
+        snprintf(path, MAX_PATH, "%s/%s", dir, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        ok = fn(ctx, entry->d_name);
+    }
+    closedir(d);
+    return ok;
+}
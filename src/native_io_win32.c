@@ -0,0 +1,80 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "native_io.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct NativeFile {
+    HANDLE handle;
+};
+
+NativeFile* NativeIo_Open(const char* path, BOOL sequential) {
+    NativeFile* file;
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                                OPEN_EXISTING,
+                                sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+                                NULL);
+
+    if (handle == INVALID_HANDLE_VALUE) return NULL;
+    file = (NativeFile*)malloc(sizeof(NativeFile));
+    if (!file) {
+        CloseHandle(handle);
+        return NULL;
+    }
+    file->handle = handle;
+    return file;
+}
+
+void NativeIo_Close(NativeFile* file) {
+    if (!file) return;
+    CloseHandle(file->handle);
+    free(file);
+}
+
+BOOL NativeIo_Size(NativeFile* file, ULONGLONG* outSize) {
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file->handle, &size) || size.QuadPart < 0) return FALSE;
+    *outSize = (ULONGLONG)size.QuadPart;
+    return TRUE;
+}
+
+BOOL NativeIo_ReadAt(NativeFile* file, ULONGLONG offset, void* buf, DWORD len) {
+    LARGE_INTEGER pos;
+    BYTE* p = (BYTE*)buf;
+    DWORD got;
+
+    pos.QuadPart = (LONGLONG)offset;
+    if (!SetFilePointerEx(file->handle, pos, NULL, FILE_BEGIN)) return FALSE;
+    while (len > 0) {
+        if (!ReadFile(file->handle, p, len, &got, NULL) || got == 0) return FALSE;
+        p += got;
+        len -= got;
+    }
+    return TRUE;
+}
+
+BOOL NativeIo_ListDir(const char* dir, NativeIoDirFunc fn, void* ctx) {
+    char pattern[MAX_PATH];
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind;
+    BOOL ok = TRUE;
+
+    snprintf(pattern, MAX_PATH, "%s\\*", dir);
+    hFind = FindFirstFileA(pattern, &fd);
+    if (hFind == INVALID_HANDLE_VALUE) {
+        /* An existing but empty directory still has "." and ".." */
+        return GetLastError() == ERROR_FILE_NOT_FOUND;
+    }
+
+    do {
+        if (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        ok = fn(ctx, fd.cFileName);
+    } while (ok && FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+    return ok;
+}
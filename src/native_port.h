@@ -0,0 +1,56 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NATIVE_PORT_H
+#define NATIVE_PORT_H
+
+/* The few Windows types and calls the portable part of the native reader
+   (restic_crypto.c, native_format.c, native_io_*.c) uses. On Windows this
+   is <windows.h>; elsewhere they are mapped to the C library, so the
+   reader's tests build and run on any platform. */
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sched.h>
+
+typedef unsigned char BYTE;
+typedef int BOOL;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define MAX_PATH 260
+
+static inline void* SecureZeroMemory(void* ptr, size_t len) {
+    volatile BYTE* p = (volatile BYTE*)ptr;
+    while (len--) *p++ = 0;
+    return ptr;
+}
+
+#define InterlockedCompareExchange(target, value, comparand) \
+    __sync_val_compare_and_swap((target), (comparand), (value))
+#define InterlockedExchange(target, value) \
+    __atomic_exchange_n((target), (value), __ATOMIC_SEQ_CST)
+
+/* restic_crypto.c only yields with Sleep(0) while another thread builds
+   the AES tables */
+#define Sleep(ms) sched_yield()
+
+#endif /* _WIN32 */
+
+#endif /* NATIVE_PORT_H */
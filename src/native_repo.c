@@ -0,0 +1,1486 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "native_repo.h"
+#include "mem_budget.h"
+#include "trace.h"
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Repository files larger than this are not metadata restic would write */
+#define MAX_META_FILE (512 * 1024 * 1024)
+
+#define MIN_BLOB_SLOTS 1024
+
+/* Decoded trees kept per repository, keyed by tree ID */
+#define TREE_CACHE_SLOTS 64
+#define TREE_CACHE_BYTES (16 * 1024 * 1024)
+
+/* Longest snapshot-internal path the walker builds */
+#define WALK_PATH_MAX (MAX_PATH * 2)
+
+typedef struct {
+    NativeId id;
+    NativeId tree;                /* all zero if the snapshot has none */
+} SnapshotRef;
+
+static const NativeId g_NoTree = {0};
+
+/* The loaded repository index. It is never changed once published:
+   reading more index files builds a new one that replaces it, and readers
+   keep the version they started with until they release it. */
+typedef struct {
+    volatile LONG refs;         /* the repository's reference plus one per reader */
+
+    /* Blob table: open addressing with linear probing, a slot is free when
+       its length is 0 (stored blobs are never shorter than the MAC) */
+    NativeBlob* blobs;          /* Mem_Alloc(MEM_NATIVE_INDEX) */
+    DWORD blobSlots;            /* power of two */
+    DWORD blobCount;
+
+    NativeId* packs;              /* Mem_Alloc(MEM_NATIVE_INDEX) */
+    DWORD packCount;
+    DWORD packCapacity;
+
+    NativeId* indexFiles;         /* IDs of the loaded index files, sorted */
+    DWORD indexFileCount;
+} BlobIndex;
+
+/* A decoded tree and its references: one held by the tree cache while it
+   is cached, one per NativeRepo_LoadTree caller until it is released */
+typedef struct {
+    volatile LONG refs;
+    size_t bytes;               /* of the whole allocation */
+    NativeTree tree;
+} SharedTree;
+
+typedef struct {
+    SharedTree* shared;         /* Mem_Alloc(MEM_NATIVE_TREES), NULL if free */
+    ULONGLONG lastUse;
+} TreeSlot;
+
+struct NativeRepo {
+    volatile LONG refs;         /* see NativeRepo_AddRef */
+    char root[MAX_PATH];        /* repository directory, no trailing separator */
+    CryptoKey key;              /* master key, not changed after opening */
+    int version;
+
+    SRWLOCK lock;               /* index, snapshots, snapshotCount */
+    BlobIndex* index;           /* NULL before the first load */
+    SnapshotRef* snapshots;     /* root trees seen by NativeRepo_SnapshotsJson */
+    int snapshotCount;
+
+    SRWLOCK loadLock;           /* one NativeRepo_LoadIndex at a time */
+
+    SRWLOCK treeLock;           /* trees, treeBytes, treeClock */
+    TreeSlot trees[TREE_CACHE_SLOTS];
+    size_t treeBytes;
+    ULONGLONG treeClock;
+};
+
+/* --- Files --- */
+
+BOOL NativeRepo_IsLocalPath(const char* repoPath) {
+    if (!repoPath) return FALSE;
+    if (strncmp(repoPath, "local:", 6) == 0) repoPath += 6;
+
+    /* "C:\..." - backend prefixes (sftp:, s3:, rest:, ...) are longer */
+    if (((repoPath[0] >= 'A' && repoPath[0] <= 'Z') || (repoPath[0] >= 'a' && repoPath[0] <= 'z')) &&
+        repoPath[1] == ':' && (repoPath[2] == '\\' || repoPath[2] == '/'))
+        return TRUE;
+
+    /* "\\server\share\..." */
+    return (repoPath[0] == '\\' && repoPath[1] == '\\') ||
+           (repoPath[0] == '/' && repoPath[1] == '/');
+}
+
+/* Read a whole file into a malloc'd buffer (charged to MEM_RESTIC_OUTPUT
+   until the caller uncharges *outLen) */
+static BYTE* ReadRepoFile(const char* path, DWORD* outLen) {
+    NativeFile* file;
+    ULONGLONG size;
+    BYTE* buffer = NULL;
+
+    *outLen = 0;
+    file = NativeIo_Open(path, TRUE);
+    if (!file) return NULL;
+
+    if (NativeIo_Size(file, &size) && size > 0 && size <= MAX_META_FILE &&
+        Mem_Charge(MEM_RESTIC_OUTPUT, (size_t)size)) {
+        buffer = (BYTE*)malloc((size_t)size);
+        if (!buffer || !NativeIo_ReadAt(file, 0, buffer, (DWORD)size)) {
+            free(buffer);
+            buffer = NULL;
+            Mem_Uncharge(MEM_RESTIC_OUTPUT, (size_t)size);
+        }
+    }
+    NativeIo_Close(file);
+
+    if (buffer) *outLen = (DWORD)size;
+    return buffer;
+}
+
+static void FreeRepoFile(BYTE* buffer, DWORD len) {
+    if (!buffer) return;
+    free(buffer);
+    Mem_Uncharge(MEM_RESTIC_OUTPUT, len);
+}
+
+/* Read a repository file (config, snapshots/, index/) and decode its
+   JSON; id is NULL for the config file */
+static cJSON* LoadJsonFile(NativeRepo* repo, const char* dir, const BYTE* id) {
+    char path[MAX_PATH];
+    BYTE* raw;
+    DWORD rawLen;
+    cJSON* json = NULL;
+
+    NativeFormat_FilePath(path, MAX_PATH, repo->root, dir, id);
+    raw = ReadRepoFile(path, &rawLen);
+    if (!raw) return NULL;
+
+    /* The plaintext is about as large as the file */
+    if (Mem_Charge(MEM_RESTIC_OUTPUT, rawLen)) {
+        json = NativeFormat_DecodeJson(&repo->key, repo->version, raw, rawLen);
+        Mem_Uncharge(MEM_RESTIC_OUTPUT, rawLen);
+    }
+    FreeRepoFile(raw, rawLen);
+    return json;
+}
+
+/* --- Keys --- */
+
+/* Derive the user key from one key file and decrypt the master key with it */
+static BOOL TryKeyFile(NativeRepo* repo, const BYTE keyId[32], const char* password) {
+    char path[MAX_PATH];
+    BYTE* raw;
+    DWORD rawLen;
+    BOOL ok;
+
+    NativeFormat_FilePath(path, MAX_PATH, repo->root, "keys", keyId);
+    raw = ReadRepoFile(path, &rawLen);
+    if (!raw) return FALSE;
+    ok = NativeFormat_OpenKeyFile(raw, rawLen, password, &repo->key);
+    FreeRepoFile(raw, rawLen);
+    return ok;
+}
+
+NativeRepo* NativeRepo_Open(const char* repoPath, const char* passwordUtf8) {
+    NativeRepo* repo;
+    NativeId* keyIds;
+    cJSON* config = NULL;
+    int keyCount, i, len;
+    BOOL ok = FALSE;
+    TraceSpan span;
+
+    if (!repoPath || !passwordUtf8) return NULL;
+    if (strncmp(repoPath, "local:", 6) == 0) repoPath += 6;
+
+    repo = (NativeRepo*)calloc(1, sizeof(NativeRepo));
+    if (!repo) return NULL;
+    repo->refs = 1;
+    InitializeSRWLock(&repo->lock);
+    InitializeSRWLock(&repo->loadLock);
+    InitializeSRWLock(&repo->treeLock);
+
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "repo", repoPath);
+
+    strncpy(repo->root, repoPath, MAX_PATH - 1);
+    len = (int)strlen(repo->root);
+    while (len > 3 && (repo->root[len - 1] == '\\' || repo->root[len - 1] == '/'))
+        repo->root[--len] = '\0';
+
+    keyIds = NativeFormat_ListIds(repo->root, "keys", &keyCount);
+    for (i = 0; i < keyCount && !ok; i++)
+        ok = TryKeyFile(repo, keyIds[i], passwordUtf8);
+    free(keyIds);
+
+    if (ok) {
+        const cJSON* version;
+        config = LoadJsonFile(repo, "config", NULL);
+        version = cJSON_GetObjectItemCaseSensitive(config, "version");
+        if (cJSON_IsNumber(version)) repo->version = version->valueint;
+        ok = repo->version == 1 || repo->version == 2;
+        cJSON_Delete(config);
+    }
+
+    Trace_ArgInt(&span, "keys", keyCount);
+    Trace_ArgInt(&span, "ok", ok);
+    Trace_End(&span, "native.open");
+
+    if (!ok) {
+        NativeRepo_Close(repo);
+        return NULL;
+    }
+    return repo;
+}
+
+/* --- Blob table --- */
+
+static void FreeIndex(BlobIndex* index) {
+    if (!index) return;
+    Mem_Free(index->blobs);
+    Mem_Free(index->packs);
+    Mem_Free(index->indexFiles);
+    free(index);
+}
+
+/* Take a reference to the current index; NULL before the first load */
+static BlobIndex* AcquireIndex(NativeRepo* repo) {
+    BlobIndex* index;
+
+    AcquireSRWLockShared(&repo->lock);
+    index = repo->index;
+    if (index) InterlockedIncrement(&index->refs);
+    ReleaseSRWLockShared(&repo->lock);
+    return index;
+}
+
+static void ReleaseIndex(BlobIndex* index) {
+    if (index && InterlockedDecrement(&index->refs) == 0) FreeIndex(index);
+}
+
+static void ReleaseTreeSlot(TreeSlot* slot) {
+    if (slot->shared && InterlockedDecrement(&slot->shared->refs) == 0)
+        Mem_Free(slot->shared);
+    slot->shared = NULL;
+}
+
+static void ClearTreeCache(NativeRepo* repo) {
+    int i;
+    for (i = 0; i < TREE_CACHE_SLOTS; i++) ReleaseTreeSlot(&repo->trees[i]);
+    repo->treeBytes = 0;
+}
+
+NativeRepo* NativeRepo_AddRef(NativeRepo* repo) {
+    if (repo) InterlockedIncrement(&repo->refs);
+    return repo;
+}
+
+void NativeRepo_Close(NativeRepo* repo) {
+    if (!repo || InterlockedDecrement(&repo->refs) != 0) return;
+    ReleaseIndex(repo->index);
+    ClearTreeCache(repo);
+    free(repo->snapshots);
+    SecureZeroMemory(&repo->key, sizeof(repo->key));
+    free(repo);
+}
+
+int NativeRepo_Version(const NativeRepo* repo) {
+    return repo ? repo->version : 0;
+}
+
+/* Blob IDs are SHA-256 hashes, so their leading bytes are already uniform */
+static DWORD BlobSlot(const BYTE id[32], DWORD slots) {
+    return ((DWORD)id[0] | ((DWORD)id[1] << 8) | ((DWORD)id[2] << 16) | ((DWORD)id[3] << 24)) &
+           (slots - 1);
+}
+
+static BOOL GrowBlobs(BlobIndex* index) {
+    DWORD slots = index->blobSlots ? index->blobSlots * 2 : MIN_BLOB_SLOTS;
+    NativeBlob* table;
+    DWORD i;
+
+    if (slots < index->blobSlots) return FALSE;
+    table = (NativeBlob*)Mem_Alloc(MEM_NATIVE_INDEX, sizeof(NativeBlob) * (size_t)slots);
+    if (!table) return FALSE;
+    memset(table, 0, sizeof(NativeBlob) * (size_t)slots);
+
+    for (i = 0; i < index->blobSlots; i++) {
+        const NativeBlob* b = &index->blobs[i];
+        DWORD s;
+        if (b->length == 0) continue;
+        for (s = BlobSlot(b->id, slots); table[s].length != 0; s = (s + 1) & (slots - 1)) {}
+        table[s] = *b;
+    }
+
+    Mem_Free(index->blobs);
+    index->blobs = table;
+    index->blobSlots = slots;
+    return TRUE;
+}
+
+/* Insert a blob unless its ID is known already (the same blob can be listed
+   by two index files, e.g. before superseded ones are deleted) */
+static BOOL AddBlob(BlobIndex* index, const NativeBlob* blob) {
+    DWORD s;
+
+    /* Keep the load factor under 3/4 */
+    if ((index->blobCount + 1) * 4 > index->blobSlots * 3 && !GrowBlobs(index)) return FALSE;
+
+    for (s = BlobSlot(blob->id, index->blobSlots); index->blobs[s].length != 0;
+         s = (s + 1) & (index->blobSlots - 1)) {
+        if (memcmp(index->blobs[s].id, blob->id, 32) == 0) return TRUE;
+    }
+    index->blobs[s] = *blob;
+    index->blobCount++;
+    return TRUE;
+}
+
+static BOOL AddPack(BlobIndex* index, const BYTE id[32], DWORD* outIndex) {
+    if (index->packCount >= index->packCapacity) {
+        DWORD capacity = index->packCapacity ? index->packCapacity * 2 : 256;
+        NativeId* grown = (NativeId*)Mem_Alloc(MEM_NATIVE_INDEX, sizeof(NativeId) * (size_t)capacity);
+        if (!grown) return FALSE;
+        if (index->packCount > 0) memcpy(grown, index->packs, sizeof(NativeId) * index->packCount);
+        Mem_Free(index->packs);
+        index->packs = grown;
+        index->packCapacity = capacity;
+    }
+    memcpy(index->packs[index->packCount], id, 32);
+    *outIndex = index->packCount++;
+    return TRUE;
+}
+
+/* Copy of an index to add index files to; the blob table and pack list
+   keep their layout, so pack numbers stay the same */
+static BlobIndex* CopyIndex(const BlobIndex* src) {
+    BlobIndex* index = (BlobIndex*)calloc(1, sizeof(BlobIndex));
+    BOOL ok = index != NULL;
+
+    if (ok && src->blobSlots) {
+        index->blobs = (NativeBlob*)Mem_Alloc(MEM_NATIVE_INDEX, sizeof(NativeBlob) * (size_t)src->blobSlots);
+        ok = index->blobs != NULL;
+        if (ok) {
+            memcpy(index->blobs, src->blobs, sizeof(NativeBlob) * (size_t)src->blobSlots);
+            index->blobSlots = src->blobSlots;
+            index->blobCount = src->blobCount;
+        }
+    }
+    if (ok && src->packCapacity) {
+        index->packs = (NativeId*)Mem_Alloc(MEM_NATIVE_INDEX, sizeof(NativeId) * (size_t)src->packCapacity);
+        ok = index->packs != NULL;
+        if (ok) {
+            memcpy(index->packs, src->packs, sizeof(NativeId) * src->packCount);
+            index->packCount = src->packCount;
+            index->packCapacity = src->packCapacity;
+        }
+    }
+    if (!ok) {
+        FreeIndex(index);
+        return NULL;
+    }
+    return index;
+}
+
+static const NativeBlob* IndexFind(const BlobIndex* index, const BYTE id[32]) {
+    DWORD s;
+
+    if (!index || index->blobSlots == 0) return NULL;
+    for (s = BlobSlot(id, index->blobSlots); index->blobs[s].length != 0;
+         s = (s + 1) & (index->blobSlots - 1)) {
+        if (memcmp(index->blobs[s].id, id, 32) == 0) return &index->blobs[s];
+    }
+    return NULL;
+}
+
+static BOOL IndexAddPack(void* ctx, const BYTE packId[32], DWORD* outPack) {
+    return AddPack((BlobIndex*)ctx, packId, outPack);
+}
+
+static BOOL IndexAddBlob(void* ctx, const NativeBlob* blob) {
+    return AddBlob((BlobIndex*)ctx, blob);
+}
+
+/* Add the packs of one index file */
+static BOOL LoadIndexFile(NativeRepo* repo, BlobIndex* index, const BYTE fileId[32]) {
+    cJSON* root = LoadJsonFile(repo, "index", fileId);
+    BOOL ok;
+
+    if (!root) return FALSE;
+    ok = NativeFormat_ParseIndex(root, IndexAddPack, IndexAddBlob, index);
+    cJSON_Delete(root);
+    return ok;
+}
+
+BOOL NativeRepo_LoadIndex(NativeRepo* repo) {
+    NativeId* ids;
+    BlobIndex* current;
+    BlobIndex* next = NULL;
+    const BlobIndex* shown;
+    int count, i, added = 0;
+    BOOL reset = FALSE, ok = TRUE;
+    TraceSpan span;
+
+    if (!repo) return FALSE;
+
+    /* A caller that waited here finds the files read by the one before */
+    AcquireSRWLockExclusive(&repo->loadLock);
+    ids = NativeFormat_ListIds(repo->root, "index", &count);
+    if (count < 0) {
+        ReleaseSRWLockExclusive(&repo->loadLock);
+        return FALSE;
+    }
+
+    Trace_Begin(&span);
+    current = AcquireIndex(repo);
+
+    /* Prune replaces index files: start over if one of ours is gone */
+    for (i = 0; current && i < (int)current->indexFileCount && !reset; i++)
+        reset = !ids || !bsearch(current->indexFiles[i], ids, count, sizeof(NativeId), NativeFormat_CompareIds);
+    for (i = 0; i < count; i++) {
+        if (reset || !current || current->indexFileCount == 0 ||
+            !bsearch(ids[i], current->indexFiles, current->indexFileCount, sizeof(NativeId), NativeFormat_CompareIds))
+            added++;
+    }
+
+    /* The next index is built aside and then replaces the current one,
+       which its readers keep until they are done */
+    if (!current || reset || added > 0) {
+        next = (current && !reset) ? CopyIndex(current) : (BlobIndex*)calloc(1, sizeof(BlobIndex));
+        ok = next != NULL &&
+             (count == 0 ||
+              (next->indexFiles = (NativeId*)Mem_Alloc(MEM_NATIVE_INDEX, sizeof(NativeId) * count)) != NULL);
+        for (i = 0; ok && i < count; i++) {
+            if (!reset && current && current->indexFileCount > 0 &&
+                bsearch(ids[i], current->indexFiles, current->indexFileCount, sizeof(NativeId), NativeFormat_CompareIds))
+                continue;
+            ok = LoadIndexFile(repo, next, ids[i]);
+        }
+
+        if (ok) {
+            BlobIndex* old;
+            if (count > 0) memcpy(next->indexFiles, ids, sizeof(NativeId) * count);
+            next->indexFileCount = count;
+            next->refs = 1;
+            AcquireSRWLockExclusive(&repo->lock);
+            old = repo->index;
+            repo->index = next;
+            ReleaseSRWLockExclusive(&repo->lock);
+            ReleaseIndex(old);
+        } else {
+            FreeIndex(next);
+            next = NULL;
+        }
+    }
+    free(ids);
+
+    shown = next ? next : current;
+    Trace_ArgInt(&span, "files", next ? added : 0);
+    Trace_ArgInt(&span, "blobs", shown ? shown->blobCount : 0);
+    Trace_ArgInt(&span, "packs", shown ? shown->packCount : 0);
+    Trace_End(&span, "native.index");
+    ReleaseIndex(current);
+    ReleaseSRWLockExclusive(&repo->loadLock);
+    return ok;
+}
+
+/* The current index, reading it first if there is none yet. NULL if it
+   cannot be read. */
+static BlobIndex* EnsureIndex(NativeRepo* repo) {
+    BlobIndex* index = AcquireIndex(repo);
+    if (!index && NativeRepo_LoadIndex(repo)) index = AcquireIndex(repo);
+    return index;
+}
+
+/* Release stale and take the index after reading new index files, for a
+   blob stale does not know */
+static BlobIndex* ReloadIndex(NativeRepo* repo, BlobIndex* stale) {
+    ReleaseIndex(stale);
+    return NativeRepo_LoadIndex(repo) ? AcquireIndex(repo) : NULL;
+}
+
+BOOL NativeRepo_FindBlob(NativeRepo* repo, const BYTE id[32], NativeBlob* outBlob) {
+    BlobIndex* index;
+    const NativeBlob* blob;
+
+    if (!repo) return FALSE;
+    index = AcquireIndex(repo);
+    blob = IndexFind(index, id);
+    if (blob) *outBlob = *blob;
+    ReleaseIndex(index);
+    return blob != NULL;
+}
+
+BOOL NativeRepo_PackId(NativeRepo* repo, DWORD pack, BYTE id[32]) {
+    BlobIndex* index;
+    BOOL found;
+
+    if (!repo) return FALSE;
+    index = AcquireIndex(repo);
+    found = index && pack < index->packCount;
+    if (found) memcpy(id, index->packs[pack], 32);
+    ReleaseIndex(index);
+    return found;
+}
+
+int NativeRepo_BlobCount(NativeRepo* repo) {
+    BlobIndex* index = repo ? AcquireIndex(repo) : NULL;
+    int count = index ? (int)index->blobCount : 0;
+    ReleaseIndex(index);
+    return count;
+}
+
+int NativeRepo_PackCount(NativeRepo* repo) {
+    BlobIndex* index = repo ? AcquireIndex(repo) : NULL;
+    int count = index ? (int)index->packCount : 0;
+    ReleaseIndex(index);
+    return count;
+}
+
+/* --- Snapshots --- */
+
+char* NativeRepo_SnapshotsJson(NativeRepo* repo) {
+    NativeId* ids;
+    SnapshotRef* refs;
+    cJSON* array;
+    char* text = NULL;
+    int count, i;
+    BOOL ok;
+    TraceSpan span;
+
+    if (!repo) return NULL;
+
+    Trace_Begin(&span);
+    ids = NativeFormat_ListIds(repo->root, "snapshots", &count);
+    array = cJSON_CreateArray();
+    refs = (count > 0) ? (SnapshotRef*)malloc(sizeof(SnapshotRef) * count) : NULL;
+    ok = count >= 0 && array != NULL && (count == 0 || refs != NULL);
+
+    for (i = 0; ok && i < count; i++) {
+        char hex[65], shortId[9];
+        cJSON* snap;
+
+        NativeFormat_FormatId(ids[i], hex);
+        snap = LoadJsonFile(repo, "snapshots", ids[i]);
+        ok = cJSON_IsObject(snap);
+        if (!ok) {
+            cJSON_Delete(snap);
+            break;
+        }
+
+        memcpy(refs[i].id, ids[i], 32);
+        if (!NativeFormat_ParseId(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(snap, "tree")),
+                                refs[i].tree))
+            memset(refs[i].tree, 0, 32);
+
+        memcpy(shortId, hex, 8);
+        shortId[8] = '\0';
+        cJSON_DeleteItemFromObjectCaseSensitive(snap, "id");
+        cJSON_DeleteItemFromObjectCaseSensitive(snap, "short_id");
+        cJSON_AddStringToObject(snap, "id", hex);
+        cJSON_AddStringToObject(snap, "short_id", shortId);
+        cJSON_AddItemToArray(array, snap);
+    }
+
+    if (ok) text = cJSON_PrintUnformatted(array);
+    if (text) {
+        SnapshotRef* old;
+        AcquireSRWLockExclusive(&repo->lock);
+        old = repo->snapshots;
+        repo->snapshots = refs;
+        repo->snapshotCount = count;
+        ReleaseSRWLockExclusive(&repo->lock);
+        free(old);
+    } else {
+        free(refs);
+    }
+    cJSON_Delete(array);
+    free(ids);
+
+    Trace_ArgInt(&span, "snapshots", count);
+    Trace_End(&span, "native.snapshots");
+    return text;
+}
+
+BOOL NativeRepo_SnapshotTree(NativeRepo* repo, const char* snapshotId, BYTE treeId[32]) {
+    size_t prefixLen;
+    NativeId* ids;
+    int count, i;
+    BOOL found = FALSE;
+
+    if (!repo || !snapshotId) return FALSE;
+    prefixLen = strlen(snapshotId);
+    if (prefixLen == 0 || prefixLen > 64) return FALSE;
+
+    AcquireSRWLockShared(&repo->lock);
+    for (i = 0; i < repo->snapshotCount && !found; i++) {
+        char hex[65];
+        NativeFormat_FormatId(repo->snapshots[i].id, hex);
+        if (strncmp(hex, snapshotId, prefixLen) == 0) {
+            memcpy(treeId, repo->snapshots[i].tree, 32);
+            found = TRUE;
+        }
+    }
+    ReleaseSRWLockShared(&repo->lock);
+    if (found) return memcmp(treeId, g_NoTree, 32) != 0;
+
+    /* Not in the last snapshot list: find the file by its ID prefix */
+    ids = NativeFormat_ListIds(repo->root, "snapshots", &count);
+    for (i = 0; i < count && !found; i++) {
+        char hex[65];
+        cJSON* snap;
+
+        NativeFormat_FormatId(ids[i], hex);
+        if (strncmp(hex, snapshotId, prefixLen) != 0) continue;
+        snap = LoadJsonFile(repo, "snapshots", ids[i]);
+        found = NativeFormat_ParseId(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(snap, "tree")),
+                                   treeId);
+        cJSON_Delete(snap);
+        break;
+    }
+    free(ids);
+    return found;
+}
+
+/* --- Blobs and trees --- */
+
+/* Open a pack file of the index for reading blobs */
+static NativeFile* OpenPack(const NativeRepo* repo, const BlobIndex* index, DWORD pack) {
+    return NativeFormat_OpenPack(repo->root, index->packs[pack]);
+}
+
+/* Read one blob by ID. Looks up blobs missing from the loaded index again
+   after reading new index files. Returns a malloc'd buffer, NULL on error. */
+static BYTE* LoadBlob(NativeRepo* repo, const BYTE id[32], size_t* outLen) {
+    BlobIndex* index = EnsureIndex(repo);
+    const NativeBlob* blob = IndexFind(index, id);
+    NativeFile* pack = NULL;
+    BYTE* plain = NULL;
+
+    *outLen = 0;
+    if (!blob && index) {
+        index = ReloadIndex(repo, index);
+        blob = IndexFind(index, id);
+    }
+    if (blob) pack = OpenPack(repo, index, blob->pack);
+    if (pack) {
+        plain = NativeFormat_ReadBlob(pack, &repo->key, blob, outLen);
+        NativeIo_Close(pack);
+    }
+    ReleaseIndex(index);
+    return plain;
+}
+
+static SharedTree* SharedOf(const NativeTree* tree) {
+    return (SharedTree*)((BYTE*)tree - offsetof(SharedTree, tree));
+}
+
+static void* AllocTree(size_t bytes) {
+    return Mem_Alloc(MEM_NATIVE_TREES, bytes);
+}
+
+/* Decode a tree blob into one allocation with its reference count (1, the
+   caller's) in front */
+static SharedTree* ParseTree(const char* text, size_t len, const BYTE id[32]) {
+    size_t bytes;
+    NativeTree* tree = NativeFormat_ParseTree(text, len, id, offsetof(SharedTree, tree),
+                                              AllocTree, Mem_Free, &bytes);
+    SharedTree* shared;
+
+    if (!tree) return NULL;
+    shared = SharedOf(tree);
+    shared->refs = 1;
+    shared->bytes = bytes;
+    return shared;
+}
+
+/* Load and decode a tree without caching it */
+static SharedTree* ReadTree(NativeRepo* repo, const BYTE id[32]) {
+    size_t len;
+    BYTE* text = LoadBlob(repo, id, &len);
+    SharedTree* shared;
+
+    if (!text) return NULL;
+    shared = ParseTree((const char*)text, len, id);
+    free(text);
+    return shared;
+}
+
+void NativeRepo_ReleaseTree(const NativeTree* tree) {
+    SharedTree* shared;
+
+    if (!tree) return;
+    shared = SharedOf(tree);
+    if (InterlockedDecrement(&shared->refs) == 0) Mem_Free(shared);
+}
+
+/* Take a reference to a cached tree, NULL if it is not cached */
+static SharedTree* AcquireCachedTree(NativeRepo* repo, const BYTE id[32]) {
+    SharedTree* found = NULL;
+    int i;
+
+    AcquireSRWLockExclusive(&repo->treeLock);
+    for (i = 0; i < TREE_CACHE_SLOTS && !found; i++) {
+        TreeSlot* slot = &repo->trees[i];
+        if (slot->shared && memcmp(slot->shared->tree.id, id, 32) == 0) {
+            found = slot->shared;
+            InterlockedIncrement(&found->refs);
+            slot->lastUse = ++repo->treeClock;
+        }
+    }
+    ReleaseSRWLockExclusive(&repo->treeLock);
+    return found;
+}
+
+/* Add a tree read by this thread to the cache, unless another thread
+   cached it meanwhile. Evicted trees are freed once their readers are
+   done with them. */
+static void CacheTree(NativeRepo* repo, SharedTree* shared) {
+    TreeSlot* slot = NULL;
+    int i;
+
+    AcquireSRWLockExclusive(&repo->treeLock);
+    for (i = 0; i < TREE_CACHE_SLOTS; i++) {
+        if (repo->trees[i].shared &&
+            memcmp(repo->trees[i].shared->tree.id, shared->tree.id, 32) == 0) {
+            ReleaseSRWLockExclusive(&repo->treeLock);
+            return;
+        }
+    }
+
+    /* Evict least recently used trees until there is a free slot and the
+       cache stays under its byte limit (a single larger tree still fits) */
+    for (;;) {
+        TreeSlot* victim = NULL;
+        int used = 0;
+        for (i = 0; i < TREE_CACHE_SLOTS; i++) {
+            if (!repo->trees[i].shared) {
+                if (!slot) slot = &repo->trees[i];
+                continue;
+            }
+            used++;
+            if (!victim || repo->trees[i].lastUse < victim->lastUse) victim = &repo->trees[i];
+        }
+        if (slot && (used == 0 || repo->treeBytes + shared->bytes <= TREE_CACHE_BYTES)) break;
+        repo->treeBytes -= victim->shared->bytes;
+        ReleaseTreeSlot(victim);
+        slot = NULL;
+    }
+
+    InterlockedIncrement(&shared->refs);
+    slot->shared = shared;
+    slot->lastUse = ++repo->treeClock;
+    repo->treeBytes += shared->bytes;
+    ReleaseSRWLockExclusive(&repo->treeLock);
+}
+
+const NativeTree* NativeRepo_LoadTree(NativeRepo* repo, const BYTE treeId[32]) {
+    SharedTree* shared;
+
+    if (!repo) return NULL;
+    shared = AcquireCachedTree(repo, treeId);
+    if (shared) return &shared->tree;
+
+    /* Read outside the lock, so other threads keep using the cache */
+    shared = ReadTree(repo, treeId);
+    if (!shared) return NULL;
+    CacheTree(repo, shared);
+    return &shared->tree;
+}
+
+int NativeRepo_FindDir(NativeRepo* repo, const BYTE rootTree[32], const char* pathUtf8,
+                       const NativeTree** outTree) {
+    const NativeTree* tree;
+    const char* p = pathUtf8;
+    TraceSpan span;
+    int depth = 0;
+
+    *outTree = NULL;
+    Trace_Begin(&span);
+    tree = NativeRepo_LoadTree(repo, rootTree);
+
+    while (tree && *p) {
+        const char* end;
+        const NativeNode* node;
+        BYTE next[32];
+
+        while (*p == '/') p++;
+        if (!*p) break;
+        end = strchr(p, '/');
+        if (!end) end = p + strlen(p);
+
+        node = NativeFormat_FindNode(tree, p, (size_t)(end - p));
+        if (!node || node->type != NATIVE_NODE_DIR || !node->hasSubtree) {
+            NativeRepo_ReleaseTree(tree);
+            Trace_ArgInt(&span, "depth", depth);
+            Trace_End(&span, "native.find_dir");
+            return 0;
+        }
+        memcpy(next, node->subtree, 32);
+        NativeRepo_ReleaseTree(tree);
+        tree = NativeRepo_LoadTree(repo, next);
+        p = end;
+        depth++;
+    }
+
+    Trace_ArgInt(&span, "depth", depth);
+    Trace_End(&span, "native.find_dir");
+    if (!tree) return -1;
+    *outTree = tree;
+    return 1;
+}
+
+static BOOL WalkTree(NativeRepo* repo, const BYTE id[32], char* path, size_t pathLen,
+                     NativeWalkFunc fn, void* ctx) {
+    SharedTree* shared = AcquireCachedTree(repo, id);
+    const NativeTree* tree;
+    BOOL ok = TRUE;
+    int i;
+
+    /* Trees not cached already are read without caching them */
+    if (!shared) shared = ReadTree(repo, id);
+    if (!shared) return FALSE;
+    tree = &shared->tree;
+
+    for (i = 0; ok && i < tree->count; i++) {
+        const NativeNode* node = &tree->nodes[i];
+        size_t nameLen = strlen(node->name);
+
+        path[pathLen] = '\0';
+        ok = fn(ctx, pathLen ? path : "/", node);
+        if (!ok || node->type != NATIVE_NODE_DIR || !node->hasSubtree) continue;
+
+        /* Deeper paths would not fit the caches' MAX_PATH fields anyway */
+        if (pathLen + 1 + nameLen >= WALK_PATH_MAX) continue;
+        path[pathLen] = '/';
+        memcpy(path + pathLen + 1, node->name, nameLen + 1);
+        ok = WalkTree(repo, node->subtree, path, pathLen + 1 + nameLen, fn, ctx);
+    }
+
+    NativeRepo_ReleaseTree(tree);
+    return ok;
+}
+
+BOOL NativeRepo_Walk(NativeRepo* repo, const BYTE rootTree[32], NativeWalkFunc fn, void* ctx) {
+    char path[WALK_PATH_MAX];
+    TraceSpan span;
+    BOOL ok;
+
+    if (!repo) return FALSE;
+    Trace_Begin(&span);
+    path[0] = '\0';
+    ok = WalkTree(repo, rootTree, path, 0, fn, ctx);
+    Trace_ArgInt(&span, "ok", ok);
+    Trace_End(&span, "native.walk");
+    return ok;
+}
+
+/* --- File extraction --- */
+
+/* Blobs decoded ahead of the write position: at most this many, holding
+   at most this many plaintext bytes (restic's chunks are up to 8 MB) */
+#define EXTRACT_WINDOW_BLOBS 64
+#define EXTRACT_WINDOW_BYTES (64 * 1024 * 1024)
+#define EXTRACT_THREADS_MAX 8
+
+/* Output files a multi-file extraction keeps open between writes */
+#define EXTRACT_OPEN_FILES 16
+
+typedef struct {
+    NativeBlob blob;
+    BYTE* plain;                /* decoded content, NULL once delivered */
+    size_t plainLen;
+    volatile LONG state;        /* 0 pending, 1 decoded, -1 failed */
+} ExtractJob;
+
+/* Read order of a window: by pack, then by offset within it */
+typedef struct {
+    DWORD pack;
+    DWORD offset;
+    int job;
+} ExtractOrder;
+
+typedef struct {
+    const NativeRepo* repo;
+    const BlobIndex* index;     /* the blobs' pack numbers refer to it */
+    ExtractJob* jobs;           /* in delivery order */
+    ExtractOrder* order;
+    int count;
+    volatile LONG next;         /* next position in order to claim */
+    volatile LONG cancel;
+    HANDLE decoded;             /* auto-reset, set after every job */
+} ExtractWindow;
+
+/* Pack file a thread read its last blob from, kept open for the next */
+typedef struct {
+    NativeFile* file;
+    DWORD pack;
+} PackReader;
+
+/* Hands a decoded blob (NULL if it could not be read) to its output, in
+   window order. Returns 1 to go on, 0 to abort, -1 on an error. */
+typedef int (*DeliverFunc)(void* ctx, int job, const BYTE* plain, size_t len);
+
+static int CompareOrder(const void* a, const void* b) {
+    const ExtractOrder* x = (const ExtractOrder*)a;
+    const ExtractOrder* y = (const ExtractOrder*)b;
+    if (x->pack != y->pack) return x->pack < y->pack ? -1 : 1;
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    return 0;
+}
+
+/* Claim the next job of the window in read order and decode it. Returns
+   FALSE when there is none left. */
+static BOOL RunNextJob(ExtractWindow* w, PackReader* reader) {
+    LONG pos = InterlockedIncrement(&w->next) - 1;
+    ExtractJob* job;
+
+    if (pos >= w->count || w->cancel) return FALSE;
+    job = &w->jobs[w->order[pos].job];
+
+    if (!reader->file || reader->pack != job->blob.pack) {
+        NativeIo_Close(reader->file);
+        reader->file = OpenPack(w->repo, w->index, job->blob.pack);
+        reader->pack = job->blob.pack;
+    }
+    if (reader->file)
+        job->plain = NativeFormat_ReadBlob(reader->file, &w->repo->key, &job->blob, &job->plainLen);
+    InterlockedExchange(&job->state, job->plain ? 1 : -1);
+    SetEvent(w->decoded);
+    return TRUE;
+}
+
+static DWORD WINAPI ExtractWorker(LPVOID param) {
+    ExtractWindow* w = (ExtractWindow*)param;
+    PackReader reader;
+
+    reader.file = NULL;
+    reader.pack = 0;
+    while (RunNextJob(w, &reader)) {}
+    NativeIo_Close(reader.file);
+    return 0;
+}
+
+/* Worker threads besides the calling one: one per processor in total */
+static int ExtractWorkers(void) {
+    SYSTEM_INFO si;
+    int threads;
+
+    GetSystemInfo(&si);
+    threads = (int)si.dwNumberOfProcessors;
+    if (threads > EXTRACT_THREADS_MAX) threads = EXTRACT_THREADS_MAX;
+    return threads > 1 ? threads - 1 : 0;
+}
+
+/* Decode one window of blobs with the worker threads and the calling
+   thread and deliver them in window order. Returns the last result of
+   deliver, or -1 if the window could not be set up. */
+static int ExtractWindowRun(const NativeRepo* repo, const BlobIndex* index,
+                            const NativeBlob* blobs, int count, int workers,
+                            PackReader* reader, DeliverFunc deliver, void* ctx) {
+    ExtractWindow w;
+    HANDLE threads[EXTRACT_THREADS_MAX];
+    int threadCount = 0;
+    int result = 1;
+    int i;
+
+    memset(&w, 0, sizeof(w));
+    w.repo = repo;
+    w.index = index;
+    w.count = count;
+    w.jobs = (ExtractJob*)calloc(count, sizeof(ExtractJob));
+    w.order = (ExtractOrder*)malloc(sizeof(ExtractOrder) * count);
+    w.decoded = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!w.jobs || !w.order || !w.decoded) {
+        free(w.jobs);
+        free(w.order);
+        if (w.decoded) CloseHandle(w.decoded);
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        w.jobs[i].blob = blobs[i];
+        w.order[i].pack = blobs[i].pack;
+        w.order[i].offset = blobs[i].offset;
+        w.order[i].job = i;
+    }
+    qsort(w.order, count, sizeof(ExtractOrder), CompareOrder);
+
+    /* The calling thread decodes too, so a one-blob window needs no thread */
+    if (workers > count - 1) workers = count - 1;
+    for (i = 0; i < workers; i++) {
+        threads[threadCount] = CreateThread(NULL, 0, ExtractWorker, &w, 0, NULL);
+        if (threads[threadCount]) threadCount++;
+    }
+
+    for (i = 0; i < count && result == 1; i++) {
+        ExtractJob* job = &w.jobs[i];
+
+        /* Decode the next blobs in read order until this one is ready */
+        while (job->state == 0) {
+            if (!RunNextJob(&w, reader)) WaitForSingleObject(w.decoded, INFINITE);
+        }
+        result = deliver(ctx, i, job->plain, job->plainLen);
+        free(job->plain);
+        job->plain = NULL;
+    }
+
+    /* Let the workers finish the job they hold, then drop undelivered blobs */
+    InterlockedExchange(&w.cancel, 1);
+    if (threadCount) WaitForMultipleObjects(threadCount, threads, TRUE, INFINITE);
+    for (i = 0; i < threadCount; i++) CloseHandle(threads[i]);
+    for (i = 0; i < count; i++) free(w.jobs[i].plain);
+    CloseHandle(w.decoded);
+    free(w.jobs);
+    free(w.order);
+    return result;
+}
+
+/* Number of blobs from first on that make up the next window */
+static int NextWindow(const NativeBlob* blobs, int first, int count, ULONGLONG* outBytes) {
+    ULONGLONG bytes = 0;
+    int n = 0;
+
+    while (first + n < count && n < EXTRACT_WINDOW_BLOBS) {
+        size_t blobBytes = NativeFormat_BlobPlainLength(&blobs[first + n]);
+        if (n > 0 && bytes + blobBytes > EXTRACT_WINDOW_BYTES) break;
+        bytes += blobBytes;
+        n++;
+    }
+    *outBytes = bytes;
+    return n;
+}
+
+/* Blob list of a file in a snapshot, resolved against index. Returns a
+   malloc'd array, NULL if the path is not a regular file or a blob is not
+   in the index (then *outMissing is set). */
+static NativeBlob* CollectFileBlobs(NativeRepo* repo, const BlobIndex* index,
+                                    const BYTE rootTree[32], const char* pathUtf8,
+                                    DWORD* outCount, ULONGLONG* outSize, BOOL* outMissing) {
+    const char* name = strrchr(pathUtf8, '/');
+    const NativeTree* tree;
+    const NativeNode* node;
+    char parent[WALK_PATH_MAX];
+    NativeBlob* blobs;
+    ULONGLONG size = 0;
+    DWORD i;
+
+    *outCount = 0;
+    *outSize = 0;
+    *outMissing = FALSE;
+    if (!name || !name[1] || (size_t)(name - pathUtf8) >= sizeof(parent)) return NULL;
+    memcpy(parent, pathUtf8, (size_t)(name - pathUtf8));
+    parent[name - pathUtf8] = '\0';
+    name++;
+
+    if (NativeRepo_FindDir(repo, rootTree, parent, &tree) != 1) return NULL;
+    node = NativeFormat_FindNode(tree, name, strlen(name));
+    blobs = (node && node->type == NATIVE_NODE_FILE)
+                ? (NativeBlob*)malloc(sizeof(NativeBlob) * (node->contentCount ? node->contentCount : 1))
+                : NULL;
+
+    for (i = 0; blobs && i < node->contentCount; i++) {
+        const NativeBlob* blob = IndexFind(index, node->content[i]);
+        if (!blob || blob->type != NATIVE_BLOB_DATA) {
+            *outMissing = blob == NULL;
+            free(blobs);
+            blobs = NULL;
+            break;
+        }
+        blobs[i] = *blob;
+        size += NativeFormat_BlobPlainLength(blob);
+    }
+    if (blobs) {
+        *outCount = node->contentCount;
+        *outSize = size;
+    }
+    NativeRepo_ReleaseTree(tree);
+    return blobs;
+}
+
+/* One file: blobs arrive in file order and are written sequentially */
+typedef struct {
+    HANDLE file;
+    ULONGLONG jobStart;         /* file position of the next blob */
+    ULONGLONG pos;              /* written up to here */
+    ULONGLONG end;
+    ULONGLONG total;
+    NativeProgressFunc fn;
+    void* ctx;
+} FileSink;
+
+static int DeliverToFile(void* ctx, int job, const BYTE* plain, size_t len) {
+    FileSink* sink = (FileSink*)ctx;
+    ULONGLONG skip, take;
+    DWORD written = 0;
+
+    (void)job;
+    if (!plain) return -1;
+    skip = (sink->pos > sink->jobStart) ? sink->pos - sink->jobStart : 0;
+    take = len > skip ? len - skip : 0;
+    if (take > sink->end - sink->pos) take = sink->end - sink->pos;
+    sink->jobStart += len;
+    if (take > 0 &&
+        (!WriteFile(sink->file, plain + skip, (DWORD)take, &written, NULL) || written != take))
+        return -1;
+    sink->pos += take;
+
+    if (sink->fn && !sink->fn((LONGLONG)sink->pos, (LONGLONG)sink->total, sink->ctx)) return 0;
+    return 1;
+}
+
+int NativeRepo_ExtractFile(NativeRepo* repo, const BYTE rootTree[32], const char* pathUtf8,
+                           const char* outputPath, ULONGLONG offset, ULONGLONG length,
+                           NativeProgressFunc fn, void* ctx) {
+    BlobIndex* index;
+    NativeBlob* blobs = NULL;
+    DWORD blobCount, first = 0;
+    ULONGLONG total, start;
+    PackReader reader;
+    FileSink sink;
+    LARGE_INTEGER seek;
+    TraceSpan span;
+    BOOL missing = FALSE;
+    int workers = ExtractWorkers();
+    int result = 1;
+
+    if (!repo) return -1;
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "path", pathUtf8);
+
+    /* The whole file is read with one version of the index */
+    index = EnsureIndex(repo);
+    if (index) blobs = CollectFileBlobs(repo, index, rootTree, pathUtf8, &blobCount, &total, &missing);
+    if (missing) {
+        index = ReloadIndex(repo, index);
+        if (index) blobs = CollectFileBlobs(repo, index, rootTree, pathUtf8, &blobCount, &total, &missing);
+    }
+    if (!blobs) {
+        ReleaseIndex(index);
+        Trace_ArgInt(&span, "result", -1);
+        Trace_End(&span, "native.extract");
+        return -1;
+    }
+
+    /* Resuming appends to what is already there */
+    memset(&sink, 0, sizeof(sink));
+    sink.file = CreateFileA(outputPath, GENERIC_WRITE, 0, NULL,
+                            offset ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    seek.QuadPart = (LONGLONG)offset;
+    if (sink.file == INVALID_HANDLE_VALUE ||
+        !SetFilePointerEx(sink.file, seek, NULL, FILE_BEGIN)) {
+        if (sink.file != INVALID_HANDLE_VALUE) CloseHandle(sink.file);
+        free(blobs);
+        ReleaseIndex(index);
+        Trace_ArgInt(&span, "result", -1);
+        Trace_End(&span, "native.extract");
+        return -1;
+    }
+    start = offset < total ? offset : total;
+    sink.pos = start;
+    sink.total = total;
+    sink.end = total;
+    if (length > 0 && start + length < sink.end) sink.end = start + length;
+    sink.fn = fn;
+    sink.ctx = ctx;
+
+    /* Blobs that end before the offset are not read at all */
+    while (first < blobCount && sink.jobStart + NativeFormat_BlobPlainLength(&blobs[first]) <= start) {
+        sink.jobStart += NativeFormat_BlobPlainLength(&blobs[first]);
+        first++;
+    }
+
+    reader.file = NULL;
+    reader.pack = 0;
+    while (result == 1 && first < blobCount && sink.jobStart < sink.end) {
+        ULONGLONG bytes;
+        int count = NextWindow(blobs, (int)first, (int)blobCount, &bytes);
+
+        if (!Mem_Charge(MEM_NATIVE_DATA, (size_t)bytes)) {
+            result = -1;
+            break;
+        }
+        result = ExtractWindowRun(repo, index, &blobs[first], count, workers, &reader,
+                                  DeliverToFile, &sink);
+        Mem_Uncharge(MEM_NATIVE_DATA, (size_t)bytes);
+        first += count;
+    }
+
+    NativeIo_Close(reader.file);
+    CloseHandle(sink.file);
+    free(blobs);
+    ReleaseIndex(index);
+
+    /* A resumed file keeps the part written so far; it is valid content */
+    if (result != 1 && offset == 0) DeleteFileA(outputPath);
+
+    Trace_ArgInt(&span, "bytes", (LONGLONG)(sink.pos - start));
+    Trace_ArgInt(&span, "blobs", blobCount);
+    Trace_ArgInt(&span, "threads", workers + 1);
+    Trace_ArgInt(&span, "result", result);
+    Trace_End(&span, "native.extract");
+    return result;
+}
+
+/* Where one blob of a planned file goes */
+typedef struct {
+    const NativeBlob* blob;
+    int item;
+    ULONGLONG fileOffset;
+} Placement;
+
+static int ComparePlacement(const void* a, const void* b) {
+    const Placement* x = (const Placement*)a;
+    const Placement* y = (const Placement*)b;
+    if (x->blob->pack != y->blob->pack) return x->blob->pack < y->blob->pack ? -1 : 1;
+    if (x->blob->offset != y->blob->offset) return x->blob->offset < y->blob->offset ? -1 : 1;
+    if (x->item != y->item) return x->item < y->item ? -1 : 1;
+    if (x->fileOffset != y->fileOffset) return x->fileOffset < y->fileOffset ? -1 : 1;
+    return 0;
+}
+
+/* Several files: every distinct blob is decoded once, in pack order, and
+   written to each place it occurs in */
+typedef struct {
+    NativeExtractItem* items;
+    DWORD* remaining;           /* blobs still to write per item */
+    Placement* placements;      /* sorted by pack and offset */
+    int* firstPlacement;        /* per distinct blob, plus an end marker */
+    int jobBase;                /* distinct blob of the window's first job */
+    HANDLE open[EXTRACT_OPEN_FILES];
+    int openItem[EXTRACT_OPEN_FILES];
+    int openNext;
+    ULONGLONG written;
+    ULONGLONG total;
+    NativeFileDoneFunc fn;
+    void* ctx;
+} MultiSink;
+
+static HANDLE OpenOutputUtf8(const char* pathUtf8, DWORD disposition) {
+    WCHAR wide[MAX_PATH * 2];
+
+    if (!MultiByteToWideChar(CP_UTF8, 0, pathUtf8, -1, wide, MAX_PATH * 2))
+        return INVALID_HANDLE_VALUE;
+    return CreateFileW(wide, GENERIC_WRITE, 0, NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+}
+
+static void DeleteOutputUtf8(const char* pathUtf8) {
+    WCHAR wide[MAX_PATH * 2];
+
+    if (MultiByteToWideChar(CP_UTF8, 0, pathUtf8, -1, wide, MAX_PATH * 2))
+        DeleteFileW(wide);
+}
+
+static void CloseItem(MultiSink* sink, int item) {
+    int i;
+    for (i = 0; i < EXTRACT_OPEN_FILES; i++) {
+        if (sink->open[i] != INVALID_HANDLE_VALUE && sink->openItem[i] == item) {
+            CloseHandle(sink->open[i]);
+            sink->open[i] = INVALID_HANDLE_VALUE;
+        }
+    }
+}
+
+/* Output of an item, reusing the handle of a recent write; the oldest
+   handle is closed when all are in use */
+static HANDLE ItemHandle(MultiSink* sink, int item) {
+    int i, slot;
+
+    for (i = 0; i < EXTRACT_OPEN_FILES; i++) {
+        if (sink->open[i] != INVALID_HANDLE_VALUE && sink->openItem[i] == item)
+            return sink->open[i];
+    }
+    slot = sink->openNext;
+    sink->openNext = (sink->openNext + 1) % EXTRACT_OPEN_FILES;
+    if (sink->open[slot] != INVALID_HANDLE_VALUE) CloseHandle(sink->open[slot]);
+    sink->open[slot] = OpenOutputUtf8(sink->items[item].outputPathUtf8, OPEN_EXISTING);
+    sink->openItem[slot] = item;
+    return sink->open[slot];
+}
+
+/* Mark an item finished and report it. Returns FALSE if fn aborted. */
+static BOOL FinishItem(MultiSink* sink, int item, int result) {
+    NativeExtractItem* it = &sink->items[item];
+
+    CloseItem(sink, item);
+    it->result = result;
+    if (result != 1) DeleteOutputUtf8(it->outputPathUtf8);
+    return !sink->fn || sink->fn(sink->ctx, item, (LONGLONG)sink->written, (LONGLONG)sink->total);
+}
+
+static int DeliverToFiles(void* ctx, int job, const BYTE* plain, size_t len) {
+    MultiSink* sink = (MultiSink*)ctx;
+    int blob = sink->jobBase + job;
+    int p;
+
+    for (p = sink->firstPlacement[blob]; p < sink->firstPlacement[blob + 1]; p++) {
+        const Placement* pl = &sink->placements[p];
+        NativeExtractItem* it = &sink->items[pl->item];
+        HANDLE hOut;
+        LARGE_INTEGER seek;
+        DWORD written = 0;
+        BOOL ok;
+
+        /* An item that failed before ignores its remaining blobs */
+        if (it->result != 0) continue;
+
+        ok = plain != NULL;
+        if (ok) {
+            hOut = ItemHandle(sink, pl->item);
+            seek.QuadPart = (LONGLONG)pl->fileOffset;
+            ok = hOut != INVALID_HANDLE_VALUE &&
+                 SetFilePointerEx(hOut, seek, NULL, FILE_BEGIN) &&
+                 (len == 0 || (WriteFile(hOut, plain, (DWORD)len, &written, NULL) &&
+                               written == len));
+        }
+        sink->written += written;
+        if (!ok) {
+            if (!FinishItem(sink, pl->item, -1)) return 0;
+            continue;
+        }
+        if (--sink->remaining[pl->item] == 0 && !FinishItem(sink, pl->item, 1)) return 0;
+    }
+    return 1;
+}
+
+/* Blob lists of all items, looked up in one index. Returns TRUE if a blob
+   of some file is not in it. */
+static BOOL CollectItemBlobs(NativeRepo* repo, const BlobIndex* index, const BYTE rootTree[32],
+                             const NativeExtractItem* items, int count,
+                             NativeBlob** fileBlobs, DWORD* blobCounts) {
+    BOOL anyMissing = FALSE;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        ULONGLONG size;
+        BOOL missing;
+
+        free(fileBlobs[i]);
+        fileBlobs[i] = CollectFileBlobs(repo, index, rootTree, items[i].pathUtf8,
+                                        &blobCounts[i], &size, &missing);
+        if (missing) anyMissing = TRUE;
+    }
+    return anyMissing;
+}
+
+int NativeRepo_ExtractFiles(NativeRepo* repo, const BYTE rootTree[32],
+                            NativeExtractItem* items, int count,
+                            NativeFileDoneFunc fn, void* ctx) {
+    MultiSink sink;
+    BlobIndex* index;
+    NativeBlob** fileBlobs = NULL;
+    NativeBlob* distinct = NULL;
+    int placementCount = 0, distinctCount = 0;
+    PackReader reader;
+    TraceSpan span;
+    int workers = ExtractWorkers();
+    int result = 1;
+    int i, first = 0;
+
+    if (!repo || count <= 0) return -1;
+    Trace_Begin(&span);
+    memset(&sink, 0, sizeof(sink));
+    for (i = 0; i < EXTRACT_OPEN_FILES; i++) sink.open[i] = INVALID_HANDLE_VALUE;
+    sink.items = items;
+    sink.fn = fn;
+    sink.ctx = ctx;
+    for (i = 0; i < count; i++) items[i].result = 0;
+
+    /* Look up every file's blobs first, all in one version of the index
+       (read again once if one is missing); all of them are known before
+       the first pack is read */
+    fileBlobs = (NativeBlob**)calloc(count, sizeof(NativeBlob*));
+    sink.remaining = (DWORD*)calloc(count, sizeof(DWORD));
+    index = EnsureIndex(repo);
+    if (!fileBlobs || !sink.remaining || !index) result = -1;
+    if (result == 1 && CollectItemBlobs(repo, index, rootTree, items, count, fileBlobs, sink.remaining)) {
+        index = ReloadIndex(repo, index);
+        if (index) CollectItemBlobs(repo, index, rootTree, items, count, fileBlobs, sink.remaining);
+        else result = -1;
+    }
+    for (i = 0; result == 1 && i < count; i++) {
+        HANDLE hOut;
+        DWORD j;
+
+        hOut = fileBlobs[i] ? OpenOutputUtf8(items[i].outputPathUtf8, CREATE_ALWAYS)
+                            : INVALID_HANDLE_VALUE;
+        if (hOut == INVALID_HANDLE_VALUE) {
+            items[i].result = -1;
+            sink.remaining[i] = 0;
+            continue;
+        }
+        CloseHandle(hOut);
+        for (j = 0; j < sink.remaining[i]; j++) sink.total += NativeFormat_BlobPlainLength(&fileBlobs[i][j]);
+        placementCount += (int)sink.remaining[i];
+    }
+
+    if (result == 1) {
+        sink.placements = (Placement*)malloc(sizeof(Placement) * (placementCount ? placementCount : 1));
+        if (!sink.placements) result = -1;
+    }
+    if (result == 1) {
+        int p = 0;
+        for (i = 0; i < count; i++) {
+            ULONGLONG fileOffset = 0;
+            DWORD j;
+            for (j = 0; j < sink.remaining[i]; j++) {
+                sink.placements[p].blob = &fileBlobs[i][j];
+                sink.placements[p].item = i;
+                sink.placements[p].fileOffset = fileOffset;
+                fileOffset += NativeFormat_BlobPlainLength(&fileBlobs[i][j]);
+                p++;
+            }
+        }
+        qsort(sink.placements, placementCount, sizeof(Placement), ComparePlacement);
+
+        /* A blob shared by several files (or repeated within one) is one job */
+        distinct = (NativeBlob*)malloc(sizeof(NativeBlob) * (placementCount ? placementCount : 1));
+        sink.firstPlacement = (int*)malloc(sizeof(int) * (placementCount + 1));
+        if (!distinct || !sink.firstPlacement) result = -1;
+    }
+    if (result == 1) {
+        for (i = 0; i < placementCount; i++) {
+            const Placement* pl = &sink.placements[i];
+            if (i > 0 && pl->blob->pack == pl[-1].blob->pack &&
+                pl->blob->offset == pl[-1].blob->offset)
+                continue;
+            sink.firstPlacement[distinctCount] = i;
+            distinct[distinctCount++] = *pl->blob;
+        }
+        sink.firstPlacement[distinctCount] = placementCount;
+    }
+
+    /* Empty files and files that could not be planned are done already */
+    for (i = 0; result == 1 && i < count; i++) {
+        if (items[i].result == 0 && sink.remaining[i] == 0 && !FinishItem(&sink, i, 1)) result = 0;
+        else if (items[i].result == -1 && fn && !fn(ctx, i, (LONGLONG)sink.written, (LONGLONG)sink.total)) result = 0;
+    }
+
+    reader.file = NULL;
+    reader.pack = 0;
+    while (result == 1 && first < distinctCount) {
+        ULONGLONG bytes;
+        int n = NextWindow(distinct, first, distinctCount, &bytes);
+
+        if (!Mem_Charge(MEM_NATIVE_DATA, (size_t)bytes)) {
+            result = -1;
+            break;
+        }
+        sink.jobBase = first;
+        result = ExtractWindowRun(repo, index, &distinct[first], n, workers, &reader,
+                                  DeliverToFiles, &sink);
+        Mem_Uncharge(MEM_NATIVE_DATA, (size_t)bytes);
+        first += n;
+    }
+    NativeIo_Close(reader.file);
+
+    /* Files left incomplete by an abort or error are removed */
+    for (i = 0; i < EXTRACT_OPEN_FILES; i++) {
+        if (sink.open[i] != INVALID_HANDLE_VALUE) CloseHandle(sink.open[i]);
+    }
+    for (i = 0; i < count; i++) {
+        if (items[i].result == 0) {
+            items[i].result = -1;
+            DeleteOutputUtf8(items[i].outputPathUtf8);
+        }
+        if (fileBlobs) free(fileBlobs[i]);
+    }
+    free(fileBlobs);
+    free(sink.remaining);
+    free(sink.placements);
+    free(sink.firstPlacement);
+    free(distinct);
+    ReleaseIndex(index);
+
+    Trace_ArgInt(&span, "files", count);
+    Trace_ArgInt(&span, "blobs", distinctCount);
+    Trace_ArgInt(&span, "bytes", (LONGLONG)sink.written);
+    Trace_ArgInt(&span, "result", result);
+    Trace_End(&span, "native.extract_files");
+    return result;
+}
@@ -0,0 +1,134 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef NATIVE_REPO_H
+#define NATIVE_REPO_H
+
+#include "native_format.h"
+
+/* In-process reader for restic repositories on a local or UNC path, so
+   snapshot lists and index lookups need no restic process.
+
+   NativeRepo_Open tries the key files with the password and keeps the
+   master key; the other calls decrypt repository files with it. Anything
+   this reader does not handle (other backends, unknown formats, damaged
+   files) makes the call fail, and the caller falls back to restic.
+
+   A handle can be used from several threads at once. The index is
+   replaced as a whole when index files are added, so a reader keeps the
+   version it started with; trees are handed out with a reference. The
+   file formats themselves are decoded by native_format.c. */
+
+typedef struct NativeRepo NativeRepo;
+
+/* Called for every node of a walk with the node's parent directory
+   ("/" for the snapshot root, else "/C/Users"); return FALSE to stop. */
+typedef BOOL (*NativeWalkFunc)(void* ctx, const char* parentPathUtf8, const NativeNode* node);
+
+/* Progress of NativeRepo_ExtractFile: the file position written up to and
+   the file size. Return FALSE to abort. */
+typedef BOOL (*NativeProgressFunc)(LONGLONG written, LONGLONG total, void* ctx);
+
+/* TRUE if restic would treat repoPath as a local directory: an absolute
+   drive or UNC path, optionally with restic's "local:" prefix. */
+BOOL NativeRepo_IsLocalPath(const char* repoPath);
+
+/* Open the repository with a UTF-8 password. Returns NULL if no key file
+   accepts the password, or the repository is not readable or of an
+   unsupported version. */
+NativeRepo* NativeRepo_Open(const char* repoPath, const char* passwordUtf8);
+
+/* Take another reference to the handle, for a thread that may still use
+   it after the owner closes it. Returns repo. */
+NativeRepo* NativeRepo_AddRef(NativeRepo* repo);
+
+/* Drop a reference; the last one releases the index and the tree cache
+   and zeroes the key. */
+void NativeRepo_Close(NativeRepo* repo);
+
+/* Repository format version from the config file (1 or 2). */
+int NativeRepo_Version(const NativeRepo* repo);
+
+/* Read all snapshot files as the JSON array `restic snapshots --json`
+   prints (with "id" and "short_id" added). Returns a malloc'd string, or
+   NULL if any snapshot cannot be read. */
+char* NativeRepo_SnapshotsJson(NativeRepo* repo);
+
+/* Load index files not read yet into the blob table; rebuilds it if an
+   index file was removed (prune). Returns FALSE on failure, keeping the
+   index loaded before. */
+BOOL NativeRepo_LoadIndex(NativeRepo* repo);
+
+/* Look up a blob by ID in the loaded index. Returns FALSE if it is not there. */
+BOOL NativeRepo_FindBlob(NativeRepo* repo, const BYTE id[32], NativeBlob* outBlob);
+
+/* ID of a pack referenced by NativeBlob.pack in the loaded index (pack
+   numbers change when a prune makes the index be read anew). */
+BOOL NativeRepo_PackId(NativeRepo* repo, DWORD pack, BYTE id[32]);
+
+/* Number of blobs and packs in the loaded index. */
+int NativeRepo_BlobCount(NativeRepo* repo);
+int NativeRepo_PackCount(NativeRepo* repo);
+
+/* Root tree of a snapshot given its full or short ID. */
+BOOL NativeRepo_SnapshotTree(NativeRepo* repo, const char* snapshotId, BYTE treeId[32]);
+
+/* Decoded tree by ID, read from its pack file on a miss (loading the index
+   first if needed). Trees are cached by ID across snapshots. The tree
+   stays valid until it is given back with NativeRepo_ReleaseTree, however
+   the cache changes meanwhile. Returns NULL if the tree cannot be read. */
+const NativeTree* NativeRepo_LoadTree(NativeRepo* repo, const BYTE treeId[32]);
+
+/* Give back a tree of NativeRepo_LoadTree or NativeRepo_FindDir (NULL is
+   ignored). */
+void NativeRepo_ReleaseTree(const NativeTree* tree);
+
+/* Resolve a snapshot-internal path ("/C/Users/me", "/" for the root) from
+   the root tree. Returns 1 with *outTree set (release it as a tree of
+   LoadTree), 0 if the path does not exist or is not a directory, -1 if a
+   tree could not be read. */
+int NativeRepo_FindDir(NativeRepo* repo, const BYTE rootTree[32], const char* pathUtf8,
+                       const NativeTree** outTree);
+
+/* Visit every node below rootTree depth-first, parents before children.
+   Returns FALSE if a tree could not be read or fn stopped the walk. */
+BOOL NativeRepo_Walk(NativeRepo* repo, const BYTE rootTree[32], NativeWalkFunc fn, void* ctx);
+
+/* Write a file of a snapshot ("/C/Users/me/a.txt") to outputPath from its
+   data blobs, like `restic dump`. Blobs are read in pack order and decoded
+   on up to one thread per processor, then written in file order. With
+   offset > 0 the existing outputPath is continued at that position (resume)
+   and blobs before it are not read; length > 0 stops after that many bytes.
+   Returns 1 when written, 0 if fn aborted, -1 if the file or one of its
+   blobs could not be read or the output not written. outputPath is deleted
+   on failure unless offset > 0. */
+int NativeRepo_ExtractFile(NativeRepo* repo, const BYTE rootTree[32], const char* pathUtf8,
+                           const char* outputPath, ULONGLONG offset, ULONGLONG length,
+                           NativeProgressFunc fn, void* ctx);
+
+/* One file of NativeRepo_ExtractFiles */
+typedef struct {
+    const char* pathUtf8;           /* file in the snapshot */
+    const char* outputPathUtf8;     /* where to write it; the directory must exist */
+    int result;                     /* set: 1 written, -1 not (output removed) */
+} NativeExtractItem;
+
+/* Called as each file of NativeRepo_ExtractFiles is finished (or has
+   failed), with the bytes written across all files so far and their total.
+   Return FALSE to abort. */
+typedef BOOL (*NativeFileDoneFunc)(void* ctx, int item, LONGLONG written, LONGLONG total);
+
+/* Write several files of a snapshot at once. All their blobs are looked up
+   first; each distinct blob is then read once, going through the packs in
+   order, and written to every file (and position) that contains it, so
+   every pack is read front to back a single time however the files are
+   spread over them. Returns 1 when done (see each item's result), 0 if fn
+   aborted, -1 if nothing could be extracted. */
+int NativeRepo_ExtractFiles(NativeRepo* repo, const BYTE rootTree[32],
+                            NativeExtractItem* items, int count,
+                            NativeFileDoneFunc fn, void* ctx);
+
+#endif /* NATIVE_REPO_H */
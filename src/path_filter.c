@@ -0,0 +1,54 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "path_filter.h"
+
+/* 64-bit FNV-1a; its two halves seed the probe sequence */
+static ULONGLONG HashPath(const char* s) {
+    ULONGLONG h = 14695981039346656037ULL;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+DWORD PathFilter_Size(DWORD pathCount) {
+    ULONGLONG bytes = ((ULONGLONG)pathCount * PATH_FILTER_BITS_PER_PATH + 7) / 8;
+    if (bytes < 8) bytes = 8;
+    if (bytes > 0x7FFFFFF0ULL) bytes = 0x7FFFFFF0ULL;
+    return (DWORD)bytes;
+}
+
+/* Probe i of a path is bit (h1 + i * h2) mod bitCount (double hashing);
+   h2 is odd so the probes don't collapse onto one bit */
+void PathFilter_Add(BYTE* bits, DWORD byteCount, const char* pathUtf8) {
+    ULONGLONG h = HashPath(pathUtf8);
+    ULONGLONG bitCount = (ULONGLONG)byteCount * 8;
+    ULONGLONG h1 = h & 0xFFFFFFFFULL;
+    ULONGLONG h2 = (h >> 32) | 1;
+    int i;
+
+    for (i = 0; i < PATH_FILTER_HASHES; i++) {
+        ULONGLONG bit = (h1 + (ULONGLONG)i * h2) % bitCount;
+        bits[bit >> 3] |= (BYTE)(1 << (bit & 7));
+    }
+}
+
+BOOL PathFilter_MayContain(const BYTE* bits, DWORD byteCount, const char* pathUtf8) {
+    ULONGLONG h = HashPath(pathUtf8);
+    ULONGLONG bitCount = (ULONGLONG)byteCount * 8;
+    ULONGLONG h1 = h & 0xFFFFFFFFULL;
+    ULONGLONG h2 = (h >> 32) | 1;
+    int i;
+
+    if (bitCount == 0) return TRUE;
+    for (i = 0; i < PATH_FILTER_HASHES; i++) {
+        ULONGLONG bit = (h1 + (ULONGLONG)i * h2) % bitCount;
+        if (!(bits[bit >> 3] & (1 << (bit & 7)))) return FALSE;
+    }
+    return TRUE;
+}
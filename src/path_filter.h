@@ -0,0 +1,33 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PATH_FILTER_H
+#define PATH_FILTER_H
+
+#include <windows.h>
+
+/* Bloom filter over the directory paths of one snapshot, so a lookup of a
+   directory the snapshot does not have can be answered without a query.
+   "Not contained" is always right; "may contain" is wrong for about 1% of
+   absent paths at PATH_FILTER_BITS_PER_PATH bits and PATH_FILTER_HASHES
+   probes per path.
+
+   The filter is a plain byte array (stored as a BLOB); its size alone
+   determines the bit count, so no header is needed. */
+
+#define PATH_FILTER_BITS_PER_PATH 10
+#define PATH_FILTER_HASHES 7
+
+/* Bytes of a filter sized for pathCount paths (at least 8). */
+DWORD PathFilter_Size(DWORD pathCount);
+
+/* Add a UTF-8 path to a zeroed filter of byteCount bytes. */
+void PathFilter_Add(BYTE* bits, DWORD byteCount, const char* pathUtf8);
+
+/* FALSE if the path was certainly never added. */
+BOOL PathFilter_MayContain(const BYTE* bits, DWORD byteCount, const char* pathUtf8);
+
+#endif /* PATH_FILTER_H */
@@ -0,0 +1,58 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "perf_stats.h"
+
+static volatile LONG g_ResticSpawns = 0;
+static volatile LONG64 g_PipeBytes = 0;
+static volatile LONG64 g_ParsedBytes = 0;
+static volatile LONG g_SqliteStatements = 0;
+static volatile LONG64 g_StoreMicros = 0;
+
+void PerfStats_AddSpawn(void) {
+    InterlockedIncrement(&g_ResticSpawns);
+}
+
+void PerfStats_AddPipeBytes(LONGLONG bytes) {
+    InterlockedExchangeAdd64(&g_PipeBytes, bytes);
+}
+
+void PerfStats_AddParsedBytes(LONGLONG bytes) {
+    InterlockedExchangeAdd64(&g_ParsedBytes, bytes);
+}
+
+void PerfStats_AddStatement(void) {
+    InterlockedIncrement(&g_SqliteStatements);
+}
+
+void PerfStats_AddStoreMicros(LONGLONG micros) {
+    InterlockedExchangeAdd64(&g_StoreMicros, micros);
+}
+
+LONGLONG PerfStats_MicrosSince(LONGLONG startCounter) {
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (now.QuadPart - startCounter) * 1000000 / freq.QuadPart;
+}
+
+void PerfStats_Get(PerfStats* out) {
+    /* Interlocked reads: 64-bit loads are not atomic on 32-bit builds */
+    out->resticSpawns = InterlockedCompareExchange(&g_ResticSpawns, 0, 0);
+    out->pipeBytes = InterlockedCompareExchange64(&g_PipeBytes, 0, 0);
+    out->parsedBytes = InterlockedCompareExchange64(&g_ParsedBytes, 0, 0);
+    out->sqliteStatements = InterlockedCompareExchange(&g_SqliteStatements, 0, 0);
+    out->storeMicros = InterlockedCompareExchange64(&g_StoreMicros, 0, 0);
+}
+
+void PerfStats_Reset(void) {
+    InterlockedExchange(&g_ResticSpawns, 0);
+    InterlockedExchange64(&g_PipeBytes, 0);
+    InterlockedExchange64(&g_ParsedBytes, 0);
+    InterlockedExchange(&g_SqliteStatements, 0);
+    InterlockedExchange64(&g_StoreMicros, 0);
+}
@@ -0,0 +1,46 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef PERF_STATS_H
+#define PERF_STATS_H
+
+#include <windows.h>
+
+/* Process-wide cost counters. Cheap enough to keep always on; read by the
+   benchmark host to attribute each navigation step to restic, parsing or SQLite. */
+typedef struct {
+    LONG resticSpawns;        /* restic processes started (all commands) */
+    LONG64 pipeBytes;         /* bytes read from restic stdout pipes */
+    LONG64 parsedBytes;       /* bytes of restic output fed to the JSON parsers */
+    LONG sqliteStatements;    /* SQLite statements started on cache connections */
+    LONG64 storeMicros;       /* wall time spent inside LsCache_Store */
+} PerfStats;
+
+/* Record one restic process start. */
+void PerfStats_AddSpawn(void);
+
+/* Add bytes read from a restic pipe. */
+void PerfStats_AddPipeBytes(LONGLONG bytes);
+
+/* Add bytes consumed by a JSON/NDJSON parser. */
+void PerfStats_AddParsedBytes(LONGLONG bytes);
+
+/* Record one SQLite statement execution. */
+void PerfStats_AddStatement(void);
+
+/* Add time spent storing a listing in the SQLite cache. */
+void PerfStats_AddStoreMicros(LONGLONG micros);
+
+/* Microseconds elapsed since a QueryPerformanceCounter start value. */
+LONGLONG PerfStats_MicrosSince(LONGLONG startCounter);
+
+/* Copy the current counter values into *out. */
+void PerfStats_Get(PerfStats* out);
+
+/* Reset all counters to zero. */
+void PerfStats_Reset(void);
+
+#endif /* PERF_STATS_H */
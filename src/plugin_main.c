@@ -5,6 +5,7 @@
  */
 
 #include <windows.h>
+#include "command_log.h"
 
 /* Global module handle for finding the DLL's directory */
 HMODULE g_hModule = NULL;
@@ -16,6 +17,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD ul_reason_for_call, LPVOID lpReserv
             DisableThreadLibraryCalls(hModule);
             break;
         case DLL_PROCESS_DETACH:
+            /* Don't lose the last buffered command log lines */
+            CommandLog_Flush();
             break;
     }
     return TRUE;
@@ -0,0 +1,375 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shlwapi.h>
+
+#define REPLAY_INDEX     "index.tsv"
+#define REPLAY_HEADER    "# restic-wfx replay bundle v2: seq exit duration_ms first_byte_ms bytes has_data repo args\n"
+#define REPLAY_LINE_MAX  (2048 + 128)
+
+#define MODE_OFF     0
+#define MODE_RECORD  1
+#define MODE_REPLAY  2
+
+typedef struct {
+    int seq;
+    ReplayTiming timing;
+    BOOL hasData;
+    BOOL served;
+    char* repo;             /* "" for runs of a v1 bundle */
+    char* args;
+} ReplayRun;
+
+static int g_Mode = MODE_OFF;
+static BOOL g_Initialized = FALSE;
+static char g_BundleDir[MAX_PATH];
+static int g_SpeedPct = 100;
+static BOOL g_RecordDumpData = FALSE;
+static CRITICAL_SECTION g_Lock;
+static int g_NextSeq = 1;
+
+/* Replay mode: the loaded index */
+static ReplayRun* g_Runs = NULL;
+static int g_RunCount = 0;
+static BOOL g_SingleRepo = TRUE;    /* all runs were recorded on one repository */
+
+/* Tabs and line breaks would break the index format; both recording and
+   lookup use the same normalized key. */
+static void NormalizeArgs(const char* args, char* out, int outSize) {
+    int i;
+    for (i = 0; args[i] && i < outSize - 1; i++) {
+        char c = args[i];
+        out[i] = (c == '\t' || c == '\r' || c == '\n') ? ' ' : c;
+    }
+    out[i] = '\0';
+}
+
+static void GetIndexPath(char* out) {
+    snprintf(out, MAX_PATH, "%s\\%s", g_BundleDir, REPLAY_INDEX);
+}
+
+static void GetDataPath(int seq, char* out) {
+    snprintf(out, MAX_PATH, "%s\\%06d.out", g_BundleDir, seq);
+}
+
+/* Resolve a bundle directory from the INI; relative paths are taken
+   relative to the INI file's directory. */
+static void ResolveBundleDir(const char* configFilePath, const char* value) {
+    char iniDir[MAX_PATH];
+
+    if (!PathIsRelativeA(value)) {
+        strncpy(g_BundleDir, value, MAX_PATH - 1);
+        g_BundleDir[MAX_PATH - 1] = '\0';
+        return;
+    }
+    strncpy(iniDir, configFilePath, MAX_PATH - 1);
+    iniDir[MAX_PATH - 1] = '\0';
+    PathRemoveFileSpecA(iniDir);
+    PathCombineA(g_BundleDir, iniDir, value);
+}
+
+/* Load index.tsv into g_Runs. Returns FALSE if the index can't be read. */
+static BOOL LoadIndex(void) {
+    char indexPath[MAX_PATH];
+    char* line;
+    FILE* f;
+    int capacity = 0, firstRepo = -1;
+
+    GetIndexPath(indexPath);
+    f = fopen(indexPath, "r");
+    if (!f) return FALSE;
+
+    line = (char*)malloc(REPLAY_LINE_MAX);
+    if (!line) {
+        fclose(f);
+        return FALSE;
+    }
+
+    while (fgets(line, REPLAY_LINE_MAX, f)) {
+        ReplayRun run;
+        unsigned long exitCode;
+        long long duration, firstByte, bytes;
+        int hasData, argsOffset = 0;
+        size_t len;
+        char* tab;
+
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (sscanf(line, "%d\t%lu\t%lld\t%lld\t%lld\t%d\t%n", &run.seq, &exitCode,
+                   &duration, &firstByte, &bytes, &hasData, &argsOffset) < 6 ||
+            argsOffset == 0)
+            continue;
+
+        len = strlen(line + argsOffset);
+        while (len > 0 && (line[argsOffset + len - 1] == '\n' ||
+                           line[argsOffset + len - 1] == '\r'))
+            line[argsOffset + --len] = '\0';
+
+        run.timing.exitCode = (DWORD)exitCode;
+        run.timing.durationMs = duration;
+        run.timing.firstByteMs = firstByte;
+        run.timing.outputBytes = bytes;
+        run.hasData = hasData != 0;
+        run.served = FALSE;
+
+        /* v2 lines have the repository before the arguments; neither
+           contains a tab (NormalizeArgs) */
+        tab = strchr(line + argsOffset, '\t');
+        if (tab) {
+            *tab = '\0';
+            run.repo = _strdup(line + argsOffset);
+            run.args = _strdup(tab + 1);
+        } else {
+            run.repo = _strdup("");
+            run.args = _strdup(line + argsOffset);
+        }
+        if (!run.repo || !run.args) {
+            free(run.repo);
+            free(run.args);
+            break;
+        }
+
+        if (g_RunCount >= capacity) {
+            int newCap = capacity ? capacity * 2 : 64;
+            ReplayRun* grown = (ReplayRun*)realloc(g_Runs, newCap * sizeof(ReplayRun));
+            if (!grown) {
+                free(run.repo);
+                free(run.args);
+                break;
+            }
+            g_Runs = grown;
+            capacity = newCap;
+        }
+        if (run.repo[0] && firstRepo >= 0 && strcmp(g_Runs[firstRepo].repo, run.repo) != 0)
+            g_SingleRepo = FALSE;
+        if (run.repo[0] && firstRepo < 0) firstRepo = g_RunCount;
+        g_Runs[g_RunCount++] = run;
+        if (run.seq >= g_NextSeq) g_NextSeq = run.seq + 1;
+    }
+
+    free(line);
+    fclose(f);
+    return TRUE;
+}
+
+static void FreeRuns(void) {
+    int i;
+    for (i = 0; i < g_RunCount; i++) {
+        free(g_Runs[i].repo);
+        free(g_Runs[i].args);
+    }
+    free(g_Runs);
+    g_Runs = NULL;
+    g_RunCount = 0;
+}
+
+void Replay_InitFromConfig(const char* configFilePath) {
+    char value[MAX_PATH];
+
+    if (g_Initialized) return;
+    g_Initialized = TRUE;
+    InitializeCriticalSection(&g_Lock);
+
+    g_SpeedPct = (int)GetPrivateProfileIntA("Debug", "ReplaySpeed", 100, configFilePath);
+    if (g_SpeedPct < 0) g_SpeedPct = 0;
+    g_RecordDumpData = GetPrivateProfileIntA("Debug", "RecordDumpData", 0, configFilePath) == 1;
+
+    GetPrivateProfileStringA("Debug", "Replay", "", value, MAX_PATH, configFilePath);
+    if (value[0]) {
+        ResolveBundleDir(configFilePath, value);
+        if (LoadIndex()) g_Mode = MODE_REPLAY;
+        return;
+    }
+
+    GetPrivateProfileStringA("Debug", "Record", "", value, MAX_PATH, configFilePath);
+    if (value[0]) {
+        char indexPath[MAX_PATH];
+        FILE* f;
+
+        ResolveBundleDir(configFilePath, value);
+        CreateDirectoryA(g_BundleDir, NULL);
+
+        /* Continue numbering when appending to an existing bundle */
+        if (LoadIndex()) {
+            FreeRuns();
+        } else {
+            GetIndexPath(indexPath);
+            f = fopen(indexPath, "w");
+            if (!f) return;
+            fputs(REPLAY_HEADER, f);
+            fclose(f);
+        }
+        g_Mode = MODE_RECORD;
+    }
+}
+
+BOOL Replay_IsRecording(void) {
+    return g_Mode == MODE_RECORD;
+}
+
+BOOL Replay_IsReplaying(void) {
+    return g_Mode == MODE_REPLAY;
+}
+
+static BOOL WriteDataFile(const char* path, const char* data, LONGLONG len) {
+    HANDLE hFile;
+    DWORD written;
+    BOOL ok = TRUE;
+
+    hFile = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+    while (ok && len > 0) {
+        DWORD chunk = (len > 0x40000000) ? 0x40000000 : (DWORD)len;
+        ok = WriteFile(hFile, data, chunk, &written, NULL) && written == chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    CloseHandle(hFile);
+    return ok;
+}
+
+void Replay_Record(const char* repo, const char* args, const char* data,
+                   LONGLONG dataLen, const char* dataFile, const ReplayTiming* timing) {
+    char repoKey[MAX_PATH];
+    char key[REPLAY_LINE_MAX];
+    char dataPath[MAX_PATH];
+    char indexPath[MAX_PATH];
+    BOOL hasData = FALSE;
+    FILE* f;
+    int seq;
+
+    if (g_Mode != MODE_RECORD) return;
+
+    EnterCriticalSection(&g_Lock);
+    seq = g_NextSeq++;
+    LeaveCriticalSection(&g_Lock);
+
+    GetDataPath(seq, dataPath);
+    if (data)
+        hasData = WriteDataFile(dataPath, data, dataLen);
+    else if (dataFile && g_RecordDumpData)
+        hasData = CopyFileA(dataFile, dataPath, FALSE);
+
+    NormalizeArgs(repo, repoKey, sizeof(repoKey));
+    NormalizeArgs(args, key, sizeof(key));
+    GetIndexPath(indexPath);
+
+    EnterCriticalSection(&g_Lock);
+    f = fopen(indexPath, "a");
+    if (f) {
+        fprintf(f, "%d\t%lu\t%lld\t%lld\t%lld\t%d\t%s\t%s\n", seq,
+                (unsigned long)timing->exitCode, (long long)timing->durationMs,
+                (long long)timing->firstByteMs, (long long)timing->outputBytes,
+                hasData ? 1 : 0, repoKey, key);
+        fclose(f);
+    }
+    LeaveCriticalSection(&g_Lock);
+}
+
+static void ScaledSleep(LONGLONG ms) {
+    LONGLONG scaled = ms * g_SpeedPct / 100;
+    if (scaled > 0) Sleep((DWORD)scaled);
+}
+
+/* Read a whole file into a malloc'd NUL-terminated buffer */
+static char* ReadWholeFile(const char* path) {
+    HANDLE hFile;
+    LARGE_INTEGER size;
+    char* buffer;
+    DWORD got, total = 0;
+
+    hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return NULL;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart >= 0x7FFFFFFF) {
+        CloseHandle(hFile);
+        return NULL;
+    }
+
+    buffer = (char*)malloc((size_t)size.QuadPart + 1);
+    if (buffer) {
+        while (total < (DWORD)size.QuadPart &&
+               ReadFile(hFile, buffer + total, (DWORD)size.QuadPart - total, &got, NULL) &&
+               got > 0)
+            total += got;
+        buffer[total] = '\0';
+    }
+    CloseHandle(hFile);
+    return buffer;
+}
+
+/* Create a zero-filled file of the given size (dump recorded without data) */
+static BOOL WriteZeroFile(const char* path, LONGLONG size) {
+    HANDLE hFile;
+    LARGE_INTEGER pos;
+    BOOL ok;
+
+    hFile = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+    pos.QuadPart = size;
+    ok = SetFilePointerEx(hFile, pos, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+    CloseHandle(hFile);
+    return ok;
+}
+
+BOOL Replay_Serve(const char* repo, const char* args, char** outData,
+                  const char* dataFile, ReplayTiming* timing) {
+    char repoKey[MAX_PATH];
+    char key[REPLAY_LINE_MAX];
+    char dataPath[MAX_PATH];
+    ReplayRun run;
+    int i, found = -1, last = -1;
+    LONGLONG firstMs;
+
+    if (outData) *outData = NULL;
+    if (g_Mode != MODE_REPLAY) return FALSE;
+
+    NormalizeArgs(repo, repoKey, sizeof(repoKey));
+    NormalizeArgs(args, key, sizeof(key));
+
+    EnterCriticalSection(&g_Lock);
+    for (i = 0; i < g_RunCount; i++) {
+        if (strcmp(g_Runs[i].args, key) != 0) continue;
+        if (!g_SingleRepo && g_Runs[i].repo[0] && strcmp(g_Runs[i].repo, repoKey) != 0)
+            continue;
+        last = i;
+        if (!g_Runs[i].served) {
+            found = i;
+            break;
+        }
+    }
+    if (found < 0) found = last;
+    if (found >= 0) {
+        g_Runs[found].served = TRUE;
+        run = g_Runs[found];
+    }
+    LeaveCriticalSection(&g_Lock);
+
+    if (found < 0) return FALSE;
+    *timing = run.timing;
+
+    firstMs = (run.timing.firstByteMs >= 0) ? run.timing.firstByteMs : run.timing.durationMs;
+    ScaledSleep(firstMs);
+
+    GetDataPath(run.seq, dataPath);
+    if (outData) {
+        *outData = run.hasData ? ReadWholeFile(dataPath) : (char*)calloc(1, 1);
+        if (!*outData) return FALSE;
+    }
+    if (dataFile) {
+        BOOL ok = run.hasData ? CopyFileA(dataPath, dataFile, FALSE)
+                              : WriteZeroFile(dataFile, run.timing.outputBytes);
+        if (!ok) return FALSE;
+    }
+
+    ScaledSleep(run.timing.durationMs - firstMs);
+    return TRUE;
+}
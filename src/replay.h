@@ -0,0 +1,63 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <windows.h>
+
+/* Record and replay of restic interactions, for reproducing performance
+   problems without the repository.
+
+   [Debug] Record=<dir>     save every restic run into the bundle <dir>
+   [Debug] Replay=<dir>     don't start restic; serve runs from the bundle
+   [Debug] ReplaySpeed=<n>  replay latency in percent of the recorded one
+                            (100 = as recorded, 0 = no delay)
+   [Debug] RecordDumpData=1 also save the contents of dumped files
+                            (by default only their size is recorded)
+
+   Relative directories are resolved against the INI file's directory.
+
+   A bundle is a directory with index.tsv (one line per run: sequence number,
+   exit code, duration, time to first byte, output size, data flag,
+   repository, restic arguments) and NNNNNN.out files holding the captured
+   output. Runs are keyed by repository and arguments. A bundle recorded on
+   a single repository replays under any repository path; one recorded on
+   several only serves each repository its own runs. Listing outputs
+   contain file names and sizes from the repository. */
+
+typedef struct {
+    DWORD exitCode;
+    LONGLONG durationMs;    /* start to process exit */
+    LONGLONG firstByteMs;   /* start to first output byte (-1 if none) */
+    LONGLONG outputBytes;   /* output size (also for dumps recorded without data) */
+} ReplayTiming;
+
+/* Enable recording or replay from the [Debug] section of the INI file.
+   Replay wins if both are set. Idempotent. */
+void Replay_InitFromConfig(const char* configFilePath);
+
+BOOL Replay_IsRecording(void);
+BOOL Replay_IsReplaying(void);
+
+/* Append one finished run to the bundle; repo is the path passed to
+   restic -r (UTF-8), args the rest of the command line. The output is taken from
+   data/dataLen if data is non-NULL, else copied from dataFile if non-NULL
+   (dumps; only when RecordDumpData=1), else no output is saved. */
+void Replay_Record(const char* repo, const char* args, const char* data,
+                   LONGLONG dataLen, const char* dataFile, const ReplayTiming* timing);
+
+/* Serve the next recorded run of this repository with these arguments,
+   sleeping for the scaled recorded latency. Runs with the same arguments
+   are served in recorded order; once exhausted the last one repeats.
+   outData:  if non-NULL, receives the output as a malloc'd NUL-terminated buffer
+   dataFile: if non-NULL, the output is written to this file (a zero-filled
+             file of the recorded size if the data was not recorded)
+   Returns FALSE if the bundle has no such run. */
+BOOL Replay_Serve(const char* repo, const char* args, char** outData,
+                  const char* dataFile, ReplayTiming* timing);
+
+#endif /* REPLAY_H */
@@ -59,6 +59,7 @@ void RepoStore_Load(void) {
     int i;
 
     memset(&g_RepoStore, 0, sizeof(g_RepoStore));
+    InitializeSRWLock(&g_RepoStore.lock);
     BuildConfigPath();
 
     /* Read repo count */
@@ -110,14 +111,63 @@ void RepoStore_Save(void) {
 }
 
 RepoConfig* RepoStore_FindByName(const char* name) {
+    RepoConfig* found = NULL;
     int i;
+
+    AcquireSRWLockShared(&g_RepoStore.lock);
     for (i = 0; i < g_RepoStore.count; i++) {
         if (g_RepoStore.repos[i].configured &&
             strcmp(g_RepoStore.repos[i].name, name) == 0) {
-            return &g_RepoStore.repos[i];
+            found = &g_RepoStore.repos[i];
+            break;
         }
     }
-    return NULL;
+    ReleaseSRWLockShared(&g_RepoStore.lock);
+    return found;
+}
+
+BOOL RepoStore_Copy(const char* name, RepoConfig* out) {
+    RepoConfig* repo = RepoStore_FindByName(name);
+
+    if (!repo) return FALSE;
+    AcquireSRWLockShared(&g_RepoStore.lock);
+    *out = *repo;
+    ReleaseSRWLockShared(&g_RepoStore.lock);
+    return TRUE;
+}
+
+/* The store's entry for repo, which may be a copy */
+static RepoConfig* StoreEntry(RepoConfig* repo) {
+    if (repo >= g_RepoStore.repos && repo < g_RepoStore.repos + MAX_REPOS) return repo;
+    return RepoStore_FindByName(repo->name);
+}
+
+/* Cache a password in repo and in the store's entry */
+static void SetPassword(RepoConfig* repo, const char* password) {
+    RepoConfig* entry = StoreEntry(repo);
+
+    AcquireSRWLockExclusive(&g_RepoStore.lock);
+    strncpy(repo->password, password, MAX_REPO_PASS - 1);
+    repo->password[MAX_REPO_PASS - 1] = '\0';
+    repo->hasPassword = TRUE;
+    if (entry && entry != repo) {
+        memcpy(entry->password, repo->password, MAX_REPO_PASS);
+        entry->hasPassword = TRUE;
+    }
+    ReleaseSRWLockExclusive(&g_RepoStore.lock);
+}
+
+void RepoStore_ForgetPassword(RepoConfig* repo) {
+    RepoConfig* entry = StoreEntry(repo);
+
+    AcquireSRWLockExclusive(&g_RepoStore.lock);
+    SecureZeroMemory(repo->password, MAX_REPO_PASS);
+    repo->hasPassword = FALSE;
+    if (entry && entry != repo) {
+        SecureZeroMemory(entry->password, MAX_REPO_PASS);
+        entry->hasPassword = FALSE;
+    }
+    ReleaseSRWLockExclusive(&g_RepoStore.lock);
 }
 
 BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc) {
@@ -129,7 +179,7 @@ BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc) {
     char* output;
 
     if (!requestProc) return FALSE;
-    if (g_RepoStore.count >= MAX_REPOS) return FALSE;
+    if (g_RepoStore.count >= MAX_REPOS) return FALSE;  /* only the UI thread adds */
 
     memset(repoPath, 0, sizeof(repoPath));
     memset(repoName, 0, sizeof(repoName));
@@ -199,7 +249,7 @@ BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc) {
     }
     free(output);
 
-    /* Add the new repo */
+    /* Add the new repo; it becomes visible to other threads with the count */
     repo = &g_RepoStore.repos[g_RepoStore.count];
     strncpy(repo->name, repoName, MAX_REPO_NAME - 1);
     strncpy(repo->path, repoPath, MAX_REPO_PATH - 1);
@@ -208,7 +258,9 @@ BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc) {
         strncpy(repo->passwordFile, passFile, MAX_PATH - 1);
     repo->configured = TRUE;
     repo->hasPassword = TRUE;
+    AcquireSRWLockExclusive(&g_RepoStore.lock);
     g_RepoStore.count++;
+    ReleaseSRWLockExclusive(&g_RepoStore.lock);
 
     /* Save to INI */
     RepoStore_Save();
@@ -221,31 +273,34 @@ BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc) {
 
 BOOL RepoStore_EnsurePassword(RepoConfig* repo, int pluginNr, tRequestProc requestProc) {
     char buf[MAX_REPO_PASS];
+    BOOL cached;
 
     if (!repo || !requestProc) return FALSE;
 
     /* Already have password in memory */
-    if (repo->hasPassword && repo->password[0] != '\0') {
-        return TRUE;
-    }
+    AcquireSRWLockShared(&g_RepoStore.lock);
+    cached = repo->hasPassword && repo->password[0] != '\0';
+    ReleaseSRWLockShared(&g_RepoStore.lock);
+    if (cached) return TRUE;
+
+    memset(buf, 0, sizeof(buf));
 
     /* Try password file */
     if (repo->passwordFile[0] != '\0') {
-        if (ReadPasswordFile(repo->passwordFile, repo->password, MAX_REPO_PASS)) {
-            repo->hasPassword = TRUE;
+        if (ReadPasswordFile(repo->passwordFile, buf, MAX_REPO_PASS)) {
+            SetPassword(repo, buf);
+            SecureZeroMemory(buf, sizeof(buf));
             return TRUE;
         }
         /* File unreadable — fall through to manual prompt */
     }
 
-    memset(buf, 0, sizeof(buf));
     if (!requestProc(pluginNr, RT_Password, "Repository Password",
                      "Enter restic repository password:", buf, MAX_REPO_PASS)) {
         return FALSE;
     }
 
-    strncpy(repo->password, buf, MAX_REPO_PASS - 1);
-    repo->hasPassword = TRUE;
+    SetPassword(repo, buf);
 
     SecureZeroMemory(buf, sizeof(buf));
     return TRUE;
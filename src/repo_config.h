@@ -24,10 +24,14 @@ typedef struct {
     BOOL hasPassword;               /* TRUE if password is cached in memory */
 } RepoConfig;
 
+/* Entries never move once added. The lock guards count and the cached
+   passwords, which the UI thread may set or clear while a background copy
+   reads them; such a thread works on a RepoStore_Copy. */
 typedef struct {
     RepoConfig repos[MAX_REPOS];
     int count;
     char configFilePath[MAX_PATH];
+    SRWLOCK lock;
 } RepoStore;
 
 /* Global repo store */
@@ -42,13 +46,22 @@ void RepoStore_Save(void);
 /* Find a repo by name. Returns pointer or NULL. */
 RepoConfig* RepoStore_FindByName(const char* name);
 
+/* Copy a repo with its cached password into *out, for use off the UI
+   thread. Returns FALSE if there is no such repo. */
+BOOL RepoStore_Copy(const char* name, RepoConfig* out);
+
+/* Drop the cached password of a repo (and of the store's entry when repo
+   is a copy), so the user is asked again. */
+void RepoStore_ForgetPassword(RepoConfig* repo);
+
 /* Prompt user to add a new repository using TC request dialogs.
    pluginNr: the plugin number from FsInit
    requestProc: the tRequestProc callback from FsInit
    Returns TRUE if a repo was successfully added. */
 BOOL RepoStore_PromptAdd(int pluginNr, tRequestProc requestProc);
 
-/* Prompt user for password if not already cached.
+/* Prompt user for password if not already cached; a password entered for
+   a copy is cached in the store's entry as well.
    Returns TRUE if password is available (already cached or just entered). */
 BOOL RepoStore_EnsurePassword(RepoConfig* repo, int pluginNr, tRequestProc requestProc);
 
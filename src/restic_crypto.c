@@ -0,0 +1,578 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "restic_crypto.h"
+#include <string.h>
+#include <stdlib.h>
+
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+static u32 Load32LE(const BYTE* p) {
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static void Store32LE(BYTE* p, u32 v) {
+    p[0] = (BYTE)v; p[1] = (BYTE)(v >> 8); p[2] = (BYTE)(v >> 16); p[3] = (BYTE)(v >> 24);
+}
+
+static u32 Load32BE(const BYTE* p) {
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+static void Store32BE(BYTE* p, u32 v) {
+    p[0] = (BYTE)(v >> 24); p[1] = (BYTE)(v >> 16); p[2] = (BYTE)(v >> 8); p[3] = (BYTE)v;
+}
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* --- SHA-256 (FIPS 180-4) --- */
+
+typedef struct {
+    u32 state[8];
+    u64 length;         /* bytes hashed */
+    BYTE block[64];
+    size_t blockLen;
+} Sha256;
+
+static const u32 g_Sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static void Sha256_Init(Sha256* h) {
+    static const u32 iv[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(h->state, iv, sizeof(iv));
+    h->length = 0;
+    h->blockLen = 0;
+}
+
+static void Sha256_Compress(Sha256* h, const BYTE* block) {
+    u32 w[64];
+    u32 a, b, c, d, e, f, g, k;
+    int i;
+
+    for (i = 0; i < 16; i++) w[i] = Load32BE(block + i * 4);
+    for (i = 16; i < 64; i++) {
+        u32 s0 = ROTR32(w[i - 15], 7) ^ ROTR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        u32 s1 = ROTR32(w[i - 2], 17) ^ ROTR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    a = h->state[0]; b = h->state[1]; c = h->state[2]; d = h->state[3];
+    e = h->state[4]; f = h->state[5]; g = h->state[6]; k = h->state[7];
+    for (i = 0; i < 64; i++) {
+        u32 t1 = k + (ROTR32(e, 6) ^ ROTR32(e, 11) ^ ROTR32(e, 25)) +
+                 ((e & f) ^ (~e & g)) + g_Sha256K[i] + w[i];
+        u32 t2 = (ROTR32(a, 2) ^ ROTR32(a, 13) ^ ROTR32(a, 22)) +
+                 ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h->state[0] += a; h->state[1] += b; h->state[2] += c; h->state[3] += d;
+    h->state[4] += e; h->state[5] += f; h->state[6] += g; h->state[7] += k;
+}
+
+static void Sha256_Update(Sha256* h, const void* data, size_t len) {
+    const BYTE* p = (const BYTE*)data;
+    h->length += len;
+
+    if (h->blockLen > 0) {
+        size_t take = 64 - h->blockLen;
+        if (take > len) take = len;
+        memcpy(h->block + h->blockLen, p, take);
+        h->blockLen += take;
+        p += take;
+        len -= take;
+        if (h->blockLen < 64) return;
+        Sha256_Compress(h, h->block);
+        h->blockLen = 0;
+    }
+    while (len >= 64) {
+        Sha256_Compress(h, p);
+        p += 64;
+        len -= 64;
+    }
+    memcpy(h->block, p, len);
+    h->blockLen = len;
+}
+
+static void Sha256_Final(Sha256* h, BYTE out[32]) {
+    u64 bits = h->length * 8;
+    BYTE pad[72];
+    size_t padLen = (h->blockLen < 56) ? 56 - h->blockLen : 120 - h->blockLen;
+    int i;
+
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (i = 0; i < 8; i++) pad[padLen + i] = (BYTE)(bits >> (56 - 8 * i));
+    Sha256_Update(h, pad, padLen + 8);
+    for (i = 0; i < 8; i++) Store32BE(out + i * 4, h->state[i]);
+}
+
+void Crypto_Sha256(const void* data, size_t len, BYTE out[32]) {
+    Sha256 h;
+    Sha256_Init(&h);
+    Sha256_Update(&h, data, len);
+    Sha256_Final(&h, out);
+}
+
+/* --- HMAC-SHA-256 and PBKDF2 (one iteration, as scrypt uses it) --- */
+
+typedef struct {
+    Sha256 inner;
+    Sha256 outer;
+} HmacSha256;
+
+static void Hmac_Init(HmacSha256* m, const BYTE* key, size_t keyLen) {
+    BYTE block[64];
+    BYTE hashed[32];
+    int i;
+
+    if (keyLen > 64) {
+        Crypto_Sha256(key, keyLen, hashed);
+        key = hashed;
+        keyLen = 32;
+    }
+    memset(block, 0, sizeof(block));
+    memcpy(block, key, keyLen);
+
+    for (i = 0; i < 64; i++) block[i] ^= 0x36;
+    Sha256_Init(&m->inner);
+    Sha256_Update(&m->inner, block, 64);
+    for (i = 0; i < 64; i++) block[i] ^= 0x36 ^ 0x5c;
+    Sha256_Init(&m->outer);
+    Sha256_Update(&m->outer, block, 64);
+}
+
+static void Hmac_Final(HmacSha256* m, BYTE out[32]) {
+    BYTE inner[32];
+    Sha256_Final(&m->inner, inner);
+    Sha256_Update(&m->outer, inner, 32);
+    Sha256_Final(&m->outer, out);
+}
+
+static void Pbkdf2Sha256Once(const BYTE* password, size_t passwordLen,
+                             const BYTE* salt, size_t saltLen, BYTE* out, size_t outLen) {
+    HmacSha256 keyed, m;
+    BYTE counter[4];
+    BYTE block[32];
+    u32 i;
+
+    Hmac_Init(&keyed, password, passwordLen);
+    for (i = 1; outLen > 0; i++) {
+        size_t take = outLen < 32 ? outLen : 32;
+        m = keyed;
+        Sha256_Update(&m.inner, salt, saltLen);
+        Store32BE(counter, i);
+        Sha256_Update(&m.inner, counter, 4);
+        Hmac_Final(&m, block);
+        memcpy(out, block, take);
+        out += take;
+        outLen -= take;
+    }
+}
+
+/* --- scrypt (RFC 7914) --- */
+
+static void Salsa20_8(u32 b[16]) {
+    u32 x[16];
+    int i;
+
+    memcpy(x, b, sizeof(x));
+    for (i = 0; i < 8; i += 2) {
+        x[ 4] ^= ROTL32(x[ 0] + x[12],  7); x[ 8] ^= ROTL32(x[ 4] + x[ 0],  9);
+        x[12] ^= ROTL32(x[ 8] + x[ 4], 13); x[ 0] ^= ROTL32(x[12] + x[ 8], 18);
+        x[ 9] ^= ROTL32(x[ 5] + x[ 1],  7); x[13] ^= ROTL32(x[ 9] + x[ 5],  9);
+        x[ 1] ^= ROTL32(x[13] + x[ 9], 13); x[ 5] ^= ROTL32(x[ 1] + x[13], 18);
+        x[14] ^= ROTL32(x[10] + x[ 6],  7); x[ 2] ^= ROTL32(x[14] + x[10],  9);
+        x[ 6] ^= ROTL32(x[ 2] + x[14], 13); x[10] ^= ROTL32(x[ 6] + x[ 2], 18);
+        x[ 3] ^= ROTL32(x[15] + x[11],  7); x[ 7] ^= ROTL32(x[ 3] + x[15],  9);
+        x[11] ^= ROTL32(x[ 7] + x[ 3], 13); x[15] ^= ROTL32(x[11] + x[ 7], 18);
+        x[ 1] ^= ROTL32(x[ 0] + x[ 3],  7); x[ 2] ^= ROTL32(x[ 1] + x[ 0],  9);
+        x[ 3] ^= ROTL32(x[ 2] + x[ 1], 13); x[ 0] ^= ROTL32(x[ 3] + x[ 2], 18);
+        x[ 6] ^= ROTL32(x[ 5] + x[ 4],  7); x[ 7] ^= ROTL32(x[ 6] + x[ 5],  9);
+        x[ 4] ^= ROTL32(x[ 7] + x[ 6], 13); x[ 5] ^= ROTL32(x[ 4] + x[ 7], 18);
+        x[11] ^= ROTL32(x[10] + x[ 9],  7); x[ 8] ^= ROTL32(x[11] + x[10],  9);
+        x[ 9] ^= ROTL32(x[ 8] + x[11], 13); x[10] ^= ROTL32(x[ 9] + x[ 8], 18);
+        x[12] ^= ROTL32(x[15] + x[14],  7); x[13] ^= ROTL32(x[12] + x[15],  9);
+        x[14] ^= ROTL32(x[13] + x[12], 13); x[15] ^= ROTL32(x[14] + x[13], 18);
+    }
+    for (i = 0; i < 16; i++) b[i] += x[i];
+}
+
+/* B (2r 64-byte blocks as words) -> Y, even blocks first, then odd ones */
+static void BlockMix(const u32* b, u32* y, DWORD r) {
+    u32 x[16];
+    DWORD i;
+    int j;
+
+    memcpy(x, b + (2 * r - 1) * 16, sizeof(x));
+    for (i = 0; i < 2 * r; i++) {
+        for (j = 0; j < 16; j++) x[j] ^= b[i * 16 + j];
+        Salsa20_8(x);
+        memcpy(y + ((i & 1) ? r + i / 2 : i / 2) * 16, x, sizeof(x));
+    }
+}
+
+static void RoMix(u32* x, DWORD r, DWORD n, u32* v, u32* y) {
+    size_t words = 32 * (size_t)r;
+    DWORD i;
+    size_t k;
+
+    for (i = 0; i < n; i++) {
+        memcpy(v + i * words, x, words * sizeof(u32));
+        BlockMix(x, y, r);
+        memcpy(x, y, words * sizeof(u32));
+    }
+    for (i = 0; i < n; i++) {
+        u32 j = x[(2 * r - 1) * 16] & (n - 1);
+        const u32* vj = v + (size_t)j * words;
+        for (k = 0; k < words; k++) x[k] ^= vj[k];
+        BlockMix(x, y, r);
+        memcpy(x, y, words * sizeof(u32));
+    }
+}
+
+BOOL Crypto_Scrypt(const BYTE* password, size_t passwordLen,
+                   const BYTE* salt, size_t saltLen,
+                   DWORD n, DWORD r, DWORD p, BYTE* out, size_t outLen) {
+    size_t blockBytes, words, k;
+    BYTE* b = NULL;
+    u32* x = NULL;
+    u32* y = NULL;
+    u32* v = NULL;
+    DWORD i;
+    BOOL ok;
+
+    if (n < 2 || (n & (n - 1)) != 0 || r == 0 || p == 0) return FALSE;
+    /* 128 * r * N bytes of V must fit size_t */
+    if ((u64)128 * r * n > (u64)((size_t)-1) / 2 || (u64)128 * r * p > 0x7FFFFFFF) return FALSE;
+
+    blockBytes = 128 * (size_t)r;
+    words = blockBytes / 4;
+    b = (BYTE*)malloc(blockBytes * p);
+    x = (u32*)malloc(blockBytes);
+    y = (u32*)malloc(blockBytes);
+    v = (u32*)malloc(blockBytes * n);
+    ok = b && x && y && v;
+
+    if (ok) {
+        Pbkdf2Sha256Once(password, passwordLen, salt, saltLen, b, blockBytes * p);
+        for (i = 0; i < p; i++) {
+            BYTE* bi = b + i * blockBytes;
+            for (k = 0; k < words; k++) x[k] = Load32LE(bi + k * 4);
+            RoMix(x, r, n, v, y);
+            for (k = 0; k < words; k++) Store32LE(bi + k * 4, x[k]);
+        }
+        Pbkdf2Sha256Once(password, passwordLen, b, blockBytes * p, out, outLen);
+    }
+
+    if (v) SecureZeroMemory(v, blockBytes * n);
+    if (b) SecureZeroMemory(b, blockBytes * p);
+    free(b);
+    free(x);
+    free(y);
+    free(v);
+    return ok;
+}
+
+/* --- AES (FIPS-197), encryption only: CTR mode and the MAC need no more --- */
+
+typedef struct {
+    u32 roundKeys[60];
+    int rounds;
+} Aes;
+
+static BYTE g_Sbox[256];
+static u32 g_Te[4][256];
+static volatile LONG g_AesInitState = 0;
+
+static BYTE XTime(BYTE x) {
+    return (BYTE)((x << 1) ^ ((x & 0x80) ? 0x1b : 0));
+}
+
+/* S-box from the multiplicative inverse in GF(2^8) plus the affine map, and
+   the combined SubBytes/ShiftRows/MixColumns tables */
+static void Aes_BuildTables(void) {
+    BYTE p = 1, q = 1;
+    int i;
+
+    do {
+        BYTE t;
+        p = (BYTE)(p ^ (p << 1) ^ ((p & 0x80) ? 0x1b : 0));     /* p *= 3 */
+        q ^= (BYTE)(q << 1);                                      /* q /= 3 */
+        q ^= (BYTE)(q << 2);
+        q ^= (BYTE)(q << 4);
+        if (q & 0x80) q ^= 0x09;
+        t = (BYTE)(q ^ (BYTE)((q << 1) | (q >> 7)) ^ (BYTE)((q << 2) | (q >> 6)) ^
+                   (BYTE)((q << 3) | (q >> 5)) ^ (BYTE)((q << 4) | (q >> 4)));
+        g_Sbox[p] = (BYTE)(t ^ 0x63);
+    } while (p != 1);
+    g_Sbox[0] = 0x63;
+
+    for (i = 0; i < 256; i++) {
+        BYTE s = g_Sbox[i];
+        BYTE s2 = XTime(s);
+        BYTE s3 = (BYTE)(s2 ^ s);
+        u32 w = ((u32)s2 << 24) | ((u32)s << 16) | ((u32)s << 8) | s3;
+        g_Te[0][i] = w;
+        g_Te[1][i] = ROTR32(w, 8);
+        g_Te[2][i] = ROTR32(w, 16);
+        g_Te[3][i] = ROTR32(w, 24);
+    }
+}
+
+static void Aes_EnsureTables(void) {
+    if (g_AesInitState == 2) return;
+
+    if (InterlockedCompareExchange(&g_AesInitState, 1, 0) == 0) {
+        Aes_BuildTables();
+        InterlockedExchange(&g_AesInitState, 2);
+    } else {
+        while (g_AesInitState != 2) Sleep(0);
+    }
+}
+
+static u32 SubWord(u32 w) {
+    return ((u32)g_Sbox[w >> 24] << 24) | ((u32)g_Sbox[(w >> 16) & 0xff] << 16) |
+           ((u32)g_Sbox[(w >> 8) & 0xff] << 8) | (u32)g_Sbox[w & 0xff];
+}
+
+/* keyLen 16 or 32 */
+static void Aes_Init(Aes* a, const BYTE* key, int keyLen) {
+    int nk = keyLen / 4;
+    int total, i;
+    BYTE rcon = 1;
+
+    Aes_EnsureTables();
+    a->rounds = nk + 6;
+    total = 4 * (a->rounds + 1);
+    for (i = 0; i < nk; i++) a->roundKeys[i] = Load32BE(key + 4 * i);
+    for (i = nk; i < total; i++) {
+        u32 t = a->roundKeys[i - 1];
+        if (i % nk == 0) {
+            t = SubWord(ROTL32(t, 8)) ^ ((u32)rcon << 24);
+            rcon = XTime(rcon);
+        } else if (nk > 6 && i % nk == 4) {
+            t = SubWord(t);
+        }
+        a->roundKeys[i] = a->roundKeys[i - nk] ^ t;
+    }
+}
+
+static void Aes_Encrypt(const Aes* a, const BYTE in[16], BYTE out[16]) {
+    const u32* rk = a->roundKeys;
+    u32 s0 = Load32BE(in) ^ rk[0];
+    u32 s1 = Load32BE(in + 4) ^ rk[1];
+    u32 s2 = Load32BE(in + 8) ^ rk[2];
+    u32 s3 = Load32BE(in + 12) ^ rk[3];
+    int round;
+
+    for (round = 1; round < a->rounds; round++) {
+        u32 t0, t1, t2, t3;
+        rk += 4;
+        t0 = g_Te[0][s0 >> 24] ^ g_Te[1][(s1 >> 16) & 0xff] ^
+             g_Te[2][(s2 >> 8) & 0xff] ^ g_Te[3][s3 & 0xff] ^ rk[0];
+        t1 = g_Te[0][s1 >> 24] ^ g_Te[1][(s2 >> 16) & 0xff] ^
+             g_Te[2][(s3 >> 8) & 0xff] ^ g_Te[3][s0 & 0xff] ^ rk[1];
+        t2 = g_Te[0][s2 >> 24] ^ g_Te[1][(s3 >> 16) & 0xff] ^
+             g_Te[2][(s0 >> 8) & 0xff] ^ g_Te[3][s1 & 0xff] ^ rk[2];
+        t3 = g_Te[0][s3 >> 24] ^ g_Te[1][(s0 >> 16) & 0xff] ^
+             g_Te[2][(s1 >> 8) & 0xff] ^ g_Te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    /* Final round: no MixColumns */
+    rk += 4;
+    Store32BE(out, (((u32)g_Sbox[s0 >> 24] << 24) | ((u32)g_Sbox[(s1 >> 16) & 0xff] << 16) |
+                    ((u32)g_Sbox[(s2 >> 8) & 0xff] << 8) | g_Sbox[s3 & 0xff]) ^ rk[0]);
+    Store32BE(out + 4, (((u32)g_Sbox[s1 >> 24] << 24) | ((u32)g_Sbox[(s2 >> 16) & 0xff] << 16) |
+                        ((u32)g_Sbox[(s3 >> 8) & 0xff] << 8) | g_Sbox[s0 & 0xff]) ^ rk[1]);
+    Store32BE(out + 8, (((u32)g_Sbox[s2 >> 24] << 24) | ((u32)g_Sbox[(s3 >> 16) & 0xff] << 16) |
+                        ((u32)g_Sbox[(s0 >> 8) & 0xff] << 8) | g_Sbox[s1 & 0xff]) ^ rk[2]);
+    Store32BE(out + 12, (((u32)g_Sbox[s3 >> 24] << 24) | ((u32)g_Sbox[(s0 >> 16) & 0xff] << 16) |
+                         ((u32)g_Sbox[(s1 >> 8) & 0xff] << 8) | g_Sbox[s2 & 0xff]) ^ rk[3]);
+}
+
+/* CTR with the whole 16-byte block as a big-endian counter (Go's cipher.NewCTR) */
+static void Aes_Ctr(const Aes* a, const BYTE iv[16], const BYTE* in, BYTE* out, size_t len) {
+    BYTE counter[16];
+    BYTE stream[16];
+    size_t i;
+    int j;
+
+    memcpy(counter, iv, 16);
+    while (len > 0) {
+        size_t take = len < 16 ? len : 16;
+        Aes_Encrypt(a, counter, stream);
+        for (i = 0; i < take; i++) out[i] = in[i] ^ stream[i];
+        in += take;
+        out += take;
+        len -= take;
+        for (j = 15; j >= 0 && ++counter[j] == 0; j--) {}
+    }
+}
+
+/* --- Poly1305 (26-bit limbs) --- */
+
+static void Poly1305(const BYTE r16[16], const BYTE s16[16], const BYTE* msg, size_t len,
+                     BYTE out[16]) {
+    u32 r0, r1, r2, r3, r4, s1, s2, s3, s4;
+    u32 h0 = 0, h1 = 0, h2 = 0, h3 = 0, h4 = 0;
+    u32 g0, g1, g2, g3, g4, mask, c;
+    u64 f;
+
+    /* r with the clamp applied */
+    r0 = Load32LE(r16) & 0x3ffffff;
+    r1 = (Load32LE(r16 + 3) >> 2) & 0x3ffff03;
+    r2 = (Load32LE(r16 + 6) >> 4) & 0x3ffc0ff;
+    r3 = (Load32LE(r16 + 9) >> 6) & 0x3f03fff;
+    r4 = (Load32LE(r16 + 12) >> 8) & 0x00fffff;
+    s1 = r1 * 5; s2 = r2 * 5; s3 = r3 * 5; s4 = r4 * 5;
+
+    while (len > 0) {
+        BYTE block[16];
+        u32 hibit = 1 << 24;
+        u64 d0, d1, d2, d3, d4;
+
+        if (len >= 16) {
+            memcpy(block, msg, 16);
+            msg += 16;
+            len -= 16;
+        } else {
+            memset(block, 0, 16);
+            memcpy(block, msg, len);
+            block[len] = 1;
+            hibit = 0;
+            len = 0;
+        }
+
+        h0 += Load32LE(block) & 0x3ffffff;
+        h1 += (Load32LE(block + 3) >> 2) & 0x3ffffff;
+        h2 += (Load32LE(block + 6) >> 4) & 0x3ffffff;
+        h3 += (Load32LE(block + 9) >> 6) & 0x3ffffff;
+        h4 += (Load32LE(block + 12) >> 8) | hibit;
+
+        d0 = (u64)h0 * r0 + (u64)h1 * s4 + (u64)h2 * s3 + (u64)h3 * s2 + (u64)h4 * s1;
+        d1 = (u64)h0 * r1 + (u64)h1 * r0 + (u64)h2 * s4 + (u64)h3 * s3 + (u64)h4 * s2;
+        d2 = (u64)h0 * r2 + (u64)h1 * r1 + (u64)h2 * r0 + (u64)h3 * s4 + (u64)h4 * s3;
+        d3 = (u64)h0 * r3 + (u64)h1 * r2 + (u64)h2 * r1 + (u64)h3 * r0 + (u64)h4 * s4;
+        d4 = (u64)h0 * r4 + (u64)h1 * r3 + (u64)h2 * r2 + (u64)h3 * r1 + (u64)h4 * r0;
+
+        c = (u32)(d0 >> 26); h0 = (u32)d0 & 0x3ffffff;
+        d1 += c; c = (u32)(d1 >> 26); h1 = (u32)d1 & 0x3ffffff;
+        d2 += c; c = (u32)(d2 >> 26); h2 = (u32)d2 & 0x3ffffff;
+        d3 += c; c = (u32)(d3 >> 26); h3 = (u32)d3 & 0x3ffffff;
+        d4 += c; c = (u32)(d4 >> 26); h4 = (u32)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+    }
+
+    /* Full carry, then h mod 2^130 - 5 */
+    c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    g4 = h4 + c - (1 << 26);
+
+    mask = (g4 >> 31) - 1;      /* all ones if h >= p */
+    h0 = (h0 & ~mask) | (g0 & mask);
+    h1 = (h1 & ~mask) | (g1 & mask);
+    h2 = (h2 & ~mask) | (g2 & mask);
+    h3 = (h3 & ~mask) | (g3 & mask);
+    h4 = (h4 & ~mask) | (g4 & mask);
+
+    /* h + s mod 2^128 */
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    f = (u64)h0 + Load32LE(s16);              Store32LE(out, (u32)f);
+    f = (u64)h1 + Load32LE(s16 + 4) + (f >> 32);  Store32LE(out + 4, (u32)f);
+    f = (u64)h2 + Load32LE(s16 + 8) + (f >> 32);  Store32LE(out + 8, (u32)f);
+    f = (u64)h3 + Load32LE(s16 + 12) + (f >> 32); Store32LE(out + 12, (u32)f);
+}
+
+/* --- restic ciphertexts --- */
+
+void Crypto_KeyFromBytes(const BYTE bytes[64], CryptoKey* key) {
+    memcpy(key->encrypt, bytes, 32);
+    memcpy(key->macK, bytes + 32, 16);
+    memcpy(key->macR, bytes + 48, 16);
+}
+
+BOOL Crypto_Open(const CryptoKey* key, const BYTE* in, size_t inLen, BYTE* out) {
+    const BYTE* iv = in;
+    const BYTE* cipher = in + CRYPTO_IV_SIZE;
+    size_t cipherLen;
+    BYTE s[16];
+    BYTE mac[16];
+    BYTE diff = 0;
+    Aes a;
+    int i;
+
+    if (inLen < CRYPTO_OVERHEAD) return FALSE;
+    cipherLen = inLen - CRYPTO_OVERHEAD;
+
+    /* Poly1305-AES: s = AES-128_k(nonce) */
+    Aes_Init(&a, key->macK, 16);
+    Aes_Encrypt(&a, iv, s);
+    Poly1305(key->macR, s, cipher, cipherLen, mac);
+    for (i = 0; i < CRYPTO_MAC_SIZE; i++) diff |= (BYTE)(mac[i] ^ cipher[cipherLen + i]);
+    if (diff != 0) return FALSE;
+
+    Aes_Init(&a, key->encrypt, 32);
+    Aes_Ctr(&a, iv, cipher, out, cipherLen);
+    return TRUE;
+}
+
+/* --- base64 --- */
+
+static int Base64Value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int Crypto_Base64Decode(const char* in, BYTE* out, int outSize) {
+    u32 acc = 0;
+    int bits = 0, len = 0;
+
+    for (; *in && *in != '='; in++) {
+        int v = Base64Value(*in);
+        if (v < 0) return -1;
+        acc = (acc << 6) | (u32)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (len >= outSize) return -1;
+            out[len++] = (BYTE)(acc >> bits);
+        }
+    }
+    return len;
+}
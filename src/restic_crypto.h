@@ -0,0 +1,49 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef RESTIC_CRYPTO_H
+#define RESTIC_CRYPTO_H
+
+#include "native_port.h"
+
+/* The primitives of restic's repository encryption, for reading local
+   repositories without the restic process:
+     - scrypt (over SHA-256 PBKDF2) derives the key that opens a key file
+     - every file and blob is IV (16) || AES-256-CTR ciphertext || MAC (16),
+       where MAC = Poly1305-AES(ciphertext) keyed by (k, r) with the IV as
+       nonce: Poly1305 with r and s = AES-128_k(IV) */
+
+#define CRYPTO_IV_SIZE 16
+#define CRYPTO_MAC_SIZE 16
+#define CRYPTO_OVERHEAD (CRYPTO_IV_SIZE + CRYPTO_MAC_SIZE)
+
+typedef struct {
+    BYTE encrypt[32];   /* AES-256 key */
+    BYTE macK[16];      /* AES-128 key that turns the IV into Poly1305's s */
+    BYTE macR[16];      /* Poly1305 r (clamped when used) */
+} CryptoKey;
+
+void Crypto_Sha256(const void* data, size_t len, BYTE out[32]);
+
+/* scrypt(password, salt, N, r, p) into outLen bytes. N must be a power of
+   two. Returns FALSE if the parameters are invalid or memory runs out. */
+BOOL Crypto_Scrypt(const BYTE* password, size_t passwordLen,
+                   const BYTE* salt, size_t saltLen,
+                   DWORD n, DWORD r, DWORD p, BYTE* out, size_t outLen);
+
+/* Key from 64 bytes laid out as restic's KDF output: encrypt || k || r. */
+void Crypto_KeyFromBytes(const BYTE bytes[64], CryptoKey* key);
+
+/* Verify and decrypt IV || ciphertext || MAC into out, which receives
+   inLen - CRYPTO_OVERHEAD bytes (out may not overlap in). Returns FALSE if
+   the input is too short or the MAC does not match (wrong key or damage). */
+BOOL Crypto_Open(const CryptoKey* key, const BYTE* in, size_t inLen, BYTE* out);
+
+/* Decode standard base64 (padding optional). Returns the byte count, or -1
+   on invalid input or if out is too small. */
+int Crypto_Base64Decode(const char* in, BYTE* out, int outSize);
+
+#endif /* RESTIC_CRYPTO_H */
@@ -5,11 +5,15 @@
  */
 
 #include "restic_process.h"
+#include "perf_stats.h"
+#include "trace.h"
+#include "metrics.h"
+#include "replay.h"
+#include "command_log.h"
+#include "mem_budget.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <shlobj.h>
 
 /* Convert a UTF-8 string to a malloc'd wide string. Caller must free. */
 static WCHAR* Utf8ToWide(const char* utf8) {
@@ -22,62 +26,12 @@ static WCHAR* Utf8ToWide(const char* utf8) {
     return wbuf;
 }
 
-/* Command logging infrastructure */
-static char g_LogFilePath[MAX_PATH] = {0};
-static BOOL g_LogInitialized = FALSE;
-
-/* Build log file path: %APPDATA%\GHISLER\plugins\wfx\restic_wfx\restic_commands.log */
-static void EnsureLogPath(void) {
-    char appData[MAX_PATH];
-    char dir[MAX_PATH];
-
-    if (g_LogInitialized) return;
-
-    if (FAILED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, appData))) {
-        g_LogFilePath[0] = '\0';
-        g_LogInitialized = TRUE;
-        return;
-    }
-
-    /* Create intermediate directories */
-    snprintf(dir, MAX_PATH, "%s\\GHISLER", appData);
-    CreateDirectoryA(dir, NULL);
-    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins", appData);
-    CreateDirectoryA(dir, NULL);
-    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins\\wfx", appData);
-    CreateDirectoryA(dir, NULL);
-    snprintf(dir, MAX_PATH, "%s\\GHISLER\\plugins\\wfx\\restic_wfx", appData);
-    CreateDirectoryA(dir, NULL);
-
-    snprintf(g_LogFilePath, MAX_PATH,
-             "%s\\GHISLER\\plugins\\wfx\\restic_wfx\\restic_commands.log", appData);
-    g_LogInitialized = TRUE;
-}
-
-/* Log a restic command with timestamp. Appends to log file. */
-static void LogResticCommand(const char* cmdLine) {
-    FILE* f;
-    time_t now;
-    struct tm* tm_info;
-    char timestamp[32];
-
-    EnsureLogPath();
-    if (g_LogFilePath[0] == '\0') return;
-
-    f = fopen(g_LogFilePath, "a");
-    if (!f) return;
-
-    time(&now);
-    tm_info = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-
-    fprintf(f, "[%s] %s\n", timestamp, cmdLine);
-    fclose(f);
-}
-
-char* RunResticWithProgress(const char* repoPath, const char* password,
-                            const char* args, DWORD* exitCode,
-                            ResticCancelFunc cancelCb, void* userData) {
+/* Shared implementation of RunRestic/RunResticWithProgress/RunResticTimed.
+   info may be NULL. */
+static char* RunResticInternal(const char* repoPath, const char* password,
+                               const char* args, DWORD* exitCode,
+                               ResticCancelFunc cancelCb, void* userData,
+                               ResticRunInfo* info) {
     SECURITY_ATTRIBUTES sa;
     HANDLE hReadPipe = NULL, hWritePipe = NULL;
     STARTUPINFOW si;
@@ -89,8 +43,17 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
     DWORD totalRead = 0;
     DWORD bytesRead;
     BOOL ok;
+    TraceSpan runSpan, spawnSpan, firstByteSpan;
+    ULONGLONG startMs = GetTickCount64();
+    LONGLONG firstByteMs = -1;
+    DWORD processExit = (DWORD)-1;
 
     if (exitCode) *exitCode = (DWORD)-1;
+    if (info) {
+        info->durationMs = 0;
+        info->firstByteMs = -1;
+        info->outputBytes = 0;
+    }
 
     /* Convert ANSI repo path to UTF-8 so the entire cmdLine is UTF-8 */
     char repoPathUtf8[MAX_PATH];
@@ -114,7 +77,35 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
 
     /* Build command line (fully UTF-8, will be converted to wide) */
     snprintf(cmdLine, sizeof(cmdLine), "restic -r \"%s\" %s", repoPathUtf8, args);
-    LogResticCommand(cmdLine);
+    Trace_Begin(&runSpan);
+    Trace_ArgStr(&runSpan, "args", args);
+
+    /* Replay mode: serve the recorded output instead of starting restic */
+    if (Replay_IsReplaying()) {
+        ReplayTiming rt;
+        if (!Replay_Serve(repoPathUtf8, args, &buffer, NULL, &rt)) {
+            Trace_ArgStr(&runSpan, "error", "not in replay bundle");
+            Trace_End(&runSpan, "restic.run");
+            CommandLog_Write(cmdLine, 0, (DWORD)-1, 0);
+            return NULL;
+        }
+        if (exitCode) *exitCode = rt.exitCode;
+        if (info) {
+            info->durationMs = (LONGLONG)(GetTickCount64() - startMs);
+            info->firstByteMs = rt.firstByteMs;
+            info->outputBytes = rt.outputBytes;
+        }
+        PerfStats_AddPipeBytes((LONG64)rt.outputBytes);
+        Trace_ArgInt(&runSpan, "exit_code", (LONGLONG)rt.exitCode);
+        Trace_ArgInt(&runSpan, "bytes", rt.outputBytes);
+        Trace_ArgInt(&runSpan, "replayed", 1);
+        Trace_End(&runSpan, "restic.run");
+        Metrics_RecordRestic(repoPath, Metrics_CommandFromArgs(args),
+                             (LONGLONG)(GetTickCount64() - startMs), rt.outputBytes);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs),
+                         rt.exitCode, rt.outputBytes);
+        return buffer;
+    }
 
     /* Create pipe for stdout capture */
     memset(&sa, 0, sizeof(sa));
@@ -153,6 +144,7 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
     }
 
     /* Create the restic process (wide version for correct Unicode paths) */
+    Trace_Begin(&spawnSpan);
     ok = CreateProcessW(
         NULL,           /* lpApplicationName */
         wCmdLine,       /* lpCommandLine */
@@ -167,6 +159,7 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
     );
 
     free(wCmdLine);
+    Trace_End(&spawnSpan, "restic.spawn");
 
     /* Clear the password from environment immediately */
     SetEnvironmentVariableA("RESTIC_PASSWORD", NULL);
@@ -177,69 +170,126 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
 
     if (!ok) {
         CloseHandle(hReadPipe);
+        Trace_ArgStr(&runSpan, "error", "spawn failed");
+        Trace_End(&runSpan, "restic.run");
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), (DWORD)-1, 0);
         return NULL;
     }
-
-    /* Read stdout into growing buffer */
-    buffer = (char*)malloc(bufSize);
+    PerfStats_AddSpawn();
+    Trace_Begin(&firstByteSpan);
+
+    /* Read stdout into growing buffer. The buffer is charged to the memory
+       budget while it grows; the caller accounts it after we return. */
+    if (Mem_Charge(MEM_RESTIC_OUTPUT, bufSize)) {
+        buffer = (char*)malloc(bufSize);
+        if (!buffer) Mem_Uncharge(MEM_RESTIC_OUTPUT, bufSize);
+    }
     if (!buffer) {
         CloseHandle(hReadPipe);
         TerminateProcess(pi.hProcess, 1);
         CloseHandle(pi.hProcess);
         CloseHandle(pi.hThread);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), (DWORD)-1, 0);
         return NULL;
     }
 
     while (ReadFile(hReadPipe, buffer + totalRead, bufSize - totalRead - 1, &bytesRead, NULL)
            && bytesRead > 0) {
+        if (totalRead == 0) {
+            Trace_End(&firstByteSpan, "restic.first_byte");
+            firstByteMs = (LONGLONG)(GetTickCount64() - startMs);
+        }
         totalRead += bytesRead;
 
         /* Check cancellation callback after each read chunk */
         if (cancelCb && !cancelCb(userData)) {
             free(buffer);
+            Mem_Uncharge(MEM_RESTIC_OUTPUT, bufSize);
             CloseHandle(hReadPipe);
             TerminateProcess(pi.hProcess, 1);
             WaitForSingleObject(pi.hProcess, 5000);
             CloseHandle(pi.hProcess);
             CloseHandle(pi.hThread);
             if (exitCode) *exitCode = (DWORD)-1;
+            CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs),
+                             (DWORD)-1, totalRead);
             return NULL;
         }
 
         if (totalRead + 1 >= bufSize) {
-            bufSize *= 2;
-            char* newBuf = (char*)realloc(buffer, bufSize);
+            char* newBuf = NULL;
+            /* Output that doesn't fit the memory budget ends the run */
+            if (Mem_Charge(MEM_RESTIC_OUTPUT, bufSize)) {
+                newBuf = (char*)realloc(buffer, bufSize * 2);
+                if (newBuf) bufSize *= 2;
+                else Mem_Uncharge(MEM_RESTIC_OUTPUT, bufSize);
+            }
             if (!newBuf) {
                 free(buffer);
+                Mem_Uncharge(MEM_RESTIC_OUTPUT, bufSize);
                 CloseHandle(hReadPipe);
                 TerminateProcess(pi.hProcess, 1);
+                WaitForSingleObject(pi.hProcess, 5000);
                 CloseHandle(pi.hProcess);
                 CloseHandle(pi.hThread);
+                CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs),
+                                 (DWORD)-1, totalRead);
                 return NULL;
             }
             buffer = newBuf;
         }
     }
     buffer[totalRead] = '\0';
+    PerfStats_AddPipeBytes(totalRead);
 
     CloseHandle(hReadPipe);
 
     /* Wait for process to finish (120 second timeout for large snapshot listings) */
     WaitForSingleObject(pi.hProcess, 120000);
 
-    if (exitCode) {
-        GetExitCodeProcess(pi.hProcess, exitCode);
+    GetExitCodeProcess(pi.hProcess, &processExit);
+    if (exitCode) *exitCode = processExit;
+    Trace_ArgInt(&runSpan, "exit_code", (LONGLONG)processExit);
+    Trace_ArgInt(&runSpan, "bytes", totalRead);
+    Trace_End(&runSpan, "restic.run");
+    Metrics_RecordRestic(repoPath, Metrics_CommandFromArgs(args),
+                         (LONGLONG)(GetTickCount64() - startMs), totalRead);
+    if (info) {
+        info->durationMs = (LONGLONG)(GetTickCount64() - startMs);
+        info->firstByteMs = firstByteMs;
+        info->outputBytes = totalRead;
+    }
+    CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), processExit, totalRead);
+    if (Replay_IsRecording()) {
+        ReplayTiming rt;
+        rt.exitCode = processExit;
+        rt.durationMs = (LONGLONG)(GetTickCount64() - startMs);
+        rt.firstByteMs = firstByteMs;
+        rt.outputBytes = totalRead;
+        Replay_Record(repoPathUtf8, args, buffer, totalRead, NULL, &rt);
     }
 
     CloseHandle(pi.hProcess);
     CloseHandle(pi.hThread);
+    Mem_Uncharge(MEM_RESTIC_OUTPUT, bufSize);
 
     return buffer;
 }
 
+char* RunResticWithProgress(const char* repoPath, const char* password,
+                            const char* args, DWORD* exitCode,
+                            ResticCancelFunc cancelCb, void* userData) {
+    return RunResticInternal(repoPath, password, args, exitCode, cancelCb, userData, NULL);
+}
+
 char* RunRestic(const char* repoPath, const char* password,
                 const char* args, DWORD* exitCode) {
-    return RunResticWithProgress(repoPath, password, args, exitCode, NULL, NULL);
+    return RunResticInternal(repoPath, password, args, exitCode, NULL, NULL, NULL);
+}
+
+char* RunResticTimed(const char* repoPath, const char* password,
+                     const char* args, DWORD* exitCode, ResticRunInfo* info) {
+    return RunResticInternal(repoPath, password, args, exitCode, NULL, NULL, info);
 }
 
 BOOL RunResticDump(const char* repoPath, const char* password,
@@ -258,6 +308,11 @@ BOOL RunResticDump(const char* repoPath, const char* password,
     DWORD bytesRead, bytesWritten;
     LONGLONG totalWritten = 0;
     BOOL ok, aborted = FALSE;
+    TraceSpan dumpSpan, firstByteSpan;
+    ULONGLONG startMs = GetTickCount64();
+    LONGLONG firstByteMs = -1;
+    DWORD processExit = (DWORD)-1;
+    char replayKey[1024];
 
     if (exitCode) *exitCode = (DWORD)-1;
 
@@ -284,7 +339,33 @@ BOOL RunResticDump(const char* repoPath, const char* password,
     /* Build command line (fully UTF-8, will be converted to wide) */
     snprintf(cmdLine, sizeof(cmdLine),
              "restic -r \"%s\" dump %s \"%s\"", repoPathUtf8, snapshotId, filePath);
-    LogResticCommand(cmdLine);
+    Trace_Begin(&dumpSpan);
+    Trace_ArgStr(&dumpSpan, "path", filePath);
+
+    /* Replay mode: write the recorded file instead of starting restic */
+    snprintf(replayKey, sizeof(replayKey), "dump %s \"%s\"", snapshotId, filePath);
+    if (Replay_IsReplaying()) {
+        ReplayTiming rt;
+        BOOL served = Replay_Serve(repoPathUtf8, replayKey, NULL, outputPath, &rt);
+        if (served && progressCb) progressCb(rt.outputBytes, totalSize, userData);
+        Trace_ArgInt(&dumpSpan, "bytes", served ? rt.outputBytes : 0);
+        Trace_ArgInt(&dumpSpan, "replayed", 1);
+        Trace_End(&dumpSpan, "restic.dump");
+        if (!served) {
+            CommandLog_Write(cmdLine, 0, (DWORD)-1, 0);
+            return FALSE;
+        }
+        Metrics_RecordRestic(repoPath, RC_DUMP, (LONGLONG)(GetTickCount64() - startMs),
+                             rt.outputBytes);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs),
+                         rt.exitCode, rt.outputBytes);
+        if (exitCode) *exitCode = rt.exitCode;
+        if (rt.exitCode != 0) {
+            DeleteFileA(outputPath);
+            return FALSE;
+        }
+        return TRUE;
+    }
 
     /* Create pipe for stdout capture */
     memset(&sa, 0, sizeof(sa));
@@ -332,8 +413,11 @@ BOOL RunResticDump(const char* repoPath, const char* password,
 
     if (!ok) {
         CloseHandle(hReadPipe);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), (DWORD)-1, 0);
         return FALSE;
     }
+    PerfStats_AddSpawn();
+    Trace_Begin(&firstByteSpan);
 
     /* Open output file */
     hOutFile = CreateFileA(outputPath, GENERIC_WRITE, 0, NULL,
@@ -349,6 +433,10 @@ BOOL RunResticDump(const char* repoPath, const char* password,
 
     /* Stream pipe to file */
     while (ReadFile(hReadPipe, buf, sizeof(buf), &bytesRead, NULL) && bytesRead > 0) {
+        if (totalWritten == 0) {
+            Trace_End(&firstByteSpan, "restic.first_byte");
+            firstByteMs = (LONGLONG)(GetTickCount64() - startMs);
+        }
         if (!WriteFile(hOutFile, buf, bytesRead, &bytesWritten, NULL)) {
             break;
         }
@@ -364,6 +452,12 @@ BOOL RunResticDump(const char* repoPath, const char* password,
 
     CloseHandle(hReadPipe);
     CloseHandle(hOutFile);
+    PerfStats_AddPipeBytes(totalWritten);
+    Trace_ArgInt(&dumpSpan, "bytes", totalWritten);
+    Trace_ArgInt(&dumpSpan, "aborted", aborted);
+    Trace_End(&dumpSpan, "restic.dump");
+    Metrics_RecordRestic(repoPath, RC_DUMP, (LONGLONG)(GetTickCount64() - startMs),
+                         totalWritten);
 
     if (aborted) {
         TerminateProcess(pi.hProcess, 1);
@@ -372,14 +466,24 @@ BOOL RunResticDump(const char* repoPath, const char* password,
         CloseHandle(pi.hThread);
         DeleteFileA(outputPath);
         if (exitCode) *exitCode = (DWORD)-1;
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs),
+                         (DWORD)-1, totalWritten);
         return FALSE;
     }
 
     /* Wait for process to finish (5 min timeout for large files) */
     WaitForSingleObject(pi.hProcess, 300000);
 
-    if (exitCode) {
-        GetExitCodeProcess(pi.hProcess, exitCode);
+    GetExitCodeProcess(pi.hProcess, &processExit);
+    if (exitCode) *exitCode = processExit;
+    CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), processExit, totalWritten);
+    if (Replay_IsRecording()) {
+        ReplayTiming rt;
+        rt.exitCode = processExit;
+        rt.durationMs = (LONGLONG)(GetTickCount64() - startMs);
+        rt.firstByteMs = firstByteMs;
+        rt.outputBytes = totalWritten;
+        Replay_Record(repoPathUtf8, replayKey, NULL, 0, outputPath, &rt);
     }
 
     CloseHandle(pi.hProcess);
@@ -403,6 +507,10 @@ BOOL RunResticRestore(const char* repoPath, const char* password,
     char cmdLine[2048];
     WCHAR* wCmdLine = NULL;
     BOOL ok;
+    TraceSpan span;
+    ULONGLONG startMs = GetTickCount64();
+    DWORD processExit = (DWORD)-1;
+    char replayKey[1024];
 
     if (exitCode) *exitCode = (DWORD)-1;
 
@@ -430,7 +538,26 @@ BOOL RunResticRestore(const char* repoPath, const char* password,
     snprintf(cmdLine, sizeof(cmdLine),
              "restic -r \"%s\" restore %s --path \"%s\" --include \"%s\" --target \"%s\"",
              repoPathUtf8, snapshotId, snapshotPath, includePath, targetDir);
-    LogResticCommand(cmdLine);
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "include", includePath);
+
+    /* Replay mode: only the exit code and duration are replayed */
+    snprintf(replayKey, sizeof(replayKey), "restore %s --path \"%s\" --include \"%s\"",
+             snapshotId, snapshotPath, includePath);
+    if (Replay_IsReplaying()) {
+        ReplayTiming rt;
+        BOOL served = Replay_Serve(repoPathUtf8, replayKey, NULL, NULL, &rt);
+        Trace_ArgInt(&span, "replayed", 1);
+        Trace_End(&span, "restic.restore");
+        if (!served) {
+            CommandLog_Write(cmdLine, 0, (DWORD)-1, 0);
+            return FALSE;
+        }
+        Metrics_RecordRestic(repoPath, RC_RESTORE, (LONGLONG)(GetTickCount64() - startMs), 0);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), rt.exitCode, 0);
+        if (exitCode) *exitCode = rt.exitCode;
+        return (exitCode && *exitCode == 0) ? TRUE : (exitCode ? FALSE : TRUE);
+    }
 
     /* Set RESTIC_PASSWORD environment variable */
     SetEnvironmentVariableA("RESTIC_PASSWORD", password);
@@ -454,13 +581,30 @@ BOOL RunResticRestore(const char* repoPath, const char* password,
     free(wCmdLine);
     SetEnvironmentVariableA("RESTIC_PASSWORD", NULL);
 
-    if (!ok) return FALSE;
+    if (!ok) {
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), (DWORD)-1, 0);
+        return FALSE;
+    }
+    PerfStats_AddSpawn();
 
     /* Wait for restore to finish (10 min timeout for large trees) */
     WaitForSingleObject(pi.hProcess, 600000);
 
     if (exitCode) {
         GetExitCodeProcess(pi.hProcess, exitCode);
+        Trace_ArgInt(&span, "exit_code", (LONGLONG)*exitCode);
+    }
+    Trace_End(&span, "restic.restore");
+    Metrics_RecordRestic(repoPath, RC_RESTORE, (LONGLONG)(GetTickCount64() - startMs), 0);
+    GetExitCodeProcess(pi.hProcess, &processExit);
+    CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), processExit, 0);
+    if (Replay_IsRecording()) {
+        ReplayTiming rt;
+        rt.exitCode = processExit;
+        rt.durationMs = (LONGLONG)(GetTickCount64() - startMs);
+        rt.firstByteMs = -1;
+        rt.outputBytes = 0;
+        Replay_Record(repoPathUtf8, replayKey, NULL, 0, NULL, &rt);
     }
 
     CloseHandle(pi.hProcess);
@@ -477,6 +621,10 @@ BOOL RunResticRewrite(const char* repoPath, const char* password,
     char cmdLine[2048];
     WCHAR* wCmdLine = NULL;
     BOOL ok;
+    TraceSpan span;
+    ULONGLONG startMs = GetTickCount64();
+    DWORD processExit = (DWORD)-1;
+    char replayKey[1024];
 
     if (exitCode) *exitCode = (DWORD)-1;
 
@@ -504,7 +652,26 @@ BOOL RunResticRewrite(const char* repoPath, const char* password,
     snprintf(cmdLine, sizeof(cmdLine),
              "restic -r \"%s\" rewrite --exclude \"%s\" --path \"%s\" --forget",
              repoPathUtf8, excludePath, snapshotPath);
-    LogResticCommand(cmdLine);
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "exclude", excludePath);
+
+    /* Replay mode: only the exit code and duration are replayed */
+    snprintf(replayKey, sizeof(replayKey), "rewrite --exclude \"%s\" --path \"%s\" --forget",
+             excludePath, snapshotPath);
+    if (Replay_IsReplaying()) {
+        ReplayTiming rt;
+        BOOL served = Replay_Serve(repoPathUtf8, replayKey, NULL, NULL, &rt);
+        Trace_ArgInt(&span, "replayed", 1);
+        Trace_End(&span, "restic.rewrite");
+        if (!served) {
+            CommandLog_Write(cmdLine, 0, (DWORD)-1, 0);
+            return FALSE;
+        }
+        Metrics_RecordRestic(repoPath, RC_REWRITE, (LONGLONG)(GetTickCount64() - startMs), 0);
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), rt.exitCode, 0);
+        if (exitCode) *exitCode = rt.exitCode;
+        return (exitCode && *exitCode == 0) ? TRUE : (exitCode ? FALSE : TRUE);
+    }
 
     /* Set RESTIC_PASSWORD environment variable */
     SetEnvironmentVariableA("RESTIC_PASSWORD", password);
@@ -528,13 +695,30 @@ BOOL RunResticRewrite(const char* repoPath, const char* password,
     free(wCmdLine);
     SetEnvironmentVariableA("RESTIC_PASSWORD", NULL);
 
-    if (!ok) return FALSE;
+    if (!ok) {
+        CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), (DWORD)-1, 0);
+        return FALSE;
+    }
+    PerfStats_AddSpawn();
 
     /* Wait for rewrite to finish (10 min timeout) */
     WaitForSingleObject(pi.hProcess, 600000);
 
     if (exitCode) {
         GetExitCodeProcess(pi.hProcess, exitCode);
+        Trace_ArgInt(&span, "exit_code", (LONGLONG)*exitCode);
+    }
+    Trace_End(&span, "restic.rewrite");
+    Metrics_RecordRestic(repoPath, RC_REWRITE, (LONGLONG)(GetTickCount64() - startMs), 0);
+    GetExitCodeProcess(pi.hProcess, &processExit);
+    CommandLog_Write(cmdLine, (LONGLONG)(GetTickCount64() - startMs), processExit, 0);
+    if (Replay_IsRecording()) {
+        ReplayTiming rt;
+        rt.exitCode = processExit;
+        rt.durationMs = (LONGLONG)(GetTickCount64() - startMs);
+        rt.firstByteMs = -1;
+        rt.outputBytes = 0;
+        Replay_Record(repoPathUtf8, replayKey, NULL, 0, NULL, &rt);
     }
 
     CloseHandle(pi.hProcess);
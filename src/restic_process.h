@@ -31,6 +31,18 @@ char* RunResticWithProgress(const char* repoPath, const char* password,
                             const char* args, DWORD* exitCode,
                             ResticCancelFunc cancelCb, void* userData);
 
+/* Timing of one finished restic run (filled by RunResticTimed). */
+typedef struct {
+    LONGLONG durationMs;    /* spawn to process exit */
+    LONGLONG firstByteMs;   /* spawn to first byte on stdout (-1 if none) */
+    LONGLONG outputBytes;   /* bytes read from stdout */
+} ResticRunInfo;
+
+/* Same as RunRestic, but also reports timing and output size in *info.
+   info is filled even when the process fails. */
+char* RunResticTimed(const char* repoPath, const char* password,
+                     const char* args, DWORD* exitCode, ResticRunInfo* info);
+
 /* Progress callback for RunResticDump.
    bytesWritten: total bytes written so far
    totalSize:    expected total size (0 if unknown)
@@ -0,0 +1,362 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "snap_index.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Write buffer per output file */
+#define SINK_BUFFER_SIZE (64 * 1024)
+
+/* Longest path or name accepted (UTF-8 of a MAX_PATH ANSI string) */
+#define SNAP_INDEX_MAX_STRING (MAX_PATH * 3)
+
+/* Buffered sequential writer over one file */
+typedef struct {
+    HANDLE file;
+    char path[MAX_PATH];
+    char* buf;
+    DWORD len;
+    ULONGLONG written;      /* bytes accepted, including the buffered ones */
+} Sink;
+
+struct SnapIndexWriter {
+    char filePath[MAX_PATH];
+    Sink main;              /* header placeholder, then the entries */
+    Sink dirs;
+    Sink strings;
+    DWORD dirCount;
+    DWORD entryCount;
+    SnapIndexDir current;   /* directory receiving entries */
+    BOOL hasCurrent;
+    BOOL failed;
+    char lastPath[SNAP_INDEX_MAX_STRING];
+    char lastName[SNAP_INDEX_MAX_STRING];
+};
+
+struct SnapIndex {
+    const BYTE* base;       /* mapped view of the whole file */
+    const SnapIndexDir* dirs;
+    const SnapIndexEntry* entries;
+    const char* strings;
+    DWORD dirCount;
+    DWORD entryCount;
+    DWORD stringBytes;
+};
+
+/* --- Writing --- */
+
+static BOOL Sink_Open(Sink* s, const char* path) {
+    memset(s, 0, sizeof(Sink));
+    strncpy(s->path, path, MAX_PATH - 1);
+    s->buf = (char*)malloc(SINK_BUFFER_SIZE);
+    if (!s->buf) return FALSE;
+    s->file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, NULL);
+    return s->file != INVALID_HANDLE_VALUE;
+}
+
+static BOOL Sink_Flush(Sink* s) {
+    DWORD written = 0;
+    BOOL ok = TRUE;
+    if (s->len > 0) {
+        ok = WriteFile(s->file, s->buf, s->len, &written, NULL) && written == s->len;
+        s->len = 0;
+    }
+    return ok;
+}
+
+static BOOL Sink_Write(Sink* s, const void* data, DWORD len) {
+    const char* p = (const char*)data;
+    while (len > 0) {
+        DWORD chunk = SINK_BUFFER_SIZE - s->len;
+        if (chunk > len) chunk = len;
+        memcpy(s->buf + s->len, p, chunk);
+        s->len += chunk;
+        s->written += chunk;
+        p += chunk;
+        len -= chunk;
+        if (s->len == SINK_BUFFER_SIZE && !Sink_Flush(s)) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Append everything written to src (flushed) to dst */
+static BOOL Sink_AppendFile(Sink* dst, Sink* src) {
+    LARGE_INTEGER zero;
+    DWORD got = 0;
+    BOOL ok;
+
+    zero.QuadPart = 0;
+    ok = Sink_Flush(src) && SetFilePointerEx(src->file, zero, NULL, FILE_BEGIN);
+    while (ok) {
+        ok = ReadFile(src->file, src->buf, SINK_BUFFER_SIZE, &got, NULL);
+        if (!ok || got == 0) break;
+        ok = Sink_Write(dst, src->buf, got);
+    }
+    return ok;
+}
+
+/* Close the file; a temporary file is deleted as well */
+static void Sink_Close(Sink* s, BOOL deleteFile) {
+    if (s->file && s->file != INVALID_HANDLE_VALUE) CloseHandle(s->file);
+    s->file = NULL;
+    if (deleteFile && s->path[0]) DeleteFileA(s->path);
+    free(s->buf);
+    s->buf = NULL;
+}
+
+/* Append a NUL-terminated string to the string table; returns its offset */
+static BOOL AddString(SnapIndexWriter* w, const char* str, DWORD* outOffset) {
+    size_t len = strlen(str) + 1;
+    if (w->strings.written + len > MAXDWORD) return FALSE;
+    *outOffset = (DWORD)w->strings.written;
+    return Sink_Write(&w->strings, str, (DWORD)len);
+}
+
+/* Write the record of the directory that was receiving entries */
+static BOOL FlushCurrentDir(SnapIndexWriter* w) {
+    if (!w->hasCurrent) return TRUE;
+    w->hasCurrent = FALSE;
+    w->dirCount++;
+    return Sink_Write(&w->dirs, &w->current, sizeof(SnapIndexDir));
+}
+
+SnapIndexWriter* SnapIndex_Create(const char* filePath) {
+    SnapIndexWriter* w;
+    SnapIndexHeader placeholder;
+    char tmpPath[MAX_PATH];
+    BOOL ok;
+
+    w = (SnapIndexWriter*)calloc(1, sizeof(SnapIndexWriter));
+    if (!w) return NULL;
+    strncpy(w->filePath, filePath, MAX_PATH - 1);
+
+    snprintf(tmpPath, MAX_PATH, "%s.tmp", filePath);
+    ok = Sink_Open(&w->main, tmpPath);
+    snprintf(tmpPath, MAX_PATH, "%s.dirs.tmp", filePath);
+    ok = Sink_Open(&w->dirs, tmpPath) && ok;
+    snprintf(tmpPath, MAX_PATH, "%s.str.tmp", filePath);
+    ok = Sink_Open(&w->strings, tmpPath) && ok;
+
+    /* Header is rewritten once the section sizes are known; the string
+       table starts with the empty string */
+    memset(&placeholder, 0, sizeof(placeholder));
+    ok = ok && Sink_Write(&w->main, &placeholder, sizeof(placeholder));
+    ok = ok && Sink_Write(&w->strings, "", 1);
+
+    if (!ok) {
+        SnapIndex_Finish(w, FALSE);
+        return NULL;
+    }
+    return w;
+}
+
+BOOL SnapIndex_AddDir(SnapIndexWriter* w, const char* pathUtf8) {
+    DWORD offset = 0;
+
+    if (w->failed) return FALSE;
+    if (strlen(pathUtf8) >= SNAP_INDEX_MAX_STRING ||
+        ((w->dirCount > 0 || w->hasCurrent) && strcmp(pathUtf8, w->lastPath) <= 0) ||
+        !FlushCurrentDir(w) ||
+        !AddString(w, pathUtf8, &offset)) {
+        w->failed = TRUE;
+        return FALSE;
+    }
+
+    strcpy(w->lastPath, pathUtf8);
+    w->lastName[0] = '\0';
+    w->current.pathOffset = offset;
+    w->current.firstEntry = w->entryCount;
+    w->current.entryCount = 0;
+    w->hasCurrent = TRUE;
+    return TRUE;
+}
+
+BOOL SnapIndex_AddEntry(SnapIndexWriter* w, const char* nameUtf8, BOOL isDirectory,
+                        DWORD sizeLow, DWORD sizeHigh, FILETIME lastWriteTime) {
+    SnapIndexEntry e;
+
+    if (w->failed) return FALSE;
+    if (!w->hasCurrent || w->entryCount == MAXDWORD ||
+        strlen(nameUtf8) >= SNAP_INDEX_MAX_STRING ||
+        (w->current.entryCount > 0 && strcmp(nameUtf8, w->lastName) <= 0) ||
+        !AddString(w, nameUtf8, &e.nameOffset)) {
+        w->failed = TRUE;
+        return FALSE;
+    }
+
+    strcpy(w->lastName, nameUtf8);
+    e.isDirectory = isDirectory ? 1 : 0;
+    e.sizeLow = sizeLow;
+    e.sizeHigh = sizeHigh;
+    e.mtimeLow = lastWriteTime.dwLowDateTime;
+    e.mtimeHigh = lastWriteTime.dwHighDateTime;
+    if (!Sink_Write(&w->main, &e, sizeof(e))) {
+        w->failed = TRUE;
+        return FALSE;
+    }
+    w->entryCount++;
+    w->current.entryCount++;
+    return TRUE;
+}
+
+BOOL SnapIndex_Finish(SnapIndexWriter* w, BOOL commit) {
+    SnapIndexHeader h;
+    LARGE_INTEGER zero;
+    DWORD written = 0;
+    BOOL ok;
+
+    if (!w) return FALSE;
+
+    ok = commit && !w->failed && FlushCurrentDir(w);
+
+    if (ok) {
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, SNAP_INDEX_MAGIC, sizeof(SNAP_INDEX_MAGIC));
+        h.version = SNAP_INDEX_VERSION;
+        h.dirCount = w->dirCount;
+        h.entryCount = w->entryCount;
+        h.stringBytes = (DWORD)w->strings.written;
+        h.entryOffset = sizeof(SnapIndexHeader);
+
+        /* Sections must be addressable with DWORD offsets */
+        ok = w->main.written + w->dirs.written + w->strings.written <= MAXDWORD;
+        h.dirOffset = (DWORD)w->main.written;
+        h.stringOffset = (DWORD)(w->main.written + w->dirs.written);
+    }
+
+    ok = ok && Sink_AppendFile(&w->main, &w->dirs)
+            && Sink_AppendFile(&w->main, &w->strings)
+            && Sink_Flush(&w->main);
+
+    if (ok) {
+        zero.QuadPart = 0;
+        ok = SetFilePointerEx(w->main.file, zero, NULL, FILE_BEGIN) &&
+             WriteFile(w->main.file, &h, sizeof(h), &written, NULL) &&
+             written == sizeof(h);
+    }
+
+    Sink_Close(&w->dirs, TRUE);
+    Sink_Close(&w->strings, TRUE);
+    Sink_Close(&w->main, !ok);
+
+    if (ok) {
+        ok = MoveFileExA(w->main.path, w->filePath, MOVEFILE_REPLACE_EXISTING);
+        if (!ok) DeleteFileA(w->main.path);
+    }
+
+    free(w);
+    return ok;
+}
+
+/* --- Reading --- */
+
+/* TRUE if count records of recordSize at offset lie inside the file */
+static BOOL SectionFits(ULONGLONG fileSize, DWORD offset, DWORD count, DWORD recordSize) {
+    return (offset % sizeof(DWORD)) == 0 &&
+           (ULONGLONG)offset + (ULONGLONG)count * recordSize <= fileSize;
+}
+
+SnapIndex* SnapIndex_Open(const char* filePath) {
+    HANDLE hFile;
+    HANDLE hMapping = NULL;
+    LARGE_INTEGER size;
+    const BYTE* base = NULL;
+    const SnapIndexHeader* h;
+    SnapIndex* idx = NULL;
+    BOOL ok;
+
+    hFile = CreateFileA(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return NULL;
+
+    /* The whole file is mapped at once, so it must fit the address space */
+    ok = GetFileSizeEx(hFile, &size) &&
+         size.QuadPart >= (LONGLONG)sizeof(SnapIndexHeader) &&
+         (ULONGLONG)size.QuadPart <= (ULONGLONG)(SIZE_T)-1;
+    if (ok) {
+        hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+        ok = hMapping != NULL;
+    }
+    if (ok) {
+        base = (const BYTE*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        ok = base != NULL;
+    }
+    /* The view keeps the file open */
+    if (hMapping) CloseHandle(hMapping);
+    CloseHandle(hFile);
+    if (!ok) return NULL;
+
+    h = (const SnapIndexHeader*)base;
+    ok = memcmp(h->magic, SNAP_INDEX_MAGIC, sizeof(SNAP_INDEX_MAGIC)) == 0 &&
+         h->version == SNAP_INDEX_VERSION &&
+         SectionFits((ULONGLONG)size.QuadPart, h->entryOffset, h->entryCount,
+                     sizeof(SnapIndexEntry)) &&
+         SectionFits((ULONGLONG)size.QuadPart, h->dirOffset, h->dirCount,
+                     sizeof(SnapIndexDir)) &&
+         h->stringBytes > 0 &&
+         (ULONGLONG)h->stringOffset + h->stringBytes <= (ULONGLONG)size.QuadPart &&
+         base[h->stringOffset + h->stringBytes - 1] == '\0';
+
+    if (ok) {
+        idx = (SnapIndex*)malloc(sizeof(SnapIndex));
+        ok = idx != NULL;
+    }
+    if (!ok) {
+        UnmapViewOfFile(base);
+        return NULL;
+    }
+
+    idx->base = base;
+    idx->entries = (const SnapIndexEntry*)(base + h->entryOffset);
+    idx->dirs = (const SnapIndexDir*)(base + h->dirOffset);
+    idx->strings = (const char*)(base + h->stringOffset);
+    idx->dirCount = h->dirCount;
+    idx->entryCount = h->entryCount;
+    idx->stringBytes = h->stringBytes;
+    return idx;
+}
+
+void SnapIndex_Close(SnapIndex* idx) {
+    if (!idx) return;
+    UnmapViewOfFile(idx->base);
+    free(idx);
+}
+
+/* The string table ends with a NUL, so any in-range offset is a valid string */
+static const char* StringAt(const SnapIndex* idx, DWORD offset) {
+    return offset < idx->stringBytes ? idx->strings + offset : "";
+}
+
+const SnapIndexEntry* SnapIndex_FindDir(const SnapIndex* idx, const char* pathUtf8,
+                                        int* outCount) {
+    DWORD lo = 0, hi = idx->dirCount;
+
+    *outCount = 0;
+    while (lo < hi) {
+        DWORD mid = lo + (hi - lo) / 2;
+        const SnapIndexDir* d = &idx->dirs[mid];
+        int cmp = strcmp(StringAt(idx, d->pathOffset), pathUtf8);
+
+        if (cmp == 0) {
+            if (d->firstEntry > idx->entryCount ||
+                d->entryCount > idx->entryCount - d->firstEntry ||
+                d->entryCount > (DWORD)0x7FFFFFFF)
+                return NULL;
+            *outCount = (int)d->entryCount;
+            return idx->entries + d->firstEntry;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+const char* SnapIndex_Name(const SnapIndex* idx, const SnapIndexEntry* e) {
+    return StringAt(idx, e->nameOffset);
+}
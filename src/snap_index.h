@@ -0,0 +1,90 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef SNAP_INDEX_H
+#define SNAP_INDEX_H
+
+#include <windows.h>
+
+/* Per-snapshot index files: a compact, read-only copy of the directory
+   listings of one fully loaded snapshot, memory-mapped for lookups.
+
+   Layout (all fields little-endian DWORDs, every section 4-byte aligned):
+     SnapIndexHeader
+     SnapIndexEntry[entryCount]   grouped by directory, sorted by name in each
+     SnapIndexDir[dirCount]       sorted by path
+     string table                 NUL-terminated UTF-8 paths and names;
+                                  offset 0 is the empty string
+   Paths and names are ordered bytewise (strcmp), the same order as SQLite's
+   BINARY collation, so the file can be streamed from primary key order.
+
+   A mapped view is not charged to the memory budget: its pages belong to
+   the file, and the OS drops them under memory pressure. */
+
+#define SNAP_INDEX_MAGIC "RWFXSIX"
+#define SNAP_INDEX_VERSION 1
+
+typedef struct {
+    char magic[8];          /* SNAP_INDEX_MAGIC, NUL-padded */
+    DWORD version;
+    DWORD dirCount;
+    DWORD entryCount;
+    DWORD stringBytes;
+    DWORD entryOffset;      /* file offsets of the sections */
+    DWORD dirOffset;
+    DWORD stringOffset;
+    DWORD reserved;
+} SnapIndexHeader;
+
+typedef struct {
+    DWORD pathOffset;       /* into the string table */
+    DWORD firstEntry;       /* index of the directory's first SnapIndexEntry */
+    DWORD entryCount;
+} SnapIndexDir;
+
+typedef struct {
+    DWORD nameOffset;       /* into the string table */
+    DWORD isDirectory;
+    DWORD sizeLow;
+    DWORD sizeHigh;
+    DWORD mtimeLow;
+    DWORD mtimeHigh;
+} SnapIndexEntry;
+
+typedef struct SnapIndexWriter SnapIndexWriter;
+typedef struct SnapIndex SnapIndex;
+
+/* Start writing an index file. The data goes to temporary files next to
+   filePath, which is only replaced by SnapIndex_Finish. Returns NULL on
+   failure. */
+SnapIndexWriter* SnapIndex_Create(const char* filePath);
+
+/* Add a directory; paths must be added in ascending order, each once. */
+BOOL SnapIndex_AddDir(SnapIndexWriter* w, const char* pathUtf8);
+
+/* Add an entry to the directory added last; names must be ascending. */
+BOOL SnapIndex_AddEntry(SnapIndexWriter* w, const char* nameUtf8, BOOL isDirectory,
+                        DWORD sizeLow, DWORD sizeHigh, FILETIME lastWriteTime);
+
+/* Complete the file (commit = TRUE) or discard it, and free the writer.
+   Returns TRUE if the index file was written. */
+BOOL SnapIndex_Finish(SnapIndexWriter* w, BOOL commit);
+
+/* Map an index file. Returns NULL if it is missing, truncated or from
+   another format version. */
+SnapIndex* SnapIndex_Open(const char* filePath);
+void SnapIndex_Close(SnapIndex* idx);
+
+/* Find a directory by its UTF-8 path. Returns a pointer into the mapped
+   entries with *outCount set (non-NULL even for an empty directory), or
+   NULL if the directory is not in the index. */
+const SnapIndexEntry* SnapIndex_FindDir(const SnapIndex* idx, const char* pathUtf8,
+                                        int* outCount);
+
+/* Name of an entry, pointing into the mapped string table. */
+const char* SnapIndex_Name(const SnapIndex* idx, const SnapIndexEntry* e);
+
+#endif /* SNAP_INDEX_H */
@@ -0,0 +1,369 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "trace.h"
+#include "mem_budget.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Each thread that records a span gets its own single-producer ring; the
+   flush thread is the only consumer. head is advanced by the producer after
+   the slot is filled, tail by the consumer after the slot is written out, so
+   neither side ever waits on a lock. A full ring drops the new event.
+   A thread that ends gives its ring up with Trace_ReleaseThread; the flush
+   thread frees it once it is drained and the slot is taken by the next
+   new thread, so short-lived threads do not use up the slots. */
+
+#define TRACE_MAX_THREADS  64
+#define TRACE_RING_SIZE    2048            /* power of two */
+#define TRACE_FLUSH_MS     250
+#define TRACE_WRITE_BUF    65536
+
+typedef struct {
+    const char* name;
+    LONGLONG start;                        /* QPC ticks */
+    LONGLONG end;
+    char args[TRACE_ARGS_MAX];
+} TraceEvent;
+
+typedef struct {
+    DWORD tid;
+    volatile LONG head;                    /* next slot to fill (producer) */
+    volatile LONG tail;                    /* next slot to write (consumer) */
+    volatile LONG dropped;
+    volatile LONG ended;                   /* set by Trace_ReleaseThread */
+    TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+
+/* A NULL slot is free */
+static TraceRing* volatile g_Rings[TRACE_MAX_THREADS];
+static LONG g_EndedDropped = 0;            /* drops of freed rings (consumer only) */
+static DWORD g_TlsIndex = TLS_OUT_OF_INDEXES;
+
+static volatile LONG g_Enabled = 0;
+static HANDLE g_TraceFile = INVALID_HANDLE_VALUE;
+static HANDLE g_FlushThread = NULL;
+static HANDLE g_StopEvent = NULL;
+static LARGE_INTEGER g_Freq;
+static LONGLONG g_Origin = 0;
+static DWORD g_Pid = 0;
+
+/* Output buffer, touched only by the flush thread (and Trace_Stop after it exits) */
+static char g_WriteBuf[TRACE_WRITE_BUF];
+static int g_WriteLen = 0;
+
+static void FlushWriteBuf(void) {
+    DWORD written;
+    if (g_WriteLen > 0 && g_TraceFile != INVALID_HANDLE_VALUE)
+        WriteFile(g_TraceFile, g_WriteBuf, (DWORD)g_WriteLen, &written, NULL);
+    g_WriteLen = 0;
+}
+
+static void Emit(const char* text, int len) {
+    if (g_WriteLen + len > TRACE_WRITE_BUF) FlushWriteBuf();
+    if (len > TRACE_WRITE_BUF) return;
+    memcpy(g_WriteBuf + g_WriteLen, text, len);
+    g_WriteLen += len;
+}
+
+static double TicksToMicros(LONGLONG ticks) {
+    return (double)ticks * 1000000.0 / (double)g_Freq.QuadPart;
+}
+
+/* Write one complete ("X") event */
+static void EmitEvent(DWORD tid, const TraceEvent* ev) {
+    char line[TRACE_ARGS_MAX + 256];
+    int len = snprintf(line, sizeof(line),
+        ",\n{\"name\":\"%s\",\"cat\":\"restic_wfx\",\"ph\":\"X\",\"ts\":%.3f,"
+        "\"dur\":%.3f,\"pid\":%lu,\"tid\":%lu,\"args\":{%s}}",
+        ev->name, TicksToMicros(ev->start - g_Origin),
+        TicksToMicros(ev->end - ev->start),
+        (unsigned long)g_Pid, (unsigned long)tid, ev->args);
+    if (len > 0 && len < (int)sizeof(line)) Emit(line, len);
+}
+
+/* Move everything currently queued in all rings to the file, and free
+   the rings of ended threads */
+static void DrainRings(void) {
+    int r;
+
+    for (r = 0; r < TRACE_MAX_THREADS; r++) {
+        TraceRing* ring = g_Rings[r];
+        LONG ended, head, tail;
+        if (!ring) continue;
+
+        /* Read ended first: once it is set, head does not move any more */
+        ended = InterlockedCompareExchange(&ring->ended, 0, 0);
+        head = InterlockedCompareExchange(&ring->head, 0, 0);
+        tail = ring->tail;
+        while (tail != head) {
+            EmitEvent(ring->tid, &ring->events[tail & (TRACE_RING_SIZE - 1)]);
+            tail++;
+        }
+        InterlockedExchange(&ring->tail, tail);
+
+        if (ended) {
+            g_EndedDropped += ring->dropped;
+            InterlockedExchangePointer((PVOID volatile*)&g_Rings[r], NULL);
+            Mem_Free(ring);
+        }
+    }
+    FlushWriteBuf();
+}
+
+static DWORD WINAPI FlushThreadProc(LPVOID param) {
+    (void)param;
+    while (WaitForSingleObject(g_StopEvent, TRACE_FLUSH_MS) == WAIT_TIMEOUT) {
+        DrainRings();
+    }
+    return 0;
+}
+
+/* Get (or create) the calling thread's ring. Returns NULL when out of
+   slots or over the memory budget. */
+static TraceRing* GetRing(void) {
+    TraceRing* ring;
+    int slot;
+
+    if (g_TlsIndex == TLS_OUT_OF_INDEXES) return NULL;
+    ring = (TraceRing*)TlsGetValue(g_TlsIndex);
+    if (ring) return ring;
+
+    ring = (TraceRing*)Mem_Alloc(MEM_TRACE, sizeof(TraceRing));
+    if (!ring) return NULL;
+    memset(ring, 0, sizeof(TraceRing));
+    ring->tid = GetCurrentThreadId();
+
+    /* The ring is complete before the consumer can see it in a slot */
+    for (slot = 0; slot < TRACE_MAX_THREADS; slot++) {
+        if (InterlockedCompareExchangePointer((PVOID volatile*)&g_Rings[slot], ring, NULL) == NULL)
+            break;
+    }
+    if (slot == TRACE_MAX_THREADS) {
+        Mem_Free(ring);
+        return NULL;
+    }
+    TlsSetValue(g_TlsIndex, ring);
+    return ring;
+}
+
+void Trace_ReleaseThread(void) {
+    TraceRing* ring;
+
+    if (g_TlsIndex == TLS_OUT_OF_INDEXES) return;
+    ring = (TraceRing*)TlsGetValue(g_TlsIndex);
+    if (!ring) return;
+    TlsSetValue(g_TlsIndex, NULL);
+    InterlockedExchange(&ring->ended, 1);
+}
+
+BOOL Trace_Start(const char* filePath) {
+    char header[256];
+    int len;
+    LARGE_INTEGER now;
+
+    if (g_Enabled) return TRUE;
+
+    if (g_TlsIndex == TLS_OUT_OF_INDEXES) {
+        g_TlsIndex = TlsAlloc();
+        if (g_TlsIndex == TLS_OUT_OF_INDEXES) return FALSE;
+    }
+
+    g_TraceFile = CreateFileA(filePath, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (g_TraceFile == INVALID_HANDLE_VALUE) return FALSE;
+
+    QueryPerformanceFrequency(&g_Freq);
+    QueryPerformanceCounter(&now);
+    g_Origin = now.QuadPart;
+    g_Pid = GetCurrentProcessId();
+
+    /* JSON array format; the metadata event makes every later event ",\n{...}" */
+    len = snprintf(header, sizeof(header),
+        "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,"
+        "\"args\":{\"name\":\"restic_wfx\"}}", (unsigned long)g_Pid);
+    g_WriteLen = 0;
+    Emit(header, len);
+    FlushWriteBuf();
+
+    g_StopEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    g_FlushThread = g_StopEvent ? CreateThread(NULL, 0, FlushThreadProc, NULL, 0, NULL) : NULL;
+    if (!g_FlushThread) {
+        if (g_StopEvent) { CloseHandle(g_StopEvent); g_StopEvent = NULL; }
+        CloseHandle(g_TraceFile);
+        g_TraceFile = INVALID_HANDLE_VALUE;
+        return FALSE;
+    }
+
+    InterlockedExchange(&g_Enabled, 1);
+    return TRUE;
+}
+
+void Trace_Stop(void) {
+    LONG dropped;
+    int r;
+
+    if (!InterlockedExchange(&g_Enabled, 0)) return;
+
+    SetEvent(g_StopEvent);
+    WaitForSingleObject(g_FlushThread, INFINITE);
+    CloseHandle(g_FlushThread);
+    CloseHandle(g_StopEvent);
+    g_FlushThread = NULL;
+    g_StopEvent = NULL;
+
+    DrainRings();
+
+    /* Report ring overflows so a truncated trace is recognisable */
+    dropped = g_EndedDropped;
+    g_EndedDropped = 0;
+    for (r = 0; r < TRACE_MAX_THREADS; r++)
+        if (g_Rings[r]) dropped += InterlockedExchange(&g_Rings[r]->dropped, 0);
+    {
+        char footer[160];
+        int len = snprintf(footer, sizeof(footer),
+            ",\n{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":%lu,"
+            "\"args\":{\"count\":%ld}}\n]\n", (unsigned long)g_Pid, (long)dropped);
+        Emit(footer, len);
+    }
+    FlushWriteBuf();
+
+    CloseHandle(g_TraceFile);
+    g_TraceFile = INVALID_HANDLE_VALUE;
+}
+
+void Trace_InitFromConfig(const char* configFilePath) {
+    char tracePath[MAX_PATH];
+    char* slash;
+
+    if (g_Enabled) return;
+    if (GetPrivateProfileIntA("Debug", "Trace", 0, configFilePath) != 1) return;
+
+    strncpy(tracePath, configFilePath, MAX_PATH - 1);
+    tracePath[MAX_PATH - 1] = '\0';
+    slash = strrchr(tracePath, '\\');
+    if (!slash) return;
+    snprintf(slash + 1, MAX_PATH - (slash + 1 - tracePath), "trace_%lu.json",
+             (unsigned long)GetCurrentProcessId());
+    Trace_Start(tracePath);
+}
+
+BOOL Trace_Enabled(void) {
+    return g_Enabled != 0;
+}
+
+void Trace_Begin(TraceSpan* span) {
+    LARGE_INTEGER now;
+    span->argsLen = 0;
+    span->args[0] = '\0';
+    if (!g_Enabled) {
+        span->start = 0;
+        return;
+    }
+    QueryPerformanceCounter(&now);
+    span->start = now.QuadPart;
+}
+
+/* Append raw text to the span's args; drops the attribute if it doesn't fit */
+static void AppendArg(TraceSpan* span, const char* text, int len) {
+    if (span->argsLen + len >= TRACE_ARGS_MAX) return;
+    memcpy(span->args + span->argsLen, text, len);
+    span->argsLen += len;
+    span->args[span->argsLen] = '\0';
+}
+
+/* Length of the well-formed UTF-8 sequence at p, or 0 if p does not start one */
+static int Utf8SequenceLength(const unsigned char* p) {
+    int n, i;
+
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) n = 2;
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF) n = 3;
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4) n = 4;
+    else return 0;
+    for (i = 1; i < n; i++)
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    if (n == 3 && ((p[0] == 0xE0 && p[1] < 0xA0) || (p[0] == 0xED && p[1] >= 0xA0))) return 0;
+    if (n == 4 && ((p[0] == 0xF0 && p[1] < 0x90) || (p[0] == 0xF4 && p[1] >= 0x90))) return 0;
+    return n;
+}
+
+/* Callers pass UTF-8 (restic paths) as well as ANSI (TC paths): well-formed
+   UTF-8 is copied as is, any other byte is taken as ANSI and written as a
+   \u escape. Truncation never splits a character. */
+void Trace_ArgStr(TraceSpan* span, const char* key, const char* value) {
+    char buf[TRACE_ARGS_MAX];
+    int len;
+    const unsigned char* p;
+
+    if (!span->start || !value) return;
+
+    len = snprintf(buf, sizeof(buf), "%s\"%s\":\"", span->argsLen ? "," : "", key);
+    for (p = (const unsigned char*)value; *p && len < (int)sizeof(buf) - 8; ) {
+        unsigned char c = *p;
+        int n;
+        WCHAR w;
+
+        if (c == '"' || c == '\\') {
+            buf[len++] = '\\';
+            buf[len++] = (char)c;
+            p++;
+        } else if (c < 0x20) {
+            len += snprintf(buf + len, sizeof(buf) - len, "\\u%04x", c);
+            p++;
+        } else if (c < 0x80) {
+            buf[len++] = (char)c;
+            p++;
+        } else if ((n = Utf8SequenceLength(p)) > 0) {
+            memcpy(buf + len, p, n);
+            len += n;
+            p += n;
+        } else {
+            if (!MultiByteToWideChar(CP_ACP, 0, (const char*)p, 1, &w, 1)) w = 0xFFFD;
+            len += snprintf(buf + len, sizeof(buf) - len, "\\u%04x", (unsigned)w);
+            p++;
+        }
+    }
+    buf[len++] = '"';
+    AppendArg(span, buf, len);
+}
+
+void Trace_ArgInt(TraceSpan* span, const char* key, LONGLONG value) {
+    char buf[96];
+    int len;
+    if (!span->start) return;
+    len = snprintf(buf, sizeof(buf), "%s\"%s\":%lld", span->argsLen ? "," : "",
+                   key, (long long)value);
+    if (len > 0 && len < (int)sizeof(buf)) AppendArg(span, buf, len);
+}
+
+void Trace_End(TraceSpan* span, const char* name) {
+    TraceRing* ring;
+    TraceEvent* ev;
+    LARGE_INTEGER now;
+    LONG head;
+
+    if (!span->start || !g_Enabled) return;
+    QueryPerformanceCounter(&now);
+
+    ring = GetRing();
+    if (!ring) return;
+
+    head = ring->head;
+    if (head - InterlockedCompareExchange(&ring->tail, 0, 0) >= TRACE_RING_SIZE) {
+        InterlockedIncrement(&ring->dropped);
+        return;
+    }
+
+    ev = &ring->events[head & (TRACE_RING_SIZE - 1)];
+    ev->name = name;
+    ev->start = span->start;
+    ev->end = now.QuadPart;
+    memcpy(ev->args, span->args, span->argsLen + 1);
+
+    /* Publish: the slot must be complete before the consumer sees head move */
+    InterlockedExchange(&ring->head, head + 1);
+}
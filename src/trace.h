@@ -0,0 +1,57 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <windows.h>
+
+/* Opt-in structured tracing in Chrome trace event format (load the file in
+   chrome://tracing or ui.perfetto.dev). Spans are recorded into a per-thread
+   ring buffer without locks and written out by a background thread.
+   Every function is a cheap no-op while tracing is off. */
+
+#define TRACE_ARGS_MAX 160
+
+/* A span in progress. Lives on the caller's stack between Begin and End. */
+typedef struct {
+    LONGLONG start;             /* QPC ticks; 0 when tracing is off */
+    int argsLen;
+    char args[TRACE_ARGS_MAX];  /* JSON object body: "k":"v","n":1 */
+} TraceSpan;
+
+/* Enable tracing if [Debug] Trace=1 is set in the given INI file.
+   The trace is written next to the INI as trace_<pid>.json. Idempotent. */
+void Trace_InitFromConfig(const char* configFilePath);
+
+/* Start tracing to the given file. Returns FALSE if it cannot be created.
+   Does nothing (returns TRUE) if tracing is already running. */
+BOOL Trace_Start(const char* filePath);
+
+/* Flush all buffered events, terminate the JSON array and close the file. */
+void Trace_Stop(void);
+
+/* TRUE while tracing is running. */
+BOOL Trace_Enabled(void);
+
+/* Begin a span: records the start time. */
+void Trace_Begin(TraceSpan* span);
+
+/* Attach attributes to a span (ignored when tracing is off or the
+   attribute buffer is full). Strings are JSON-escaped and may be UTF-8
+   or ANSI. */
+void Trace_ArgStr(TraceSpan* span, const char* key, const char* value);
+void Trace_ArgInt(TraceSpan* span, const char* key, LONGLONG value);
+
+/* End a span and queue it. name must be a string literal (stored by pointer). */
+void Trace_End(TraceSpan* span, const char* name);
+
+/* Give up the calling thread's ring, when the thread is about to end. Its
+   queued events are still written; the flush thread then frees the ring
+   and its slot is reused by the next thread that records a span. */
+void Trace_ReleaseThread(void);
+
+#endif /* TRACE_H */
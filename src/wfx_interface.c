@@ -9,9 +9,19 @@
 #include "restic_process.h"
 #include "json_parse.h"
 #include "ls_cache.h"
+#include "trace.h"
+#include "metrics.h"
+#include "perf_stats.h"
+#include "replay.h"
+#include "command_log.h"
+#include "mem_budget.h"
+#include "name_match.h"
+#include "native_repo.h"
+#include "cache_service.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <shellapi.h>
 #include <shlwapi.h>
 #include <wincrypt.h>
@@ -58,6 +68,34 @@ static DWORD GetSecureRandomValue(void) {
 #define VERSION_SUFFIX     " [show all versions]"
 #define VERSION_SUFFIX_LEN 20
 
+/* [Search] virtual folder constants */
+#define SEARCH_ENTRY       "[Search]"
+#define NEW_SEARCH_ENTRY   "[New search]"
+#define SEARCH_MAX_HITS    10000
+#define SEARCH_MAX_RECENT  16
+
+/* [Deleted files] virtual folder constants */
+#define DELETED_ENTRY      "[Deleted files]"
+#define DELETED_MAX        20000
+
+/* [Changes since previous] virtual folder constants (inside each snapshot) */
+#define CHANGES_ENTRY       "[Changes since previous]"
+#define CHANGES_MAX         20000
+#define CHANGE_TAG_ADDED    " [added]"
+#define CHANGE_TAG_REMOVED  " [removed]"
+#define CHANGE_TAG_MODIFIED " [modified]"
+
+/* [Largest files] / [Biggest growth] size reports (inside each snapshot) */
+#define LARGEST_ENTRY       "[Largest files]"
+#define LARGEST_MAX         200
+#define GROWTH_ENTRY        "[Biggest growth]"
+#define GROWTH_MAX          50
+#define GROWTH_ROOT_LABEL   "(backup root)"
+
+/* Virtual per-repository statistics file at the repo root */
+#define STATS_ENTRY        "[Statistics].txt"
+#define STATS_MAX_SIZE     8192
+
 /* Get the path to README.txt next to the plugin DLL.
    Returns TRUE if the file exists, FALSE otherwise. */
 static BOOL GetReadmePath(char* outPath, size_t maxLen) {
@@ -85,7 +123,13 @@ static tRequestProc g_RequestProc = NULL;
 
 /* --- Batch restore state for FsStatusInfo/FsGetFile optimization --- */
 
-static struct {
+/* One multi-file copy. TC announces it with FsStatusInfo(START) and ends
+   it with FsStatusInfo(END) on the thread that runs the copy, so a batch
+   belongs to that thread: copies running side by side each have their
+   own, with a temp dir of its own. */
+typedef struct {
+    volatile LONG refs;           /* the table's, plus one per FsGetFile using it */
+    DWORD threadId;               /* thread running the copy */
     BOOL active;                  /* TRUE after restore completed successfully */
     BOOL pending;                 /* TRUE after FsStatusInfo(START), waiting for first FsGetFile */
     char tempDir[MAX_PATH];       /* temp root where restic restored to */
@@ -94,7 +138,17 @@ static struct {
     char password[256];
     char snapshotPath[MAX_PATH];  /* original path for --path flag (UTF-8) */
     char shortId[16];
-} g_BatchRestore = {0};
+    char nativeScope[MAX_PATH];   /* folder last extracted by the native reader (UTF-8) */
+} BatchRestore;
+
+#define MAX_BATCHES 16
+
+static BatchRestore* g_Batches[MAX_BATCHES];
+static int g_BatchCount = 0;
+
+/* Guards g_Batches, only for the lookup; the fields of a batch are used by
+   its own thread alone, so copies never wait for each other's restore */
+static SRWLOCK g_BatchLock = SRWLOCK_INIT;
 
 /* --- Snapshot list cache (TTL-based, per repo) --- */
 
@@ -109,6 +163,43 @@ typedef struct {
 
 static SnapshotCache g_SnapCache[MAX_REPOS];
 static int g_SnapCacheCount = 0;
+static SRWLOCK g_SnapLock = SRWLOCK_INIT;   /* guards g_SnapCache and g_TimeIndex */
+
+/* --- Snapshot time index (per backup path, built from the cached list) --- */
+
+#define TIME_INDEX_MAX     4
+#define SNAPSHOT_NAME_LEN  48   /* "2025-01-28 10-30-05 (fb4ed15b)" */
+#define SNAPSHOT_TIME_LEN  19   /* "2025-01-28 10-30-05" */
+
+typedef struct {
+    char displayName[SNAPSHOT_NAME_LEN];
+    FILETIME ft;
+} SnapshotTimeEntry;
+
+/* The snapshots of one backup path with their display names formatted once
+   and sorted by them (i.e. by local snapshot time), so listings, date
+   folders and [@...] lookups need no per-call parsing. An index is never
+   changed once built; a rebuild replaces it, and whoever still reads the
+   old one holds a reference. */
+typedef struct {
+    volatile LONG refs;             /* one for g_TimeIndex, one per reader */
+    char repoName[MAX_REPO_NAME];
+    char sanitizedPath[MAX_PATH];
+    ULONGLONG builtFrom;            /* fetchTimeMs of the snapshot list used */
+    SnapshotTimeEntry* entries;     /* oldest first, in the same Mem_Alloc block */
+    int count;
+} SnapshotTimeIndex;
+
+static SnapshotTimeIndex* g_TimeIndex[TIME_INDEX_MAX];
+static int g_TimeIndexNext = 0;
+
+/* Group snapshots into year/month/day folders ([Browse] DateFolders=1) */
+static BOOL g_DateFolders = FALSE;
+
+static void ReleaseTimeIndex(const SnapshotTimeIndex* ti) {
+    SnapshotTimeIndex* owned = (SnapshotTimeIndex*)ti;
+    if (owned && InterlockedDecrement(&owned->refs) == 0) Mem_Free(owned);
+}
 
 /* Deep-copy a snapshot array. Caller must free the returned pointer. */
 static ResticSnapshot* CopySnapshots(const ResticSnapshot* src, int count) {
@@ -119,21 +210,37 @@ static ResticSnapshot* CopySnapshots(const ResticSnapshot* src, int count) {
     return copy;
 }
 
-/* Invalidate snapshot cache for a specific repo (e.g. on password change). */
+/* Copy a snapshot array into budget-tracked cache memory (free with Mem_Free).
+   Returns NULL if it doesn't fit the memory budget. */
+static ResticSnapshot* CacheCopySnapshots(const ResticSnapshot* src, int count) {
+    ResticSnapshot* copy;
+    if (count <= 0 || !src) return NULL;
+    copy = (ResticSnapshot*)Mem_Alloc(MEM_SNAPSHOT_CACHE, sizeof(ResticSnapshot) * count);
+    if (copy) memcpy(copy, src, sizeof(ResticSnapshot) * count);
+    return copy;
+}
+
+/* Invalidate snapshot cache for a specific repo (e.g. on password change),
+   here and in the cache service if one answers our listings. */
 static void InvalidateSnapshotCache(const char* repoName) {
     int i;
+
+    AcquireSRWLockExclusive(&g_SnapLock);
     for (i = 0; i < g_SnapCacheCount; i++) {
         if (strcmp(g_SnapCache[i].repoName, repoName) == 0) {
-            free(g_SnapCache[i].snapshots);
+            Mem_Free(g_SnapCache[i].snapshots);
             g_SnapCache[i].snapshots = NULL;
             /* Move last entry into this slot */
             g_SnapCacheCount--;
             if (i < g_SnapCacheCount) {
                 g_SnapCache[i] = g_SnapCache[g_SnapCacheCount];
             }
-            return;
+            break;
         }
     }
+    ReleaseSRWLockExclusive(&g_SnapLock);
+
+    CacheService_Forget(repoName);
 }
 
 /* --- Directory listing cache (immutable, keyed on shortId+path) --- */
@@ -149,6 +256,7 @@ typedef struct {
 
 static LsCacheEntry g_LsCache[LS_CACHE_MAX];
 static int g_LsCacheCount = 0;
+static SRWLOCK g_ListingLock = SRWLOCK_INIT;    /* guards g_LsCache */
 
 /* Deep-copy a DirEntry array. Caller must free the returned pointer. */
 static DirEntry* CopyDirEntries(const DirEntry* src, int count) {
@@ -159,6 +267,197 @@ static DirEntry* CopyDirEntries(const DirEntry* src, int count) {
     return copy;
 }
 
+/* Copy a DirEntry array into budget-tracked cache memory (free with Mem_Free).
+   Returns NULL if it doesn't fit the memory budget. */
+static DirEntry* CacheCopyDirEntries(const DirEntry* src, int count) {
+    DirEntry* copy;
+    if (count <= 0 || !src) return NULL;
+    copy = (DirEntry*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(DirEntry) * count);
+    if (copy) memcpy(copy, src, sizeof(DirEntry) * count);
+    return copy;
+}
+
+/* Drop every in-memory listing; they are reloaded from SQLite on demand */
+static void ClearListingCache(void) {
+    int i;
+
+    AcquireSRWLockExclusive(&g_ListingLock);
+    for (i = 0; i < g_LsCacheCount; i++) {
+        Mem_Free(g_LsCache[i].entries);
+        g_LsCache[i].entries = NULL;
+    }
+    g_LsCacheCount = 0;
+    ReleaseSRWLockExclusive(&g_ListingLock);
+}
+
+/* Add a listing to the in-memory directory cache, evicting the oldest entry
+   when full. The copy is made before taking the lock because allocating
+   it may make the budget reclaimer evict entries. */
+static void LsCacheInsert(const char* shortId, const char* path,
+                          const DirEntry* entries, int count) {
+    LsCacheEntry* lce;
+    DirEntry* evicted = NULL;
+    DirEntry* copy = CacheCopyDirEntries(entries, count);
+    if (!copy) return;
+
+    AcquireSRWLockExclusive(&g_ListingLock);
+    if (g_LsCacheCount >= LS_CACHE_MAX) {
+        /* Evict oldest entry (index 0) */
+        evicted = g_LsCache[0].entries;
+        memmove(&g_LsCache[0], &g_LsCache[1],
+                sizeof(LsCacheEntry) * (LS_CACHE_MAX - 1));
+        g_LsCacheCount--;
+    }
+    lce = &g_LsCache[g_LsCacheCount];
+    strncpy(lce->shortId, shortId, sizeof(lce->shortId) - 1);
+    lce->shortId[sizeof(lce->shortId) - 1] = '\0';
+    strncpy(lce->path, path, MAX_PATH - 1);
+    lce->path[MAX_PATH - 1] = '\0';
+    lce->entries = copy;
+    lce->count = count;
+    g_LsCacheCount++;
+    ReleaseSRWLockExclusive(&g_ListingLock);
+    Mem_Free(evicted);
+}
+
+/* --- Virtual result trees ([Search], [Changes since previous]) --- */
+
+typedef struct {
+    char relDir[MAX_PATH];  /* directory below the backup path (ANSI, backslashes, "" = root) */
+    DirEntry entry;         /* file with its tag (version, change) in the name */
+} ResultFile;
+
+/* One result set per kind is kept in memory while its folder is browsed
+   and recomputed from SQLite on demand. A set is computed without the lock
+   and swapped in; the lock only keeps readers off a set the budget
+   reclaimer (on any thread) or a recomputation is freeing. */
+typedef struct {
+    char repoName[MAX_REPO_NAME];
+    char key[MAX_PATH];     /* what was computed, e.g. backup path + search folder */
+    ResultFile* results;    /* Mem_Alloc(MEM_LISTING_CACHE) */
+    int count;
+    SRWLOCK lock;           /* guards the fields above */
+} ResultCache;
+
+static ResultCache g_SearchCache = {0};
+static ResultCache g_ChangesCache = {0};
+static ResultCache g_DeletedCache = {0};
+static ResultCache g_LargestCache = {0};
+static ResultCache g_GrowthCache = {0};   /* relDir = grown directory, entry = its label */
+
+/* Replace a result set (results NULL = drop it) */
+static void StoreResultCache(ResultCache* rc, const char* repoName, const char* key,
+                             ResultFile* results, int count) {
+    ResultFile* old;
+
+    AcquireSRWLockExclusive(&rc->lock);
+    old = rc->results;
+    strncpy(rc->repoName, repoName, MAX_REPO_NAME - 1);
+    rc->repoName[MAX_REPO_NAME - 1] = '\0';
+    strncpy(rc->key, key, MAX_PATH - 1);
+    rc->key[MAX_PATH - 1] = '\0';
+    rc->results = results;
+    rc->count = count;
+    ReleaseSRWLockExclusive(&rc->lock);
+    Mem_Free(old);
+}
+
+static void FreeResultCache(ResultCache* rc) {
+    StoreResultCache(rc, "", "", NULL, 0);
+}
+
+static BOOL ResultCacheMatches(ResultCache* rc, const char* repoName, const char* key) {
+    BOOL matches;
+
+    AcquireSRWLockShared(&rc->lock);
+    matches = rc->results && strcmp(rc->repoName, repoName) == 0 && strcmp(rc->key, key) == 0;
+    ReleaseSRWLockShared(&rc->lock);
+    return matches;
+}
+
+/* Drop a result set for the budget reclaimer unless it is in use.
+   Returns the bytes freed. */
+static LONG64 ReclaimResultCache(ResultCache* rc) {
+    ResultFile* results;
+    LONG64 freed;
+
+    if (!TryAcquireSRWLockExclusive(&rc->lock)) return 0;
+    results = rc->results;
+    freed = (LONG64)sizeof(ResultFile) * rc->count;
+    rc->results = NULL;
+    rc->count = 0;
+    rc->key[0] = '\0';
+    ReleaseSRWLockExclusive(&rc->lock);
+    Mem_Free(results);
+    return results ? freed : 0;
+}
+
+/* Memory budget reclaimer: drop in-memory listings (oldest first), the
+   result trees, the snapshot time indexes, then cached snapshot lists,
+   until needBytes have been released. All of them only hold copies of
+   data that can be re-read from SQLite or restic. */
+static LONG64 ReclaimCacheMemory(LONG64 needBytes) {
+    LONG64 freed = 0;
+    int i;
+
+    /* Caches another thread is using are skipped rather than waited for */
+    if (TryAcquireSRWLockExclusive(&g_ListingLock)) {
+        while (freed < needBytes && g_LsCacheCount > 0) {
+            freed += (LONG64)sizeof(DirEntry) * g_LsCache[0].count;
+            Mem_Free(g_LsCache[0].entries);
+            g_LsCacheCount--;
+            memmove(&g_LsCache[0], &g_LsCache[1], sizeof(LsCacheEntry) * g_LsCacheCount);
+        }
+        ReleaseSRWLockExclusive(&g_ListingLock);
+    }
+
+    /* Path filters are reread from SQLite with one query per snapshot */
+    if (freed < needBytes) freed += LsCache_ReleaseFilters();
+
+    if (freed < needBytes) freed += ReclaimResultCache(&g_SearchCache);
+    if (freed < needBytes) freed += ReclaimResultCache(&g_ChangesCache);
+    if (freed < needBytes) freed += ReclaimResultCache(&g_DeletedCache);
+    if (freed < needBytes) freed += ReclaimResultCache(&g_LargestCache);
+    if (freed < needBytes) freed += ReclaimResultCache(&g_GrowthCache);
+
+    if (freed < needBytes && TryAcquireSRWLockExclusive(&g_SnapLock)) {
+        /* An index still being read is freed by its last reader */
+        for (i = 0; i < TIME_INDEX_MAX && freed < needBytes; i++) {
+            if (!g_TimeIndex[i]) continue;
+            freed += (LONG64)sizeof(SnapshotTimeEntry) * g_TimeIndex[i]->count;
+            ReleaseTimeIndex(g_TimeIndex[i]);
+            g_TimeIndex[i] = NULL;
+        }
+
+        while (freed < needBytes && g_SnapCacheCount > 0) {
+            int oldest = 0;
+            for (i = 1; i < g_SnapCacheCount; i++) {
+                if (g_SnapCache[i].fetchTimeMs < g_SnapCache[oldest].fetchTimeMs) oldest = i;
+            }
+            freed += (LONG64)sizeof(ResticSnapshot) * g_SnapCache[oldest].count;
+            Mem_Free(g_SnapCache[oldest].snapshots);
+            g_SnapCacheCount--;
+            if (oldest < g_SnapCacheCount)
+                g_SnapCache[oldest] = g_SnapCache[g_SnapCacheCount];
+        }
+        ReleaseSRWLockExclusive(&g_SnapLock);
+    }
+
+    return freed;
+}
+
+/* Text of a repo's [Statistics].txt: its metrics plus the plugin-wide
+   memory report. Returns the length. */
+static int FormatStatistics(RepoConfig* repo, char* buf, int bufSize) {
+    int len = Metrics_Format(repo->name, repo->path, buf, bufSize);
+    if (len + 3 < bufSize) {
+        memcpy(buf + len, "\r\n", 3);
+        len += 2;
+        len += Mem_Format(buf + len, bufSize - len);
+    }
+    return len;
+}
+
 /* Helper: add an entry to a dynamic array. Grows the array as needed. */
 static void AddEntry(DirEntry** entries, int* count, int* capacity,
                      const char* name, BOOL isDir,
@@ -178,11 +477,11 @@ static void AddEntry(DirEntry** entries, int* count, int* capacity,
     (*count)++;
 }
 
-/* Parse path into segments.
+/* Split path into segments.
    path: e.g. "\\RepoName\\snapshots"
    seg1, seg2, seg3: output buffers (MAX_PATH each), filled with segments or empty string.
-   Returns number of segments (0 for root "\\"). */
-static int ParsePathSegments(const char* path, char* seg1, char* seg2, char* seg3, char* rest) {
+   Returns number of segments (0 for root "\\"). See also ParsePathSegments. */
+static int SplitPathSegments(const char* path, char* seg1, char* seg2, char* seg3, char* rest) {
     const char* p;
     int segCount = 0;
 
@@ -286,6 +585,119 @@ static void SanitizePath(const char* raw, char* out, int maxLen) {
     }
 }
 
+/* --- In-process reader for local repositories ([Native] Enabled=1) --- */
+
+typedef struct {
+    char repoName[MAX_REPO_NAME];
+    NativeRepo* handle;     /* NULL if opening or reading failed */
+} NativeRepoSlot;
+
+static BOOL g_NativeRead = FALSE;
+static NativeRepoSlot g_NativeRepos[MAX_REPOS];
+static int g_NativeRepoCount = 0;
+static SRWLOCK g_NativeLock = SRWLOCK_INIT;     /* guards g_NativeRepos */
+
+/* Close the native handle of a repo (NULL = all), so the next use reopens
+   it with the current password. A copy still using the handle keeps its
+   own reference. */
+static void CloseNativeRepo(const char* repoName) {
+    int i;
+
+    AcquireSRWLockExclusive(&g_NativeLock);
+    for (i = g_NativeRepoCount - 1; i >= 0; i--) {
+        if (repoName && strcmp(g_NativeRepos[i].repoName, repoName) != 0) continue;
+        NativeRepo_Close(g_NativeRepos[i].handle);
+        g_NativeRepoCount--;
+        if (i < g_NativeRepoCount) g_NativeRepos[i] = g_NativeRepos[g_NativeRepoCount];
+    }
+    ReleaseSRWLockExclusive(&g_NativeLock);
+}
+
+/* The repository opened in-process, opening it on first use; release it
+   with NativeRepo_Close. NULL if the native reader is off, the repository
+   is not local, or it could not be opened before (each attempt runs
+   scrypt, so failures are remembered until the password is re-entered or
+   the plugin disconnects). */
+static NativeRepo* GetNativeRepo(RepoConfig* repo) {
+    NativeRepo* handle = NULL;
+    char passwordUtf8[MAX_REPO_PASS * 3];
+    BOOL known = FALSE;
+    int i;
+
+    if (!g_NativeRead || !NativeRepo_IsLocalPath(repo->path)) return NULL;
+
+    AcquireSRWLockShared(&g_NativeLock);
+    for (i = 0; i < g_NativeRepoCount && !known; i++) {
+        if (strcmp(g_NativeRepos[i].repoName, repo->name) == 0) {
+            handle = NativeRepo_AddRef(g_NativeRepos[i].handle);
+            known = TRUE;
+        }
+    }
+    ReleaseSRWLockShared(&g_NativeLock);
+    if (known) return handle;
+
+    /* Open without the lock: the key derivation takes a while, and other
+       repositories are used meanwhile */
+    AnsiToUtf8(repo->password, passwordUtf8, sizeof(passwordUtf8));
+    handle = NativeRepo_Open(repo->path, passwordUtf8);
+    SecureZeroMemory(passwordUtf8, sizeof(passwordUtf8));
+
+    AcquireSRWLockExclusive(&g_NativeLock);
+    for (i = 0; i < g_NativeRepoCount && !known; i++) {
+        if (strcmp(g_NativeRepos[i].repoName, repo->name) == 0) {
+            /* Another thread opened it first */
+            NativeRepo_Close(handle);
+            handle = NativeRepo_AddRef(g_NativeRepos[i].handle);
+            known = TRUE;
+        }
+    }
+    if (!known && g_NativeRepoCount < MAX_REPOS) {
+        NativeRepoSlot* slot = &g_NativeRepos[g_NativeRepoCount++];
+        strncpy(slot->repoName, repo->name, MAX_REPO_NAME - 1);
+        slot->repoName[MAX_REPO_NAME - 1] = '\0';
+        slot->handle = NativeRepo_AddRef(handle);
+    }
+    ReleaseSRWLockExclusive(&g_NativeLock);
+    return handle;
+}
+
+/* TRUE if the repository is read in-process */
+static BOOL UsesNativeRepo(RepoConfig* repo) {
+    NativeRepo* handle = GetNativeRepo(repo);
+    NativeRepo_Close(handle);
+    return handle != NULL;
+}
+
+/* Stop using a handle that failed to read the repository, so it keeps
+   using restic; the caller still releases its reference */
+static void DropNativeRepo(const char* repoName, NativeRepo* handle) {
+    int i;
+
+    AcquireSRWLockExclusive(&g_NativeLock);
+    for (i = 0; i < g_NativeRepoCount; i++) {
+        if (g_NativeRepos[i].handle == handle &&
+            strcmp(g_NativeRepos[i].repoName, repoName) == 0) {
+            NativeRepo_Close(handle);
+            g_NativeRepos[i].handle = NULL;
+        }
+    }
+    ReleaseSRWLockExclusive(&g_NativeLock);
+}
+
+/* `restic snapshots --json` output read in-process, or NULL to run restic.
+   A repository whose snapshots cannot be read natively (e.g. a damaged
+   file) keeps using restic. */
+static char* ReadSnapshotsNative(RepoConfig* repo) {
+    NativeRepo* handle = GetNativeRepo(repo);
+    char* output;
+
+    if (!handle) return NULL;
+    output = NativeRepo_SnapshotsJson(handle);
+    if (!output) DropNativeRepo(repo->name, handle);
+    NativeRepo_Close(handle);
+    return output;
+}
+
 /* Fetch and parse all snapshots for a repo. Returns count, caller frees *outSnapshots.
    Uses TTL-based cache to avoid repeated restic calls. */
 static int FetchSnapshots(RepoConfig* repo, ResticSnapshot** outSnapshots) {
@@ -298,24 +710,35 @@ static int FetchSnapshots(RepoConfig* repo, ResticSnapshot** outSnapshots) {
 
     /* Check snapshot cache */
     now = GetTickCount64();
+    numSnaps = -1;
+    AcquireSRWLockExclusive(&g_SnapLock);
     for (i = 0; i < g_SnapCacheCount; i++) {
         if (strcmp(g_SnapCache[i].repoName, repo->name) == 0) {
             if (now - g_SnapCache[i].fetchTimeMs < SNAPSHOT_CACHE_TTL_MS) {
                 /* Cache hit — return deep copy */
                 *outSnapshots = CopySnapshots(g_SnapCache[i].snapshots, g_SnapCache[i].count);
-                return (*outSnapshots) ? g_SnapCache[i].count : 0;
+                numSnaps = (*outSnapshots) ? g_SnapCache[i].count : 0;
+                break;
             }
             /* Cache expired — remove it */
-            free(g_SnapCache[i].snapshots);
+            Mem_Free(g_SnapCache[i].snapshots);
             g_SnapCacheCount--;
             if (i < g_SnapCacheCount)
                 g_SnapCache[i] = g_SnapCache[g_SnapCacheCount];
             break;
         }
     }
+    ReleaseSRWLockExclusive(&g_SnapLock);
+    if (numSnaps >= 0) {
+        Metrics_Add(repo->path, MC_SNAPLIST_HIT, 1);
+        return numSnaps;
+    }
 
-    /* Cache miss — fetch from restic */
-    output = RunRestic(repo->path, repo->password, "snapshots --json", &exitCode);
+    /* Cache miss — read a local repository in-process, else fetch from restic */
+    Metrics_Add(repo->path, MC_SNAPLIST_MISS, 1);
+    exitCode = 0;
+    output = ReadSnapshotsNative(repo);
+    if (!output) output = RunRestic(repo->path, repo->password, "snapshots --json", &exitCode);
     if (!output) {
         if (g_LogProc)
             g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
@@ -331,9 +754,9 @@ static int FetchSnapshots(RepoConfig* repo, ResticSnapshot** outSnapshots) {
             g_RequestProc(g_PluginNr, RT_MsgOK, "Restic Error", msg, output, MAX_PATH);
         }
         /* Invalidate cached password so user is re-prompted next time */
-        repo->hasPassword = FALSE;
-        repo->password[0] = '\0';
+        RepoStore_ForgetPassword(repo);
         InvalidateSnapshotCache(repo->name);
+        CloseNativeRepo(repo->name);
         free(output);
         return 0;
     }
@@ -342,15 +765,31 @@ static int FetchSnapshots(RepoConfig* repo, ResticSnapshot** outSnapshots) {
     free(output);
     if (numSnaps <= 0) return 0;
 
-    /* Store in cache */
-    if (g_SnapCacheCount < MAX_REPOS) {
-        SnapshotCache* sc = &g_SnapCache[g_SnapCacheCount];
-        strncpy(sc->repoName, repo->name, MAX_REPO_NAME - 1);
-        sc->repoName[MAX_REPO_NAME - 1] = '\0';
-        sc->snapshots = CopySnapshots(*outSnapshots, numSnaps);
-        sc->count = numSnaps;
-        sc->fetchTimeMs = now;
-        if (sc->snapshots) g_SnapCacheCount++;
+    /* Store in cache (copy first: allocating may make the budget reclaimer
+       drop other cached lists) */
+    {
+        ResticSnapshot* copy = CacheCopySnapshots(*outSnapshots, numSnaps);
+
+        AcquireSRWLockExclusive(&g_SnapLock);
+        for (i = 0; i < g_SnapCacheCount && copy; i++) {
+            /* Another thread fetched the list meanwhile */
+            if (strcmp(g_SnapCache[i].repoName, repo->name) == 0) {
+                Mem_Free(copy);
+                copy = NULL;
+            }
+        }
+        if (copy && g_SnapCacheCount < MAX_REPOS) {
+            SnapshotCache* sc = &g_SnapCache[g_SnapCacheCount];
+            strncpy(sc->repoName, repo->name, MAX_REPO_NAME - 1);
+            sc->repoName[MAX_REPO_NAME - 1] = '\0';
+            sc->snapshots = copy;
+            sc->count = numSnaps;
+            sc->fetchTimeMs = now;
+            g_SnapCacheCount++;
+        } else {
+            Mem_Free(copy);
+        }
+        ReleaseSRWLockExclusive(&g_SnapLock);
     }
 
     /* Purge persistent cache for deleted snapshots */
@@ -366,6 +805,234 @@ static int FetchSnapshots(RepoConfig* repo, ResticSnapshot** outSnapshots) {
     return numSnaps;
 }
 
+/* "2025-01-28 10-30-05 (fb4ed15b)" from restic's local snapshot time */
+static void FormatSnapshotName(const ResticSnapshot* snap, char* out, int maxLen) {
+    int yr = 0, mo = 0, dy = 0, hr = 0, mn = 0, sc = 0;
+
+    sscanf(snap->time, "%d-%d-%dT%d:%d:%d", &yr, &mo, &dy, &hr, &mn, &sc);
+    snprintf(out, maxLen, "%04d-%02d-%02d %02d-%02d-%02d (%s)",
+             yr, mo, dy, hr, mn, sc, snap->shortId);
+}
+
+static int CompareTimeEntries(const void* a, const void* b) {
+    return strcmp(((const SnapshotTimeEntry*)a)->displayName,
+                  ((const SnapshotTimeEntry*)b)->displayName);
+}
+
+/* fetchTimeMs of the repo's cached snapshot list, or 0 if none is valid */
+static ULONGLONG SnapshotListStamp(const char* repoName) {
+    ULONGLONG now = GetTickCount64(), stamp = 0;
+    int i;
+
+    AcquireSRWLockShared(&g_SnapLock);
+    for (i = 0; i < g_SnapCacheCount; i++) {
+        if (strcmp(g_SnapCache[i].repoName, repoName) == 0 &&
+            now - g_SnapCache[i].fetchTimeMs < SNAPSHOT_CACHE_TTL_MS)
+            stamp = g_SnapCache[i].fetchTimeMs;
+    }
+    ReleaseSRWLockShared(&g_SnapLock);
+    return stamp;
+}
+
+/* Time index of a backup path's snapshots. Reused while the snapshot list
+   it was built from is cached; rebuilt (one pass + sort) when the list is
+   refetched. Returns NULL if the repository has no snapshots, else a
+   reference to give back with ReleaseTimeIndex. */
+static const SnapshotTimeIndex* GetTimeIndex(RepoConfig* repo, const char* sanitizedPath) {
+    ResticSnapshot* snapshots = NULL;
+    SnapshotTimeEntry* entries;
+    SnapshotTimeIndex* ti = NULL;
+    SnapshotTimeIndex* old;
+    ULONGLONG stamp = SnapshotListStamp(repo->name);
+    int numSnaps, count = 0, i, j;
+
+    AcquireSRWLockShared(&g_SnapLock);
+    for (i = 0; i < TIME_INDEX_MAX && stamp && !ti; i++) {
+        old = g_TimeIndex[i];
+        if (old && old->builtFrom == stamp &&
+            strcmp(old->repoName, repo->name) == 0 &&
+            strcmp(old->sanitizedPath, sanitizedPath) == 0) {
+            InterlockedIncrement(&old->refs);
+            ti = old;
+        }
+    }
+    ReleaseSRWLockShared(&g_SnapLock);
+    if (ti) {
+        Metrics_Add(repo->path, MC_SNAPLIST_HIT, 1);
+        return ti;
+    }
+
+    numSnaps = FetchSnapshots(repo, &snapshots);
+    if (numSnaps == 0) return NULL;
+
+    ti = (SnapshotTimeIndex*)Mem_Alloc(MEM_SNAPSHOT_CACHE, sizeof(SnapshotTimeIndex) +
+                                       sizeof(SnapshotTimeEntry) * numSnaps);
+    if (!ti) {
+        if (g_LogProc)
+            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                      "Snapshot list does not fit the memory budget ([Memory] BudgetMB)");
+        free(snapshots);
+        return NULL;
+    }
+    entries = (SnapshotTimeEntry*)(ti + 1);
+
+    for (i = 0; i < numSnaps; i++) {
+        for (j = 0; j < snapshots[i].pathCount; j++) {
+            char sanitized[MAX_PATH];
+            SanitizePath(snapshots[i].paths[j], sanitized, MAX_PATH);
+            if (strcmp(sanitized, sanitizedPath) == 0) {
+                FormatSnapshotName(&snapshots[i], entries[count].displayName, SNAPSHOT_NAME_LEN);
+                entries[count].ft = ParseISOTime(snapshots[i].time);
+                count++;
+                break;
+            }
+        }
+    }
+    free(snapshots);
+    qsort(entries, count, sizeof(SnapshotTimeEntry), CompareTimeEntries);
+
+    ti->refs = 2;   /* g_TimeIndex's and the caller's */
+    strncpy(ti->repoName, repo->name, MAX_REPO_NAME - 1);
+    ti->repoName[MAX_REPO_NAME - 1] = '\0';
+    strncpy(ti->sanitizedPath, sanitizedPath, MAX_PATH - 1);
+    ti->sanitizedPath[MAX_PATH - 1] = '\0';
+    ti->builtFrom = SnapshotListStamp(repo->name);
+    ti->entries = entries;
+    ti->count = count;
+
+    AcquireSRWLockExclusive(&g_SnapLock);
+    old = g_TimeIndex[g_TimeIndexNext];
+    g_TimeIndex[g_TimeIndexNext] = ti;
+    g_TimeIndexNext = (g_TimeIndexNext + 1) % TIME_INDEX_MAX;
+    ReleaseSRWLockExclusive(&g_SnapLock);
+    ReleaseTimeIndex(old);
+    return ti;
+}
+
+/* First entry whose display name does not sort before key[0..keyLen) */
+static int TimeIndexLowerBound(const SnapshotTimeIndex* ti, const char* key, int keyLen) {
+    int lo = 0, hi = ti->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(ti->entries[mid].displayName, key, keyLen) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* First entry whose display name sorts after key[0..keyLen) */
+static int TimeIndexUpperBound(const SnapshotTimeIndex* ti, const char* key, int keyLen) {
+    int lo = 0, hi = ti->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strncmp(ti->entries[mid].displayName, key, keyLen) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Is seg a date folder: "2025", "2025-01" or "2025-01-28"? */
+static BOOL IsDateBucket(const char* seg) {
+    static const char pattern[] = "####-##-##";
+    int len = (int)strlen(seg), i;
+
+    if (len != 4 && len != 7 && len != 10) return FALSE;
+    for (i = 0; i < len; i++) {
+        if (pattern[i] == '#' ? (seg[i] < '0' || seg[i] > '9') : seg[i] != pattern[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Add what a date folder contains: years at the top (bucket ""), then
+   months, days, and finally the snapshots of one day. Each child costs two
+   binary searches, so a path with years of hourly snapshots lists fast. */
+static void AddDateBucketEntries(const SnapshotTimeIndex* ti, const char* bucket,
+                                 DirEntry** entries, int* count, int* capacity) {
+    int bucketLen = (int)strlen(bucket);
+    int childLen = bucketLen == 0 ? 4 : bucketLen == 4 ? 7 : bucketLen == 7 ? 10 : 0;
+    int i = TimeIndexLowerBound(ti, bucket, bucketLen);
+    int end = TimeIndexUpperBound(ti, bucket, bucketLen);
+
+    if (childLen == 0) {
+        for (; i < end; i++)
+            AddEntry(entries, count, capacity, ti->entries[i].displayName, TRUE, 0, 0,
+                     ti->entries[i].ft);
+        return;
+    }
+
+    while (i < end) {
+        char child[16];
+        int next;
+        snprintf(child, sizeof(child), "%.*s", childLen, ti->entries[i].displayName);
+        next = TimeIndexUpperBound(ti, child, childLen);
+        /* Dated like the newest snapshot inside */
+        AddEntry(entries, count, capacity, child, TRUE, 0, 0, ti->entries[next - 1].ft);
+        i = next;
+    }
+}
+
+/* Is seg an as-of reference "[@2025-01-28 10:00]"? */
+static BOOL IsAsOfSegment(const char* seg) {
+    return seg[0] == '[' && seg[1] == '@';
+}
+
+/* Turn "[@YYYY-MM-DD]", "[@YYYY-MM-DD HH:MM]" or "[@YYYY-MM-DD HH:MM:SS]"
+   ('-' also accepted between the time parts, as in snapshot names) into
+   the latest display time it covers, e.g. "2025-01-28 10-00-59". */
+static BOOL ParseAsOfSegment(const char* seg, char* key, int maxLen) {
+    int yr, mo, dy, hr = 23, mn = 59, sc = 59;
+    int n = sscanf(seg, "[@%4d-%2d-%2d %2d%*[:-]%2d%*[:-]%2d", &yr, &mo, &dy, &hr, &mn, &sc);
+
+    if (n != 3 && n != 5 && n != 6) return FALSE;
+    if (seg[strlen(seg) - 1] != ']') return FALSE;
+    if (n == 5) sc = 59;
+    snprintf(key, maxLen, "%04d-%02d-%02d %02d-%02d-%02d", yr, mo, dy, hr, mn, sc);
+    return TRUE;
+}
+
+/* Replace an as-of segment with the display name of the latest snapshot of
+   the backup path taken at or before that time (one binary search). Left
+   unchanged if nothing matches, which then lists as empty. */
+static void ResolveAsOfSegment(const char* repoName, const char* sanitizedPath, char* seg3) {
+    RepoConfig* repo = RepoStore_FindByName(repoName);
+    const SnapshotTimeIndex* ti;
+    char key[32];
+    int end;
+
+    if (!repo || !ParseAsOfSegment(seg3, key, sizeof(key))) return;
+    if (!RepoStore_EnsurePassword(repo, g_PluginNr, g_RequestProc)) return;
+
+    ti = GetTimeIndex(repo, sanitizedPath);
+    if (!ti) return;
+    end = TimeIndexUpperBound(ti, key, SNAPSHOT_TIME_LEN);
+    if (end > 0) {
+        strncpy(seg3, ti->entries[end - 1].displayName, MAX_PATH - 1);
+        seg3[MAX_PATH - 1] = '\0';
+    }
+    ReleaseTimeIndex(ti);
+}
+
+/* Split path into segments like SplitPathSegments, with seg3 normalized to
+   a snapshot display name where possible: date folders in front of a
+   snapshot are dropped ("2025\2025-01\2025-01-28\<snapshot>\x" is the same
+   as "<snapshot>\x"; a bare date folder stays in seg3 to be listed) and an
+   "[@...]" segment is resolved to the snapshot it refers to. */
+static int ParsePathSegments(const char* path, char* seg1, char* seg2, char* seg3, char* rest) {
+    int numSegs = SplitPathSegments(path, seg1, seg2, seg3, rest);
+    if (numSegs < 3) return numSegs;
+
+    while (IsDateBucket(seg3) && rest[0] != '\0') {
+        const char* sep = strchr(rest, '\\');
+        char tail[MAX_PATH];
+        snprintf(seg3, MAX_PATH, "%.*s", sep ? (int)(sep - rest) : (int)strlen(rest), rest);
+        snprintf(tail, MAX_PATH, "%s", sep ? sep + 1 : "");
+        strcpy(rest, tail);
+    }
+    if (IsAsOfSegment(seg3)) ResolveAsOfSegment(seg1, seg2, seg3);
+    return numSegs;
+}
+
 /* List unique backup paths from all snapshots as folder entries */
 static DirEntry* GetPathEntries(RepoConfig* repo, int* outCount) {
     DirEntry* entries = NULL;
@@ -422,73 +1089,50 @@ static DirEntry* GetPathEntries(RepoConfig* repo, int* outCount) {
     return entries;
 }
 
-/* List snapshots that match a given sanitized path */
+/* List snapshots that match a given sanitized path, or the year folders
+   holding them when date folders are enabled */
 static DirEntry* GetSnapshotsForPath(RepoConfig* repo, const char* sanitizedPath, int* outCount) {
     DirEntry* entries = NULL;
     int count = 0, capacity = 0;
-    ResticSnapshot* snapshots = NULL;
-    int numSnaps, i, j;
-
-    /* Arrays to track matching snapshots */
-    int* matchingIndices = NULL;
-    int matchingCount = 0;
-
-    numSnaps = FetchSnapshots(repo, &snapshots);
-    if (numSnaps == 0) {
-        *outCount = 0;
-        return NULL;
-    }
+    const SnapshotTimeIndex* ti;
+    FILETIME ftNow;
 
-    /* Allocate array for matching indices */
-    matchingIndices = malloc(numSnaps * sizeof(int));
-    if (!matchingIndices) {
-        free(snapshots);
+    ti = GetTimeIndex(repo, sanitizedPath);
+    if (!ti) {
         *outCount = 0;
         return NULL;
     }
 
-    /* First pass - identify matching snapshots */
-    for (i = 0; i < numSnaps; i++) {
-        BOOL matches = FALSE;
-        for (j = 0; j < snapshots[i].pathCount; j++) {
-            char sanitized[MAX_PATH];
-            SanitizePath(snapshots[i].paths[j], sanitized, MAX_PATH);
-            if (strcmp(sanitized, sanitizedPath) == 0) {
-                matches = TRUE;
-                break;
-            }
-        }
-        if (matches) {
-            matchingIndices[matchingCount++] = i;
-        }
-    }
-
-    /* Insert [All Files] virtual entry */
-    {
-        FILETIME ftNow;
-
-        GetSystemTimeAsFileTime(&ftNow);
+    /* Virtual entries first */
+    GetSystemTimeAsFileTime(&ftNow);
+    AddEntry(&entries, &count, &capacity, ALL_FILES_ENTRY, TRUE, 0, 0, ftNow);
+    AddEntry(&entries, &count, &capacity, SEARCH_ENTRY, TRUE, 0, 0, ftNow);
+    AddEntry(&entries, &count, &capacity, DELETED_ENTRY, TRUE, 0, 0, ftNow);
+    AddEntry(&entries, &count, &capacity, "[Refresh snapshot list]", TRUE, 0, 0, ftNow);
 
-        AddEntry(&entries, &count, &capacity, ALL_FILES_ENTRY, TRUE, 0, 0, ftNow);
-        AddEntry(&entries, &count, &capacity, "[Refresh snapshot list]", TRUE, 0, 0, ftNow);
+    if (g_DateFolders) {
+        AddDateBucketEntries(ti, "", &entries, &count, &capacity);
+    } else {
+        int i;
+        for (i = 0; i < ti->count; i++)
+            AddEntry(&entries, &count, &capacity, ti->entries[i].displayName, TRUE, 0, 0,
+                     ti->entries[i].ft);
     }
+    ReleaseTimeIndex(ti);
 
-    /* Second pass - add snapshot entries */
-    for (i = 0; i < matchingCount; i++) {
-        int idx = matchingIndices[i];
-        char displayName[MAX_PATH];
-        int yr = 0, mo = 0, dy = 0, hr = 0, mn = 0, sc = 0;
-
-        sscanf(snapshots[idx].time, "%d-%d-%dT%d:%d:%d", &yr, &mo, &dy, &hr, &mn, &sc);
-        snprintf(displayName, sizeof(displayName), "%04d-%02d-%02d %02d-%02d-%02d (%s)",
-                 yr, mo, dy, hr, mn, sc, snapshots[idx].shortId);
+    *outCount = count;
+    return entries;
+}
 
-        FILETIME ft = ParseISOTime(snapshots[idx].time);
-        AddEntry(&entries, &count, &capacity, displayName, TRUE, 0, 0, ft);
-    }
+/* List one date folder ("2025", "2025-01" or "2025-01-28") of a backup path */
+static DirEntry* GetDateBucketContents(RepoConfig* repo, const char* sanitizedPath,
+                                       const char* bucket, int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0, capacity = 0;
+    const SnapshotTimeIndex* ti = GetTimeIndex(repo, sanitizedPath);
 
-    free(matchingIndices);
-    free(snapshots);
+    if (ti) AddDateBucketEntries(ti, bucket, &entries, &count, &capacity);
+    ReleaseTimeIndex(ti);
     *outCount = count;
     return entries;
 }
@@ -548,15 +1192,25 @@ static BOOL IsAllFilesPath(const char* seg) {
     return (strncmp(seg, ALL_FILES_ENTRY, strlen(ALL_FILES_ENTRY)) == 0);
 }
 
+/* Check if a segment is the [Search] virtual folder. */
+static BOOL IsSearchPath(const char* seg) {
+    return (strcmp(seg, SEARCH_ENTRY) == 0);
+}
+
+/* Check if a segment is the [Deleted files] virtual folder. */
+static BOOL IsDeletedPath(const char* seg) {
+    return (strcmp(seg, DELETED_ENTRY) == 0);
+}
+
 /* Check if a name contains the version suffix " [show all versions]". */
 static BOOL HasVersionSuffix(const char* name) {
     return (strstr(name, VERSION_SUFFIX) != NULL);
 }
 
-/* Return the name without the " [show all versions]" suffix (static buffer),
-   rejoining stem and extension. E.g. "photo [show all versions].jpg" → "photo.jpg". */
-static const char* StripVersionSuffix(const char* name) {
-    static char buf[MAX_PATH];
+/* Return the name without the " [show all versions]" suffix (in buf, which
+   holds MAX_PATH chars), rejoining stem and extension.
+   E.g. "photo [show all versions].jpg" → "photo.jpg". */
+static const char* StripVersionSuffix(const char* name, char* buf) {
     const char* suffixPos = strstr(name, VERSION_SUFFIX);
     if (suffixPos) {
         int stemLen = (int)(suffixPos - name);
@@ -734,7 +1388,7 @@ static int CompareByParentPath(const void* a, const void* b) {
 
 /* Parse all entries from a restic ls call and bulk-cache every subdirectory
    into SQLite. Returns the direct children of requestedPathUtf8 via outDirectChildren. */
-static void BulkCacheSubdirectories(
+void BulkCacheSubdirectories(
     const char* repoName, const char* shortId,
     const char* requestedPathUtf8,
     ResticLsEntry* allEntries, int allCount,
@@ -842,28 +1496,359 @@ static void BulkCacheSubdirectories(
     free(parentPathList);
 }
 
-/* List directory contents inside a snapshot. Uses cache for repeat visits. */
-static DirEntry* GetSnapshotContents(RepoConfig* repo, const char* sanitizedPath,
-                                      const char* snapshotDisplayName, const char* subpath,
-                                      int* outCount) {
-    DirEntry* entries = NULL;
-    int count = 0;
-    char shortId[16];
-    char originalPath[MAX_PATH];
-    char lsSubpath[MAX_PATH];
-    char args[MAX_PATH * 2];
-    char* output;
-    DWORD exitCode;
-    int i;
+/* Growing array of a native snapshot walk, charged to MEM_PARSE as it
+   grows like the parsed output of restic ls */
+typedef struct {
+    ResticLsEntry* entries;
+    int count;
+    int capacity;
+    size_t charged;
+} NativeWalkList;
+
+static BOOL CollectNativeNode(void* ctx, const char* parentPathUtf8, const NativeNode* node) {
+    NativeWalkList* list = (NativeWalkList*)ctx;
+    ResticLsEntry* e;
+
+    if (list->count >= list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 1024;
+        size_t extra = (size_t)(capacity - list->capacity) * sizeof(ResticLsEntry);
+        ResticLsEntry* grown;
+
+        if (!Mem_Charge(MEM_PARSE, extra)) return FALSE;
+        grown = (ResticLsEntry*)realloc(list->entries, (size_t)capacity * sizeof(ResticLsEntry));
+        if (!grown) {
+            Mem_Uncharge(MEM_PARSE, extra);
+            return FALSE;
+        }
+        list->entries = grown;
+        list->capacity = capacity;
+        list->charged += extra;
+    }
 
-    *outCount = 0;
+    e = &list->entries[list->count++];
+    memset(e, 0, sizeof(ResticLsEntry));
+    Utf8ToAnsi(node->name, e->name, MAX_PATH);
+    snprintf(e->path, MAX_PATH, "%s/%s",
+             strcmp(parentPathUtf8, "/") == 0 ? "" : parentPathUtf8, node->name);
+    strcpy(e->type, node->type == NATIVE_NODE_DIR ? "dir" :
+                    node->type == NATIVE_NODE_SYMLINK ? "symlink" : "file");
+    e->sizeLow = (DWORD)(node->size & 0xFFFFFFFF);
+    e->sizeHigh = (DWORD)(node->size >> 32);
+    strncpy(e->mtime, node->mtime, sizeof(e->mtime) - 1);
+    return TRUE;
+}
 
-    if (!ExtractShortId(snapshotDisplayName, shortId, sizeof(shortId))) {
-        return NULL;
+/* Full listing of a snapshot walked in-process, in the shape restic ls
+   prints it. Returns the entry count with *parseSize charged to MEM_PARSE,
+   or -1 to run restic instead. */
+static int WalkSnapshotNative(RepoConfig* repo, const char* shortId,
+                              ResticLsEntry** outEntries, size_t* parseSize,
+                              SnapshotStats* stats) {
+    NativeRepo* handle = GetNativeRepo(repo);
+    NativeWalkList list;
+    BYTE rootTree[32];
+    LARGE_INTEGER walkStart;
+    BOOL ok;
+
+    if (!handle || !NativeRepo_SnapshotTree(handle, shortId, rootTree)) {
+        NativeRepo_Close(handle);
+        return -1;
     }
 
-    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) {
-        return NULL;
+    memset(&list, 0, sizeof(list));
+    QueryPerformanceCounter(&walkStart);
+    ok = NativeRepo_Walk(handle, rootTree, CollectNativeNode, &list);
+    NativeRepo_Close(handle);
+    if (!ok) {
+        free(list.entries);
+        if (list.charged) Mem_Uncharge(MEM_PARSE, list.charged);
+        Metrics_Add(repo->path, MC_NATIVE_MISS, 1);
+        return -1;
+    }
+    Metrics_Add(repo->path, MC_NATIVE_HIT, 1);
+
+    /* There is no restic output to time, so the walk stands in for it */
+    stats->resticMs = PerfStats_MicrosSince(walkStart.QuadPart) / 1000;
+    stats->firstByteMs = 0;
+    stats->outputBytes = 0;
+    stats->parseMs = 0;
+    *outEntries = list.entries;
+    *parseSize = list.charged;
+    return list.count;
+}
+
+/* Full listing of a snapshot from one "restic ls". Returns the entry count
+   with *parseSize charged to MEM_PARSE, or -1 after reporting an error. */
+static int ListSnapshotRestic(RepoConfig* repo, const char* shortId,
+                              ResticLsEntry** outEntries, size_t* parseSize,
+                              SnapshotStats* stats) {
+    char args[MAX_PATH * 2];
+    char* output;
+    DWORD exitCode;
+    ResticRunInfo runInfo;
+    LARGE_INTEGER parseStart;
+    size_t outputSize;
+    const char* p;
+    int allCount;
+
+    /* Full recursive listing (no path filter), so every subdirectory can be
+       bulk-cached at once */
+    snprintf(args, sizeof(args), "ls --json %s", shortId);
+
+    output = RunResticTimed(repo->path, repo->password, args, &exitCode, &runInfo);
+    if (!output) {
+        if (g_LogProc)
+            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                      "Error: Could not run restic. Is restic.exe in PATH?");
+        return -1;
+    }
+    if (exitCode != 0) {
+        if (g_LogProc)
+            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                      "Error: restic ls failed. Check repository and snapshot.");
+        free(output);
+        return -1;
+    }
+
+    /* Account the output and the parsed array (one entry per JSON line)
+       against the memory budget; a snapshot too big to hold is refused
+       here instead of failing allocations halfway through the ingest */
+    outputSize = strlen(output) + 1;
+    *parseSize = 0;
+    for (p = output; *p; p++) {
+        if (*p == '\n') (*parseSize)++;
+    }
+    *parseSize *= sizeof(ResticLsEntry);
+    if (!Mem_Charge(MEM_RESTIC_OUTPUT, outputSize)) outputSize = 0;
+    if (!outputSize || !Mem_Charge(MEM_PARSE, *parseSize)) {
+        if (outputSize) Mem_Uncharge(MEM_RESTIC_OUTPUT, outputSize);
+        free(output);
+        *parseSize = 0;
+        if (g_LogProc)
+            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                      "Error: Snapshot listing is too large for the memory budget. "
+                      "Raise [Memory] BudgetMB in restic_wfx.ini.");
+        return -1;
+    }
+
+    QueryPerformanceCounter(&parseStart);
+    allCount = ParseLsOutputAll(output, outEntries);
+    stats->parseMs = PerfStats_MicrosSince(parseStart.QuadPart) / 1000;
+    free(output);
+    Mem_Uncharge(MEM_RESTIC_OUTPUT, outputSize);
+
+    stats->resticMs = runInfo.durationMs;
+    stats->firstByteMs = runInfo.firstByteMs;
+    stats->outputBytes = runInfo.outputBytes;
+    return allCount;
+}
+
+/* Load a whole snapshot (walked in-process for local repositories, else
+   with one "restic ls") and bulk-cache every directory in SQLite, then
+   mark the snapshot loaded. Returns the direct children of lsSubpathUtf8
+   (caller frees), or NULL. */
+static DirEntry* LoadSnapshot(RepoConfig* repo, const char* shortId,
+                              const char* lsSubpathUtf8, int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0;
+    ResticLsEntry* allEntries = NULL;
+    int allCount;
+    size_t parseSize = 0;
+    int i;
+    TraceSpan span;
+    LARGE_INTEGER ingestStart;
+    LONGLONG ingestMicros;
+    SnapshotStats stats;
+
+    *outCount = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    allCount = WalkSnapshotNative(repo, shortId, &allEntries, &parseSize, &stats);
+    if (allCount < 0)
+        allCount = ListSnapshotRestic(repo, shortId, &allEntries, &parseSize, &stats);
+    if (allCount <= 0) {
+        free(allEntries);
+        if (parseSize) Mem_Uncharge(MEM_PARSE, parseSize);
+        return NULL;
+    }
+
+    stats.dirCount = 0;
+    for (i = 0; i < allCount; i++) {
+        if (strcmp(allEntries[i].type, "dir") == 0) stats.dirCount++;
+    }
+
+    QueryPerformanceCounter(&ingestStart);
+    Trace_Begin(&span);
+    BulkCacheSubdirectories(repo->name, shortId, lsSubpathUtf8,
+                            allEntries, allCount, &entries, &count);
+    free(allEntries);
+    Mem_Uncharge(MEM_PARSE, parseSize);
+
+    /* Mark this snapshot as fully loaded so we don't re-fetch for non-existent paths */
+    LsCache_MarkSnapshotLoaded(repo->name, shortId);
+    ingestMicros = PerfStats_MicrosSince(ingestStart.QuadPart);
+    Metrics_RecordIngest(repo->path, allCount, ingestMicros);
+    Trace_ArgStr(&span, "snapshot", shortId);
+    Trace_ArgInt(&span, "entries", allCount);
+    Trace_End(&span, "sqlite.ingest");
+
+    /* Remember what this snapshot cost to load */
+    stats.entryCount = allCount;
+    stats.sqliteMs = ingestMicros / 1000;
+    stats.recordedAt = (LONGLONG)time(NULL);
+    LsCache_StoreSnapshotStats(repo->name, shortId, &stats);
+
+    *outCount = count;
+    return entries;
+}
+
+/* Polling interval while another TC instance ingests a snapshot, and how
+   long to wait for it at most (the timeout of a restic listing) */
+#define INGEST_POLL_MIN_MS 50
+#define INGEST_POLL_MAX_MS 1000
+#define INGEST_WAIT_MAX_MS 120000
+
+/* Take the ingest lease of a snapshot, waiting while another process or
+   thread holds it. Returns 1 with the lease taken, 0 if the holder has
+   loaded the snapshot meanwhile, -1 to ingest without a lease (also when
+   the wait times out or the user presses ESC in the progress dialog). */
+static int WaitIngestLease(RepoConfig* repo, const char* shortId) {
+    DWORD delay = INGEST_POLL_MIN_MS;
+    ULONGLONG start = GetTickCount64();
+    char progressName[MAX_PATH];
+    int lease, polls = 0;
+    TraceSpan span;
+
+    snprintf(progressName, sizeof(progressName), "\\%s\\%s", repo->name, shortId);
+    Trace_Begin(&span);
+    while ((lease = LsCache_AcquireIngestLease(repo->name, shortId)) == 0 &&
+           !LsCache_IsSnapshotLoaded(repo->name, shortId)) {
+        if (GetTickCount64() - start >= INGEST_WAIT_MAX_MS ||
+            (g_ProgressProc && g_ProgressProc(g_PluginNr, progressName, "", 0))) {
+            lease = -1;
+            break;
+        }
+        Sleep(delay);
+        if (delay < INGEST_POLL_MAX_MS) delay *= 2;
+        polls++;
+    }
+
+    /* The holder may have finished just before the lease was given up */
+    if (lease == 1 && LsCache_IsSnapshotLoaded(repo->name, shortId)) {
+        LsCache_ReleaseIngestLease(repo->name, shortId);
+        lease = 0;
+    }
+    Trace_ArgStr(&span, "snapshot", shortId);
+    Trace_ArgInt(&span, "lease", lease);
+    Trace_ArgInt(&span, "polls", polls);
+    Trace_End(&span, "cache.ingest_lease");
+    return lease;
+}
+
+/* Load a whole snapshot into the SQLite cache like LoadSnapshot, unless
+   another TC instance is loading it already: then wait for that and read
+   the listing of lsSubpathUtf8 from the cache it filled. */
+static DirEntry* IngestSnapshot(RepoConfig* repo, const char* shortId,
+                                const char* lsSubpathUtf8, int* outCount) {
+    DirEntry* entries;
+    int lease = WaitIngestLease(repo, shortId);
+
+    if (lease == 0) {
+        *outCount = 0;
+        entries = LsCache_Lookup(repo->name, shortId, lsSubpathUtf8, outCount);
+        if (entries && *outCount == 0) {
+            free(entries);
+            entries = NULL;
+        }
+        return entries;
+    }
+
+    entries = LoadSnapshot(repo, shortId, lsSubpathUtf8, outCount);
+    if (lease == 1) LsCache_ReleaseIngestLease(repo->name, shortId);
+    return entries;
+}
+
+/* Make sure a snapshot is fully loaded into the SQLite cache, ingesting it
+   if needed. Returns FALSE if it could not be loaded. */
+static BOOL EnsureSnapshotLoaded(RepoConfig* repo, const char* shortId) {
+    int count = 0;
+    if (LsCache_IsSnapshotLoaded(repo->name, shortId)) return TRUE;
+    free(IngestSnapshot(repo, shortId, "/", &count));
+    return LsCache_IsSnapshotLoaded(repo->name, shortId);
+}
+
+/* List one directory of a snapshot in-process and store it in SQLite (the
+   snapshot is not marked loaded, so other directories are listed the same
+   way on demand). Returns 1 with *outEntries set (caller frees, NULL for an
+   empty directory), 0 if the path is not a directory of the snapshot, or
+   -1 to load the snapshot with restic instead. */
+static int ListDirNative(RepoConfig* repo, const char* shortId, const char* pathUtf8,
+                         DirEntry** outEntries, int* outCount) {
+    NativeRepo* handle = GetNativeRepo(repo);
+    const NativeTree* tree;
+    DirEntry* entries;
+    BYTE rootTree[32];
+    int found, count, i;
+
+    *outEntries = NULL;
+    *outCount = 0;
+    if (!handle || !NativeRepo_SnapshotTree(handle, shortId, rootTree)) {
+        NativeRepo_Close(handle);
+        return -1;
+    }
+
+    found = NativeRepo_FindDir(handle, rootTree, pathUtf8, &tree);
+    NativeRepo_Close(handle);
+    if (found <= 0) return found;
+    count = tree->count;
+    if (count == 0) {
+        NativeRepo_ReleaseTree(tree);
+        LsCache_Store(repo->name, shortId, pathUtf8, NULL, 0);
+        return 1;
+    }
+
+    entries = (DirEntry*)calloc(count, sizeof(DirEntry));
+    if (!entries) {
+        NativeRepo_ReleaseTree(tree);
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        const NativeNode* node = &tree->nodes[i];
+        Utf8ToAnsi(node->name, entries[i].name, MAX_PATH);
+        entries[i].isDirectory = (node->type == NATIVE_NODE_DIR);
+        entries[i].fileSizeLow = (DWORD)(node->size & 0xFFFFFFFF);
+        entries[i].fileSizeHigh = (DWORD)(node->size >> 32);
+        entries[i].lastWriteTime = ParseISOTime(node->mtime);
+    }
+    NativeRepo_ReleaseTree(tree);
+    LsCache_Store(repo->name, shortId, pathUtf8, entries, count);
+
+    *outEntries = entries;
+    *outCount = count;
+    return 1;
+}
+
+/* List directory contents inside a snapshot. Uses cache for repeat visits. */
+static DirEntry* GetSnapshotContents(RepoConfig* repo, const char* sanitizedPath,
+                                      const char* snapshotDisplayName, const char* subpath,
+                                      int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0;
+    char shortId[16];
+    char originalPath[MAX_PATH];
+    char lsSubpath[MAX_PATH];
+    int i;
+    BOOL loaded, absent;
+    TraceSpan span;
+
+    *outCount = 0;
+
+    if (!ExtractShortId(snapshotDisplayName, shortId, sizeof(shortId))) {
+        return NULL;
+    }
+
+    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) {
+        return NULL;
     }
 
     BuildLsSubpath(originalPath, subpath, lsSubpath, MAX_PATH);
@@ -873,38 +1858,57 @@ static DirEntry* GetSnapshotContents(RepoConfig* repo, const char* sanitizedPath
     AnsiToUtf8(lsSubpath, lsSubpathUtf8, MAX_PATH);
 
     /* Check in-memory directory listing cache (keyed on UTF-8 path) */
-    for (i = 0; i < g_LsCacheCount; i++) {
+    Trace_Begin(&span);
+    count = -1;
+    AcquireSRWLockShared(&g_ListingLock);
+    for (i = 0; i < g_LsCacheCount && count < 0; i++) {
         if (strcmp(g_LsCache[i].shortId, shortId) == 0 &&
             strcmp(g_LsCache[i].path, lsSubpathUtf8) == 0) {
             /* Cache hit — return deep copy */
-            *outCount = g_LsCache[i].count;
-            return CopyDirEntries(g_LsCache[i].entries, g_LsCache[i].count);
+            count = g_LsCache[i].count;
+            entries = CopyDirEntries(g_LsCache[i].entries, count);
         }
     }
+    ReleaseSRWLockShared(&g_ListingLock);
+    if (count >= 0) {
+        Trace_ArgInt(&span, "hit", 1);
+        Trace_End(&span, "cache.memory");
+        Metrics_Add(repo->path, MC_MEM_HIT, 1);
+        *outCount = count;
+        return entries;
+    }
+    Trace_ArgInt(&span, "hit", 0);
+    Trace_End(&span, "cache.memory");
+    Metrics_Add(repo->path, MC_MEM_MISS, 1);
+
+    /* A loaded snapshot's path filter rules out most directories it does not
+       have without a query; [All Files] asks every snapshot of the path */
+    Trace_Begin(&span);
+    absent = LsCache_IsPathAbsent(repo->name, shortId, lsSubpathUtf8);
+    Trace_ArgInt(&span, "absent", absent);
+    Trace_End(&span, "cache.path_filter");
+    Metrics_Add(repo->path, absent ? MC_FILTER_SKIP : MC_FILTER_PASS, 1);
+    if (absent) {
+        *outCount = 0;
+        return NULL;
+    }
 
     /* Check persistent SQLite cache.
        LsCache_Lookup returns non-NULL for any cache hit (even empty dirs). */
     {
         int dbCount = 0;
-        DirEntry* dbEntries = LsCache_Lookup(repo->name, shortId, lsSubpathUtf8, &dbCount);
+        DirEntry* dbEntries;
+
+        Trace_Begin(&span);
+        dbEntries = LsCache_Lookup(repo->name, shortId, lsSubpathUtf8, &dbCount);
+        Trace_ArgInt(&span, "hit", dbEntries != NULL);
+        Trace_ArgInt(&span, "entries", dbCount);
+        Trace_End(&span, "cache.sqlite");
+        Metrics_Add(repo->path, dbEntries ? MC_SQLITE_HIT : MC_SQLITE_MISS, 1);
         if (dbEntries) {
             if (dbCount > 0) {
                 /* Non-empty cache hit — populate in-memory cache */
-                LsCacheEntry* lce;
-                if (g_LsCacheCount >= LS_CACHE_MAX) {
-                    free(g_LsCache[0].entries);
-                    memmove(&g_LsCache[0], &g_LsCache[1],
-                            sizeof(LsCacheEntry) * (LS_CACHE_MAX - 1));
-                    g_LsCacheCount--;
-                }
-                lce = &g_LsCache[g_LsCacheCount];
-                strncpy(lce->shortId, shortId, sizeof(lce->shortId) - 1);
-                lce->shortId[sizeof(lce->shortId) - 1] = '\0';
-                strncpy(lce->path, lsSubpathUtf8, MAX_PATH - 1);
-                lce->path[MAX_PATH - 1] = '\0';
-                lce->entries = CopyDirEntries(dbEntries, dbCount);
-                lce->count = dbCount;
-                if (lce->entries) g_LsCacheCount++;
+                LsCacheInsert(shortId, lsSubpathUtf8, dbEntries, dbCount);
 
                 *outCount = dbCount;
                 return dbEntries;
@@ -918,50 +1922,30 @@ static DirEntry* GetSnapshotContents(RepoConfig* repo, const char* sanitizedPath
 
     /* Check if snapshot was already fully loaded (bulk-cached).
        If so, and we got here (cache miss), the folder doesn't exist. */
-    if (LsCache_IsSnapshotLoaded(repo->name, shortId)) {
+    Trace_Begin(&span);
+    loaded = LsCache_IsSnapshotLoaded(repo->name, shortId);
+    Trace_ArgInt(&span, "loaded", loaded);
+    Trace_End(&span, "cache.snapshot_loaded");
+    if (loaded) {
         *outCount = 0;
         return NULL;
     }
 
-    /* Cache miss — fetch full recursive listing from restic (no path filter,
-       so we get ALL entries and can bulk-cache every subdirectory at once) */
-    snprintf(args, sizeof(args), "ls --json %s", shortId);
-
-    output = RunRestic(repo->path, repo->password, args, &exitCode);
-    if (!output) {
-        if (g_LogProc)
-            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
-                      "Error: Could not run restic. Is restic.exe in PATH?");
-        return NULL;
-    }
-    if (exitCode != 0) {
-        if (g_LogProc)
-            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
-                      "Error: restic ls failed. Check repository and snapshot.");
-        free(output);
-        return NULL;
-    }
-
-    /* Parse ALL entries from restic ls and bulk-cache every subdirectory */
+    /* Local repositories list just this directory from its tree */
     {
-        ResticLsEntry* allEntries = NULL;
-        int allCount = ParseLsOutputAll(output, &allEntries);
-        free(output);
-
-        if (allCount <= 0) {
-            free(allEntries);
-            *outCount = 0;
-            return NULL;
+        int native = ListDirNative(repo, shortId, lsSubpathUtf8, &entries, &count);
+        if (native >= 0) {
+            Metrics_Add(repo->path, MC_NATIVE_HIT, 1);
+            if (count > 0) LsCacheInsert(shortId, lsSubpathUtf8, entries, count);
+            *outCount = count;
+            return entries;
         }
-
-        BulkCacheSubdirectories(repo->name, shortId, lsSubpathUtf8,
-                                allEntries, allCount, &entries, &count);
-        free(allEntries);
-
-        /* Mark this snapshot as fully loaded so we don't re-fetch for non-existent paths */
-        LsCache_MarkSnapshotLoaded(repo->name, shortId);
+        if (UsesNativeRepo(repo)) Metrics_Add(repo->path, MC_NATIVE_MISS, 1);
     }
 
+    /* Cache miss — load the whole snapshot */
+    entries = IngestSnapshot(repo, shortId, lsSubpathUtf8, &count);
+
     if (count <= 0 || !entries) {
         free(entries);
         *outCount = 0;
@@ -971,24 +1955,7 @@ static DirEntry* GetSnapshotContents(RepoConfig* repo, const char* sanitizedPath
     *outCount = count;
 
     /* Store in in-memory directory listing cache (SQLite already done by BulkCacheSubdirectories) */
-    if (entries && count > 0) {
-        LsCacheEntry* lce;
-        if (g_LsCacheCount >= LS_CACHE_MAX) {
-            /* Evict oldest entry (index 0) */
-            free(g_LsCache[0].entries);
-            memmove(&g_LsCache[0], &g_LsCache[1],
-                    sizeof(LsCacheEntry) * (LS_CACHE_MAX - 1));
-            g_LsCacheCount--;
-        }
-        lce = &g_LsCache[g_LsCacheCount];
-        strncpy(lce->shortId, shortId, sizeof(lce->shortId) - 1);
-        lce->shortId[sizeof(lce->shortId) - 1] = '\0';
-        strncpy(lce->path, lsSubpathUtf8, MAX_PATH - 1);
-        lce->path[MAX_PATH - 1] = '\0';
-        lce->entries = CopyDirEntries(entries, count);
-        lce->count = count;
-        if (lce->entries) g_LsCacheCount++;
-    }
+    LsCacheInsert(shortId, lsSubpathUtf8, entries, count);
 
     return entries;
 }
@@ -1003,6 +1970,7 @@ static DirEntry* GetAllFilesContents(RepoConfig* repo, const char* sanitizedPath
     int count = 0, capacity = 0;
     ResticSnapshot* snapshots = NULL;
     int numSnaps, i, j, k;
+    size_t charged = 0;
 
     *outCount = 0;
 
@@ -1046,7 +2014,8 @@ static DirEntry* GetAllFilesContents(RepoConfig* repo, const char* sanitizedPath
 
             /* Check if already in merged result */
             for (m = 0; m < count; m++) {
-                const char* existingBase = StripVersionSuffix(entries[m].name);
+                char stripped[MAX_PATH];
+                const char* existingBase = StripVersionSuffix(entries[m].name, stripped);
                 if (strcmp(existingBase, baseName) == 0) {
                     duplicate = TRUE;
                     break;
@@ -1078,8 +2047,23 @@ static DirEntry* GetAllFilesContents(RepoConfig* repo, const char* sanitizedPath
         }
 
         free(snapEntries);
+
+        /* Account the merged array's growth; stop with what we have if the
+           memory budget can't take more */
+        if ((size_t)capacity * sizeof(DirEntry) > charged) {
+            size_t grown = (size_t)capacity * sizeof(DirEntry) - charged;
+            if (!Mem_Charge(MEM_MERGE, grown)) {
+                if (g_LogProc)
+                    g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                              "Warning: [All Files] listing is incomplete because it exceeds "
+                              "the memory budget ([Memory] BudgetMB in restic_wfx.ini).");
+                break;
+            }
+            charged += grown;
+        }
     }
 
+    Mem_Uncharge(MEM_MERGE, charged);
     free(snapshots);
     *outCount = count;
     return entries;
@@ -1192,6 +2176,992 @@ static DirEntry* GetFileVersions(RepoConfig* repo, const char* sanitizedPath,
     return entries;
 }
 
+/* Compare directory paths so that everything below "a" sorts right after
+   "a" itself: '\' ranks before every other character. */
+static int CompareRelDir(const char* a, const char* b) {
+    for (; *a && *a == *b; a++, b++) {}
+    if (*a == *b) return 0;
+    if (*a == '\\') return *b ? -1 : 1;
+    if (*b == '\\') return *a ? 1 : -1;
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+/* Directory of a restic parent path relative to the backup path prefix
+   (both UTF-8), as ANSI with backslashes. */
+static void RelDirFromResticPath(const char* pathUtf8, const char* prefixUtf8,
+                                 char* out, int maxLen) {
+    char relUtf8[MAX_PATH];
+    int prefixLen = (int)strlen(prefixUtf8);
+    int i;
+
+    if (prefixLen > 1 && pathUtf8[prefixLen] == '/')
+        strncpy(relUtf8, pathUtf8 + prefixLen + 1, MAX_PATH - 1);
+    else if (prefixLen <= 1 && pathUtf8[0] == '/')
+        strncpy(relUtf8, pathUtf8 + 1, MAX_PATH - 1);  /* backup path is "/" */
+    else
+        relUtf8[0] = '\0';
+    relUtf8[MAX_PATH - 1] = '\0';
+
+    Utf8ToAnsi(relUtf8, out, maxLen);
+    for (i = 0; out[i]; i++) {
+        if (out[i] == '/') out[i] = '\\';
+    }
+}
+
+static int CompareResultFiles(const void* a, const void* b) {
+    const ResultFile* ra = (const ResultFile*)a;
+    const ResultFile* rb = (const ResultFile*)b;
+    int c = CompareRelDir(ra->relDir, rb->relDir);
+    return c ? c : strcmp(ra->entry.name, rb->entry.name);
+}
+
+/* List one directory of a result tree: the files whose relDir is sub, and
+   the child directories leading to deeper results. The results must be
+   sorted with CompareRelDir, so each child directory is one run. */
+static DirEntry* ListResultDir(ResultCache* rc, const char* sub, int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0, capacity = 0;
+    int subLen = (int)strlen(sub);
+    FILETIME ftNow;
+    int i;
+
+    GetSystemTimeAsFileTime(&ftNow);
+
+    AcquireSRWLockShared(&rc->lock);
+    for (i = 0; i < rc->count; i++) {
+        const ResultFile* r = &rc->results[i];
+        const char* below;
+        char child[MAX_PATH];
+        const char* end;
+
+        if (strcmp(r->relDir, sub) == 0) {
+            AddEntry(&entries, &count, &capacity, r->entry.name, FALSE,
+                     r->entry.fileSizeLow, r->entry.fileSizeHigh, r->entry.lastWriteTime);
+            continue;
+        }
+        if (subLen == 0) {
+            below = r->relDir;
+        } else if (strncmp(r->relDir, sub, subLen) == 0 && r->relDir[subLen] == '\\') {
+            below = r->relDir + subLen + 1;
+        } else {
+            continue;
+        }
+
+        end = strchr(below, '\\');
+        snprintf(child, MAX_PATH, "%.*s", end ? (int)(end - below) : (int)strlen(below), below);
+        if (count > 0 && entries[count - 1].isDirectory && strcmp(entries[count - 1].name, child) == 0)
+            continue;
+        AddEntry(&entries, &count, &capacity, child, TRUE, 0, 0, ftNow);
+    }
+    ReleaseSRWLockShared(&rc->lock);
+
+    *outCount = count;
+    return entries;
+}
+
+/* --- [Search]: file name search over the cached snapshots --- */
+
+/* Searches typed into [New search], most recent first. TC paths cannot
+   carry '*' or '?', so each query gets an encoded folder name and the
+   query itself is kept here. */
+typedef struct {
+    char repoName[MAX_REPO_NAME];
+    char folder[MAX_PATH];
+    char query[NAME_MATCH_MAX];     /* UTF-8 */
+} RecentSearch;
+
+static RecentSearch g_RecentSearches[SEARCH_MAX_RECENT];
+static int g_RecentSearchCount = 0;
+
+/* Folder name for a query: '*' -> '#', '?' -> '~', other characters that
+   are invalid in file names -> '_'. */
+static void EncodeSearchFolder(const char* queryAnsi, char* out, int maxLen) {
+    int i;
+    for (i = 0; queryAnsi[i] && i < maxLen - 1; i++) {
+        char c = queryAnsi[i];
+        if (c == '*') c = '#';
+        else if (c == '?') c = '~';
+        else if (strchr("\\/:\"<>|", c) || (unsigned char)c < 32) c = '_';
+        out[i] = c;
+    }
+    out[i] = '\0';
+}
+
+/* Find the query of a search folder. Folders not in the recent list (e.g.
+   after a restart) are decoded back into a wildcard query. */
+static void GetSearchQuery(const char* repoName, const char* folder, char* queryUtf8, int maxLen) {
+    char decoded[MAX_PATH];
+    int i;
+
+    for (i = 0; i < g_RecentSearchCount; i++) {
+        if (strcmp(g_RecentSearches[i].repoName, repoName) == 0 &&
+            strcmp(g_RecentSearches[i].folder, folder) == 0) {
+            strncpy(queryUtf8, g_RecentSearches[i].query, maxLen - 1);
+            queryUtf8[maxLen - 1] = '\0';
+            return;
+        }
+    }
+
+    strncpy(decoded, folder, MAX_PATH - 1);
+    decoded[MAX_PATH - 1] = '\0';
+    for (i = 0; decoded[i]; i++) {
+        if (decoded[i] == '#') decoded[i] = '*';
+        else if (decoded[i] == '~') decoded[i] = '?';
+    }
+    AnsiToUtf8(decoded, queryUtf8, maxLen);
+}
+
+/* Ask for a search query and remember it. Returns FALSE if cancelled or
+   the query is not valid. */
+static BOOL PromptNewSearch(RepoConfig* repo) {
+    char queryAnsi[NAME_MATCH_MAX] = {0};
+    char queryUtf8[NAME_MATCH_MAX];
+    char folder[MAX_PATH];
+    NameMatch match;
+    RecentSearch rs;
+    int i;
+
+    if (!g_RequestProc) return FALSE;
+    if (!g_RequestProc(g_PluginNr, RT_Other, "Search Cached Snapshots",
+                       "File name to find (text, wildcards like *.pdf, or re:<regex>):",
+                       queryAnsi, sizeof(queryAnsi)) || queryAnsi[0] == '\0')
+        return FALSE;
+
+    AnsiToUtf8(queryAnsi, queryUtf8, sizeof(queryUtf8));
+    if (!NameMatch_Init(&match, queryUtf8)) {
+        char buf[MAX_PATH] = {0};
+        g_RequestProc(g_PluginNr, RT_MsgOK, "Search", "Invalid search query.", buf, MAX_PATH);
+        return FALSE;
+    }
+
+    EncodeSearchFolder(queryAnsi, folder, MAX_PATH);
+
+    /* Move to the front, dropping an older search with the same folder */
+    memset(&rs, 0, sizeof(rs));
+    strncpy(rs.repoName, repo->name, MAX_REPO_NAME - 1);
+    strncpy(rs.folder, folder, MAX_PATH - 1);
+    strncpy(rs.query, queryUtf8, NAME_MATCH_MAX - 1);
+
+    for (i = 0; i < g_RecentSearchCount; i++) {
+        if (strcmp(g_RecentSearches[i].repoName, rs.repoName) == 0 &&
+            strcmp(g_RecentSearches[i].folder, rs.folder) == 0)
+            break;
+    }
+    if (i == g_RecentSearchCount && g_RecentSearchCount < SEARCH_MAX_RECENT)
+        g_RecentSearchCount++;
+    if (i >= g_RecentSearchCount) i = g_RecentSearchCount - 1;
+    memmove(&g_RecentSearches[1], &g_RecentSearches[0], sizeof(RecentSearch) * i);
+    g_RecentSearches[0] = rs;
+
+    /* A search re-run under the same folder must not reuse old results */
+    FreeResultCache(&g_SearchCache);
+    return TRUE;
+}
+
+/* Version name of a search hit, same format as the [All Files] version
+   listing: "report - 2025-01-28 10-30-05 (fb4ed15b).pdf" */
+static void FormatSearchVersionName(const char* name, const char* shortId, FILETIME mtime,
+                                    char* out, int maxLen) {
+    FILETIME local;
+    SYSTEMTIME st;
+    const char* dot = strrchr(name, '.');
+
+    memset(&st, 0, sizeof(st));
+    FileTimeToLocalFileTime(&mtime, &local);
+    FileTimeToSystemTime(&local, &st);
+
+    if (dot)
+        snprintf(out, maxLen, "%.*s - %04d-%02d-%02d %02d-%02d-%02d (%s)%s",
+                 (int)(dot - name), name, st.wYear, st.wMonth, st.wDay,
+                 st.wHour, st.wMinute, st.wSecond, shortId, dot);
+    else
+        snprintf(out, maxLen, "%s - %04d-%02d-%02d %02d-%02d-%02d (%s)",
+                 name, st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, shortId);
+}
+
+/* Reverse of FormatSearchVersionName: recover the file name and snapshot. */
+static BOOL ParseSearchVersionName(const char* display, char* name, char* shortId, int idLen) {
+    const char* close = strrchr(display, ')');
+    const char* open;
+    int stemLen, len;
+
+    if (!close) return FALSE;
+    for (open = close; open > display && *open != '('; open--) {}
+    /* " - " + "YYYY-MM-DD hh-mm-ss" + " " precede the '(' */
+    if (*open != '(' || open - display < 23 || open[-1] != ' ' ||
+        strncmp(open - 23, " - ", 3) != 0)
+        return FALSE;
+
+    len = (int)(close - open - 1);
+    if (len <= 0 || len >= idLen) return FALSE;
+    memcpy(shortId, open + 1, len);
+    shortId[len] = '\0';
+
+    stemLen = (int)(open - 23 - display);
+    snprintf(name, MAX_PATH, "%.*s%s", stemLen, display, close + 1);
+    return TRUE;
+}
+
+typedef struct {
+    const LsSearchHit* hit;
+    int rank;               /* snapshot index in restic order: higher = newer */
+} RankedHit;
+
+/* Directory, name and version; the newest snapshot first within a version */
+static int CompareRankedHits(const void* a, const void* b) {
+    const RankedHit* ra = (const RankedHit*)a;
+    const RankedHit* rb = (const RankedHit*)b;
+    int c = CompareRelDir(ra->hit->path, rb->hit->path);
+    if (c) return c;
+    c = strcmp(ra->hit->entry.name, rb->hit->entry.name);
+    if (c) return c;
+    c = (int)CompareFileTime(&ra->hit->entry.lastWriteTime, &rb->hit->entry.lastWriteTime);
+    if (c) return c;
+    return rb->rank - ra->rank;
+}
+
+static BOOL SameVersion(const LsSearchHit* a, const LsSearchHit* b) {
+    return strcmp(a->path, b->path) == 0 && strcmp(a->entry.name, b->entry.name) == 0 &&
+           CompareFileTime(&a->entry.lastWriteTime, &b->entry.lastWriteTime) == 0 &&
+           a->entry.fileSizeLow == b->entry.fileSizeLow &&
+           a->entry.fileSizeHigh == b->entry.fileSizeHigh;
+}
+
+/* Run a search below one backup path and keep the results in g_SearchCache.
+   Only fully loaded snapshots are searched; one result per distinct file
+   version (path, size, mtime), named after the newest snapshot holding it. */
+static void RunSearch(RepoConfig* repo, const char* sanitizedPath, const char* folder) {
+    char queryUtf8[NAME_MATCH_MAX];
+    char likePattern[NAME_MATCH_MAX];
+    char originalPath[MAX_PATH], prefix[MAX_PATH], prefixUtf8[MAX_PATH], key[MAX_PATH];
+    NameMatch match;
+    ResticSnapshot* snapshots = NULL;
+    LsSearchHit* hits = NULL;
+    RankedHit* ranked = NULL;
+    ResultFile* results;
+    int numSnaps, numHits = 0, numRanked = 0, count = 0, i, j;
+
+    FreeResultCache(&g_SearchCache);
+
+    GetSearchQuery(repo->name, folder, queryUtf8, sizeof(queryUtf8));
+    if (!NameMatch_Init(&match, queryUtf8)) return;
+    NameMatch_LikePattern(&match, likePattern, sizeof(likePattern));
+
+    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) return;
+    BuildLsSubpath(originalPath, "", prefix, MAX_PATH);
+    AnsiToUtf8(prefix, prefixUtf8, MAX_PATH);
+    if (strcmp(prefixUtf8, "/") == 0) prefixUtf8[0] = '\0';
+
+    numSnaps = FetchSnapshots(repo, &snapshots);
+    if (numSnaps == 0) return;
+
+    hits = LsCache_Search(repo->name, prefixUtf8, likePattern, NameMatch_Test, &match,
+                          SEARCH_MAX_HITS, &numHits);
+    if (numHits >= SEARCH_MAX_HITS && g_LogProc)
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Warning: [Search] shows only the first matches "
+                  "(too many files match; narrow the query).");
+    if (numHits > 0) ranked = (RankedHit*)malloc(sizeof(RankedHit) * numHits);
+    if (!ranked) {
+        free(hits);
+        free(snapshots);
+        return;
+    }
+
+    /* Keep files from snapshots of this backup path; turn the restic parent
+       path into a directory relative to the backup path */
+    for (i = 0; i < numHits; i++) {
+        LsSearchHit* h = &hits[i];
+        char relDir[MAX_PATH];
+        int rank = -1;
+
+        if (h->entry.isDirectory) continue;
+        for (j = numSnaps - 1; j >= 0 && rank < 0; j--) {
+            int k;
+            if (strcmp(snapshots[j].shortId, h->shortId) != 0) continue;
+            for (k = 0; k < snapshots[j].pathCount; k++) {
+                char sanitized[MAX_PATH];
+                SanitizePath(snapshots[j].paths[k], sanitized, MAX_PATH);
+                if (strcmp(sanitized, sanitizedPath) == 0) {
+                    rank = j;
+                    break;
+                }
+            }
+        }
+        if (rank < 0) continue;
+
+        RelDirFromResticPath(h->path, prefixUtf8, relDir, MAX_PATH);
+        strncpy(h->path, relDir, MAX_PATH - 1);
+
+        ranked[numRanked].hit = h;
+        ranked[numRanked].rank = rank;
+        numRanked++;
+    }
+
+    qsort(ranked, numRanked, sizeof(RankedHit), CompareRankedHits);
+
+    results = numRanked > 0
+        ? (ResultFile*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(ResultFile) * numRanked)
+        : NULL;
+    if (results) {
+        for (i = 0; i < numRanked; i++) {
+            const LsSearchHit* h = ranked[i].hit;
+            ResultFile* r;
+            if (count > 0 && SameVersion(h, ranked[i - 1].hit)) continue;
+
+            r = &results[count++];
+            strncpy(r->relDir, h->path, MAX_PATH - 1);
+            r->relDir[MAX_PATH - 1] = '\0';
+            r->entry = h->entry;
+            FormatSearchVersionName(h->entry.name, h->shortId, h->entry.lastWriteTime,
+                                    r->entry.name, MAX_PATH);
+        }
+
+        snprintf(key, MAX_PATH, "%s\\%s", sanitizedPath, folder);
+        StoreResultCache(&g_SearchCache, repo->name, key, results, count);
+    } else if (numRanked > 0 && g_LogProc) {
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Search results do not fit the memory budget ([Memory] BudgetMB)");
+    }
+
+    free(ranked);
+    free(hits);
+    free(snapshots);
+}
+
+/* List [Search], a search folder, or a directory inside a search folder.
+   rest is what follows [Search]: "", "<folder>" or "<folder>\<dir>". */
+static DirEntry* GetSearchContents(RepoConfig* repo, const char* sanitizedPath,
+                                   const char* rest, int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0, capacity = 0;
+    char folder[MAX_PATH], sub[MAX_PATH], key[MAX_PATH];
+    const char* sep;
+    FILETIME ftNow;
+    int subLen, i;
+
+    *outCount = 0;
+    GetSystemTimeAsFileTime(&ftNow);
+
+    if (rest[0] == '\0') {
+        AddEntry(&entries, &count, &capacity, NEW_SEARCH_ENTRY, TRUE, 0, 0, ftNow);
+        for (i = 0; i < g_RecentSearchCount; i++) {
+            if (strcmp(g_RecentSearches[i].repoName, repo->name) == 0)
+                AddEntry(&entries, &count, &capacity, g_RecentSearches[i].folder,
+                         TRUE, 0, 0, ftNow);
+        }
+        *outCount = count;
+        return entries;
+    }
+
+    if (strcmp(rest, NEW_SEARCH_ENTRY) == 0) {
+        /* Like [Add Repository]: prompt, then leave a hint entry */
+        if (PromptNewSearch(repo))
+            AddEntry(&entries, &count, &capacity,
+                     "Search saved - go back to open it", FALSE, 0, 0, ftNow);
+        *outCount = count;
+        return entries;
+    }
+
+    sep = strchr(rest, '\\');
+    if (sep) {
+        snprintf(folder, MAX_PATH, "%.*s", (int)(sep - rest), rest);
+        strncpy(sub, sep + 1, MAX_PATH - 1);
+        sub[MAX_PATH - 1] = '\0';
+    } else {
+        strncpy(folder, rest, MAX_PATH - 1);
+        folder[MAX_PATH - 1] = '\0';
+        sub[0] = '\0';
+    }
+    subLen = (int)strlen(sub);
+    if (subLen > 0 && sub[subLen - 1] == '\\') sub[--subLen] = '\0';
+
+    /* Entering the folder itself runs the search again (newly loaded
+       snapshots are picked up); subfolders reuse the results */
+    snprintf(key, MAX_PATH, "%s\\%s", sanitizedPath, folder);
+    if (sub[0] == '\0' || !ResultCacheMatches(&g_SearchCache, repo->name, key))
+        RunSearch(repo, sanitizedPath, folder);
+
+    return ListResultDir(&g_SearchCache, sub, outCount);
+}
+
+/* Split a versioned result file path into the file path below the backup
+   path and the snapshot that holds it. [Search] paths start with the search
+   folder ("<folder>\<dir>\<version name>"), [Deleted files] paths do not
+   ("<dir>\<version name>"). */
+static BOOL ResolveResultFile(const char* seg3, const char* rest,
+                              char* fileSubpath, char* shortId, int idLen) {
+    const char* rel = rest;
+    const char* lastSep;
+    char name[MAX_PATH];
+
+    if (IsSearchPath(seg3)) {
+        rel = strchr(rest, '\\');
+        if (!rel) return FALSE;
+        rel++;
+    }
+    if (rel[0] == '\0') return FALSE;
+
+    lastSep = strrchr(rel, '\\');
+    if (!ParseSearchVersionName(lastSep ? lastSep + 1 : rel, name, shortId, idLen))
+        return FALSE;
+
+    if (lastSep)
+        snprintf(fileSubpath, MAX_PATH, "%.*s\\%s", (int)(lastSep - rel), rel, name);
+    else
+        snprintf(fileSubpath, MAX_PATH, "%s", name);
+    return TRUE;
+}
+
+/* --- [Deleted files]: cached files missing from the newest snapshot --- */
+
+/* Collect the files of a backup path that the newest snapshot no longer has
+   into g_DeletedCache. The newest snapshot is loaded first if needed; older
+   ones contribute only when cached. */
+static void ComputeDeleted(RepoConfig* repo, const char* sanitizedPath) {
+    char originalPath[MAX_PATH], prefix[MAX_PATH], prefixUtf8[MAX_PATH];
+    ResticSnapshot* snapshots = NULL;
+    const char** ids = NULL;
+    LONGLONG* times = NULL;
+    LsSearchHit* hits = NULL;
+    ResultFile* results = NULL;
+    int numSnaps, numSeries = 0, numHits = 0, i, j;
+
+    FreeResultCache(&g_DeletedCache);
+
+    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) return;
+    numSnaps = FetchSnapshots(repo, &snapshots);
+    if (numSnaps == 0) return;
+
+    ids = (const char**)malloc(sizeof(const char*) * numSnaps);
+    times = (LONGLONG*)malloc(sizeof(LONGLONG) * numSnaps);
+    if (!ids || !times) {
+        free(ids);
+        free(times);
+        free(snapshots);
+        return;
+    }
+
+    /* restic lists snapshots oldest first, which is the order the
+       last-seen fold expects */
+    for (i = 0; i < numSnaps; i++) {
+        for (j = 0; j < snapshots[i].pathCount; j++) {
+            char sanitized[MAX_PATH];
+            SanitizePath(snapshots[i].paths[j], sanitized, MAX_PATH);
+            if (strcmp(sanitized, sanitizedPath) == 0) {
+                FILETIME ft = ParseISOTime(snapshots[i].time);
+                ids[numSeries] = snapshots[i].shortId;
+                times[numSeries] = ((LONGLONG)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+                numSeries++;
+                break;
+            }
+        }
+    }
+
+    if (numSeries > 0 && EnsureSnapshotLoaded(repo, ids[numSeries - 1])) {
+        BuildLsSubpath(originalPath, "", prefix, MAX_PATH);
+        AnsiToUtf8(prefix, prefixUtf8, MAX_PATH);
+        if (strcmp(prefixUtf8, "/") == 0) prefixUtf8[0] = '\0';
+
+        hits = LsCache_DeletedFiles(repo->name, sanitizedPath, prefixUtf8, ids, times,
+                                    numSeries, DELETED_MAX, &numHits);
+        if (numHits >= DELETED_MAX && g_LogProc)
+            g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                      "Warning: [Deleted files] shows only the first files "
+                      "(too many files were deleted).");
+    }
+
+    if (numHits > 0)
+        results = (ResultFile*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(ResultFile) * numHits);
+    if (results) {
+        for (i = 0; i < numHits; i++) {
+            ResultFile* r = &results[i];
+            RelDirFromResticPath(hits[i].path, prefixUtf8, r->relDir, MAX_PATH);
+            r->entry = hits[i].entry;
+            /* Named after the last snapshot that had the file, like a
+               [Search] version, so it resolves the same way */
+            FormatSearchVersionName(hits[i].entry.name, hits[i].shortId,
+                                    hits[i].entry.lastWriteTime, r->entry.name, MAX_PATH);
+        }
+        qsort(results, numHits, sizeof(ResultFile), CompareResultFiles);
+
+        StoreResultCache(&g_DeletedCache, repo->name, sanitizedPath, results, numHits);
+    } else if (numHits > 0 && g_LogProc) {
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Deleted files do not fit the memory budget ([Memory] BudgetMB)");
+    }
+
+    free(hits);
+    free(ids);
+    free(times);
+    free(snapshots);
+}
+
+/* List [Deleted files] or a directory inside it. rest is what follows the
+   folder ("" or "<dir>"). */
+static DirEntry* GetDeletedContents(RepoConfig* repo, const char* sanitizedPath,
+                                    const char* rest, int* outCount) {
+    char sub[MAX_PATH];
+    int subLen;
+
+    strncpy(sub, rest, MAX_PATH - 1);
+    sub[MAX_PATH - 1] = '\0';
+    subLen = (int)strlen(sub);
+    if (subLen > 0 && sub[subLen - 1] == '\\') sub[--subLen] = '\0';
+
+    /* Entering the folder itself refreshes it (new snapshots and newly
+       cached ones are folded in); subfolders reuse the result */
+    if (sub[0] == '\0' || !ResultCacheMatches(&g_DeletedCache, repo->name, sanitizedPath))
+        ComputeDeleted(repo, sanitizedPath);
+
+    return ListResultDir(&g_DeletedCache, sub, outCount);
+}
+
+/* --- [Changes since previous]: diff against the previous snapshot --- */
+
+static const char* g_ChangeTags[] = {
+    CHANGE_TAG_ADDED,       /* LS_DIFF_ADDED */
+    CHANGE_TAG_REMOVED,     /* LS_DIFF_REMOVED */
+    CHANGE_TAG_MODIFIED     /* LS_DIFF_MODIFIED */
+};
+
+/* Check if a snapshot subpath is (inside) the virtual folder at the
+   snapshot root. Sets *after to what follows it ("" for the folder itself). */
+static BOOL IsSnapshotFolderPath(const char* rest, const char* folder, const char** after) {
+    size_t len = strlen(folder);
+    if (strncmp(rest, folder, len) != 0) return FALSE;
+    if (rest[len] != '\0' && rest[len] != '\\') return FALSE;
+    *after = rest[len] ? rest + len + 1 : rest + len;
+    return TRUE;
+}
+
+static BOOL IsChangesPath(const char* rest, const char** after) {
+    return IsSnapshotFolderPath(rest, CHANGES_ENTRY, after);
+}
+
+/* Find the snapshot of the same backup path taken before shortId.
+   Returns FALSE if shortId is the first one. */
+static BOOL FindPreviousSnapshot(RepoConfig* repo, const char* sanitizedPath,
+                                 const char* shortId, char* prevShortId, int maxLen) {
+    ResticSnapshot* snapshots = NULL;
+    int numSnaps, i, j;
+    int prev = -1;
+    BOOL found = FALSE;
+
+    numSnaps = FetchSnapshots(repo, &snapshots);
+
+    /* restic lists snapshots oldest first */
+    for (i = 0; i < numSnaps && !found; i++) {
+        BOOL matches = FALSE;
+        for (j = 0; j < snapshots[i].pathCount; j++) {
+            char sanitized[MAX_PATH];
+            SanitizePath(snapshots[i].paths[j], sanitized, MAX_PATH);
+            if (strcmp(sanitized, sanitizedPath) == 0) {
+                matches = TRUE;
+                break;
+            }
+        }
+        if (!matches) continue;
+        if (strcmp(snapshots[i].shortId, shortId) == 0) found = TRUE;
+        else prev = i;
+    }
+
+    if (found && prev >= 0) {
+        strncpy(prevShortId, snapshots[prev].shortId, maxLen - 1);
+        prevShortId[maxLen - 1] = '\0';
+    }
+    free(snapshots);
+    return found && prev >= 0;
+}
+
+/* "photo.jpg" + " [added]" -> "photo [added].jpg" */
+static void TagChangeName(const char* name, const char* tag, char* out, int maxLen) {
+    const char* dot = strrchr(name, '.');
+    if (dot)
+        snprintf(out, maxLen, "%.*s%s%s", (int)(dot - name), name, tag, dot);
+    else
+        snprintf(out, maxLen, "%s%s", name, tag);
+}
+
+/* Reverse of TagChangeName. Returns the change kind, or -1 if untagged. */
+static int ParseChangeName(const char* display, char* name, int maxLen) {
+    int kind;
+    for (kind = 0; kind < (int)(sizeof(g_ChangeTags) / sizeof(g_ChangeTags[0])); kind++) {
+        const char* tag = strstr(display, g_ChangeTags[kind]);
+        if (tag) {
+            snprintf(name, maxLen, "%.*s%s", (int)(tag - display), display,
+                     tag + strlen(g_ChangeTags[kind]));
+            return kind;
+        }
+    }
+    return -1;
+}
+
+/* Diff two snapshots of a backup path into g_ChangesCache. Snapshots that
+   are not cached yet are ingested first (one "restic ls" each). */
+static void ComputeChanges(RepoConfig* repo, const char* sanitizedPath,
+                           const char* prevShortId, const char* shortId, const char* key) {
+    char originalPath[MAX_PATH], prefix[MAX_PATH], prefixUtf8[MAX_PATH];
+    LsDiffEntry* diffs;
+    ResultFile* results = NULL;
+    int numDiffs = 0, i;
+
+    FreeResultCache(&g_ChangesCache);
+
+    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) return;
+    if (!EnsureSnapshotLoaded(repo, prevShortId) || !EnsureSnapshotLoaded(repo, shortId))
+        return;
+
+    BuildLsSubpath(originalPath, "", prefix, MAX_PATH);
+    AnsiToUtf8(prefix, prefixUtf8, MAX_PATH);
+    if (strcmp(prefixUtf8, "/") == 0) prefixUtf8[0] = '\0';
+
+    diffs = LsCache_Diff(repo->name, prevShortId, shortId, prefixUtf8, CHANGES_MAX, &numDiffs);
+    if (numDiffs >= CHANGES_MAX && g_LogProc)
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Warning: [Changes since previous] shows only the first changes "
+                  "(too many files differ).");
+
+    if (numDiffs > 0)
+        results = (ResultFile*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(ResultFile) * numDiffs);
+    if (results) {
+        for (i = 0; i < numDiffs; i++) {
+            ResultFile* r = &results[i];
+            RelDirFromResticPath(diffs[i].path, prefixUtf8, r->relDir, MAX_PATH);
+            r->entry = diffs[i].entry;
+            TagChangeName(diffs[i].entry.name, g_ChangeTags[diffs[i].kind],
+                          r->entry.name, MAX_PATH);
+        }
+        /* SQLite ordered by '/'-separated path; the tree listing needs
+           CompareRelDir order */
+        qsort(results, numDiffs, sizeof(ResultFile), CompareResultFiles);
+
+        StoreResultCache(&g_ChangesCache, repo->name, key, results, numDiffs);
+    } else if (numDiffs > 0 && g_LogProc) {
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Changes do not fit the memory budget ([Memory] BudgetMB)");
+    }
+
+    free(diffs);
+}
+
+/* List [Changes since previous] of a snapshot or a directory inside it.
+   sub is what follows the folder ("" or "<dir>"). Files are tagged
+   " [added]", " [removed]" or " [modified]" before the extension. */
+static DirEntry* GetChangesContents(RepoConfig* repo, const char* sanitizedPath,
+                                    const char* snapshotDisplayName, const char* sub,
+                                    int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0, capacity = 0;
+    char shortId[16], prevShortId[16];
+    char subDir[MAX_PATH], key[MAX_PATH];
+    int subLen;
+
+    *outCount = 0;
+    if (!ExtractShortId(snapshotDisplayName, shortId, sizeof(shortId))) return NULL;
+
+    if (!FindPreviousSnapshot(repo, sanitizedPath, shortId, prevShortId, sizeof(prevShortId))) {
+        FILETIME ftNow;
+        GetSystemTimeAsFileTime(&ftNow);
+        AddEntry(&entries, &count, &capacity,
+                 "No previous snapshot of this path", FALSE, 0, 0, ftNow);
+        *outCount = count;
+        return entries;
+    }
+
+    strncpy(subDir, sub, MAX_PATH - 1);
+    subDir[MAX_PATH - 1] = '\0';
+    subLen = (int)strlen(subDir);
+    if (subLen > 0 && subDir[subLen - 1] == '\\') subDir[subLen - 1] = '\0';
+
+    /* Snapshots are immutable, so the diff is only recomputed when another
+       snapshot pair is opened (or the budget reclaimer dropped it) */
+    snprintf(key, MAX_PATH, "%s\\%s..%s", sanitizedPath, prevShortId, shortId);
+    if (!ResultCacheMatches(&g_ChangesCache, repo->name, key))
+        ComputeChanges(repo, sanitizedPath, prevShortId, shortId, key);
+
+    return ListResultDir(&g_ChangesCache, subDir, outCount);
+}
+
+/* Split a changes file path "<dir>\<tagged name>" (what follows the
+   [Changes since previous] folder) into the file path below the backup
+   path and the snapshot to read it from: the previous one for removed
+   files, this one otherwise. */
+static BOOL ResolveChangesFile(RepoConfig* repo, const char* sanitizedPath,
+                               const char* snapshotDisplayName, const char* after,
+                               char* fileSubpath, char* shortId, int idLen) {
+    const char* lastSep = strrchr(after, '\\');
+    char name[MAX_PATH];
+    int kind;
+
+    if (after[0] == '\0') return FALSE;
+    kind = ParseChangeName(lastSep ? lastSep + 1 : after, name, MAX_PATH);
+    if (kind < 0) return FALSE;
+
+    if (!ExtractShortId(snapshotDisplayName, shortId, idLen)) return FALSE;
+    if (kind == LS_DIFF_REMOVED) {
+        char current[16];
+        strncpy(current, shortId, sizeof(current) - 1);
+        current[sizeof(current) - 1] = '\0';
+        if (!FindPreviousSnapshot(repo, sanitizedPath, current, shortId, idLen))
+            return FALSE;
+    }
+
+    if (lastSep)
+        snprintf(fileSubpath, MAX_PATH, "%.*s\\%s", (int)(lastSep - after), after, name);
+    else
+        snprintf(fileSubpath, MAX_PATH, "%s", name);
+    return TRUE;
+}
+
+/* --- [Largest files] / [Biggest growth]: size reports of a snapshot --- */
+
+static BOOL IsLargestPath(const char* rest, const char** after) {
+    return IsSnapshotFolderPath(rest, LARGEST_ENTRY, after);
+}
+
+static BOOL IsGrowthPath(const char* rest, const char** after) {
+    return IsSnapshotFolderPath(rest, GROWTH_ENTRY, after);
+}
+
+static BOOL IsReportPath(const char* rest) {
+    const char* after;
+    return IsLargestPath(rest, &after) || IsGrowthPath(rest, &after);
+}
+
+/* "1.2 GB", "350 MB", "12 KB", "512 B" */
+static void FormatByteSize(LONGLONG bytes, char* buf, int bufSize) {
+    if (bytes >= 1024LL * 1024 * 1024)
+        snprintf(buf, bufSize, "%.1f GB", bytes / (1024.0 * 1024 * 1024));
+    else if (bytes >= 1024LL * 1024)
+        snprintf(buf, bufSize, "%.0f MB", bytes / (1024.0 * 1024));
+    else if (bytes >= 1024)
+        snprintf(buf, bufSize, "%.0f KB", bytes / 1024.0);
+    else
+        snprintf(buf, bufSize, "%lld B", (long long)bytes);
+}
+
+/* UTF-8 restic path of the backup path, "" when it is the root */
+static BOOL GetBackupPrefixUtf8(RepoConfig* repo, const char* sanitizedPath, char* prefixUtf8) {
+    char originalPath[MAX_PATH], prefix[MAX_PATH];
+
+    if (!FindOriginalPath(repo, sanitizedPath, originalPath)) return FALSE;
+    BuildLsSubpath(originalPath, "", prefix, MAX_PATH);
+    AnsiToUtf8(prefix, prefixUtf8, MAX_PATH);
+    if (strcmp(prefixUtf8, "/") == 0) prefixUtf8[0] = '\0';
+    return TRUE;
+}
+
+/* Read the largest files of a snapshot into g_LargestCache, loading the
+   snapshot into the cache first if needed */
+static void ComputeLargest(RepoConfig* repo, const char* sanitizedPath,
+                           const char* shortId, const char* key) {
+    char prefixUtf8[MAX_PATH];
+    LsSearchHit* hits;
+    ResultFile* results = NULL;
+    int numHits = 0, i;
+
+    FreeResultCache(&g_LargestCache);
+
+    if (!GetBackupPrefixUtf8(repo, sanitizedPath, prefixUtf8)) return;
+    if (!EnsureSnapshotLoaded(repo, shortId)) return;
+
+    hits = LsCache_LargestFiles(repo->name, shortId, prefixUtf8, LARGEST_MAX, &numHits);
+    if (numHits > 0)
+        results = (ResultFile*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(ResultFile) * numHits);
+    if (results) {
+        for (i = 0; i < numHits; i++) {
+            RelDirFromResticPath(hits[i].path, prefixUtf8, results[i].relDir, MAX_PATH);
+            results[i].entry = hits[i].entry;
+        }
+        qsort(results, numHits, sizeof(ResultFile), CompareResultFiles);
+
+        StoreResultCache(&g_LargestCache, repo->name, key, results, numHits);
+    } else if (numHits > 0 && g_LogProc) {
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Largest files do not fit the memory budget ([Memory] BudgetMB)");
+    }
+
+    free(hits);
+}
+
+/* List [Largest files] of a snapshot or a directory inside it. sub is what
+   follows the folder ("" or "<dir>"). The files keep their real names and
+   directories; TC's branch view (Ctrl+B) shows them as one list. */
+static DirEntry* GetLargestContents(RepoConfig* repo, const char* sanitizedPath,
+                                    const char* snapshotDisplayName, const char* sub,
+                                    int* outCount) {
+    char shortId[16], subDir[MAX_PATH], key[MAX_PATH];
+    int subLen;
+
+    *outCount = 0;
+    if (!ExtractShortId(snapshotDisplayName, shortId, sizeof(shortId))) return NULL;
+
+    strncpy(subDir, sub, MAX_PATH - 1);
+    subDir[MAX_PATH - 1] = '\0';
+    subLen = (int)strlen(subDir);
+    if (subLen > 0 && subDir[subLen - 1] == '\\') subDir[subLen - 1] = '\0';
+
+    snprintf(key, MAX_PATH, "%s\\%s", sanitizedPath, shortId);
+    if (!ResultCacheMatches(&g_LargestCache, repo->name, key))
+        ComputeLargest(repo, sanitizedPath, shortId, key);
+
+    return ListResultDir(&g_LargestCache, subDir, outCount);
+}
+
+/* Read the directories that grew most since the previous snapshot into
+   g_GrowthCache, one labelled entry per directory ("01 +1.2 GB docs_big") */
+static void ComputeGrowth(RepoConfig* repo, const char* sanitizedPath,
+                          const char* prevShortId, const char* shortId, const char* key) {
+    char prefixUtf8[MAX_PATH];
+    LsDirGrowth* dirs;
+    ResultFile* results = NULL;
+    FILETIME ftNow;
+    int numDirs = 0, i, j;
+
+    FreeResultCache(&g_GrowthCache);
+
+    if (!GetBackupPrefixUtf8(repo, sanitizedPath, prefixUtf8)) return;
+    if (!EnsureSnapshotLoaded(repo, prevShortId) || !EnsureSnapshotLoaded(repo, shortId))
+        return;
+
+    dirs = LsCache_DirGrowth(repo->name, prevShortId, shortId, prefixUtf8, GROWTH_MAX, &numDirs);
+    if (numDirs > 0)
+        results = (ResultFile*)Mem_Alloc(MEM_LISTING_CACHE, sizeof(ResultFile) * numDirs);
+    if (results) {
+        GetSystemTimeAsFileTime(&ftNow);
+        for (i = 0; i < numDirs; i++) {
+            ResultFile* r = &results[i];
+            char sizeStr[32], flat[MAX_PATH];
+
+            RelDirFromResticPath(dirs[i].path, prefixUtf8, r->relDir, MAX_PATH);
+
+            /* TC names cannot contain '\', so flatten like SanitizePath */
+            if (r->relDir[0]) {
+                strncpy(flat, r->relDir, MAX_PATH - 1);
+                flat[MAX_PATH - 1] = '\0';
+                for (j = 0; flat[j]; j++) {
+                    if (flat[j] == '\\') flat[j] = '_';
+                }
+            } else {
+                strncpy(flat, GROWTH_ROOT_LABEL, MAX_PATH - 1);
+            }
+            FormatByteSize(dirs[i].growth, sizeStr, sizeof(sizeStr));
+
+            memset(&r->entry, 0, sizeof(r->entry));
+            snprintf(r->entry.name, MAX_PATH, "%02d +%s %s", i + 1, sizeStr, flat);
+            r->entry.isDirectory = TRUE;
+            r->entry.fileSizeLow = (DWORD)(dirs[i].growth & 0xFFFFFFFF);
+            r->entry.fileSizeHigh = (DWORD)(dirs[i].growth >> 32);
+            r->entry.lastWriteTime = ftNow;
+        }
+
+        StoreResultCache(&g_GrowthCache, repo->name, key, results, numDirs);
+    } else if (numDirs > 0 && g_LogProc) {
+        g_LogProc(g_PluginNr, MSGTYPE_IMPORTANTERROR,
+                  "Growth report does not fit the memory budget ([Memory] BudgetMB)");
+    }
+
+    free(dirs);
+}
+
+/* Make sure g_GrowthCache holds the report of this snapshot. Returns FALSE
+   if the snapshot is the first of its backup path. */
+static BOOL EnsureGrowth(RepoConfig* repo, const char* sanitizedPath,
+                         const char* snapshotDisplayName) {
+    char shortId[16], prevShortId[16], key[MAX_PATH];
+
+    if (!ExtractShortId(snapshotDisplayName, shortId, sizeof(shortId))) return FALSE;
+    if (!FindPreviousSnapshot(repo, sanitizedPath, shortId, prevShortId, sizeof(prevShortId)))
+        return FALSE;
+
+    snprintf(key, MAX_PATH, "%s\\%s..%s", sanitizedPath, prevShortId, shortId);
+    if (!ResultCacheMatches(&g_GrowthCache, repo->name, key))
+        ComputeGrowth(repo, sanitizedPath, prevShortId, shortId, key);
+    return TRUE;
+}
+
+/* Map "<label>[\<more>]" inside [Biggest growth] to the snapshot subpath
+   of the labelled directory */
+static BOOL MapGrowthPath(RepoConfig* repo, const char* sanitizedPath,
+                          const char* snapshotDisplayName, const char* after, char* mapped) {
+    const char* sep = strchr(after, '\\');
+    int labelLen = sep ? (int)(sep - after) : (int)strlen(after);
+    const char* more = sep ? sep + 1 : "";
+    BOOL found = FALSE;
+    int i;
+
+    if (labelLen == 0) return FALSE;
+    if (!EnsureGrowth(repo, sanitizedPath, snapshotDisplayName)) return FALSE;
+
+    AcquireSRWLockShared(&g_GrowthCache.lock);
+    for (i = 0; i < g_GrowthCache.count && !found; i++) {
+        const ResultFile* r = &g_GrowthCache.results[i];
+        if ((int)strlen(r->entry.name) != labelLen ||
+            strncmp(r->entry.name, after, labelLen) != 0)
+            continue;
+        if (r->relDir[0] && more[0])
+            snprintf(mapped, MAX_PATH, "%s\\%s", r->relDir, more);
+        else
+            snprintf(mapped, MAX_PATH, "%s", r->relDir[0] ? r->relDir : more);
+        found = TRUE;
+    }
+    ReleaseSRWLockShared(&g_GrowthCache.lock);
+    return found;
+}
+
+/* Map a path inside [Largest files] or [Biggest growth] to the plain
+   snapshot subpath it shows, e.g. "[Largest files]\a\big.iso" -> "a\big.iso" */
+static BOOL MapReportPath(RepoConfig* repo, const char* sanitizedPath,
+                          const char* snapshotDisplayName, const char* rest, char* mapped) {
+    const char* after;
+
+    if (IsLargestPath(rest, &after)) {
+        strncpy(mapped, after, MAX_PATH - 1);
+        mapped[MAX_PATH - 1] = '\0';
+        return TRUE;
+    }
+    if (IsGrowthPath(rest, &after))
+        return MapGrowthPath(repo, sanitizedPath, snapshotDisplayName, after, mapped);
+    return FALSE;
+}
+
+/* List [Biggest growth] of a snapshot, or browse one of its directories
+   (after = "<label>[\<dir>]") as in the snapshot itself */
+static DirEntry* GetGrowthContents(RepoConfig* repo, const char* sanitizedPath,
+                                   const char* snapshotDisplayName, const char* after,
+                                   int* outCount) {
+    DirEntry* entries = NULL;
+    int count = 0, capacity = 0, i;
+    char mapped[MAX_PATH];
+
+    *outCount = 0;
+    if (after[0] != '\0') {
+        if (!MapGrowthPath(repo, sanitizedPath, snapshotDisplayName, after, mapped))
+            return NULL;
+        return GetSnapshotContents(repo, sanitizedPath, snapshotDisplayName, mapped, outCount);
+    }
+
+    if (!EnsureGrowth(repo, sanitizedPath, snapshotDisplayName)) {
+        FILETIME ftNow;
+        GetSystemTimeAsFileTime(&ftNow);
+        AddEntry(&entries, &count, &capacity,
+                 "No previous snapshot of this path", FALSE, 0, 0, ftNow);
+        *outCount = count;
+        return entries;
+    }
+
+    AcquireSRWLockShared(&g_GrowthCache.lock);
+    for (i = 0; i < g_GrowthCache.count; i++) {
+        const DirEntry* e = &g_GrowthCache.results[i].entry;
+        AddEntry(&entries, &count, &capacity, e->name, TRUE,
+                 e->fileSizeLow, e->fileSizeHigh, e->lastWriteTime);
+    }
+    ReleaseSRWLockShared(&g_GrowthCache.lock);
+    *outCount = count;
+    return entries;
+}
+
 /* Returns heap-allocated directory entries for the given path. */
 DirEntry* GetEntriesForPath(const char* path, int* outCount) {
     DirEntry* entries = NULL;
@@ -1242,10 +3212,17 @@ DirEntry* GetEntriesForPath(const char* path, int* outCount) {
         /* If cancelled, return empty → TC shows empty folder / goes back */
     }
     else if (numSegs == 1) {
-        /* Inside a repo: show unique backup paths as folders */
+        /* Inside a repo: show unique backup paths as folders + [Statistics].txt */
         RepoConfig* repo = RepoStore_FindByName(seg1);
         if (repo && RepoStore_EnsurePassword(repo, g_PluginNr, g_RequestProc)) {
+            char stats[STATS_MAX_SIZE];
+            int statsLen;
+
             entries = GetPathEntries(repo, &count);
+            capacity = count;
+            statsLen = FormatStatistics(repo, stats, sizeof(stats));
+            AddEntry(&entries, &count, &capacity, STATS_ENTRY, FALSE,
+                     (DWORD)statsLen, 0, ftNow);
         }
     }
     else if (numSegs == 2) {
@@ -1264,6 +3241,17 @@ DirEntry* GetEntriesForPath(const char* path, int* outCount) {
                 AddEntry(&entries, &count, &capacity,
                          "Snapshot cache cleared - go back to see it", FALSE, 0, 0, ftNow);
             }
+            else if (IsDateBucket(seg3)) {
+                /* ParsePathSegments leaves seg3 a date folder only when
+                   nothing follows it */
+                entries = GetDateBucketContents(repo, seg2, seg3, &count);
+            }
+            else if (IsSearchPath(seg3)) {
+                entries = GetSearchContents(repo, seg2, rest, &count);
+            }
+            else if (IsDeletedPath(seg3)) {
+                entries = GetDeletedContents(repo, seg2, rest, &count);
+            }
             else if (IsAllFilesPath(seg3)) {
                 const char* vComp = FindVersionComponent(rest);
                 if (vComp) {
@@ -1285,8 +3273,25 @@ DirEntry* GetEntriesForPath(const char* path, int* outCount) {
                     entries = GetAllFilesContents(repo, seg2, rest, &count);
                 }
             } else {
-                /* Normal snapshot browsing */
-                entries = GetSnapshotContents(repo, seg2, seg3, rest, &count);
+                const char* changesSub;
+                const char* reportSub;
+                if (IsChangesPath(rest, &changesSub)) {
+                    entries = GetChangesContents(repo, seg2, seg3, changesSub, &count);
+                } else if (IsLargestPath(rest, &reportSub)) {
+                    entries = GetLargestContents(repo, seg2, seg3, reportSub, &count);
+                } else if (IsGrowthPath(rest, &reportSub)) {
+                    entries = GetGrowthContents(repo, seg2, seg3, reportSub, &count);
+                } else {
+                    /* Normal snapshot browsing; the diff and report folders
+                       sit at the root */
+                    entries = GetSnapshotContents(repo, seg2, seg3, rest, &count);
+                    if (rest[0] == '\0') {
+                        capacity = count;
+                        AddEntry(&entries, &count, &capacity, CHANGES_ENTRY, TRUE, 0, 0, ftNow);
+                        AddEntry(&entries, &count, &capacity, LARGEST_ENTRY, TRUE, 0, 0, ftNow);
+                        AddEntry(&entries, &count, &capacity, GROWTH_ENTRY, TRUE, 0, 0, ftNow);
+                    }
+                }
             }
         }
     }
@@ -1295,6 +3300,11 @@ DirEntry* GetEntriesForPath(const char* path, int* outCount) {
     return entries;
 }
 
+void ForgetRepoCaches(const char* repoName) {
+    InvalidateSnapshotCache(repoName);
+    ClearListingCache();
+}
+
 /* Fill WIN32_FIND_DATAA from a DirEntry */
 static void FillFindData(WIN32_FIND_DATAA* fd, const DirEntry* entry) {
     memset(fd, 0, sizeof(WIN32_FIND_DATAA));
@@ -1325,15 +3335,57 @@ int __stdcall FsInit(int PluginNr, tProgressProc pProgressProc,
     /* Load repo configuration */
     RepoStore_Load();
 
-    /* Initialize persistent directory listing cache */
+    /* Opt-in tracing ([Debug] Trace=1 in restic_wfx.ini) */
+    Trace_InitFromConfig(g_RepoStore.configFilePath);
+
+    /* Opt-in record/replay of restic runs ([Debug] Record= / Replay=) */
+    Replay_InitFromConfig(g_RepoStore.configFilePath);
+
+    /* Memory budget ([Memory] BudgetMB=); caches give memory back first */
+    Mem_InitFromConfig(g_RepoStore.configFilePath);
+    Mem_SetReclaimer(ReclaimCacheMemory);
+
+    /* Optional year/month/day folders for snapshots ([Browse] DateFolders=1) */
+    g_DateFolders = GetPrivateProfileIntA("Browse", "DateFolders", 0,
+                                          g_RepoStore.configFilePath) == 1;
+
+    /* Read local repositories in-process instead of running restic
+       ([Native] Enabled=1) */
+    g_NativeRead = GetPrivateProfileIntA("Native", "Enabled", 0,
+                                         g_RepoStore.configFilePath) == 1;
+
+    /* Initialize persistent directory listing cache, optionally with
+       mapped per-snapshot index files ([Cache] IndexFiles=1) */
     LsCache_Init();
+    LsCache_SetIndexFiles(GetPrivateProfileIntA("Cache", "IndexFiles", 0,
+                                                g_RepoStore.configFilePath) == 1);
+
+    /* Ask restic-wfx-cached for listings first ([Service] Enabled=1) */
+    CacheService_InitFromConfig(g_RepoStore.configFilePath);
 
     return 0;
 }
 
 HANDLE __stdcall FsFindFirst(char* Path, WIN32_FIND_DATAA* FindData) {
     int count = 0;
-    DirEntry* entries = GetEntriesForPath(Path, &count);
+    DirEntry* entries = NULL;
+    const char* below;
+    BOOL served = FALSE;
+    TraceSpan span;
+
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "path", Path);
+
+    /* Folders below a repository come from the cache service when it runs;
+       the root, [Add Repository] and the repository folders stay here (their
+       [Statistics].txt is sized from this process's metrics) */
+    below = Path[0] == '\\' ? strchr(Path + 1, '\\') : NULL;
+    if (CacheService_IsEnabled() && below && below[1] != '\0')
+        served = CacheService_List(Path, &entries, &count);
+    if (!served) entries = GetEntriesForPath(Path, &count);
+    Trace_ArgInt(&span, "service", served);
+    Trace_ArgInt(&span, "entries", count);
+    Trace_End(&span, "FsFindFirst");
 
     if (!entries || count == 0) {
         free(entries);
@@ -1432,6 +3484,67 @@ static void BuildBatchTempFilePath(const char* tempDir, const char* resticPath,
         snprintf(outPath, maxLen, "%s\\%s", tempDir, converted);
 }
 
+/* Drop a reference to a batch; the last one deletes its temp dir */
+static void ReleaseBatch(BatchRestore* batch) {
+    if (!batch || InterlockedDecrement(&batch->refs) > 0) return;
+    if (batch->tempDir[0]) DeleteDirectoryRecursive(batch->tempDir);
+    SecureZeroMemory(batch, sizeof(BatchRestore));
+    free(batch);
+}
+
+/* The calling thread's batch with a reference, or NULL outside a
+   multi-file copy */
+static BatchRestore* AcquireBatch(void) {
+    DWORD self = GetCurrentThreadId();
+    BatchRestore* batch = NULL;
+    int i;
+
+    AcquireSRWLockShared(&g_BatchLock);
+    for (i = 0; i < g_BatchCount && !batch; i++) {
+        if (g_Batches[i]->threadId == self) {
+            batch = g_Batches[i];
+            InterlockedIncrement(&batch->refs);
+        }
+    }
+    ReleaseSRWLockShared(&g_BatchLock);
+    return batch;
+}
+
+/* Take a thread's batch out of the table and return the table's
+   reference, or NULL if the thread has none */
+static BatchRestore* RemoveBatch(DWORD threadId) {
+    BatchRestore* batch = NULL;
+    int i;
+
+    AcquireSRWLockExclusive(&g_BatchLock);
+    for (i = 0; i < g_BatchCount && !batch; i++) {
+        if (g_Batches[i]->threadId == threadId) {
+            batch = g_Batches[i];
+            g_Batches[i] = g_Batches[--g_BatchCount];
+        }
+    }
+    ReleaseSRWLockExclusive(&g_BatchLock);
+    return batch;
+}
+
+/* Register a batch for its thread, replacing one left over from a copy
+   whose END never came. Returns FALSE (the batch is released) if too many
+   copies are running. */
+static BOOL AddBatch(BatchRestore* batch) {
+    BatchRestore* stale = RemoveBatch(batch->threadId);
+    BOOL added = FALSE;
+
+    ReleaseBatch(stale);
+    AcquireSRWLockExclusive(&g_BatchLock);
+    if (g_BatchCount < MAX_BATCHES) {
+        g_Batches[g_BatchCount++] = batch;
+        added = TRUE;
+    }
+    ReleaseSRWLockExclusive(&g_BatchLock);
+    if (!added) ReleaseBatch(batch);
+    return added;
+}
+
 /* --- Rewrite helper --- */
 
 /* Resolve a TC RemoteName into repo, original backup path, and restic file path
@@ -1443,6 +3556,7 @@ static BOOL ResolveFileForRewrite(const char* remoteName,
                                    char* outResticFilePath)  /* e.g. "/D/Fotky/Mix/photo.jpg" */
 {
     char seg1[MAX_PATH], seg2[MAX_PATH], seg3[MAX_PATH], rest[MAX_PATH];
+    const char* changesSub;
     int numSegs = ParsePathSegments(remoteName, seg1, seg2, seg3, rest);
     if (numSegs < 3 || rest[0] == '\0') return FALSE;
 
@@ -1453,7 +3567,12 @@ static BOOL ResolveFileForRewrite(const char* remoteName,
     /* Get the original backup path from sanitized seg2 */
     if (!FindOriginalPath(*outRepo, seg2, outOriginalPath)) return FALSE;
 
-    if (IsAllFilesPath(seg3)) {
+    if (IsSearchPath(seg3) || IsDeletedPath(seg3)) {
+        /* [Search] / [Deleted files] result: rest = "[<folder>\]subdir\file - <time> (<id>).txt" */
+        char fileSubpath[MAX_PATH], shortId[16];
+        if (!ResolveResultFile(seg3, rest, fileSubpath, shortId, sizeof(shortId))) return FALSE;
+        BuildLsSubpath(outOriginalPath, fileSubpath, outResticFilePath, MAX_PATH);
+    } else if (IsAllFilesPath(seg3)) {
         /* [All Files] path: rest might be "subdir\file.txt" or "file [show all versions].txt\..." */
         const char* vComp = FindVersionComponent(rest);
         char fileSubpath[MAX_PATH];
@@ -1474,6 +3593,18 @@ static BOOL ResolveFileForRewrite(const char* remoteName,
             fileSubpath[MAX_PATH - 1] = '\0';
         }
 
+        BuildLsSubpath(outOriginalPath, fileSubpath, outResticFilePath, MAX_PATH);
+    } else if (IsChangesPath(rest, &changesSub)) {
+        /* [Changes since previous] file: the tag is not part of the real name */
+        char fileSubpath[MAX_PATH], shortId[16];
+        if (!ResolveChangesFile(*outRepo, seg2, seg3, changesSub, fileSubpath,
+                                shortId, sizeof(shortId)))
+            return FALSE;
+        BuildLsSubpath(outOriginalPath, fileSubpath, outResticFilePath, MAX_PATH);
+    } else if (IsReportPath(rest)) {
+        /* [Largest files] / [Biggest growth]: files of this snapshot */
+        char fileSubpath[MAX_PATH];
+        if (!MapReportPath(*outRepo, seg2, seg3, rest, fileSubpath)) return FALSE;
         BuildLsSubpath(outOriginalPath, fileSubpath, outResticFilePath, MAX_PATH);
     } else {
         /* Snapshot path: seg3 = "2025-01-28 10-30-05 (fb4ed15b)", rest = "subdir\file.txt" */
@@ -1492,7 +3623,8 @@ static BOOL ResolveFileForRewrite(const char* remoteName,
 
 /* Resolved components of a remote file path */
 typedef struct {
-    RepoConfig* repo;
+    RepoConfig config;      /* copy of the repo taken when resolving */
+    RepoConfig* repo;       /* &config */
     char shortId[16];
     char resticPath[MAX_PATH];
 } ResolvedPath;
@@ -1502,17 +3634,37 @@ typedef struct {
 static BOOL ResolveRemotePath(const char* remoteName, ResolvedPath* out) {
     char seg1[MAX_PATH], seg2[MAX_PATH], seg3[MAX_PATH], rest[MAX_PATH];
     char originalPath[MAX_PATH];
+    const char* changesSub;
     int numSegs;
 
     numSegs = ParsePathSegments(remoteName, seg1, seg2, seg3, rest);
     if (numSegs < 3 || rest[0] == '\0') return FALSE;
 
-    out->repo = RepoStore_FindByName(seg1);
-    if (!out->repo) return FALSE;
+    /* A copy may run on a background thread while the UI thread changes the
+       repo's password, so it works on its own copy */
+    if (!RepoStore_Copy(seg1, &out->config)) return FALSE;
+    out->repo = &out->config;
 
     if (!RepoStore_EnsurePassword(out->repo, g_PluginNr, g_RequestProc))
         return FALSE;
 
+    if (IsSearchPath(seg3) || IsDeletedPath(seg3)) {
+        /* [Search] / [Deleted files] result:
+           rest = "[<folder>\]subdir\photo - 2025-01-28 10-30-05 (fb4ed15b).jpg" */
+        char fileSubpath[MAX_PATH];
+        if (!ResolveResultFile(seg3, rest, fileSubpath, out->shortId, sizeof(out->shortId)))
+            return FALSE;
+        if (!FindOriginalPath(out->repo, seg2, originalPath))
+            return FALSE;
+        BuildLsSubpath(originalPath, fileSubpath, out->resticPath, MAX_PATH);
+
+        char utf8Path[MAX_PATH];
+        AnsiToUtf8(out->resticPath, utf8Path, MAX_PATH);
+        strncpy(out->resticPath, utf8Path, MAX_PATH - 1);
+        out->resticPath[MAX_PATH - 1] = '\0';
+        return TRUE;
+    }
+
     if (IsAllFilesPath(seg3)) {
         /* [All Files] path: rest = "subdir\photo [show all versions].jpg\2025-01-28 10-30-05 (fb4ed15b)" */
         char pathBefore[MAX_PATH], vFileName[MAX_PATH], afterV[MAX_PATH];
@@ -1547,13 +3699,34 @@ static BOOL ResolveRemotePath(const char* remoteName, ResolvedPath* out) {
         return TRUE;
     }
 
-    if (!ExtractShortId(seg3, out->shortId, sizeof(out->shortId)))
-        return FALSE;
+    if (IsChangesPath(rest, &changesSub)) {
+        /* [Changes since previous] file: rest = "[Changes since previous]\subdir\photo [added].jpg" */
+        char fileSubpath[MAX_PATH];
+        if (!ResolveChangesFile(out->repo, seg2, seg3, changesSub, fileSubpath,
+                                out->shortId, sizeof(out->shortId)))
+            return FALSE;
+        if (!FindOriginalPath(out->repo, seg2, originalPath))
+            return FALSE;
+        BuildLsSubpath(originalPath, fileSubpath, out->resticPath, MAX_PATH);
+    } else if (IsReportPath(rest)) {
+        /* [Largest files] / [Biggest growth]: rest = "[Largest files]\subdir\big.iso" */
+        char fileSubpath[MAX_PATH];
+        if (!ExtractShortId(seg3, out->shortId, sizeof(out->shortId)))
+            return FALSE;
+        if (!MapReportPath(out->repo, seg2, seg3, rest, fileSubpath))
+            return FALSE;
+        if (!FindOriginalPath(out->repo, seg2, originalPath))
+            return FALSE;
+        BuildLsSubpath(originalPath, fileSubpath, out->resticPath, MAX_PATH);
+    } else {
+        if (!ExtractShortId(seg3, out->shortId, sizeof(out->shortId)))
+            return FALSE;
 
-    if (!FindOriginalPath(out->repo, seg2, originalPath))
-        return FALSE;
+        if (!FindOriginalPath(out->repo, seg2, originalPath))
+            return FALSE;
 
-    BuildLsSubpath(originalPath, rest, out->resticPath, MAX_PATH);
+        BuildLsSubpath(originalPath, rest, out->resticPath, MAX_PATH);
+    }
 
     /* Convert ANSI path to UTF-8 for restic command */
     char utf8Path[MAX_PATH];
@@ -1589,92 +3762,243 @@ static BOOL DumpProgressCallback(LONGLONG bytesWritten, LONGLONG totalSize, void
     return TRUE;
 }
 
-/* --- FsGetFile: copy file from snapshot to local filesystem (F5 in TC) --- */
+/* If remoteName is "\Repo\[Statistics].txt", return that repo, else NULL. */
+static RepoConfig* ResolveStatisticsPath(const char* remoteName) {
+    char seg1[MAX_PATH], seg2[MAX_PATH], seg3[MAX_PATH], rest[MAX_PATH];
+    int numSegs = ParsePathSegments(remoteName, seg1, seg2, seg3, rest);
 
-int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
-                        RemoteInfoStruct* ri) {
-    ResolvedPath resolved;
-    ProgressUserData pud;
-    LONGLONG totalSize = 0;
-    DWORD exitCode;
+    if (numSegs != 2 || strcmp(seg2, STATS_ENTRY) != 0) return NULL;
+    return RepoStore_FindByName(seg1);
+}
+
+/* Render the repo's statistics report into a local file. */
+static BOOL WriteStatisticsFile(RepoConfig* repo, const char* localName) {
+    char stats[STATS_MAX_SIZE];
+    int len = FormatStatistics(repo, stats, sizeof(stats));
+    HANDLE hFile;
+    DWORD written = 0;
     BOOL ok;
 
-    /* Handle README.txt at root */
-    if (strcmp(RemoteName, "\\README.txt") == 0) {
-        char readmePath[MAX_PATH];
-        if (!GetReadmePath(readmePath, MAX_PATH))
-            return FS_FILE_NOTFOUND;
+    hFile = CreateFileA(localName, GENERIC_WRITE, 0, NULL,
+                        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) return FALSE;
+    ok = WriteFile(hFile, stats, (DWORD)len, &written, NULL) && written == (DWORD)len;
+    CloseHandle(hFile);
+    return ok;
+}
 
-        if (!(CopyFlags & FS_COPYFLAGS_OVERWRITE)) {
-            if (GetFileAttributesA(LocalName) != INVALID_FILE_ATTRIBUTES)
-                return FS_FILE_EXISTS;
+/* Folder a batch extracts for a file: the first subdirectory below the
+   batch prefix, or the file itself if it is directly in the prefix dir.
+   prefix = "/d/Martin/Mapy", resticPath = "/d/Martin/Mapy/Gpx/file.gpx"
+   → includePath = "/d/Martin/Mapy/Gpx" */
+static void BuildBatchIncludePath(const BatchRestore* batch, const char* resticPath,
+                                  char* includePath) {
+    size_t prefixLen = strlen(batch->resticPrefix);
+    const char* afterPrefix = resticPath + prefixLen;
+    const char* nextSlash;
+
+    /* Skip leading '/' after prefix */
+    if (*afterPrefix == '/') afterPrefix++;
+
+    /* Find the next '/' — that ends the subfolder name */
+    nextSlash = strchr(afterPrefix, '/');
+    if (nextSlash) {
+        size_t includeLen = nextSlash - resticPath;
+        if (includeLen >= MAX_PATH) includeLen = MAX_PATH - 1;
+        memcpy(includePath, resticPath, includeLen);
+        includePath[includeLen] = '\0';
+    } else {
+        strncpy(includePath, resticPath, MAX_PATH - 1);
+        includePath[MAX_PATH - 1] = '\0';
+    }
+}
+
+/* Create a directory under the batch temp dir, with missing parents */
+static void CreateBatchTempDir(const char* pathUtf8) {
+    WCHAR wPath[MAX_PATH];
+    WCHAR* p;
+
+    if (!MultiByteToWideChar(CP_UTF8, 0, pathUtf8, -1, wPath, MAX_PATH)) return;
+    for (p = wPath + 3; *p; p++) {
+        if (*p != L'\\') continue;
+        *p = L'\0';
+        CreateDirectoryW(wPath, NULL);
+        *p = L'\\';
+    }
+    CreateDirectoryW(wPath, NULL);
+}
+
+/* Files of a folder collected for NativeRepo_ExtractFiles */
+typedef struct {
+    const char* tempDir;          /* the batch's temp dir */
+    const char* scope;            /* restic path of the folder (UTF-8) */
+    NativeExtractItem* items;
+    int count;
+    int capacity;
+    size_t charged;
+    ProgressUserData* pud;
+} BatchPlan;
+
+static BOOL AddBatchNode(void* ctx, const char* parentPathUtf8, const NativeNode* node) {
+    BatchPlan* plan = (BatchPlan*)ctx;
+    NativeExtractItem* item;
+    char pathUtf8[MAX_PATH], tempUtf8[MAX_PATH];
+
+    snprintf(pathUtf8, MAX_PATH, "%s%s/%s", plan->scope,
+             strcmp(parentPathUtf8, "/") == 0 ? "" : parentPathUtf8, node->name);
+    BuildBatchTempFilePath(plan->tempDir, pathUtf8, tempUtf8, MAX_PATH);
+
+    /* The walk visits folders before their contents */
+    if (node->type == NATIVE_NODE_DIR) {
+        CreateBatchTempDir(tempUtf8);
+        return TRUE;
+    }
+    if (node->type != NATIVE_NODE_FILE) return TRUE;
+
+    if (plan->count >= plan->capacity) {
+        int capacity = plan->capacity ? plan->capacity * 2 : 256;
+        size_t extra = (size_t)(capacity - plan->capacity) * sizeof(NativeExtractItem);
+        NativeExtractItem* grown;
+
+        if (!Mem_Charge(MEM_PARSE, extra)) return FALSE;
+        grown = (NativeExtractItem*)realloc(plan->items, (size_t)capacity * sizeof(NativeExtractItem));
+        if (!grown) {
+            Mem_Uncharge(MEM_PARSE, extra);
+            return FALSE;
         }
+        plan->items = grown;
+        plan->capacity = capacity;
+        plan->charged += extra;
+    }
+    item = &plan->items[plan->count];
+    item->pathUtf8 = _strdup(pathUtf8);
+    item->outputPathUtf8 = _strdup(tempUtf8);
+    item->result = 0;
+    if (!item->pathUtf8 || !item->outputPathUtf8) {
+        free((char*)item->pathUtf8);
+        free((char*)item->outputPathUtf8);
+        return FALSE;
+    }
+    plan->count++;
+    return TRUE;
+}
 
-        if (CopyFileA(readmePath, LocalName, FALSE))
-            return FS_FILE_OK;
-        return FS_FILE_READERROR;
+/* Report each file of a native batch as it is finished */
+static BOOL BatchFileDone(void* ctx, int item, LONGLONG written, LONGLONG total) {
+    BatchPlan* plan = (BatchPlan*)ctx;
+    char nameAnsi[MAX_PATH];
+    int percent = total > 0 ? (int)((written * 100) / total) : 100;
+
+    Utf8ToAnsi(plan->items[item].pathUtf8, nameAnsi, MAX_PATH);
+    if (g_ProgressProc(g_PluginNr, nameAnsi, plan->pud->localName, percent)) {
+        plan->pud->aborted = TRUE;
+        return FALSE;
     }
+    return TRUE;
+}
 
-    /* Resume not supported for restic dump */
-    if ((CopyFlags & FS_COPYFLAGS_RESUME) && !(CopyFlags & FS_COPYFLAGS_OVERWRITE))
-        return FS_FILE_NOTSUPPORTED;
+/* Extract a whole folder of the batch's snapshot into the batch temp dir
+   with the native reader, reading each pack once for all its files.
+   Returns FALSE if the user aborted. */
+static BOOL ExtractBatchNative(const BatchRestore* batch, const ResolvedPath* resolved,
+                               const char* scopeUtf8, ProgressUserData* pud) {
+    NativeRepo* handle = GetNativeRepo(resolved->repo);
+    const NativeTree* tree;
+    BatchPlan plan;
+    BYTE rootTree[32], folderTree[32];
+    char scopeTemp[MAX_PATH];
+    int result = -1;
+    int i;
 
-    /* Check if destination exists and overwrite not requested */
-    if (!(CopyFlags & FS_COPYFLAGS_OVERWRITE)) {
-        if (GetFileAttributesA(LocalName) != INVALID_FILE_ATTRIBUTES)
-            return FS_FILE_EXISTS;
+    if (!handle || !NativeRepo_SnapshotTree(handle, resolved->shortId, rootTree) ||
+        NativeRepo_FindDir(handle, rootTree, scopeUtf8, &tree) != 1) {
+        NativeRepo_Close(handle);
+        return TRUE;
     }
+    memcpy(folderTree, tree->id, 32);
+    NativeRepo_ReleaseTree(tree);
+
+    memset(&plan, 0, sizeof(plan));
+    plan.tempDir = batch->tempDir;
+    plan.scope = scopeUtf8;
+    plan.pud = pud;
+    BuildBatchTempFilePath(batch->tempDir, scopeUtf8, scopeTemp, MAX_PATH);
+    CreateBatchTempDir(scopeTemp);
+
+    /* Files that are not extracted here are dumped one by one later */
+    if (NativeRepo_Walk(handle, folderTree, AddBatchNode, &plan) && plan.count > 0)
+        result = NativeRepo_ExtractFiles(handle, rootTree, plan.items, plan.count,
+                                         BatchFileDone, &plan);
+    NativeRepo_Close(handle);
+
+    for (i = 0; i < plan.count; i++) {
+        free((char*)plan.items[i].pathUtf8);
+        free((char*)plan.items[i].outputPathUtf8);
+    }
+    free(plan.items);
+    if (plan.charged) Mem_Uncharge(MEM_PARSE, plan.charged);
+    return result != 0;
+}
 
-    /* Resolve the remote path into repo + snapshot + restic path */
-    if (!ResolveRemotePath(RemoteName, &resolved))
-        return FS_FILE_NOTFOUND;
+/* Write a snapshot file with the native reader, continuing at byte offset.
+   Returns 1 if written, 0 if aborted through progressCb, -1 to use restic. */
+static int DumpFileNative(const ResolvedPath* resolved, const char* localName,
+                          LONGLONG offset, DumpProgressFunc progressCb, void* userData) {
+    NativeRepo* handle = GetNativeRepo(resolved->repo);
+    BYTE rootTree[32];
+    int result = -1;
+
+    if (handle && NativeRepo_SnapshotTree(handle, resolved->shortId, rootTree))
+        result = NativeRepo_ExtractFile(handle, rootTree, resolved->resticPath, localName,
+                                        (ULONGLONG)offset, 0, progressCb, userData);
+    NativeRepo_Close(handle);
+    return result;
+}
 
-    /* Initial progress report */
-    if (g_ProgressProc(g_PluginNr, RemoteName, LocalName, 0))
-        return FS_FILE_USERABORT;
+/* The multi-file copy part of FsGetFile: extract the batch on its first
+   file, then copy files from its temp dir. Returns an FS_FILE_* result, or
+   -1 if the file is not in the batch. */
+static int CopyFromBatch(BatchRestore* batch, const ResolvedPath* resolved,
+                         char* RemoteName, char* LocalName, ProgressUserData* pud) {
+    /* Multi-file copy from a local repository: extract the selected folder
+       natively as a whole, once per folder, instead of running restic
+       restore; TC then asks for its files one by one */
+    if ((batch->pending || batch->nativeScope[0]) && UsesNativeRepo(resolved->repo)) {
+        char includePath[MAX_PATH];
+        size_t scopeLen = strlen(batch->nativeScope);
+
+        batch->pending = FALSE;
+        BuildBatchIncludePath(batch, resolved->resticPath, includePath);
+        if (strcmp(includePath, resolved->resticPath) != 0 &&
+            !(scopeLen && strncmp(resolved->resticPath, batch->nativeScope, scopeLen) == 0 &&
+              resolved->resticPath[scopeLen] == '/')) {
+            strncpy(batch->nativeScope, includePath, MAX_PATH - 1);
+            batch->nativeScope[MAX_PATH - 1] = '\0';
+            if (!ExtractBatchNative(batch, resolved, includePath, pud)) return FS_FILE_USERABORT;
+            batch->active = TRUE;
+        }
+    }
 
     /* Deferred batch restore: on first FsGetFile, derive the --include path
        from the actual file path and run restic restore now */
-    if (g_BatchRestore.pending && !g_BatchRestore.active) {
-        /* Build include path: take the first subdirectory after the prefix.
-           prefix = "/d/Martin/Mapy", resticPath = "/d/Martin/Mapy/Gpx/file.gpx"
-           → includePath = "/d/Martin/Mapy/Gpx" */
+    if (batch->pending && !batch->active) {
         char includePath[MAX_PATH];
-        size_t prefixLen = strlen(g_BatchRestore.resticPrefix);
-        const char* afterPrefix = resolved.resticPath + prefixLen;
-
-        /* Skip leading '/' after prefix */
-        if (*afterPrefix == '/') afterPrefix++;
-
-        /* Find the next '/' — that ends the subfolder name */
-        {
-            const char* nextSlash = strchr(afterPrefix, '/');
-            if (nextSlash) {
-                size_t includeLen = nextSlash - resolved.resticPath;
-                if (includeLen >= MAX_PATH) includeLen = MAX_PATH - 1;
-                memcpy(includePath, resolved.resticPath, includeLen);
-                includePath[includeLen] = '\0';
-            } else {
-                /* File is directly in the prefix dir — use the full file path */
-                strncpy(includePath, resolved.resticPath, MAX_PATH - 1);
-                includePath[MAX_PATH - 1] = '\0';
-            }
-        }
 
-        g_BatchRestore.pending = FALSE;
+        BuildBatchIncludePath(batch, resolved->resticPath, includePath);
+        batch->pending = FALSE;
 
         {
-            BOOL restoreOk = RunResticRestore(g_BatchRestore.repoPath,
-                                 g_BatchRestore.password,
-                                 g_BatchRestore.shortId, g_BatchRestore.snapshotPath,
-                                 includePath, g_BatchRestore.tempDir,
+            BOOL restoreOk = RunResticRestore(batch->repoPath,
+                                 batch->password,
+                                 batch->shortId, batch->snapshotPath,
+                                 includePath, batch->tempDir,
                                  NULL);  /* exitCode unused - partial success OK */
 
             if (restoreOk) {
                 /* Activate batch even with non-zero exit code (partial success).
                    Symlinks/device nodes may fail on Windows but regular files
                    are restored. Missing files will fall through to per-file dump. */
-                g_BatchRestore.active = TRUE;
+                batch->active = TRUE;
             }
             /* If process didn't run at all, fall through to per-file dump */
         }
@@ -1683,12 +4007,12 @@ int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
     /* Check if batch restore has this file pre-extracted.
        Use wide APIs because restic creates Unicode filenames and
        the temp path is built from UTF-8 resticPath. */
-    if (g_BatchRestore.active) {
+    if (batch->active) {
         char tempFileUtf8[MAX_PATH];
         WCHAR wTempFile[MAX_PATH];
         WCHAR wLocalName[MAX_PATH];
 
-        BuildBatchTempFilePath(g_BatchRestore.tempDir, resolved.resticPath,
+        BuildBatchTempFilePath(batch->tempDir, resolved->resticPath,
                                tempFileUtf8, MAX_PATH);
 
         /* Convert UTF-8 temp path to wide */
@@ -1705,11 +4029,75 @@ int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
         /* Fall through to per-file dump if temp file missing */
     }
 
-    /* Get total size for progress reporting */
-    if (ri) {
-        totalSize = ((LONGLONG)ri->SizeHigh << 32) | ri->SizeLow;
+    return -1;
+}
+
+/* --- FsGetFile: copy file from snapshot to local filesystem (F5 in TC) --- */
+
+static int GetFileImpl(char* RemoteName, char* LocalName, int CopyFlags,
+                       RemoteInfoStruct* ri) {
+    ResolvedPath resolved;
+    ProgressUserData pud;
+    LONGLONG totalSize = 0;
+    LONGLONG resumeOffset = 0;
+    DWORD exitCode;
+    BatchRestore* batch;
+    BOOL ok, resume;
+    int native, copied;
+
+    /* Handle README.txt at root */
+    if (strcmp(RemoteName, "\\README.txt") == 0) {
+        char readmePath[MAX_PATH];
+        if (!GetReadmePath(readmePath, MAX_PATH))
+            return FS_FILE_NOTFOUND;
+
+        if (!(CopyFlags & FS_COPYFLAGS_OVERWRITE)) {
+            if (GetFileAttributesA(LocalName) != INVALID_FILE_ATTRIBUTES)
+                return FS_FILE_EXISTS;
+        }
+
+        if (CopyFileA(readmePath, LocalName, FALSE))
+            return FS_FILE_OK;
+        return FS_FILE_READERROR;
+    }
+
+    /* Handle [Statistics].txt at a repo root */
+    {
+        RepoConfig* statsRepo = ResolveStatisticsPath(RemoteName);
+        if (statsRepo) {
+            if (!(CopyFlags & FS_COPYFLAGS_OVERWRITE)) {
+                if (GetFileAttributesA(LocalName) != INVALID_FILE_ATTRIBUTES)
+                    return FS_FILE_EXISTS;
+            }
+            return WriteStatisticsFile(statsRepo, LocalName) ? FS_FILE_OK : FS_FILE_WRITEERROR;
+        }
+    }
+
+    resume = (CopyFlags & FS_COPYFLAGS_RESUME) && !(CopyFlags & FS_COPYFLAGS_OVERWRITE);
+
+    /* Check if destination exists and overwrite not requested */
+    if (!resume && !(CopyFlags & FS_COPYFLAGS_OVERWRITE)) {
+        if (GetFileAttributesA(LocalName) != INVALID_FILE_ATTRIBUTES)
+            return FS_FILE_EXISTS;
+    }
+
+    /* Resolve the remote path into repo + snapshot + restic path */
+    if (!ResolveRemotePath(RemoteName, &resolved))
+        return FS_FILE_NOTFOUND;
+
+    /* Only the native reader can start in the middle of a file; restic
+       dump always writes it from the beginning */
+    if (resume) {
+        WIN32_FILE_ATTRIBUTE_DATA fad;
+        if (!UsesNativeRepo(resolved.repo)) return FS_FILE_NOTSUPPORTED;
+        if (GetFileAttributesExA(LocalName, GetFileExInfoStandard, &fad))
+            resumeOffset = ((LONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
     }
 
+    /* Initial progress report */
+    if (g_ProgressProc(g_PluginNr, RemoteName, LocalName, 0))
+        return FS_FILE_USERABORT;
+
     /* Set up progress user data */
     strncpy(pud.remoteName, RemoteName, MAX_PATH - 1);
     pud.remoteName[MAX_PATH - 1] = '\0';
@@ -1717,6 +4105,37 @@ int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
     pud.localName[MAX_PATH - 1] = '\0';
     pud.aborted = FALSE;
 
+    /* A resumed file is continued in place by the native reader */
+    if (resume) {
+        native = DumpFileNative(&resolved, LocalName, resumeOffset, DumpProgressCallback, &pud);
+        if (native == 1) {
+            g_ProgressProc(g_PluginNr, RemoteName, LocalName, 100);
+            return FS_FILE_OK;
+        }
+        return native == 0 ? FS_FILE_USERABORT : FS_FILE_READERROR;
+    }
+
+    /* Copy from the batch's temp dir when this is part of a multi-file copy */
+    batch = AcquireBatch();
+    if (batch) {
+        copied = CopyFromBatch(batch, &resolved, RemoteName, LocalName, &pud);
+        ReleaseBatch(batch);
+        if (copied >= 0) return copied;
+    }
+
+    /* Local repositories: assemble the file from its blobs in-process */
+    native = DumpFileNative(&resolved, LocalName, 0, DumpProgressCallback, &pud);
+    if (native == 1) {
+        g_ProgressProc(g_PluginNr, RemoteName, LocalName, 100);
+        return FS_FILE_OK;
+    }
+    if (native == 0) return FS_FILE_USERABORT;
+
+    /* Get total size for progress reporting */
+    if (ri) {
+        totalSize = ((LONGLONG)ri->SizeHigh << 32) | ri->SizeLow;
+    }
+
     /* Run restic dump, streaming to local file */
     ok = RunResticDump(resolved.repo->path, resolved.repo->password,
                        resolved.shortId, resolved.resticPath,
@@ -1734,9 +4153,22 @@ int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
     return FS_FILE_OK;
 }
 
+int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
+                        RemoteInfoStruct* ri) {
+    TraceSpan span;
+    int result;
+
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "path", RemoteName);
+    result = GetFileImpl(RemoteName, LocalName, CopyFlags, ri);
+    Trace_ArgInt(&span, "result", result);
+    Trace_End(&span, "FsGetFile");
+    return result;
+}
+
 /* --- FsExecuteFile: open/view file from snapshot (Enter/double-click in TC) --- */
 
-int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
+static int ExecuteFileImpl(HWND MainWin, char* RemoteName, char* Verb) {
     ResolvedPath resolved;
     char tempDir[MAX_PATH];
     char tempFile[MAX_PATH];
@@ -1754,6 +4186,25 @@ int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
         return FS_EXEC_YOURSELF;
     }
 
+    /* Handle [Statistics].txt - write a fresh report to temp and open it */
+    {
+        RepoConfig* statsRepo = ResolveStatisticsPath(RemoteName);
+        if (statsRepo) {
+            if (strcmp(Verb, "open") != 0) return FS_EXEC_YOURSELF;
+
+            GetTempPathA(MAX_PATH, tempDir);
+            PathAppendA(tempDir, "restic_wfx");
+            CreateDirectoryA(tempDir, NULL);
+            snprintf(tempFile, MAX_PATH, "%s\\%s_statistics.txt", tempDir, statsRepo->name);
+
+            if (!WriteStatisticsFile(statsRepo, tempFile)) return FS_EXEC_ERROR;
+            if ((INT_PTR)ShellExecuteA(MainWin, "open", tempFile,
+                                        NULL, NULL, SW_SHOWNORMAL) <= 32)
+                return FS_EXEC_ERROR;
+            return FS_EXEC_OK;
+        }
+    }
+
     if (strcmp(Verb, "properties") == 0) {
         /* Rewrite: remove file from all snapshots in this backup path */
         char originalPath[MAX_PATH], resticFilePath[MAX_PATH];
@@ -1811,9 +4262,10 @@ int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
 
                 /* Remove all in-memory cache entries matching this parent path */
                 i = 0;
+                AcquireSRWLockExclusive(&g_ListingLock);
                 while (i < g_LsCacheCount) {
                     if (strcmp(g_LsCache[i].path, parentPath) == 0) {
-                        free(g_LsCache[i].entries);
+                        Mem_Free(g_LsCache[i].entries);
                         g_LsCacheCount--;
                         if (i < g_LsCacheCount) {
                             memmove(&g_LsCache[i], &g_LsCache[i + 1],
@@ -1823,6 +4275,7 @@ int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
                         i++;
                     }
                 }
+                ReleaseSRWLockExclusive(&g_ListingLock);
             }
         }
 
@@ -1890,7 +4343,8 @@ int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
     snprintf(tempFile, MAX_PATH, "%s\\%s_%s", tempDir, resolved.shortId, fileName);
 
     /* Skip extraction if temp file already exists (cache hit) */
-    if (GetFileAttributesA(tempFile) == INVALID_FILE_ATTRIBUTES) {
+    if (GetFileAttributesA(tempFile) == INVALID_FILE_ATTRIBUTES &&
+        DumpFileNative(&resolved, tempFile, 0, NULL, NULL) != 1) {
         ok = RunResticDump(resolved.repo->path, resolved.repo->password,
                            resolved.shortId, resolved.resticPath,
                            tempFile, 0, NULL, NULL, &exitCode);
@@ -1906,6 +4360,19 @@ int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
     return FS_EXEC_OK;
 }
 
+int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb) {
+    TraceSpan span;
+    int result;
+
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "path", RemoteName);
+    Trace_ArgStr(&span, "verb", Verb);
+    result = ExecuteFileImpl(MainWin, RemoteName, Verb);
+    Trace_ArgInt(&span, "result", result);
+    Trace_End(&span, "FsExecuteFile");
+    return result;
+}
+
 /* --- FsDisconnect: cleanup on plugin disconnect --- */
 
 /* Delete all files in %TEMP%\restic_wfx\ and remove the directory. */
@@ -1937,35 +4404,53 @@ static void DeleteTempDir(void) {
 int __stdcall FsDisconnect(char* DisconnectRoot) {
     int i;
 
-    /* Clean up any active batch restore */
-    if (g_BatchRestore.active) {
-        DeleteDirectoryRecursive(g_BatchRestore.tempDir);
-        memset(&g_BatchRestore, 0, sizeof(g_BatchRestore));
+    /* Drop the batches; one still copying keeps its temp dir until its
+       current file is done */
+    AcquireSRWLockExclusive(&g_BatchLock);
+    while (g_BatchCount > 0) {
+        BatchRestore* batch = g_Batches[--g_BatchCount];
+        ReleaseSRWLockExclusive(&g_BatchLock);
+        ReleaseBatch(batch);
+        AcquireSRWLockExclusive(&g_BatchLock);
     }
+    ReleaseSRWLockExclusive(&g_BatchLock);
 
     /* Free snapshot cache */
+    AcquireSRWLockExclusive(&g_SnapLock);
     for (i = 0; i < g_SnapCacheCount; i++) {
-        free(g_SnapCache[i].snapshots);
+        Mem_Free(g_SnapCache[i].snapshots);
         g_SnapCache[i].snapshots = NULL;
     }
     g_SnapCacheCount = 0;
+    for (i = 0; i < TIME_INDEX_MAX; i++) {
+        ReleaseTimeIndex(g_TimeIndex[i]);
+        g_TimeIndex[i] = NULL;
+    }
+    ReleaseSRWLockExclusive(&g_SnapLock);
 
     /* Free directory listing cache */
-    for (i = 0; i < g_LsCacheCount; i++) {
-        free(g_LsCache[i].entries);
-        g_LsCache[i].entries = NULL;
-    }
-    g_LsCacheCount = 0;
+    ClearListingCache();
+
+    /* Free the result trees */
+    FreeResultCache(&g_SearchCache);
+    FreeResultCache(&g_ChangesCache);
+    FreeResultCache(&g_DeletedCache);
+    FreeResultCache(&g_LargestCache);
+    FreeResultCache(&g_GrowthCache);
+
+    /* Drop the master keys of natively opened repositories */
+    CloseNativeRepo(NULL);
 
     /* Zero all passwords */
-    for (i = 0; i < g_RepoStore.count; i++) {
-        SecureZeroMemory(g_RepoStore.repos[i].password, MAX_REPO_PASS);
-        g_RepoStore.repos[i].hasPassword = FALSE;
-    }
+    for (i = 0; i < g_RepoStore.count; i++)
+        RepoStore_ForgetPassword(&g_RepoStore.repos[i]);
 
     /* Shut down persistent directory listing cache */
     LsCache_Shutdown();
 
+    /* Stop the restic_commands.log writer and write out its buffered lines */
+    CommandLog_Shutdown();
+
     /* Delete temp files */
     DeleteTempDir();
 
@@ -1987,17 +4472,26 @@ void __stdcall FsStatusInfo(char* RemoteName, int InfoStartEnd, int InfoOperatio
             char restoreSub[MAX_PATH];
             char originalPathUtf8[MAX_PATH];
             int numSegs;
-            RepoConfig* repo;
+            RepoConfig config;
+            RepoConfig* repo = &config;
+            BatchRestore* batch;
             char shortId[16];
 
             numSegs = ParsePathSegments(RemoteName, seg1, seg2, seg3, rest);
             if (numSegs < 3) return;
 
-            /* Skip [All Files] paths — files come from different snapshots */
-            if (IsAllFilesPath(seg3)) return;
+            /* Skip [All Files], [Search], [Deleted files] and [Changes since
+               previous] paths — files come from different snapshots — and
+               the size reports, whose paths do not match the snapshot's */
+            if (IsAllFilesPath(seg3) || IsSearchPath(seg3) || IsDeletedPath(seg3)) return;
+            {
+                const char* changesSub;
+                if (IsChangesPath(rest, &changesSub) || IsReportPath(rest)) return;
+            }
 
-            repo = RepoStore_FindByName(seg1);
-            if (!repo) return;
+            /* This runs on TC's copy thread for a background copy, while
+               the UI thread may change the repo's password */
+            if (!RepoStore_Copy(seg1, &config)) return;
             if (!RepoStore_EnsurePassword(repo, g_PluginNr, g_RequestProc)) return;
 
             if (!ExtractShortId(seg3, shortId, sizeof(shortId))) return;
@@ -2027,27 +4521,32 @@ void __stdcall FsStatusInfo(char* RemoteName, int InfoStartEnd, int InfoOperatio
             /* Defer actual restore to first FsGetFile — we don't know
                the selected subfolder yet (TC only gives us the parent dir).
                Store everything needed so FsGetFile can run the restore. */
-            g_BatchRestore.pending = TRUE;
-            g_BatchRestore.active = FALSE;
-            strncpy(g_BatchRestore.tempDir, restoreSub, MAX_PATH - 1);
-            g_BatchRestore.tempDir[MAX_PATH - 1] = '\0';
-            strncpy(g_BatchRestore.resticPrefix, resticPrefixUtf8, MAX_PATH - 1);
-            g_BatchRestore.resticPrefix[MAX_PATH - 1] = '\0';
-            strncpy(g_BatchRestore.repoPath, repo->path, sizeof(g_BatchRestore.repoPath) - 1);
-            g_BatchRestore.repoPath[sizeof(g_BatchRestore.repoPath) - 1] = '\0';
-            strncpy(g_BatchRestore.password, repo->password, sizeof(g_BatchRestore.password) - 1);
-            g_BatchRestore.password[sizeof(g_BatchRestore.password) - 1] = '\0';
-            strncpy(g_BatchRestore.snapshotPath, originalPathUtf8, MAX_PATH - 1);
-            g_BatchRestore.snapshotPath[MAX_PATH - 1] = '\0';
-            strncpy(g_BatchRestore.shortId, shortId, sizeof(g_BatchRestore.shortId) - 1);
-            g_BatchRestore.shortId[sizeof(g_BatchRestore.shortId) - 1] = '\0';
+            batch = (BatchRestore*)calloc(1, sizeof(BatchRestore));
+            if (!batch) {
+                RemoveDirectoryA(restoreSub);
+                return;
+            }
+            batch->refs = 1;
+            batch->threadId = GetCurrentThreadId();
+            batch->pending = TRUE;
+            strncpy(batch->tempDir, restoreSub, MAX_PATH - 1);
+            strncpy(batch->resticPrefix, resticPrefixUtf8, MAX_PATH - 1);
+            strncpy(batch->repoPath, repo->path, sizeof(batch->repoPath) - 1);
+            strncpy(batch->password, repo->password, sizeof(batch->password) - 1);
+            strncpy(batch->snapshotPath, originalPathUtf8, MAX_PATH - 1);
+            strncpy(batch->shortId, shortId, sizeof(batch->shortId) - 1);
+            AddBatch(batch);
         }
         else if (InfoStartEnd == FS_STATUS_END) {
-            if (g_BatchRestore.active || g_BatchRestore.pending) {
-                if (g_BatchRestore.tempDir[0])
-                    DeleteDirectoryRecursive(g_BatchRestore.tempDir);
-                SecureZeroMemory(g_BatchRestore.password, sizeof(g_BatchRestore.password));
-                memset(&g_BatchRestore, 0, sizeof(g_BatchRestore));
+            /* A file still being copied keeps the temp dir until it is done */
+            ReleaseBatch(RemoveBatch(GetCurrentThreadId()));
+
+            /* TC runs this operation on a thread of its own, which ends
+               with it; its SQLite connections and trace ring are not
+               needed any more */
+            if (InfoOperation == FS_STATUS_OP_GET_MULTI_THREAD) {
+                LsCache_ReleaseThread();
+                Trace_ReleaseThread();
             }
         }
     }
@@ -2055,22 +4554,103 @@ void __stdcall FsStatusInfo(char* RemoteName, int InfoStartEnd, int InfoOperatio
 
 /* --- Content plugin functions: custom columns for cache status --- */
 
+/* Per-repository metric columns (shown on the repository folders at the root) */
+static const struct {
+    const char* name;
+    int type;
+} g_MetricFields[] = {
+    { "Cache Status",            ft_string },     /* field 0: per-snapshot, see below */
+    { "Listing Cache Hit %",     ft_numeric_32 },
+    { "Snapshot List Hit %",     ft_numeric_32 },
+    { "Restic Calls",            ft_numeric_32 },
+    { "Restic Bytes",            ft_numeric_64 },
+    { "Ingest Rows/s",           ft_numeric_64 },
+};
+#define METRIC_FIELD_COUNT ((int)(sizeof(g_MetricFields) / sizeof(g_MetricFields[0])))
+
 int __stdcall FsContentGetSupportedField(int FieldIndex, char* FieldName,
                                           char* Units, int maxlen) {
-    if (FieldIndex == 0) {
-        strncpy(FieldName, "Cache Status", maxlen - 1);
+    if (FieldIndex >= 0 && FieldIndex < METRIC_FIELD_COUNT) {
+        strncpy(FieldName, g_MetricFields[FieldIndex].name, maxlen - 1);
         FieldName[maxlen - 1] = '\0';
         Units[0] = '\0';
-        return ft_string;
+        return g_MetricFields[FieldIndex].type;
     }
     return ft_nomorefields;
 }
 
-int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
-                                 void* FieldValue, int maxlen, int flags) {
+/* Value of a metric column (FieldIndex >= 1) for a repository folder "\Repo". */
+static int GetRepoMetricValue(const char* FileName, int FieldIndex, void* FieldValue) {
+    char seg1[MAX_PATH], seg2[MAX_PATH], seg3[MAX_PATH], rest[MAX_PATH];
+    RepoConfig* repo;
+    RepoMetrics m;
+    LONGLONG value = 0;
+    int i;
+
+    if (ParsePathSegments(FileName, seg1, seg2, seg3, rest) != 1) return ft_fieldempty;
+    repo = RepoStore_FindByName(seg1);
+    if (!repo || !Metrics_Get(repo->path, &m)) return ft_fieldempty;
+
+    switch (FieldIndex) {
+        case 1: {
+            /* Every listing request checks the in-memory cache first */
+            LONGLONG requests = m.counters[MC_MEM_HIT] + m.counters[MC_MEM_MISS];
+            if (requests == 0) return ft_fieldempty;
+            value = (m.counters[MC_MEM_HIT] + m.counters[MC_SQLITE_HIT]) * 100 / requests;
+            break;
+        }
+        case 2:
+            value = Metrics_HitRate(&m, MC_SNAPLIST_HIT, MC_SNAPLIST_MISS);
+            if (value < 0) return ft_fieldempty;
+            break;
+        case 3:
+            for (i = 0; i < RC_COUNT; i++) value += m.spawns[i];
+            break;
+        case 4:
+            value = m.counters[MC_PIPE_BYTES];
+            break;
+        case 5:
+            if (m.ingestRowsPerSec.count == 0) return ft_fieldempty;
+            value = m.ingestRowsPerSec.sum / m.ingestRowsPerSec.count;
+            break;
+        default:
+            return ft_nosuchfield;
+    }
+
+    if (g_MetricFields[FieldIndex].type == ft_numeric_32)
+        *(int*)FieldValue = (int)value;
+    else
+        *(LONGLONG*)FieldValue = value;
+    return g_MetricFields[FieldIndex].type;
+}
+
+/* Describe a snapshot's load cost, e.g. "12.4 s, 1.8M entries" */
+static void FormatSnapshotCost(const SnapshotStats* stats, char* buf, int bufSize) {
+    LONGLONG totalMs = stats->resticMs + stats->parseMs + stats->sqliteMs;
+    char timeStr[24], countStr[24];
+
+    if (totalMs < 1000)
+        snprintf(timeStr, sizeof(timeStr), "%lld ms", (long long)totalMs);
+    else
+        snprintf(timeStr, sizeof(timeStr), "%.1f s", totalMs / 1000.0);
+
+    if (stats->entryCount >= 1000000)
+        snprintf(countStr, sizeof(countStr), "%.1fM", stats->entryCount / 1000000.0);
+    else if (stats->entryCount >= 1000)
+        snprintf(countStr, sizeof(countStr), "%.1fK", stats->entryCount / 1000.0);
+    else
+        snprintf(countStr, sizeof(countStr), "%lld", (long long)stats->entryCount);
+
+    snprintf(buf, bufSize, "%s, %s entries", timeStr, countStr);
+}
+
+static int ContentGetValueImpl(char* FileName, int FieldIndex,
+                               void* FieldValue, int maxlen) {
     char seg1[MAX_PATH], seg2[MAX_PATH], seg3[MAX_PATH], rest[MAX_PATH];
     int numSegs;
 
+    if (FieldIndex >= 1 && FieldIndex < METRIC_FIELD_COUNT)
+        return GetRepoMetricValue(FileName, FieldIndex, FieldValue);
     if (FieldIndex != 0) return ft_nosuchfield;
 
     numSegs = ParsePathSegments(FileName, seg1, seg2, seg3, rest);
@@ -2078,8 +4658,8 @@ int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
     /* Only show cache status for depth-3 entries (snapshot listing level) */
     if (numSegs != 3 || rest[0] != '\0') return ft_fieldempty;
 
-    if (IsAllFilesPath(seg3)) {
-        /* [All Files] — count cached vs total matching snapshots */
+    if (IsAllFilesPath(seg3) || IsSearchPath(seg3) || IsDeletedPath(seg3)) {
+        /* [All Files], [Search], [Deleted files] — count cached vs total matching snapshots */
         RepoConfig* repo = RepoStore_FindByName(seg1);
         ResticSnapshot* snapshots = NULL;
         int numSnaps, i, j, matchingCount = 0, cachedCount = 0;
@@ -2107,11 +4687,24 @@ int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
         return ft_string;
     }
 
-    /* Regular snapshot entry — check if cached */
+    /* Regular snapshot entry — check if cached, and what loading it cost.
+       A snapshot whose cache was invalidated still shows its last load cost
+       as an estimate. */
     {
         char shortId[16];
         if (ExtractShortId(seg3, shortId, sizeof(shortId))) {
-            if (LsCache_IsSnapshotLoaded(seg1, shortId)) {
+            SnapshotStats stats;
+            BOOL loaded = LsCache_IsSnapshotLoaded(seg1, shortId);
+            BOOL haveStats = LsCache_GetSnapshotStats(seg1, shortId, &stats);
+            char cost[64];
+
+            if (haveStats) {
+                FormatSnapshotCost(&stats, cost, sizeof(cost));
+                snprintf((char*)FieldValue, maxlen, "%s %s",
+                         loaded ? "cached," : "not cached, est.", cost);
+                return ft_string;
+            }
+            if (loaded) {
                 strncpy((char*)FieldValue, "cached", maxlen - 1);
                 ((char*)FieldValue)[maxlen - 1] = '\0';
                 return ft_string;
@@ -2122,6 +4715,19 @@ int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
     return ft_fieldempty;
 }
 
+int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
+                                 void* FieldValue, int maxlen, int flags) {
+    TraceSpan span;
+    int result;
+
+    Trace_Begin(&span);
+    Trace_ArgStr(&span, "path", FileName);
+    result = ContentGetValueImpl(FileName, FieldIndex, FieldValue, maxlen);
+    Trace_ArgInt(&span, "result", result);
+    Trace_End(&span, "FsContentGetValue");
+    return result;
+}
+
 int __stdcall FsContentGetDefaultSortOrder(int FieldIndex) {
     return 1; /* ascending */
 }
@@ -8,6 +8,7 @@
 #define WFX_INTERFACE_H
 
 #include "fsplugin.h"
+#include "json_parse.h"
 
 /* A single entry in a directory listing */
 typedef struct {
@@ -32,4 +33,34 @@ typedef struct {
    Sets *outCount to the number of entries. Returns NULL if none. */
 DirEntry* GetEntriesForPath(const char* path, int* outCount);
 
+/* Drop a repository's snapshot list and the in-memory listings, after its
+   snapshots changed in another process (the SQLite cache is shared). */
+void ForgetRepoCaches(const char* repoName);
+
+/* Group a full `restic ls` listing by parent directory and store every group
+   (plus sentinels for empty directories) in the persistent cache.
+   Sorts allEntries in place. Returns the children of requestedPathUtf8 via
+   *outDirectChildren (caller must free). */
+void BulkCacheSubdirectories(const char* repoName, const char* shortId,
+                             const char* requestedPathUtf8,
+                             ResticLsEntry* allEntries, int allCount,
+                             DirEntry** outDirectChildren, int* outDirectCount);
+
+/* Exported WFX entry points (see restic_wfx.def). Declared here so hosts that
+   link the plugin core directly (benchmarks) can drive them without the DLL. */
+int __stdcall FsInit(int PluginNr, tProgressProc pProgressProc,
+                     tLogProc pLogProc, tRequestProc pRequestProc);
+HANDLE __stdcall FsFindFirst(char* Path, WIN32_FIND_DATAA* FindData);
+BOOL __stdcall FsFindNext(HANDLE Hdl, WIN32_FIND_DATAA* FindData);
+int __stdcall FsFindClose(HANDLE Hdl);
+int __stdcall FsGetFile(char* RemoteName, char* LocalName, int CopyFlags,
+                        RemoteInfoStruct* ri);
+int __stdcall FsExecuteFile(HWND MainWin, char* RemoteName, char* Verb);
+int __stdcall FsDisconnect(char* DisconnectRoot);
+void __stdcall FsStatusInfo(char* RemoteName, int InfoStartEnd, int InfoOperation);
+int __stdcall FsContentGetSupportedField(int FieldIndex, char* FieldName,
+                                          char* Units, int maxlen);
+int __stdcall FsContentGetValue(char* FileName, int FieldIndex, int UnitIndex,
+                                 void* FieldValue, int maxlen, int flags);
+
 #endif /* WFX_INTERFACE_H */
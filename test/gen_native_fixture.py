@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+#
+# restic-wfx - Total Commander plugin for browsing restic backup repositories
+# Copyright (c) 2026 Martin Široký
+# SPDX-License-Identifier: MIT
+#
+# Writes the small restic repositories that test/native_test.c reads with
+# the native reader (src/native_format.c, src/native_repo.c). The output is deterministic: keys, IVs
+# and the scrypt salt come from a seeded generator, so regenerating only
+# changes the files if this script or the zstd version changes.
+#
+# Needs the openssl and zstd command line tools (AES and compression).
+#
+# Usage: gen_native_fixture.py [--version 1|2] [OUTDIR]
+#        (default version 2, OUTDIR test/fixtures/native_v<version>)
+#
+# Repository (password "native-test"):
+#   2 snapshots of the same tree, paths ["C:\data"]
+#   /C/data/hello.txt     "hello restic\n", one uncompressed blob
+#   /C/data/multi.bin     3 blobs A B A (B zstd-compressed in version 2),
+#                         70000 bytes
+#   /C/data/empty.txt     no blobs
+#   /C/data/damaged.bin   one blob whose MAC does not match
+#   /C/data/sub/ž.txt     "z\n" (UTF-8 name)
+# Version 1 stores the same content without compression: plain sealed JSON
+# for the metadata and no uncompressed_length in the index. The trees are
+# the same, so both versions have the same root tree ID.
+# The SHA-256 of the extracted files is printed for native_test.c.
+
+import base64
+import hashlib
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+
+PASSWORD = b"native-test"
+rng = random.Random(20260101)
+
+
+def rand(n):
+    return bytes(rng.getrandbits(8) for _ in range(n))
+
+
+def aes_ecb(key, block):
+    return subprocess.run(["openssl", "enc", "-aes-%d-ecb" % (len(key) * 8),
+                           "-K", key.hex(), "-nopad"],
+                          input=block, capture_output=True, check=True).stdout
+
+
+def aes_ctr(key, iv, data):
+    if not data:
+        return b""
+    return subprocess.run(["openssl", "enc", "-aes-256-ctr", "-K", key.hex(), "-iv", iv.hex()],
+                          input=data, capture_output=True, check=True).stdout
+
+
+def zstd(data):
+    return subprocess.run(["zstd", "-q", "-c", "-3"],
+                          input=data, capture_output=True, check=True).stdout
+
+
+def poly1305(r, s, msg):
+    r = int.from_bytes(r, "little") & 0x0ffffffc0ffffffc0ffffffc0fffffff
+    s = int.from_bytes(s, "little")
+    p = (1 << 130) - 5
+    h = 0
+    for i in range(0, len(msg), 16):
+        h = ((h + int.from_bytes(msg[i:i + 16] + b"\x01", "little")) * r) % p
+    return ((h + s) % (1 << 128)).to_bytes(16, "little")
+
+
+def seal(key, plain):
+    """IV || AES-256-CTR(plain) || Poly1305-AES MAC, as restic stores it"""
+    encrypt, k, r = key
+    iv = rand(16)
+    ct = aes_ctr(encrypt, iv, plain)
+    return iv + ct + poly1305(r, aes_ecb(k, iv), ct)
+
+
+def write(root, rel, data, name=None):
+    name = name or hashlib.sha256(data).hexdigest()
+    path = os.path.join(root, rel, name)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "wb") as f:
+        f.write(data)
+    return name
+
+
+def main():
+    args = sys.argv[1:]
+    version = 2
+    if len(args) >= 2 and args[0] == "--version":
+        version = int(args[1])
+        args = args[2:]
+    if version not in (1, 2):
+        sys.exit("version must be 1 or 2")
+    root = args[0] if args else os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), "fixtures", "native_v%d" % version)
+    if os.path.isdir(root):
+        shutil.rmtree(root)
+    os.makedirs(root)
+
+    master = (rand(32), rand(16), rand(16))
+
+    # Key file: scrypt with small parameters so the test opens it quickly
+    salt = rand(64)
+    n, r, p = 1024, 8, 1
+    derived = hashlib.scrypt(PASSWORD, salt=salt, n=n, r=r, p=p, dklen=64)
+    user = (derived[:32], derived[32:48], derived[48:])
+    b64 = lambda b: base64.b64encode(b).decode()
+    masterJson = json.dumps({"mac": {"k": b64(master[1]), "r": b64(master[2])},
+                             "encrypt": b64(master[0])}).encode()
+    keyFile = json.dumps({"created": "2026-01-01T00:00:00Z", "username": "test",
+                          "hostname": "test", "kdf": "scrypt", "N": n, "r": r, "p": p,
+                          "salt": b64(salt), "data": b64(seal(user, masterJson))}).encode()
+    write(root, "keys", keyFile)
+
+    def meta(obj):
+        if version == 1:
+            return seal(master, json.dumps(obj).encode())
+        return seal(master, b"\x02" + zstd(json.dumps(obj).encode()))
+
+    with open(os.path.join(root, "config"), "wb") as f:
+        f.write(seal(master, json.dumps({"version": version, "id": "5e" * 32,
+                                         "chunker_polynomial": "3f"}).encode()))
+
+    # Data blobs: (plaintext, compressed, damaged)
+    blobs = {}
+
+    def blob(data, compressed=False, damaged=False):
+        bid = hashlib.sha256(data).hexdigest()
+        blobs[bid] = (data, compressed and version >= 2, damaged)
+        return bid
+
+    hello = b"hello restic\n"
+    chunkA = rand(20000)
+    chunkB = bytes((i // 100) % 7 for i in range(30000))
+    multi = chunkA + chunkB + chunkA
+    z = b"z\n"
+    damaged = rand(5000)
+    files = {
+        "hello.txt": (hello, [blob(hello)]),
+        "multi.bin": (multi, [blob(chunkA), blob(chunkB, compressed=True), blob(chunkA)]),
+        "empty.txt": (b"", []),
+        "damaged.bin": (damaged, [blob(damaged, damaged=True)]),
+    }
+
+    # Trees
+    trees = {}
+
+    def node(name, **extra):
+        n = {"name": name, "mode": 420, "mtime": "2025-05-06T07:08:09.5+02:00",
+             "atime": "2025-05-06T07:08:09+02:00", "ctime": "2025-05-06T07:08:09+02:00",
+             "uid": 0, "gid": 0, "user": "test", "inode": 1, "device_id": 2, "links": 1}
+        n.update(extra)
+        return n
+
+    def tree(nodes):
+        nodes.sort(key=lambda n: n["name"].encode())
+        text = (json.dumps({"nodes": nodes}) + "\n").encode()
+        tid = hashlib.sha256(text).hexdigest()
+        trees[tid] = text
+        return tid
+
+    sub = tree([node("ž.txt", type="file", size=len(z), content=[blob(z)])])
+    data = tree([node(k, type="file", size=len(v[0]), content=v[1]) for k, v in files.items()] +
+                [node("sub", type="dir", subtree=sub)])
+    cdir = tree([node("data", type="dir", subtree=data)])
+    rootTree = tree([node("C", type="dir", subtree=cdir)])
+
+    # Packs: trees in one, data blobs in another
+    packs = []
+
+    def pack(entries, kind):
+        body = b""
+        index = []
+        for bid, plain, compressed, broken in entries:
+            e = {"id": bid, "type": kind, "offset": len(body)}
+            if compressed:
+                stored = seal(master, zstd(plain))
+                e["uncompressed_length"] = len(plain)
+            else:
+                stored = seal(master, plain)
+            if broken:
+                stored = stored[:-1] + bytes([stored[-1] ^ 0x5a])
+            e["length"] = len(stored)
+            body += stored
+            index.append(e)
+        # The reader goes by the index; the header only has to be present
+        body += seal(master, b"H" * 37) + (53).to_bytes(4, "little")
+        pid = hashlib.sha256(body).hexdigest()
+        write(root, "data/" + pid[:2], body, pid)
+        packs.append({"id": pid, "blobs": index})
+
+    pack([(tid, text, version >= 2 and len(text) > 200, False)
+          for tid, text in sorted(trees.items())], "tree")
+    pack([(bid, v[0], v[1], v[2]) for bid, v in sorted(blobs.items())], "data")
+    write(root, "index", meta({"packs": packs}))
+
+    snaps = []
+    for month in (1, 2):
+        snaps.append(write(root, "snapshots", meta({
+            "time": "2026-%02d-01T10:00:00.123+02:00" % month, "tree": rootTree,
+            "paths": ["C:\\data"], "hostname": "test", "username": "test"})))
+
+    for name in ("hello.txt", "multi.bin", "empty.txt"):
+        print("%-10s %s" % (name, hashlib.sha256(files[name][0]).hexdigest()))
+    print("snapshots", " ".join(s[:8] for s in sorted(snaps)))
+    print("root tree", rootTree)
+
+
+if __name__ == "__main__":
+    main()
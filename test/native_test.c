@@ -0,0 +1,602 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Tests of the native repository reader.
+   Checks the crypto primitives against published vectors (scrypt from
+   RFC 7914, Poly1305-AES from the Poly1305-AES paper), then decodes the
+   repositories in test/fixtures/native_v1 and native_v2 (written by
+   gen_native_fixture.py) file by file with native_format.c: key file and
+   a wrong password, config, snapshots, index, trees, file contents and a
+   blob whose MAC does not match. This part builds on any platform.
+
+   Built with NATIVE_TEST_REPO (native_repo_test, Windows only), it also
+   reads both repositories through the shared reader of native_repo.c:
+   index, tree cache and extraction to files.
+
+   Usage: native_test FIXTURES_DIR    exit code 0 if every check passes */
+
+#include "restic_crypto.h"
+#include "native_format.h"
+#ifdef NATIVE_TEST_REPO
+#include "native_repo.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NATIVE_TEST_REPO
+/* The plugin core expects the DLL module handle; NULL resolves to this exe */
+HMODULE g_hModule = NULL;
+#endif
+
+#define FIXTURE_PASSWORD "native-test"
+
+/* Both versions hold the same trees (gen_native_fixture.py prints these) */
+#define FIXTURE_ROOT_TREE  "eb486383f1188c8ada0c7de024d5cb0d87a7a7123e4b2f610c87a7e9191119db"
+
+/* Two snapshots of the same tree per repository, sorted by ID */
+typedef struct {
+    const char* dir;
+    int version;
+    const char* snapshot1;
+    const char* snapshot2;
+} Fixture;
+
+static const Fixture g_Fixtures[] = {
+    { "native_v1", 1, "39f398a0", "79f7c2c5" },
+    { "native_v2", 2, "a2b5e9f7", "e71bc44e" },
+};
+
+#define SHA256_HELLO "fbbd69198637d5360353c39796181175de6311c2a61abe2fe6392c938018660f"
+#define SHA256_MULTI "2451a01718205662d8ab67a4c576eff491e2c98872dfcc2f8c8730d8ffe43500"
+#define SHA256_EMPTY "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"
+
+static int g_Checks = 0;
+static int g_Failures = 0;
+
+static void Check(BOOL ok, const char* what) {
+    g_Checks++;
+    if (!ok) {
+        g_Failures++;
+        fprintf(stderr, "FAIL %s\n", what);
+    }
+}
+
+/* Decode hex into out; returns the byte count */
+static int FromHex(const char* hex, BYTE* out, int outSize) {
+    int n = 0;
+    while (hex[0] && hex[1] && n < outSize) {
+        unsigned int b;
+        if (sscanf(hex, "%2x", &b) != 1) break;
+        out[n++] = (BYTE)b;
+        hex += 2;
+    }
+    return n;
+}
+
+static BOOL EqualsHex(const BYTE* bytes, int len, const char* hex) {
+    BYTE expect[128];
+    return FromHex(hex, expect, sizeof(expect)) == len && memcmp(bytes, expect, len) == 0;
+}
+
+/* --- Crypto vectors --- */
+
+static void TestScrypt(void) {
+    /* RFC 7914 section 12; the fourth vector (N = 2^20) needs 1 GiB */
+    static const struct {
+        const char* password;
+        const char* salt;
+        DWORD n, r, p;
+        const char* expect;
+    } vectors[] = {
+        { "", "", 16, 1, 1,
+          "77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+          "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906" },
+        { "password", "NaCl", 1024, 8, 16,
+          "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+          "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640" },
+        { "pleaseletmein", "SodiumChloride", 16384, 8, 1,
+          "7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+          "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887" },
+    };
+    BYTE out[64];
+    int i;
+
+    for (i = 0; i < (int)(sizeof(vectors) / sizeof(vectors[0])); i++) {
+        char what[64];
+        BOOL ok = Crypto_Scrypt((const BYTE*)vectors[i].password, strlen(vectors[i].password),
+                                (const BYTE*)vectors[i].salt, strlen(vectors[i].salt),
+                                vectors[i].n, vectors[i].r, vectors[i].p, out, sizeof(out));
+        snprintf(what, sizeof(what), "scrypt RFC 7914 vector %d", i + 1);
+        Check(ok && EqualsHex(out, sizeof(out), vectors[i].expect), what);
+    }
+
+    /* N must be a power of two */
+    Check(!Crypto_Scrypt((const BYTE*)"p", 1, (const BYTE*)"s", 1, 1000, 8, 1, out, 64),
+          "scrypt rejects N that is not a power of two");
+}
+
+/* Poly1305-AES (k, r, nonce, message, MAC) from appendix B of Bernstein's
+   "The Poly1305-AES message-authentication code", which is restic's MAC
+   with the IV as nonce. Crypto_Open verifies the MAC of IV || message ||
+   MAC, so a vector passes exactly when Poly1305-AES matches. */
+static void TestPoly1305(void) {
+    static const struct {
+        const char* k;
+        const char* r;
+        const char* nonce;
+        const char* msg;
+        const char* mac;
+    } vectors[] = {
+        { "ec074c835580741701425b623235add6", "851fc40c3467ac0be05cc20404f3f700",
+          "fb447350c4e868c52ac3275cf9d4327e", "f3f6",
+          "f4c633c3044fc145f84f335cb81953de" },
+        { "75deaa25c09f208e1dc4ce6b5cad3fbf", "a0f3080000f46400d0c7e9076c834403",
+          "61ee09218d29b0aaed7e154a2c5509cc", "",
+          "dd3fab2251f11ac759f0887129cc2ee7" },
+        { "6acb5f61a7176dd320c5c1eb2edcdc74", "48443d0bb0d21109c89a100b5ce2c208",
+          "ae212a55399729595dea458bc621ff0e",
+          "663cea190ffb83d89593f3f476b6bc24d7e679107ea26adb8caf6652d0656136",
+          "0ee1c16bb73f0f4fd19881753c01cdbe" },
+        { "e1a5668a4d5b66a5f68cc5424ed5982d", "12976a08c4426d0ce8a82407c4f48207",
+          "9ae831e743978d3a23527c7128149e3a",
+          "ab0812724a7f1e342742cbed374d94d136c6b8795d45b3819830f2c04491faf0"
+          "990c62e48b8018b2c3e4a0fa3134cb67fa83e158c994d961c4cb21095c1bf9",
+          "5154ad0d2cb26e01274fc51148491f1b" },
+    };
+    int i;
+
+    for (i = 0; i < (int)(sizeof(vectors) / sizeof(vectors[0])); i++) {
+        CryptoKey key;
+        BYTE sealed[CRYPTO_OVERHEAD + 64];
+        BYTE plain[64];
+        char what[64];
+        int len;
+
+        memset(&key, 0, sizeof(key));
+        FromHex(vectors[i].k, key.macK, 16);
+        FromHex(vectors[i].r, key.macR, 16);
+        FromHex(vectors[i].nonce, sealed, CRYPTO_IV_SIZE);
+        len = FromHex(vectors[i].msg, sealed + CRYPTO_IV_SIZE, 64);
+        FromHex(vectors[i].mac, sealed + CRYPTO_IV_SIZE + len, CRYPTO_MAC_SIZE);
+
+        snprintf(what, sizeof(what), "Poly1305-AES vector %d", i + 1);
+        Check(Crypto_Open(&key, sealed, CRYPTO_OVERHEAD + len, plain), what);
+
+        /* Any changed bit of message or MAC must fail */
+        sealed[CRYPTO_OVERHEAD + len - 1] ^= 0x01;
+        snprintf(what, sizeof(what), "Poly1305-AES vector %d with a bad MAC", i + 1);
+        Check(!Crypto_Open(&key, sealed, CRYPTO_OVERHEAD + len, plain), what);
+    }
+}
+
+/* --- Fixture repositories, file by file --- */
+
+static const NativeNode* FindNode(const NativeTree* tree, const char* name) {
+    int i;
+    for (i = 0; tree && i < tree->count; i++)
+        if (strcmp(tree->nodes[i].name, name) == 0) return &tree->nodes[i];
+    return NULL;
+}
+
+/* Blobs of the fixture index (2 packs, 9 blobs) */
+#define TEST_PACKS_MAX 8
+#define TEST_BLOBS_MAX 32
+
+typedef struct {
+    NativeId packs[TEST_PACKS_MAX];
+    int packCount;
+    NativeBlob blobs[TEST_BLOBS_MAX];
+    int blobCount;
+} TestIndex;
+
+static BOOL TestAddPack(void* ctx, const BYTE packId[32], DWORD* outPack) {
+    TestIndex* index = (TestIndex*)ctx;
+    if (index->packCount >= TEST_PACKS_MAX) return FALSE;
+    memcpy(index->packs[index->packCount], packId, 32);
+    *outPack = (DWORD)index->packCount++;
+    return TRUE;
+}
+
+static BOOL TestAddBlob(void* ctx, const NativeBlob* blob) {
+    TestIndex* index = (TestIndex*)ctx;
+    if (index->blobCount >= TEST_BLOBS_MAX) return FALSE;
+    index->blobs[index->blobCount++] = *blob;
+    return TRUE;
+}
+
+static const NativeBlob* TestFindBlob(const TestIndex* index, const BYTE id[32]) {
+    int i;
+    for (i = 0; i < index->blobCount; i++)
+        if (memcmp(index->blobs[i].id, id, 32) == 0) return &index->blobs[i];
+    return NULL;
+}
+
+/* Whole file into a malloc'd buffer */
+static BYTE* ReadFixtureFile(const char* root, const char* dir, const BYTE* id, size_t* outLen) {
+    char path[MAX_PATH];
+    NativeFile* file;
+    ULONGLONG size = 0;
+    BYTE* data = NULL;
+
+    *outLen = 0;
+    NativeFormat_FilePath(path, MAX_PATH, root, dir, id);
+    file = NativeIo_Open(path, TRUE);
+    if (!file) return NULL;
+    if (NativeIo_Size(file, &size) && size > 0) data = (BYTE*)malloc((size_t)size);
+    if (data && !NativeIo_ReadAt(file, 0, data, (DWORD)size)) {
+        free(data);
+        data = NULL;
+    }
+    NativeIo_Close(file);
+    if (data) *outLen = (size_t)size;
+    return data;
+}
+
+static cJSON* ReadFixtureJson(const char* root, const CryptoKey* key, const char* dir,
+                              const BYTE* id) {
+    size_t len;
+    BYTE* raw = ReadFixtureFile(root, dir, id, &len);
+    cJSON* json = raw ? NativeFormat_DecodeJson(key, 2, raw, len) : NULL;
+    free(raw);
+    return json;
+}
+
+/* Read and check one blob by ID; NULL if it is missing or damaged */
+static BYTE* ReadFixtureBlob(const char* root, const CryptoKey* key, const TestIndex* index,
+                             const BYTE id[32], size_t* outLen) {
+    const NativeBlob* blob = TestFindBlob(index, id);
+    NativeFile* pack = blob ? NativeFormat_OpenPack(root, index->packs[blob->pack]) : NULL;
+    BYTE* plain = pack ? NativeFormat_ReadBlob(pack, key, blob, outLen) : NULL;
+
+    NativeIo_Close(pack);
+    return plain;
+}
+
+static void FreeBlock(void* block) {
+    free(block);
+}
+
+static NativeTree* ReadFixtureTree(const char* root, const CryptoKey* key,
+                                   const TestIndex* index, const BYTE id[32]) {
+    size_t len, bytes;
+    BYTE* text = ReadFixtureBlob(root, key, index, id, &len);
+    NativeTree* tree = text ? NativeFormat_ParseTree((const char*)text, len, id, 0, malloc,
+                                                     FreeBlock, &bytes)
+                            : NULL;
+    free(text);
+    return tree;
+}
+
+/* SHA-256 of a file put together from its data blobs */
+static BOOL FixtureFileSha256(const char* root, const CryptoKey* key, const TestIndex* index,
+                              const NativeNode* node, const char* expectHex) {
+    BYTE* data = (BYTE*)malloc(node->size > 0 ? (size_t)node->size : 1);
+    BYTE hash[32];
+    size_t pos = 0;
+    DWORD i;
+    BOOL ok = data != NULL;
+
+    for (i = 0; ok && i < node->contentCount; i++) {
+        size_t len;
+        BYTE* plain = ReadFixtureBlob(root, key, index, node->content[i], &len);
+        ok = plain && pos + len <= node->size;
+        if (ok) memcpy(data + pos, plain, len);
+        pos += len;
+        free(plain);
+    }
+    if (ok) {
+        Crypto_Sha256(data, pos, hash);
+        ok = pos == node->size && EqualsHex(hash, 32, expectHex);
+    }
+    free(data);
+    return ok;
+}
+
+static void TestFormatTrees(const char* root, const CryptoKey* key, const TestIndex* index,
+                            const Fixture* fx) {
+    BYTE id[32];
+    NativeTree* top;
+    NativeTree* cdir = NULL;
+    NativeTree* data = NULL;
+    NativeTree* sub = NULL;
+    const NativeNode* node;
+    char what[128];
+
+    NativeFormat_ParseId(FIXTURE_ROOT_TREE, id);
+    top = ReadFixtureTree(root, key, index, id);
+    snprintf(what, sizeof(what), "%s: root tree", fx->dir);
+    Check(top && top->count == 1 && memcmp(top->id, id, 32) == 0, what);
+
+    node = top ? NativeFormat_FindNode(top, "C", 1) : NULL;
+    if (node && node->hasSubtree) cdir = ReadFixtureTree(root, key, index, node->subtree);
+    node = cdir ? NativeFormat_FindNode(cdir, "data/ignored", 4) : NULL;
+    if (node && node->hasSubtree) data = ReadFixtureTree(root, key, index, node->subtree);
+    snprintf(what, sizeof(what), "%s: /C/data by name", fx->dir);
+    Check(data != NULL, what);
+
+    if (data) {
+        snprintf(what, sizeof(what), "%s: /C/data has 5 entries", fx->dir);
+        Check(data->count == 5, what);
+        node = FindNode(data, "multi.bin");
+        snprintf(what, sizeof(what), "%s: multi.bin is a 70000-byte file of 3 blobs", fx->dir);
+        Check(node && node->type == NATIVE_NODE_FILE && node->size == 70000 &&
+              node->contentCount == 3, what);
+        snprintf(what, sizeof(what), "%s: nodes are sorted by name", fx->dir);
+        Check(strcmp(data->nodes[0].name, "damaged.bin") == 0 &&
+              NativeFormat_FindNode(data, "multi.bin", 9) == node, what);
+        snprintf(what, sizeof(what), "%s: missing name", fx->dir);
+        Check(NativeFormat_FindNode(data, "missing", 7) == NULL &&
+              NativeFormat_FindNode(data, "multi", 5) == NULL, what);
+
+        snprintf(what, sizeof(what), "%s: read hello.txt", fx->dir);
+        node = FindNode(data, "hello.txt");
+        Check(node && FixtureFileSha256(root, key, index, node, SHA256_HELLO), what);
+        snprintf(what, sizeof(what), "%s: read multi.bin", fx->dir);
+        node = FindNode(data, "multi.bin");
+        Check(node && FixtureFileSha256(root, key, index, node, SHA256_MULTI), what);
+        snprintf(what, sizeof(what), "%s: read empty.txt", fx->dir);
+        node = FindNode(data, "empty.txt");
+        Check(node && node->contentCount == 0 &&
+              FixtureFileSha256(root, key, index, node, SHA256_EMPTY), what);
+
+        /* The blob of damaged.bin fails its MAC */
+        node = FindNode(data, "damaged.bin");
+        snprintf(what, sizeof(what), "%s: blob with a bad MAC is refused", fx->dir);
+        if (node && node->contentCount == 1 && TestFindBlob(index, node->content[0])) {
+            size_t len;
+            BYTE* plain = ReadFixtureBlob(root, key, index, node->content[0], &len);
+            Check(plain == NULL, what);
+            free(plain);
+        } else {
+            Check(FALSE, what);
+        }
+
+        node = FindNode(data, "sub");
+        if (node && node->hasSubtree) sub = ReadFixtureTree(root, key, index, node->subtree);
+        snprintf(what, sizeof(what), "%s: UTF-8 name in /C/data/sub", fx->dir);
+        Check(sub && FindNode(sub, "\xc5\xbe.txt") != NULL, what);
+    }
+
+    free(sub);
+    free(data);
+    free(cdir);
+    free(top);
+}
+
+static void TestFormat(const char* root, const Fixture* fx) {
+    NativeId* ids;
+    CryptoKey key;
+    TestIndex index;
+    cJSON* json;
+    BYTE* raw;
+    size_t rawLen;
+    int count, i;
+    char what[128];
+
+    memset(&key, 0, sizeof(key));
+    ids = NativeFormat_ListIds(root, "keys", &count);
+    snprintf(what, sizeof(what), "%s: one key file", fx->dir);
+    Check(count == 1, what);
+    raw = count == 1 ? ReadFixtureFile(root, "keys", ids[0], &rawLen) : NULL;
+    free(ids);
+    snprintf(what, sizeof(what), "%s: wrong password fails the key file MAC", fx->dir);
+    Check(raw && !NativeFormat_OpenKeyFile(raw, rawLen, "wrong password", &key), what);
+    snprintf(what, sizeof(what), "%s: open key file", fx->dir);
+    Check(raw && NativeFormat_OpenKeyFile(raw, rawLen, FIXTURE_PASSWORD, &key), what);
+    free(raw);
+
+    json = ReadFixtureJson(root, &key, "config", NULL);
+    snprintf(what, sizeof(what), "%s: config of version %d", fx->dir, fx->version);
+    Check(cJSON_GetNumberValue(cJSON_GetObjectItemCaseSensitive(json, "version")) == fx->version,
+          what);
+    cJSON_Delete(json);
+
+    ids = NativeFormat_ListIds(root, "snapshots", &count);
+    snprintf(what, sizeof(what), "%s: snapshot list", fx->dir);
+    Check(count == 2, what);
+    for (i = 0; i < count && i < 2; i++) {
+        char hex[65];
+        BYTE tree[32], expect[32];
+
+        NativeFormat_FormatId(ids[i], hex);
+        json = ReadFixtureJson(root, &key, "snapshots", ids[i]);
+        NativeFormat_ParseId(FIXTURE_ROOT_TREE, expect);
+        snprintf(what, sizeof(what), "%s: root tree of snapshot %.8s", fx->dir, hex);
+        Check(strncmp(hex, i == 0 ? fx->snapshot1 : fx->snapshot2, 8) == 0 &&
+              NativeFormat_ParseId(cJSON_GetStringValue(cJSON_GetObjectItemCaseSensitive(json, "tree")),
+                                   tree) &&
+              memcmp(tree, expect, 32) == 0, what);
+        cJSON_Delete(json);
+    }
+    free(ids);
+
+    memset(&index, 0, sizeof(index));
+    ids = NativeFormat_ListIds(root, "index", &count);
+    json = count == 1 ? ReadFixtureJson(root, &key, "index", ids[0]) : NULL;
+    free(ids);
+    snprintf(what, sizeof(what), "%s: index of 2 packs and 9 blobs", fx->dir);
+    Check(json && NativeFormat_ParseIndex(json, TestAddPack, TestAddBlob, &index) &&
+          index.packCount == 2 && index.blobCount == 9, what);
+    cJSON_Delete(json);
+
+    /* Version 1 has no compressed blobs, version 2 compresses some */
+    for (i = 0, count = 0; i < index.blobCount; i++) count += index.blobs[i].rawLength > 0;
+    snprintf(what, sizeof(what), "%s: compressed blobs", fx->dir);
+    Check(fx->version == 1 ? count == 0 : count > 0, what);
+
+    TestFormatTrees(root, &key, &index, fx);
+    SecureZeroMemory(&key, sizeof(key));
+}
+
+/* Trees the reader must refuse: a node without a name, a bad content ID */
+static void TestMalformedTrees(void) {
+    static const char* texts[] = {
+        "{\"nodes\": [{\"type\": \"file\"}]}",
+        "{\"nodes\": [{\"name\": \"a\", \"type\": \"file\", \"content\": [\"00\"]}]}",
+        "[]",
+    };
+    BYTE id[32];
+    size_t bytes;
+    int i;
+
+    memset(id, 0, sizeof(id));
+    for (i = 0; i < (int)(sizeof(texts) / sizeof(texts[0])); i++) {
+        char what[64];
+        NativeTree* tree = NativeFormat_ParseTree(texts[i], strlen(texts[i]), id, 0, malloc,
+                                                  FreeBlock, &bytes);
+        snprintf(what, sizeof(what), "malformed tree %d is refused", i + 1);
+        Check(tree == NULL, what);
+        free(tree);
+    }
+}
+
+#ifdef NATIVE_TEST_REPO
+
+/* --- Fixture repositories through the shared reader --- */
+
+static BOOL FileSha256(const char* path, const char* expectHex) {
+    FILE* f = fopen(path, "rb");
+    BYTE* data;
+    BYTE hash[32];
+    long size;
+    BOOL ok = FALSE;
+
+    if (!f) return FALSE;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = (BYTE*)malloc(size > 0 ? (size_t)size : 1);
+    if (data && fread(data, 1, (size_t)size, f) == (size_t)size) {
+        Crypto_Sha256(data, (size_t)size, hash);
+        ok = EqualsHex(hash, 32, expectHex);
+    }
+    free(data);
+    fclose(f);
+    return ok;
+}
+
+static void TestTrees(NativeRepo* repo, const BYTE root[32]) {
+    const NativeTree* tree = NULL;
+    const NativeNode* node;
+
+    Check(NativeRepo_FindDir(repo, root, "/C/data", &tree) == 1, "find /C/data");
+    if (tree) {
+        Check(tree->count == 5, "/C/data has 5 entries");
+        node = FindNode(tree, "multi.bin");
+        Check(node && node->type == NATIVE_NODE_FILE && node->size == 70000 &&
+              node->contentCount == 3, "multi.bin is a 70000-byte file of 3 blobs");
+        node = FindNode(tree, "sub");
+        Check(node && node->type == NATIVE_NODE_DIR && node->hasSubtree, "sub is a directory");
+        node = FindNode(tree, "empty.txt");
+        Check(node && node->size == 0 && node->contentCount == 0, "empty.txt has no blobs");
+        Check(strcmp(tree->nodes[0].name, "damaged.bin") == 0, "nodes are sorted by name");
+        NativeRepo_ReleaseTree(tree);
+    }
+
+    tree = NULL;
+    Check(NativeRepo_FindDir(repo, root, "/C/data/sub", &tree) == 1, "find /C/data/sub");
+    if (tree) {
+        Check(FindNode(tree, "\xc5\xbe.txt") != NULL, "UTF-8 name in /C/data/sub");
+        NativeRepo_ReleaseTree(tree);
+    }
+
+    Check(NativeRepo_FindDir(repo, root, "/C/missing", &tree) == 0, "missing directory");
+    Check(NativeRepo_FindDir(repo, root, "/C/data/hello.txt", &tree) == 0,
+          "a file is not a directory");
+}
+
+static void TestExtract(NativeRepo* repo, const BYTE root[32]) {
+    static const struct {
+        const char* path;
+        const char* sha256;
+    } files[] = {
+        { "/C/data/hello.txt", SHA256_HELLO },
+        { "/C/data/multi.bin", SHA256_MULTI },
+        { "/C/data/empty.txt", SHA256_EMPTY },
+    };
+    char outPath[MAX_PATH];
+    char what[128];
+    int i;
+
+    GetTempPathA(MAX_PATH, outPath);
+    strncat(outPath, "restic_wfx_native_test.out", MAX_PATH - strlen(outPath) - 1);
+
+    for (i = 0; i < (int)(sizeof(files) / sizeof(files[0])); i++) {
+        int rc = NativeRepo_ExtractFile(repo, root, files[i].path, outPath, 0, 0, NULL, NULL);
+        snprintf(what, sizeof(what), "extract %s", files[i].path);
+        Check(rc == 1 && FileSha256(outPath, files[i].sha256), what);
+        DeleteFileA(outPath);
+    }
+
+    /* The blob of damaged.bin fails its MAC: no output is left behind */
+    Check(NativeRepo_ExtractFile(repo, root, "/C/data/damaged.bin", outPath,
+                                 0, 0, NULL, NULL) == -1,
+          "extract of a blob with a bad MAC fails");
+    Check(GetFileAttributesA(outPath) == INVALID_FILE_ATTRIBUTES,
+          "failed extract removes its output");
+}
+
+static void TestRepository(const char* fixture, const Fixture* fx) {
+    NativeRepo* repo;
+    BYTE root[32], other[32], expectRoot[32];
+    char* snapshots;
+
+    Check(NativeRepo_Open(fixture, "wrong password") == NULL,
+          "wrong password fails the key file MAC");
+
+    repo = NativeRepo_Open(fixture, FIXTURE_PASSWORD);
+    Check(repo != NULL, "open fixture repository");
+    if (!repo) return;
+
+    Check(NativeRepo_Version(repo) == fx->version, "repository version");
+
+    snapshots = NativeRepo_SnapshotsJson(repo);
+    Check(snapshots && strstr(snapshots, fx->snapshot1) &&
+          strstr(snapshots, fx->snapshot2), "snapshot list");
+    free(snapshots);
+
+    Check(NativeRepo_LoadIndex(repo) && NativeRepo_PackCount(repo) == 2 &&
+          NativeRepo_BlobCount(repo) == 9, "index of 2 packs and 9 blobs");
+
+    NativeFormat_ParseId(FIXTURE_ROOT_TREE, expectRoot);
+    Check(NativeRepo_SnapshotTree(repo, fx->snapshot1, root) &&
+          memcmp(root, expectRoot, 32) == 0, "root tree of the first snapshot");
+    Check(NativeRepo_SnapshotTree(repo, fx->snapshot2, other) &&
+          memcmp(other, expectRoot, 32) == 0, "root tree of the second snapshot");
+    Check(!NativeRepo_SnapshotTree(repo, "00000000", other), "unknown snapshot");
+
+    TestTrees(repo, root);
+    TestExtract(repo, root);
+    NativeRepo_Close(repo);
+}
+
+#endif /* NATIVE_TEST_REPO */
+
+int main(int argc, char** argv) {
+    int i;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: native_test FIXTURES_DIR\n");
+        return 2;
+    }
+
+    TestScrypt();
+    TestPoly1305();
+    TestMalformedTrees();
+    for (i = 0; i < (int)(sizeof(g_Fixtures) / sizeof(g_Fixtures[0])); i++) {
+        char root[MAX_PATH];
+
+        snprintf(root, MAX_PATH, "%s" NATIVE_IO_SEP "%s", argv[1], g_Fixtures[i].dir);
+        TestFormat(root, &g_Fixtures[i]);
+#ifdef NATIVE_TEST_REPO
+        TestRepository(root, &g_Fixtures[i]);
+#endif
+    }
+
+    printf("native_test: %d checks, %d failed\n", g_Checks, g_Failures);
+    return g_Failures ? 1 : 0;
+}
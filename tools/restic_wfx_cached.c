@@ -0,0 +1,280 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Shared cache service for the plugin ([Service] Enabled=1, see
+   cache_service.h).
+   Hosts the plugin core like restic-wfx-cli and answers the directory
+   listings of every Total Commander window of the user over a named pipe,
+   so they share one in-memory cache, one snapshot list per repository and
+   one set of restic processes. The core serves one listing at a time. A
+   listing of the repository whose listing is running waits for it, as it
+   will then find that restic run's output in the cache; a listing of
+   another repository waits only briefly and is then answered with
+   CACHE_REPLY_LOCAL, as its client blocks a Total Commander window until
+   the reply arrives.
+
+   There is nobody to ask, so anything that would talk to the user is
+   answered with CACHE_REPLY_LOCAL and handled by the plugin itself:
+   repositories without a password file, [Search] (its queries and
+   recent searches live in the plugin), listings that fail with an error
+   dialog, the plugin root and [Add Repository].
+
+   The pipe is named after the user's SID and its DACL admits only that
+   SID, so other accounts on the machine can neither connect nor pose as
+   the service.
+
+   Usage: restic-wfx-cached [-v]     runs until Ctrl+C */
+
+#include "wfx_interface.h"
+#include "repo_config.h"
+#include "ls_cache.h"
+#include "cache_service.h"
+#include <sddl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The plugin core expects the DLL module handle; NULL resolves to this exe */
+HMODULE g_hModule = NULL;
+
+/* Pipe instances, so windows can queue their requests while one is served */
+#define SERVICE_INSTANCES 8
+
+/* How long a listing waits for the core while a listing of the same
+   repository runs (the timeout of a restic listing), and while one of
+   another repository runs, before the plugin is told to list it itself */
+#define SERVICE_WAIT_SAME_REPO_MS  120000
+#define SERVICE_WAIT_OTHER_REPO_MS 2000
+#define SERVICE_WAIT_POLL_MS       20
+
+#define SERVICE_PIPE_BUFFER 65536
+
+static BOOL g_Verbose = FALSE;
+
+/* The plugin core, one request at a time */
+static SRWLOCK g_CoreLock = SRWLOCK_INIT;
+
+/* Repository of the listing holding g_CoreLock */
+static SRWLOCK g_RunningLock = SRWLOCK_INIT;
+static char g_RunningRepo[MAX_REPO_NAME];
+
+/* Set when the request holding g_CoreLock tried to talk to the user */
+static BOOL g_Prompted = FALSE;
+
+/* --- Host callbacks: no user to talk to --- */
+
+static int __stdcall ServiceProgress(int PluginNr, char* SourceName,
+                                     char* TargetName, int PercentDone) {
+    return 0;
+}
+
+static void __stdcall ServiceLog(int PluginNr, int MsgType, char* LogString) {
+    if (MsgType == MSGTYPE_IMPORTANTERROR || g_Verbose)
+        fprintf(stderr, "%s\n", LogString);
+}
+
+static BOOL __stdcall ServiceRequest(int PluginNr, int RequestType,
+                                     char* CustomTitle, char* CustomText,
+                                     char* ReturnedText, int maxlen) {
+    g_Prompted = TRUE;
+    if (RequestType == RT_MsgOK && CustomText)
+        fprintf(stderr, "%s: %s\n", CustomTitle ? CustomTitle : "", CustomText);
+    return FALSE;
+}
+
+/* --- Requests --- */
+
+/* Repository name of a plugin path ("\Repo\..."). FALSE if it has none. */
+static BOOL RepoOfPath(const char* path, char* name) {
+    const char* start = path + (path[0] == '\\');
+    const char* end = strchr(start, '\\');
+    size_t len = end ? (size_t)(end - start) : strlen(start);
+
+    if (len == 0 || len >= MAX_REPO_NAME) return FALSE;
+    memcpy(name, start, len);
+    name[len] = '\0';
+    return TRUE;
+}
+
+/* TRUE if a repository can be listed without asking for its password */
+static BOOL HasPassword(const char* repoName) {
+    RepoConfig* repo = RepoStore_FindByName(repoName);
+    return repo && RepoStore_EnsurePassword(repo, 1, ServiceRequest);
+}
+
+/* Take the core for a listing of repoName, waiting while another listing
+   runs (see SERVICE_WAIT_*). FALSE if the wait ran out. */
+static BOOL AcquireCore(const char* repoName) {
+    ULONGLONG start = GetTickCount64();
+    BOOL sameRepo;
+
+    while (!TryAcquireSRWLockExclusive(&g_CoreLock)) {
+        AcquireSRWLockShared(&g_RunningLock);
+        sameRepo = strcmp(g_RunningRepo, repoName) == 0;
+        ReleaseSRWLockShared(&g_RunningLock);
+        if (GetTickCount64() - start >=
+            (sameRepo ? SERVICE_WAIT_SAME_REPO_MS : SERVICE_WAIT_OTHER_REPO_MS))
+            return FALSE;
+        Sleep(SERVICE_WAIT_POLL_MS);
+    }
+
+    AcquireSRWLockExclusive(&g_RunningLock);
+    strcpy(g_RunningRepo, repoName);
+    ReleaseSRWLockExclusive(&g_RunningLock);
+    return TRUE;
+}
+
+static void ReleaseCore(void) {
+    AcquireSRWLockExclusive(&g_RunningLock);
+    g_RunningRepo[0] = '\0';
+    ReleaseSRWLockExclusive(&g_RunningLock);
+    ReleaseSRWLockExclusive(&g_CoreLock);
+}
+
+/* TRUE for paths in a [Search] folder ("\Repo\Path\[Search]..."), whose
+   queries are asked for and remembered by the plugin */
+static BOOL IsSearchPath(const char* path) {
+    const char* seg = path;
+
+    while ((seg = strstr(seg, "\\[Search]")) != NULL) {
+        if (seg[9] == '\0' || seg[9] == '\\') return TRUE;
+        seg += 9;
+    }
+    return FALSE;
+}
+
+/* Serve one request of a connected client */
+static void ServeRequest(HANDLE pipe) {
+    CacheRequest req;
+    CacheReplyHeader reply;
+    char repoName[MAX_REPO_NAME];
+    DirEntry* entries = NULL;
+    int count = 0;
+
+    if (!CacheService_ReadAll(pipe, &req, sizeof(req)) || req.version != CACHE_SERVICE_VERSION)
+        return;
+    req.path[MAX_PATH - 1] = '\0';
+
+    memset(&reply, 0, sizeof(reply));
+    reply.version = CACHE_SERVICE_VERSION;
+    reply.status = CACHE_REPLY_OK;
+
+    /* Dropping cached snapshots takes only the core's own locks */
+    if (req.op == CACHE_OP_FORGET) {
+        ForgetRepoCaches(req.path);
+        if (g_Verbose) fprintf(stderr, "forget %s\n", req.path);
+    } else if (req.op != CACHE_OP_LIST || IsSearchPath(req.path) ||
+               !RepoOfPath(req.path, repoName)) {
+        reply.status = CACHE_REPLY_LOCAL;
+    } else if (!AcquireCore(repoName)) {
+        reply.status = CACHE_REPLY_LOCAL;
+        if (g_Verbose) fprintf(stderr, "busy %s\n", req.path);
+    } else {
+        g_Prompted = FALSE;
+        if (HasPassword(repoName)) entries = GetEntriesForPath(req.path, &count);
+        else reply.status = CACHE_REPLY_LOCAL;
+        /* A dialog the user never saw: let the plugin list it and show it */
+        if (g_Prompted) {
+            free(entries);
+            entries = NULL;
+            reply.status = CACHE_REPLY_LOCAL;
+        }
+        ReleaseCore();
+        if (g_Verbose) fprintf(stderr, "ls %s: %d%s\n", req.path, count,
+                               reply.status == CACHE_REPLY_LOCAL ? " (local)" : "");
+    }
+
+    reply.count = entries ? (DWORD)count : 0;
+    if (CacheService_WriteAll(pipe, &reply, sizeof(reply)) && reply.count > 0)
+        CacheService_WriteAll(pipe, entries, (DWORD)(sizeof(DirEntry) * reply.count));
+    FlushFileBuffers(pipe);
+    free(entries);
+}
+
+/* Create a pipe instance whose protected DACL grants the current user
+   and nobody else */
+static HANDLE CreateInstance(BOOL first) {
+    char name[MAX_PATH];
+    char sid[CACHE_SERVICE_SID_MAX];
+    char sddl[CACHE_SERVICE_SID_MAX + 16];
+    SECURITY_ATTRIBUTES sa;
+    PSECURITY_DESCRIPTOR sd = NULL;
+    HANDLE pipe;
+
+    if (!CacheService_UserSid(sid, sizeof(sid)) || !CacheService_PipeName(name, MAX_PATH))
+        return INVALID_HANDLE_VALUE;
+    snprintf(sddl, sizeof(sddl), "D:P(A;;GA;;;%s)", sid);
+    if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(sddl, SDDL_REVISION_1, &sd, NULL))
+        return INVALID_HANDLE_VALUE;
+
+    sa.nLength = sizeof(sa);
+    sa.lpSecurityDescriptor = sd;
+    sa.bInheritHandle = FALSE;
+    pipe = CreateNamedPipeA(name,
+                            PIPE_ACCESS_DUPLEX | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0),
+                            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+                            PIPE_REJECT_REMOTE_CLIENTS,
+                            SERVICE_INSTANCES, SERVICE_PIPE_BUFFER, SERVICE_PIPE_BUFFER,
+                            0, &sa);
+    LocalFree(sd);
+    return pipe;
+}
+
+/* Serve the clients of one pipe instance, one connection after another.
+   The thread keeps its SQLite connections between requests. */
+static DWORD WINAPI InstanceThread(LPVOID param) {
+    HANDLE pipe = (HANDLE)param;
+
+    if (pipe == INVALID_HANDLE_VALUE) pipe = CreateInstance(FALSE);
+    if (pipe == INVALID_HANDLE_VALUE) return 1;
+
+    for (;;) {
+        if (ConnectNamedPipe(pipe, NULL) || GetLastError() == ERROR_PIPE_CONNECTED)
+            ServeRequest(pipe);
+        DisconnectNamedPipe(pipe);
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    HANDLE first;
+    HANDLE threads[SERVICE_INSTANCES];
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            g_Verbose = TRUE;
+        } else {
+            fprintf(stderr, "usage: restic-wfx-cached [-v]\n");
+            return 2;
+        }
+    }
+
+    FsInit(1, ServiceProgress, ServiceLog, ServiceRequest);
+    /* The service shares the plugin's INI; it must not ask itself */
+    CacheService_Disable();
+
+    /* A second service of the same user would not get the first instance */
+    first = CreateInstance(TRUE);
+    if (first == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "restic-wfx-cached: already running (error %lu)\n", GetLastError());
+        return 1;
+    }
+
+    for (i = 0; i < SERVICE_INSTANCES; i++) {
+        threads[i] = CreateThread(NULL, 0, InstanceThread,
+                                  i == 0 ? first : INVALID_HANDLE_VALUE, 0, NULL);
+        if (!threads[i]) {
+            fprintf(stderr, "restic-wfx-cached: cannot start a pipe thread\n");
+            return 1;
+        }
+    }
+    if (g_Verbose) fprintf(stderr, "restic-wfx-cached: serving\n");
+
+    WaitForMultipleObjects(SERVICE_INSTANCES, threads, TRUE, INFINITE);
+    FsDisconnect("\\");
+    return 0;
+}
@@ -0,0 +1,396 @@
+/*
+ * restic-wfx - Total Commander plugin for browsing restic backup repositories
+ * Copyright (c) 2026 Martin Široký
+ * SPDX-License-Identifier: MIT
+ */
+
+/* Headless host for the plugin core.
+   Links the same code as the DLL and drives it through GetEntriesForPath
+   and the exported Fs* functions, with console stand-ins for Total
+   Commander's request, log and progress callbacks. Uses the plugin's restic_wfx.ini and caches, so it can
+   pre-warm the cache from a scheduled task, script benchmarks, or run the
+   core under a native profiler without Total Commander.
+
+   Paths are plugin paths without the leading backslash; '/' works as a
+   separator too, e.g. "MyRepo\C_Users_me\2026-01-31 10-00-00 (abcd1234)\docs".
+
+   Usage: restic-wfx-cli [-v] [--time] <command> ...
+     ls <path>                      list a directory
+     get <path> <local file>        copy a file out (FsGetFile)
+     cat <path>                     print a file to stdout
+     warm <repo>[\<backup path>] [--latest N]
+                                    load snapshot listings into the cache
+     fields <path>                  print the content column values */
+
+#include "wfx_interface.h"
+#include "repo_config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <io.h>
+#include <fcntl.h>
+
+/* The plugin core expects the DLL module handle; NULL resolves to this exe */
+HMODULE g_hModule = NULL;
+
+#define CLI_FIELD_MAX  32
+
+static BOOL g_Verbose = FALSE;
+static BOOL g_ShowProgress = FALSE;
+static volatile LONG g_Abort = 0;
+
+/* --- Host callbacks (stand-ins for Total Commander) --- */
+
+static int __stdcall CliProgress(int PluginNr, char* SourceName,
+                                 char* TargetName, int PercentDone) {
+    if (g_ShowProgress)
+        fprintf(stderr, "\r%3d%%  %s", PercentDone, SourceName ? SourceName : "");
+    return g_Abort ? 1 : 0;
+}
+
+static void __stdcall CliLog(int PluginNr, int MsgType, char* LogString) {
+    if (MsgType == MSGTYPE_IMPORTANTERROR || g_Verbose)
+        fprintf(stderr, "%s\n", LogString);
+}
+
+/* Read one line from the console; with echo off for passwords */
+static BOOL ReadConsoleLine(const char* prompt, BOOL hidden, char* out, int maxlen) {
+    HANDLE hIn = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD mode = 0;
+    BOOL isConsole = GetConsoleMode(hIn, &mode);
+    BOOL ok;
+    int len;
+
+    /* Scheduled jobs have no console: fail instead of waiting for input */
+    if (!isConsole) return FALSE;
+
+    fprintf(stderr, "%s ", prompt);
+    if (hidden) SetConsoleMode(hIn, mode & ~ENABLE_ECHO_INPUT);
+    ok = fgets(out, maxlen, stdin) != NULL;
+    if (hidden) {
+        SetConsoleMode(hIn, mode);
+        fputc('\n', stderr);
+    }
+    if (!ok) return FALSE;
+
+    len = (int)strlen(out);
+    while (len > 0 && (out[len - 1] == '\n' || out[len - 1] == '\r'))
+        out[--len] = '\0';
+    return TRUE;
+}
+
+static BOOL __stdcall CliRequest(int PluginNr, int RequestType,
+                                 char* CustomTitle, char* CustomText,
+                                 char* ReturnedText, int maxlen) {
+    const char* text = CustomText ? CustomText : "";
+
+    switch (RequestType) {
+        case RT_MsgOK:
+            fprintf(stderr, "%s: %s\n", CustomTitle ? CustomTitle : "", text);
+            return TRUE;
+        case RT_MsgYesNo:
+        case RT_MsgOKCancel: {
+            char answer[16];
+            fprintf(stderr, "%s\n", text);
+            if (!ReadConsoleLine("[y/N]", FALSE, answer, sizeof(answer))) return FALSE;
+            return answer[0] == 'y' || answer[0] == 'Y';
+        }
+        case RT_Password:
+        case RT_PasswordFirewall:
+            return ReadConsoleLine(text, TRUE, ReturnedText, maxlen);
+        default:
+            return ReadConsoleLine(text, FALSE, ReturnedText, maxlen);
+    }
+}
+
+static BOOL WINAPI CtrlHandler(DWORD ctrlType) {
+    if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT) {
+        /* Lets FsGetFile stop the running dump through the progress callback */
+        InterlockedExchange(&g_Abort, 1);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* --- Helpers --- */
+
+static double NowMs(void) {
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1000.0 / (double)freq.QuadPart;
+}
+
+/* "Repo/Path/x" or "\Repo\Path\x\" -> "\Repo\Path\x" */
+static void ToPluginPath(const char* arg, char* out, int maxLen) {
+    int len;
+    char* p;
+
+    snprintf(out, maxLen, "\\%s", arg);
+    for (p = out; *p; p++) {
+        if (*p == '/') *p = '\\';
+    }
+    while (out[1] == '\\') memmove(out + 1, out + 2, strlen(out + 1));
+    len = (int)strlen(out);
+    while (len > 1 && out[len - 1] == '\\') out[--len] = '\0';
+}
+
+static void FormatFileTime(const FILETIME* ft, char* out, int maxLen) {
+    FILETIME local;
+    SYSTEMTIME st;
+    if (!FileTimeToLocalFileTime(ft, &local) || !FileTimeToSystemTime(&local, &st)) {
+        snprintf(out, maxLen, "%-16s", "");
+        return;
+    }
+    snprintf(out, maxLen, "%04d-%02d-%02d %02d:%02d",
+             st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute);
+}
+
+/* Virtual folders ("[All Files]", "[Refresh snapshot list]", ...) */
+static BOOL IsRealDir(const DirEntry* e) {
+    return e->isDirectory && e->name[0] != '[';
+}
+
+/* --- Commands --- */
+
+static int CmdLs(const char* path) {
+    int count = 0, i;
+    DirEntry* entries = GetEntriesForPath(path, &count);
+
+    for (i = 0; i < count; i++) {
+        char when[32];
+        FormatFileTime(&entries[i].lastWriteTime, when, sizeof(when));
+        if (entries[i].isDirectory) {
+            printf("%s  %15s  %s\\\n", when, "<DIR>", entries[i].name);
+        } else {
+            ULONGLONG size = ((ULONGLONG)entries[i].fileSizeHigh << 32) | entries[i].fileSizeLow;
+            printf("%s  %15llu  %s\n", when, (unsigned long long)size, entries[i].name);
+        }
+    }
+    free(entries);
+    return 0;
+}
+
+static int GetToFile(const char* path, const char* localName) {
+    RemoteInfoStruct ri;
+    int result;
+
+    memset(&ri, 0, sizeof(ri));
+    result = FsGetFile((char*)path, (char*)localName, FS_COPYFLAGS_OVERWRITE, &ri);
+    if (g_ShowProgress) fputc('\n', stderr);
+
+    switch (result) {
+        case FS_FILE_OK:        return 0;
+        case FS_FILE_NOTFOUND:  fprintf(stderr, "not found: %s\n", path); break;
+        case FS_FILE_USERABORT: fprintf(stderr, "aborted\n"); break;
+        case FS_FILE_WRITEERROR: fprintf(stderr, "cannot write %s\n", localName); break;
+        default:                fprintf(stderr, "cannot read %s (%d)\n", path, result); break;
+    }
+    return 1;
+}
+
+static int CmdCat(const char* path) {
+    char tempDir[MAX_PATH], tempFile[MAX_PATH];
+    char buf[65536];
+    size_t got;
+    FILE* f;
+    int rc;
+
+    GetTempPathA(MAX_PATH, tempDir);
+    if (!GetTempFileNameA(tempDir, "rwx", 0, tempFile)) {
+        fprintf(stderr, "cannot create a temporary file\n");
+        return 1;
+    }
+
+    rc = GetToFile(path, tempFile);
+    if (rc == 0) {
+        f = fopen(tempFile, "rb");
+        if (!f) {
+            rc = 1;
+        } else {
+            /* Text mode would turn every \n of the file into \r\n */
+            fflush(stdout);
+            _setmode(_fileno(stdout), _O_BINARY);
+            while ((got = fread(buf, 1, sizeof(buf), f)) > 0)
+                fwrite(buf, 1, got, stdout);
+            fclose(f);
+        }
+    }
+    DeleteFileA(tempFile);
+    return rc;
+}
+
+/* Year, month or day folder of [Browse] DateFolders=1: "2025", "2025-01"
+   or "2025-01-28" (snapshot names carry a time and an ID as well) */
+static BOOL IsDateFolder(const DirEntry* e) {
+    static const char pattern[] = "####-##-##";
+    int len = (int)strlen(e->name), i;
+
+    if (!e->isDirectory || (len != 4 && len != 7 && len != 10)) return FALSE;
+    for (i = 0; i < len; i++) {
+        if (pattern[i] == '#' ? (e->name[i] < '0' || e->name[i] > '9') : e->name[i] != pattern[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Load the snapshots listed in dir, newest first, while *todo is not 0
+   (negative = all). Date folders are walked down, newest first too. */
+static void WarmSnapshots(const char* dir, int* todo, int* warmed, int* failed) {
+    DirEntry* snaps;
+    int count = 0, i;
+
+    snaps = GetEntriesForPath(dir, &count);
+    /* Snapshot and date folders are listed oldest first */
+    for (i = count - 1; i >= 0 && *todo != 0 && !g_Abort; i--) {
+        char snapDir[MAX_PATH];
+        DirEntry* entries;
+        int n = 0;
+        double t0;
+
+        if (!IsRealDir(&snaps[i])) continue;
+        snprintf(snapDir, MAX_PATH, "%s\\%s", dir, snaps[i].name);
+        if (IsDateFolder(&snaps[i])) {
+            WarmSnapshots(snapDir, todo, warmed, failed);
+            continue;
+        }
+
+        if (*todo > 0) (*todo)--;
+        t0 = NowMs();
+        entries = GetEntriesForPath(snapDir, &n);
+        if (entries) (*warmed)++;
+        else (*failed)++;
+        free(entries);
+        if (g_Verbose)
+            fprintf(stderr, "%s  %d entries  %.0f ms\n", snapDir, n, NowMs() - t0);
+    }
+    free(snaps);
+}
+
+/* Load the newest `latest` snapshots (0 = all) of one backup path.
+   Listing a snapshot root fetches and caches the whole snapshot. */
+static void WarmBackupPath(const char* pathDir, int latest, int* warmed, int* failed) {
+    int todo = (latest > 0) ? latest : -1;
+    WarmSnapshots(pathDir, &todo, warmed, failed);
+}
+
+static int CmdWarm(const char* path, int latest) {
+    int warmed = 0, failed = 0;
+
+    if (strchr(path + 1, '\\')) {
+        /* One backup path: \Repo\Path */
+        WarmBackupPath(path, latest, &warmed, &failed);
+    } else {
+        DirEntry* paths;
+        int count = 0, i;
+
+        paths = GetEntriesForPath(path, &count);
+        if (!paths) {
+            fprintf(stderr, "cannot list %s\n", path);
+            return 1;
+        }
+        for (i = 0; i < count && !g_Abort; i++) {
+            char pathDir[MAX_PATH];
+            if (!IsRealDir(&paths[i])) continue;
+            snprintf(pathDir, MAX_PATH, "%s\\%s", path, paths[i].name);
+            WarmBackupPath(pathDir, latest, &warmed, &failed);
+        }
+        free(paths);
+    }
+
+    fprintf(stderr, "%d snapshots warmed, %d failed\n", warmed, failed);
+    return (failed > 0 || g_Abort) ? 1 : 0;
+}
+
+static int CmdFields(const char* path) {
+    int i;
+    for (i = 0; i < CLI_FIELD_MAX; i++) {
+        char name[MAX_PATH], units[MAX_PATH];
+        char value[1024];
+        int type = FsContentGetSupportedField(i, name, units, MAX_PATH);
+
+        if (type == ft_nomorefields) break;
+        memset(value, 0, sizeof(value));
+        type = FsContentGetValue((char*)path, i, 0, value, sizeof(value), 0);
+        switch (type) {
+            case ft_string:
+                printf("%-22s %s\n", name, value);
+                break;
+            case ft_numeric_32:
+                printf("%-22s %ld\n", name, (long)*(int*)value);
+                break;
+            case ft_numeric_64:
+                printf("%-22s %lld\n", name, (long long)*(LONGLONG*)value);
+                break;
+            default:
+                printf("%-22s\n", name);
+                break;
+        }
+    }
+    return 0;
+}
+
+static int Usage(void) {
+    fprintf(stderr,
+            "usage: restic-wfx-cli [-v] [--time] <command> ...\n"
+            "  ls <path>                      list a directory\n"
+            "  get <path> <local file>        copy a file out\n"
+            "  cat <path>                     print a file to stdout\n"
+            "  warm <repo>[\\<backup path>] [--latest N]\n"
+            "                                 load snapshot listings into the cache\n"
+            "  fields <path>                  print the content column values\n"
+            "Paths are plugin paths, e.g. MyRepo\\C_Users_me\\<snapshot>\\docs\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    char path[MAX_PATH];
+    const char* cmd;
+    BOOL showTime = FALSE;
+    DWORD mode;
+    double t0;
+    int i = 1, rc;
+
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-v") == 0) g_Verbose = TRUE;
+        else if (strcmp(argv[i], "--time") == 0) showTime = TRUE;
+        else return Usage();
+    }
+    if (i + 1 >= argc) return Usage();
+    cmd = argv[i++];
+    ToPluginPath(argv[i++], path, MAX_PATH);
+
+    g_ShowProgress = GetConsoleMode(GetStdHandle(STD_ERROR_HANDLE), &mode);
+    SetConsoleCtrlHandler(CtrlHandler, TRUE);
+
+    FsInit(1, CliProgress, CliLog, CliRequest);
+    t0 = NowMs();
+
+    if (strcmp(cmd, "ls") == 0 && i == argc) {
+        rc = CmdLs(path);
+    } else if (strcmp(cmd, "get") == 0 && i + 1 == argc) {
+        rc = GetToFile(path, argv[i]);
+    } else if (strcmp(cmd, "cat") == 0 && i == argc) {
+        g_ShowProgress = FALSE;
+        rc = CmdCat(path);
+    } else if (strcmp(cmd, "warm") == 0) {
+        int latest = 0;
+        if (i + 1 < argc && strcmp(argv[i], "--latest") == 0) {
+            latest = atoi(argv[i + 1]);
+            i += 2;
+        }
+        rc = (i == argc) ? CmdWarm(path, latest) : Usage();
+    } else if (strcmp(cmd, "fields") == 0 && i == argc) {
+        rc = CmdFields(path);
+    } else {
+        rc = Usage();
+    }
+
+    if (showTime)
+        fprintf(stderr, "%s: %.1f ms\n", cmd, NowMs() - t0);
+
+    /* Flushes the command log and releases the caches */
+    FsDisconnect("\\");
+    return rc;
+}